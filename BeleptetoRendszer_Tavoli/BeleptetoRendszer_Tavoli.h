@@ -12,6 +12,29 @@
 #ifndef BELEPTETORENDSZER_TAVOLI_H
 #define BELEPTETORENDSZER_TAVOLI_H
 
+#include <stdint.h>
+
+/**
+ * @defgroup RFID_TRANSPORT RFID reader transport
+ * @brief The host interface of the PN532, chosen at build time with #RFID_TRANSPORT.
+ *
+ * - #RFID_TRANSPORT_SWHSU: software serial on #RFID_RX_PIN and #RFID_TX_PIN.
+ * - #RFID_TRANSPORT_HSU: the hardware UART, swapped to GPIO13 (RX) and GPIO15 (TX). The relay and
+ *   the red LED move to the former software serial pins, and there is no debug output, since the
+ *   UART belongs to the reader.
+ * - #RFID_TRANSPORT_I2C: the I2C bus of the RTC and the EEPROM, the PN532 at address 0x24. The
+ *   interface selection pins of the reader have to be set to I2C.
+ * @{
+ */
+#define RFID_TRANSPORT_SWHSU 0
+#define RFID_TRANSPORT_HSU 1
+#define RFID_TRANSPORT_I2C 2
+
+#ifndef RFID_TRANSPORT
+#define RFID_TRANSPORT RFID_TRANSPORT_SWHSU
+#endif
+/** @} */
+
 /**
  * @defgroup PINOUT Pinout
  * @brief Pinout of the module.
@@ -23,18 +46,89 @@
 #define WAKEUP_PIN 16
 #define WAKEUP_PRESSED LOW
 
+#if RFID_TRANSPORT == RFID_TRANSPORT_HSU
+#define RELAY_SWITCH_PIN 4
+#else
 #define RELAY_SWITCH_PIN 15
+#endif
 #define RELAY_OFF LOW
 #define RELAY_ON HIGH
 
+#if RFID_TRANSPORT == RFID_TRANSPORT_HSU
+#define RFID_RX_PIN 13
+#define RFID_TX_PIN 15
+#else
 #define RFID_RX_PIN 4
 #define RFID_TX_PIN 5
+#endif
 #define RFID_IRQ_PIN 0
 
+#if RFID_TRANSPORT == RFID_TRANSPORT_HSU
+#define LED_RED_PIN 5
+#else
 #define LED_RED_PIN 13
+#endif
 #define LED_GREEN_PIN 12
 #define LED_ON LOW
 #define LED_OFF HIGH
 /** @} */
 
+/**
+ * @defgroup DOOR_CHANNELS Door channels
+ * @brief The readers of the module and the outputs they drive, one row of #DOOR_CHANNELS each.
+ *
+ * The readers are serviced in turn against the same table and door ID, and the logs tell the
+ * channel of their reader. Channels may share outputs, for example the entry and the exit reader
+ * of a door share its relay. A transport serves one reader, since the I2C address of the PN532 is
+ * fixed, and a reader on the hardware UART needs #RFID_TRANSPORT set to #RFID_TRANSPORT_HSU, which
+ * moves the pins and turns the debug output off. For example an entry reader on the hardware UART
+ * and an exit reader on I2C, its IRQ line on GPIO3 that the swapped UART frees:
+ * @code
+ * #define RFID_TRANSPORT RFID_TRANSPORT_HSU
+ * #define DOOR_CHANNELS {{RFID_TRANSPORT_HSU, 0, 4, 12, 5}, {RFID_TRANSPORT_I2C, 3, 4, 12, 5}}
+ * @endcode
+ * @{
+ */
+/**
+ * @brief A reader and the outputs that show its decisions.
+ */
+typedef struct _door_channel_t
+{
+    uint8_t transport;   /**< The host interface of the reader, see #RFID_TRANSPORT. */
+    uint8_t irqPin;      /**< The pin of the IRQ line of the reader. */
+    uint8_t relayPin;    /**< The relay that opens the door. */
+    uint8_t ledGreenPin; /**< The LED of the granted decisions. */
+    uint8_t ledRedPin;   /**< The LED of the denied decisions. */
+} door_channel_t;
+
+#define DOOR_CHANNEL_MAX 4
+
+#ifndef DOOR_CHANNELS
+#define DOOR_CHANNELS {{RFID_TRANSPORT, RFID_IRQ_PIN, RELAY_SWITCH_PIN, LED_GREEN_PIN, LED_RED_PIN}}
+#endif
+/** @} */
+
+/**
+ * @defgroup RTC_MEMORY RTC user memory layout
+ * @brief Offsets of the data kept in the RTC user memory, in 4 byte blocks.
+ * @note The RTC user memory keeps its content across resets and deep sleep, but not across power
+ * loss, so every entry is protected by a CRC.
+ * @{
+ */
+#define RTC_MEMORY_WIFI_CACHE_OFFSET 0
+#define RTC_MEMORY_WIFI_CACHE_BLOCKS 8
+#define RTC_MEMORY_POWER_STATE_OFFSET 8
+#define RTC_MEMORY_POWER_STATE_BLOCKS 12
+#define RTC_MEMORY_LOOP_STATE_OFFSET 20
+#define RTC_MEMORY_LOOP_STATE_BLOCKS 8
+#define RTC_MEMORY_SYNC_STATE_OFFSET 28
+#define RTC_MEMORY_SYNC_STATE_BLOCKS 8
+#define RTC_MEMORY_AUTHENTICATE_INDEX_OFFSET 36
+#define RTC_MEMORY_AUTHENTICATE_INDEX_BLOCKS 38
+#define RTC_MEMORY_REVOCATION_OFFSET 74
+#define RTC_MEMORY_REVOCATION_BLOCKS 36
+#define RTC_MEMORY_CLOCK_STATE_OFFSET 110
+#define RTC_MEMORY_CLOCK_STATE_BLOCKS 4
+/** @} */
+
 #endif /* BELEPTETORENDSZER_TAVOLI_H */
@@ -23,11 +23,25 @@
 #include "authenticate_log.h"
 #include "timers.h"
 #include "rtc.h"
-#include "WifiModemWakeupSleep.hpp"
+#include "sync.h"
+#include "revocation.h"
+#include "credential.h"
+#include "power.h"
+#include "crc32.h"
+#include "scheduler.h"
+#include "decision_cache.h"
+
+#ifndef DEBUG
+#define DEBUG 0
+#endif
 
+#if RFID_TRANSPORT == RFID_TRANSPORT_HSU
+// The hardware UART belongs to the reader
+#undef DEBUG
 #define DEBUG 0
+#endif
 
-#ifdef DEBUG
+#if DEBUG
 #define DEBUG_PRINT(str) Serial.print(str)
 #else
 #define DEBUG_PRINT(str)
@@ -35,30 +49,214 @@
 
 #define ACTIVE_TIME_MS 15000
 #define SLEEP_TIME_MS 1000
-#define WIFI_ACTIVE_HOUR 1
+#define ACTIVE_POLL_MS 20
+#define SCHEDULE_CHECK_MS 1000
+#define DEEP_SLEEP_MIN_S 30
+#define LOG_PUSH_THRESHOLD_PERCENT 50
+#define LOG_PUSH_RETRY_MS (10UL * 60UL * 1000UL)
+
+/**
+ * @defgroup task_budgets Task budgets
+ * @brief The longest step of each task of the loop, in microseconds.
+ * @{
+ */
+#define TASK_TIMERS_BUDGET_US 1000UL
+#define TASK_RFID_BUDGET_US 100000UL
+#define TASK_EEPROM_BUDGET_US 5000UL
+#define TASK_CLOCK_BUDGET_US 2000UL
+#define TASK_DECISIONS_BUDGET_US 10000UL
+#define TASK_SYNC_BUDGET_US 50000UL
+#define TASK_SCHEDULE_BUDGET_US 5000UL
+#define TASK_STATS_BUDGET_US 10000UL
+/** @} */
+
+/**
+ * @brief The value of #statsLine when there are no statistics to print.
+ */
+#define STATS_LINE_NONE 0xFF
+
+#if CREDENTIAL_SIZE != RFID_CREDENTIAL_BLOCKS * 16
+#error "The credential does not fit in the credential blocks of the card"
+#endif
 
 unsigned long activityCounter = 0;
 
-static uint8_t temporary_image[EEPROM_SIZE / 2];
+/**
+ * @brief The channels of the module: the readers and the outputs they drive.
+ */
+static const door_channel_t doorChannels[] = DOOR_CHANNELS;
+
+#define DOOR_CHANNEL_COUNT ((uint8_t)(sizeof(doorChannels) / sizeof(doorChannels[0])))
+
+/**
+ * @brief The maximum number of outputs, the channels may share them.
+ */
+#define IO_OUTPUT_MAX (3 * DOOR_CHANNEL_MAX)
+
+/**
+ * @brief An LED or relay output, switched on while it has a user.
+ */
+typedef struct _io_output_t
+{
+    uint8_t pin;           /**< The pin of the output. */
+    uint8_t onLevel;       /**< The level that switches the output on. */
+    uint32_t count;        /**< The number of the users of the output. */
+    timer_handle_t handle; /**< The timer that switches the output off. */
+    bool timed;            /**< True if the timer is a user of the output. */
+} io_output_t;
+
+/**
+ * @brief The outputs of the channels, every pin once.
+ */
+static io_output_t ioOutputs[IO_OUTPUT_MAX];
+
+/**
+ * @brief The number of used entries of #ioOutputs.
+ */
+static uint8_t ioOutputCount = 0;
+
+/**
+ * @brief True if the red LED is on because of the running synchronization.
+ */
+static bool syncLedOn = false;
+
+/**
+ * @brief True if the RTC works, the deep sleep needs its timer.
+ */
+static bool rtcReady = false;
+
+/**
+ * @defgroup loop_state Loop state
+ * @brief State of the main loop, saved in the RTC user memory during the deep sleep.
+ * @{
+ */
+/** @brief True if there is user activity. */
+static bool isActive = false;
+/** @brief Value of TIMERS_Millis() when the wakeup button was last pressed. */
+static unsigned long activeMillis = 0;
+/** @brief True if the logs were pushed early. */
+static bool logsPushed = false;
+/** @brief Value of TIMERS_Millis() when the logs were last pushed early. */
+static unsigned long logsPushMillis = 0;
+/** @} */
+
+/**
+ * @brief The loop state saved in the RTC user memory.
+ */
+typedef struct _loop_state_t
+{
+    uint32_t crc;             /**< CRC-32 of the rest of the structure. */
+    uint32_t activityCounter; /**< See #activityCounter. */
+    uint32_t logsPushMillis;  /**< See #logsPushMillis. */
+    uint8_t logsPushed;       /**< See #logsPushed. */
+} loop_state_t;
+
+static_assert(sizeof(loop_state_t) <= RTC_MEMORY_LOOP_STATE_BLOCKS * 4,
+              "The loop state does not fit in its RTC user memory area");
+
+/**
+ * @brief True until the first decision after a wakeup from deep sleep, for its latency.
+ */
+static bool firstDecisionPending = false;
+
+/**
+ * @brief The time from the last wakeup from deep sleep to the first decision, in milliseconds.
+ */
+static unsigned long wakeupDecisionMillis = 0;
+
+/**
+ * @brief Value of TIMERS_Millis() when the reader of each channel was last started or read.
+ */
+static unsigned long rfidPollMillis[DOOR_CHANNEL_MAX] = {0};
+
+/**
+ * @brief The channel whose reader is serviced first on the next run of the rfid task.
+ */
+static uint8_t rfidNextChannel = 0;
+
+/**
+ * @brief True once the sync schedule was checked.
+ */
+static bool scheduleChecked = false;
+
+/**
+ * @brief Value of TIMERS_Millis() when the sync schedule was last checked.
+ */
+static unsigned long scheduleCheckMillis = 0;
+
+#if DEBUG
+/**
+ * @brief The next line of the statistics printed by the stats task, #STATS_LINE_NONE if there is
+ * nothing to print.
+ */
+static uint8_t statsLine = STATS_LINE_NONE;
+#endif /* DEBUG */
 
 void ioPinsInit(void);
+void ioOutputAdd(uint8_t pin, uint8_t onLevel);
+void ioPinRegister(uint8_t pin, bool increment);
 void ioPinOn(uint8_t pin, unsigned long millis_interval);
-
-void ioLedRedRegister(bool increment);
-void ioLedGreenRegister(bool increment);
+void ioPinsOff(unsigned long millis_real_period);
+void ioLedsRedRegister(bool increment);
 
 bool checkActivity(void);
-bool checkWiFiActivity(void);
+bool checkLogPushActivity(void);
+void waitForEvent(bool active);
+void enterDeepSleep(void);
+uint32_t loopStateCrc(const loop_state_t *state);
+void loopStateSave(void);
+bool loopStateLoad(void);
+
+void startSync(sync_mode_t mode);
+void handleSync(void);
+void handleRFID(uint8_t channel);
+bool authenticateCard(const uint8_t *uid, unixtime_t time);
+
+bool timersTaskReady(void);
+void timersTaskRun(void);
+bool rfidChannelReady(uint8_t channel);
+bool rfidTaskReady(void);
+void rfidTaskRun(void);
+bool eepromTaskReady(void);
+void eepromTaskRun(void);
+bool clockTaskReady(void);
+bool decisionsTaskReady(void);
+void decisionsTaskRun(void);
+bool syncTaskReady(void);
+bool scheduleTaskReady(void);
+void scheduleTaskRun(void);
+#if DEBUG
+bool statsTaskReady(void);
+void statsTaskRun(void);
+bool printStatsLine(uint8_t line);
+void printTaskStats(uint8_t index);
+#endif /* DEBUG */
 
-void handleWiFi(void);
-void handleRFID(void);
+/**
+ * @brief The tasks of the loop, the first is the most important.
+ * @note The timers switch the LEDs and the relay, and the reader decides at the door, so they go
+ * before the background work. The sync is paused during user activity. The statistics of a debug
+ * build are printed last, as the UART blocks once its FIFO is full.
+ */
+static const scheduler_task_t loopTasks[] = {
+    {"timers", timersTaskReady, timersTaskRun, TASK_TIMERS_BUDGET_US},
+    {"rfid", rfidTaskReady, rfidTaskRun, TASK_RFID_BUDGET_US},
+    {"eeprom", eepromTaskReady, eepromTaskRun, TASK_EEPROM_BUDGET_US},
+    {"clock", clockTaskReady, RTC_Resync, TASK_CLOCK_BUDGET_US},
+    {"decisions", decisionsTaskReady, decisionsTaskRun, TASK_DECISIONS_BUDGET_US},
+    {"sync", syncTaskReady, handleSync, TASK_SYNC_BUDGET_US},
+    {"schedule", scheduleTaskReady, scheduleTaskRun, TASK_SCHEDULE_BUDGET_US},
+#if DEBUG
+    {"stats", statsTaskReady, statsTaskRun, TASK_STATS_BUDGET_US},
+#endif /* DEBUG */
+};
 
 /**
  * @brief Arduino setup function.
  */
 void setup(void)
 {
-#ifdef DEBUG
+#if DEBUG
     Serial.begin(115200);
     delay(10);
     Serial.println();
@@ -70,9 +268,13 @@ void setup(void)
 
     Wire.begin(I2C_SDA_PIN, I2C_SCL_PIN);
 
+    // The reader wakes up while the RTC and the index are read
+    RFID_WakeUp();
+
     EEPROM_Init();
 
-    if (!RTC_Init())
+    rtcReady = RTC_Init();
+    if (!rtcReady)
     {
         DEBUG_PRINT("RTC init failed.\r\n");
     }
@@ -83,16 +285,50 @@ void setup(void)
         DEBUG_PRINT("\r\n");
     }
 
-    if (!RFID_Init())
+    AUTHENTICATE_LOG_Init();
+    REVOCATION_Init();
+
+    for (uint8_t channel = 0; channel < DOOR_CHANNEL_COUNT; channel++)
     {
-        DEBUG_PRINT("RFID init failed.\r\n");
+        if (!RFID_Init(channel))
+        {
+            DEBUG_PRINT("RFID init failed on channel ");
+            DEBUG_PRINT(channel);
+            DEBUG_PRINT("\r\n");
+        }
     }
 
-    AUTHENTICATE_LOG_Init();
+    // The first sync is started by the schedule shortly after boot
+    SYNC_Init();
+
+    SCHEDULER_Init(loopTasks, sizeof(loopTasks) / sizeof(loopTasks[0]));
+
+#if POWER_DEEP_SLEEP_ENABLED
+    if (rtcReady)
+    {
+        unixtime_t time = RTC_GetTime();
+        power_wakeup_t wakeup = POWER_Resume(time);
+        if (wakeup != POWER_WAKEUP_RESET)
+        {
+            // Continue where the module went to sleep, the sync after boot is not repeated
+            SYNC_Resume(time);
+            loopStateLoad();
+        }
+        if (wakeup == POWER_WAKEUP_BUTTON)
+        {
+            // The button may be released already, start the activity without it
+            isActive = true;
+            activeMillis = TIMERS_Millis();
+            firstDecisionPending = true;
+        }
+    }
+#endif
 
-    ioLedRedRegister(true);
-    handleWiFi();
-    ioLedRedRegister(false);
+    if (!isActive)
+    {
+        // The RF field is only needed during user activity
+        RFID_PowerDown();
+    }
 }
 
 /**
@@ -100,28 +336,331 @@ void setup(void)
  */
 void loop(void)
 {
-    // Always handle the timers
-    TIMERS_HandleEvents(millis());
+    bool active = checkActivity();
+
+    if (SCHEDULER_RunOnce())
+    {
+        // Return after every step, so the WiFi stack runs between them
+        return;
+    }
+
+    waitForEvent(active);
+}
+
+/**
+ * @brief Check if a timer event is due.
+ * @return True if a timer event is due, false otherwise.
+ */
+bool timersTaskReady(void)
+{
+    unsigned long timerMillis;
+    return TIMERS_GetNextDeadline(TIMERS_Millis(), &timerMillis) && (timerMillis == 0);
+}
+
+/**
+ * @brief Handle the due timer events.
+ */
+void timersTaskRun(void)
+{
+    TIMERS_HandleEvents(TIMERS_Millis());
+}
+
+/**
+ * @brief Check if the reader of a channel needs attention.
+ * @param channel The index of the channel.
+ * @return True if the reader found a tag, or if the reader is awake, does not search and
+ * #ACTIVE_POLL_MS passed since its last tag, false otherwise.
+ */
+bool rfidChannelReady(uint8_t channel)
+{
+    if (RFID_IsDetecting(channel))
+    {
+        return RFID_IsTagDetected(channel);
+    }
+    return RFID_IsAwake(channel) && ((TIMERS_Millis() - rfidPollMillis[channel]) >= ACTIVE_POLL_MS);
+}
+
+/**
+ * @brief Check if a reader needs attention.
+ * @return True during user activity if the reader of a channel needs attention, false otherwise.
+ */
+bool rfidTaskReady(void)
+{
+    if (!isActive)
+    {
+        return false;
+    }
+    for (uint8_t channel = 0; channel < DOOR_CHANNEL_COUNT; channel++)
+    {
+        if (rfidChannelReady(channel))
+        {
+            return true;
+        }
+    }
+    return false;
+}
 
-    if (checkActivity())
+/**
+ * @brief Start the search for a tag, or decide on the tag found, on one channel.
+ * @note The channels are serviced in turn, starting after the last serviced one, so a busy reader
+ * does not hold back the others.
+ */
+void rfidTaskRun(void)
+{
+    for (uint8_t i = 0; i < DOOR_CHANNEL_COUNT; i++)
     {
+        uint8_t channel = (rfidNextChannel + i) % DOOR_CHANNEL_COUNT;
+        if (!rfidChannelReady(channel))
+        {
+            continue;
+        }
+        rfidNextChannel = (channel + 1) % DOOR_CHANNEL_COUNT;
+
         DEBUG_PRINT("Active\r\n");
-        // If there is user activity, handle the RFID authentication
-        handleRFID();
+        if (!RFID_IsDetecting(channel))
+        {
+            rfidPollMillis[channel] = TIMERS_Millis();
+            RFID_StartDetection(channel);
+            return;
+        }
+        handleRFID(channel);
+        // The next search starts after a pause, the same tag is likely still in the field
+        rfidPollMillis[channel] = TIMERS_Millis();
+        return;
     }
-    else
+}
+
+/**
+ * @brief Check if the next committed page of the EEPROM can be written.
+ * @return True if a page is waiting and the EEPROM is ready, false otherwise.
+ */
+bool eepromTaskReady(void)
+{
+    return EEPROM_MemoryImage_IsCommitReady();
+}
+
+/**
+ * @brief Write the next committed page of the EEPROM.
+ */
+void eepromTaskRun(void)
+{
+    EEPROM_MemoryImage_CommitStep();
+}
+
+/**
+ * @brief Check if the software clock has to read the RTC.
+ * @return True if a read is due, there is no user activity and no committed EEPROM page waits,
+ * false otherwise.
+ * @note The read shares the I2C bus with the EEPROM, so it waits for the commit.
+ */
+bool clockTaskReady(void)
+{
+    return !isActive && !EEPROM_MemoryImage_IsCommitPending() && RTC_IsResyncDue();
+}
+
+/**
+ * @brief Check if the counted repeats of a card have to be logged.
+ * @return True if a summary log is due, false otherwise.
+ */
+bool decisionsTaskReady(void)
+{
+    return DECISION_CACHE_IsSummaryDue(TIMERS_Millis());
+}
+
+/**
+ * @brief Log the counted repeats that are due.
+ */
+void decisionsTaskRun(void)
+{
+    DECISION_CACHE_WriteDueSummaries(TIMERS_Millis());
+}
+
+/**
+ * @brief Check if the synchronization has to be advanced.
+ * @return True if a synchronization is running and there is no user activity, false otherwise.
+ */
+bool syncTaskReady(void)
+{
+    return !isActive && SYNC_IsActive();
+}
+
+/**
+ * @brief Check if the sync schedule has to be checked.
+ * @return True at most once every #SCHEDULE_CHECK_MS without user activity and synchronization,
+ * false otherwise.
+ * @note The schedule has a resolution of seconds, so the RTC is not read on every wakeup.
+ */
+bool scheduleTaskReady(void)
+{
+    if (isActive || SYNC_IsActive())
     {
-        // Only communicate with the central module if there is no user activity
-        if (checkWiFiActivity())
+        return false;
+    }
+    return !scheduleChecked || ((TIMERS_Millis() - scheduleCheckMillis) >= SCHEDULE_CHECK_MS);
+}
+
+/**
+ * @brief Start the synchronization that is due, if any.
+ */
+void scheduleTaskRun(void)
+{
+    scheduleChecked = true;
+    scheduleCheckMillis = TIMERS_Millis();
+
+    if (SYNC_IsScheduled(RTC_GetTime()))
+    {
+        startSync(SYNC_MODE_FULL);
+    }
+    else if (checkLogPushActivity())
+    {
+        // Push the logs early, before the log area fills up
+        startSync(SYNC_MODE_LOGS);
+    }
+    else if (SYNC_IsProbeDue())
+    {
+        // Pick up the cards revoked since the last probe
+        startSync(SYNC_MODE_REVOCATION);
+    }
+}
+
+/**
+ * @brief Wait for the next event the loop has to handle.
+ * @param active True if there is user activity.
+ * @note During user activity the module waits for the tag or the next search of the reader, while
+ * a committed page of the EEPROM waits for the write cycle. Otherwise the module light sleeps until
+ * the next timer event, the wakeup button or the interrupt of the reader, but at most
+ * #SLEEP_TIME_MS.
+ */
+void waitForEvent(bool active)
+{
+    unsigned long timerMillis;
+    bool timerPending = TIMERS_GetNextDeadline(TIMERS_Millis(), &timerMillis);
+
+    if (EEPROM_MemoryImage_IsCommitPending())
+    {
+        // The write cycle of the page ends within a few milliseconds
+        delay(1);
+        return;
+    }
+
+    if (active)
+    {
+        // While a reader wakes up or searches, it is checked every millisecond. The light sleep
+        // would lose the response, since the software serial port does not receive in it.
+        unsigned long pollMillis = ACTIVE_POLL_MS;
+        for (uint8_t channel = 0; channel < DOOR_CHANNEL_COUNT; channel++)
+        {
+            unsigned long channelMillis = 1;
+            if (!RFID_IsDetecting(channel) && RFID_IsAwake(channel))
+            {
+                channelMillis = ACTIVE_POLL_MS - (TIMERS_Millis() - rfidPollMillis[channel]);
+            }
+            if (channelMillis > ACTIVE_POLL_MS)
+            {
+                channelMillis = 0;
+            }
+            if (channelMillis < pollMillis)
+            {
+                pollMillis = channelMillis;
+            }
+        }
+        if (timerPending && (timerMillis < pollMillis))
         {
-            ioLedRedRegister(true);
-            handleWiFi();
-            ioLedRedRegister(false);
+            pollMillis = timerMillis;
         }
+        delay(pollMillis);
+        return;
+    }
+
+    unsigned long sleepMillis = SLEEP_TIME_MS;
+    if (timerPending && (timerMillis < sleepMillis))
+    {
+        sleepMillis = timerMillis;
+    }
+
+#if POWER_DEEP_SLEEP_ENABLED
+    static unsigned long deepSleepCheckMillis = 0;
+    if (!timerPending && rtcReady &&
+        ((TIMERS_Millis() - deepSleepCheckMillis) >= SCHEDULE_CHECK_MS))
+    {
+        // Does not return if the next synchronization is far enough
+        deepSleepCheckMillis = TIMERS_Millis();
+        enterDeepSleep();
+    }
+#endif
+
+    POWER_Sleep(sleepMillis);
+}
+
+/**
+ * @brief Go to deep sleep until the next synchronization, if it is at least #DEEP_SLEEP_MIN_S
+ * away.
+ * @note The LEDs and the relay have to be off, since the outputs are not driven in deep sleep.
+ */
+void enterDeepSleep(void)
+{
+    unixtime_t time = RTC_GetTime();
+    unixtime_t wakeTime = SYNC_GetNextWakeTime(time);
+    if (wakeTime < time + DEEP_SLEEP_MIN_S)
+    {
+        return;
+    }
+
+    DEBUG_PRINT("Deep sleep s: ");
+    DEBUG_PRINT(wakeTime - time);
+    DEBUG_PRINT("\r\n");
+
+    SYNC_Suspend(time);
+    RTC_Suspend();
+    loopStateSave();
+    // The cache of the decisions is lost in the deep sleep
+    DECISION_CACHE_WriteSummaries();
+    EEPROM_MemoryImage_Flush();
+    POWER_DeepSleep(time, wakeTime);
+}
+
+/**
+ * @brief Calculate the CRC of the saved loop state.
+ * @param state The saved loop state.
+ * @return The CRC of every field after the CRC.
+ */
+uint32_t loopStateCrc(const loop_state_t *state)
+{
+    const uint8_t *data = (const uint8_t *)state + sizeof(state->crc);
+    return CRC32_Final(CRC32_Update(CRC32_Init(), data, sizeof(*state) - sizeof(state->crc)));
+}
+
+/**
+ * @brief Save the loop state to the RTC user memory before the deep sleep.
+ */
+void loopStateSave(void)
+{
+    loop_state_t state;
+    memset(&state, 0, sizeof(state));
+    state.activityCounter = activityCounter;
+    state.logsPushMillis = logsPushMillis;
+    state.logsPushed = logsPushed;
+    state.crc = loopStateCrc(&state);
+    ESP.rtcUserMemoryWrite(RTC_MEMORY_LOOP_STATE_OFFSET, (uint32_t *)&state, sizeof(state));
+}
+
+/**
+ * @brief Restore the loop state from the RTC user memory after the deep sleep.
+ * @return True if the state was restored, false otherwise.
+ */
+bool loopStateLoad(void)
+{
+    loop_state_t state;
+    if (!ESP.rtcUserMemoryRead(RTC_MEMORY_LOOP_STATE_OFFSET, (uint32_t *)&state, sizeof(state)) ||
+        (state.crc != loopStateCrc(&state)))
+    {
+        return false;
     }
 
-    // Go to sleep
-    delay(SLEEP_TIME_MS);
+    activityCounter = state.activityCounter;
+    logsPushMillis = state.logsPushMillis;
+    logsPushed = state.logsPushed;
+    return true;
 }
 
 /**
@@ -130,272 +669,509 @@ void loop(void)
  */
 bool checkActivity(void)
 {
-    static unsigned long startMillis = 0;
-    static bool isActive = false;
-
     // Check if the wakeup button is pressed
     if (digitalRead(WAKEUP_PIN) == WAKEUP_PRESSED)
     {
-        // Put the module to active state and start the timer
+        // Put the module to active state and start the timer, the readers wake up meanwhile
+        RFID_WakeUp();
         isActive = true;
-        startMillis = millis();
+        activeMillis = TIMERS_Millis();
     }
-    else if (isActive && ((millis() - startMillis) > ACTIVE_TIME_MS))
+    else if (isActive && ((TIMERS_Millis() - activeMillis) > ACTIVE_TIME_MS))
     {
-        // If the timer is over, put the module to inactive state
+        // If the timer is over, put the module to inactive state, and the readers to power-down
         isActive = false;
         activityCounter++;
+        RFID_PowerDown();
     }
 
     return isActive;
 }
 
 /**
- * @brief Handle the WiFi connection and communication.
+ * @brief Start a synchronization with the central module.
+ * @param mode The kind of the synchronization.
+ * @note The red LEDs are on during the full synchronization.
  */
-void handleWiFi(void)
+void startSync(sync_mode_t mode)
 {
-    // Create a WifiModemWakeupSleep object to handle modem wakeup and sleep
-    WifiModemWakeupSleep wifiModemController(WiFi);
-
-    if (!WIFI_Connect())
+    if (SYNC_IsActive())
     {
-        DEBUG_PRINT("WiFi connection failed\r\n");
         return;
     }
 
-    WiFiClient client;
-    client.setTimeout(30000);
+    // The counted repeats go up with the logs
+    DECISION_CACHE_WriteSummaries();
 
-    if (!WIFI_ClientSendMemory(client, EEPROM_GetMemoryImage(), EEPROM_GetSize()))
+    syncLedOn = (mode == SYNC_MODE_FULL);
+    if (syncLedOn)
     {
-        DEBUG_PRINT("Sending memory failed\r\n");
-        return;
+        ioLedsRedRegister(true);
     }
+    SYNC_Start(mode);
+}
 
-    if (!WIFI_ClientRequestNewMemory(client, temporary_image, sizeof(temporary_image)))
+/**
+ * @brief Advance the synchronization with the central module by one step.
+ */
+void handleSync(void)
+{
+    if (SYNC_Step())
     {
-        DEBUG_PRINT("Requesting new memory failed\r\n");
         return;
     }
-    EEPROM_Write(0, temporary_image, sizeof(temporary_image));
-    AUTHENTICATE_LOG_ClearLogs();
-    EEPROM_MemoryImage_Commit();
 
-    uint32_t time = 0;
-    if (!WIFI_ClientRequestTime(client, &time))
+#if DEBUG
+    // The statistics are printed by the stats task, a line per step
+    statsLine = 0;
+#endif /* DEBUG */
+
+    if (syncLedOn)
     {
-        DEBUG_PRINT("Requesting time failed\r\n");
-        return;
+        syncLedOn = false;
+        ioLedsRedRegister(false);
     }
-    RTC_SetTime(time);
 }
 
+#if DEBUG
 /**
- * @brief Check if it is time for WiFi activity.
- * @return True if it is time for WiFi activity, false otherwise.
+ * @brief Check if statistics are waiting to be printed.
+ * @return True if a line is waiting and there is no user activity, false otherwise.
  */
-bool checkWiFiActivity(void)
+bool statsTaskReady(void)
 {
-    static bool wifi_activated = false;
+    return !isActive && (statsLine != STATS_LINE_NONE);
+}
 
-    // Get current time
-    unixtime_t time = RTC_GetTime();
-    unixtime_t hour_of_day = UNIXTIME_TO_HOUR_OF_DAY(time);
+/**
+ * @brief Print the next line of the statistics.
+ */
+void statsTaskRun(void)
+{
+    statsLine = printStatsLine(statsLine) ? (statsLine + 1) : STATS_LINE_NONE;
+}
 
-    if ((!wifi_activated) && (hour_of_day == WIFI_ACTIVE_HOUR))
+/**
+ * @brief Print a line of the statistics of the finished synchronization and of the loop.
+ * @param line The index of the line.
+ * @return True if more lines follow, false otherwise.
+ * @note A line is about as long as the FIFO of the UART, so printing it does not block for long.
+ */
+bool printStatsLine(uint8_t line)
+{
+    if (line == 0)
+    {
+        wifi_connect_stats_t stats;
+        WIFI_GetConnectStats(&stats);
+        DEBUG_PRINT("Sync finished, WiFi connect ms: ");
+        DEBUG_PRINT(stats.lastConnectMillis);
+        DEBUG_PRINT(", fast connect hits: ");
+        DEBUG_PRINT(stats.fastHits);
+        DEBUG_PRINT("/");
+        DEBUG_PRINT(stats.fastAttempts);
+        DEBUG_PRINT("\r\n");
+        return true;
+    }
+    if (line == 1)
+    {
+        sync_stats_t sync_stats;
+        SYNC_GetStats(&sync_stats);
+        DEBUG_PRINT(sync_stats.resumed ? "Resumed" : "Full");
+        DEBUG_PRINT(" handshake us: ");
+        DEBUG_PRINT(sync_stats.handshakeMicros);
+        DEBUG_PRINT(", crypto us: ");
+        DEBUG_PRINT(sync_stats.cryptoMicros);
+        DEBUG_PRINT(" for bytes: ");
+        DEBUG_PRINT(sync_stats.cryptoBytes);
+        DEBUG_PRINT("\r\n");
+        return true;
+    }
+    if (line == 2)
+    {
+        power_stats_t power_stats;
+        POWER_GetStats(&power_stats);
+        DEBUG_PRINT("Light sleeps: ");
+        DEBUG_PRINT(power_stats.sleepCount);
+        DEBUG_PRINT(", ms: ");
+        DEBUG_PRINT(power_stats.sleepMillis);
+        DEBUG_PRINT(", pin wakeups: ");
+        DEBUG_PRINT(power_stats.pinWakeups);
+        DEBUG_PRINT(", deep sleeps: ");
+        DEBUG_PRINT(power_stats.deepSleepCount);
+        DEBUG_PRINT(", s: ");
+        DEBUG_PRINT(power_stats.deepSleepSeconds);
+        DEBUG_PRINT(", average uA: ");
+        DEBUG_PRINT(power_stats.averageMicroamps);
+        DEBUG_PRINT(", wakeup to decision ms: ");
+        DEBUG_PRINT(wakeupDecisionMillis);
+        DEBUG_PRINT("\r\n");
+        return true;
+    }
+    if (line == 3)
     {
-        // WiFi was not activated in this hour and it is time for communication with the central
-        // module
-        wifi_activated = true;
+        rtc_clock_stats_t clock_stats;
+        RTC_GetClockStats(&clock_stats);
+        DEBUG_PRINT("RTC reads: ");
+        DEBUG_PRINT(clock_stats.reads);
+        DEBUG_PRINT(", corrections: ");
+        DEBUG_PRINT(clock_stats.corrections);
+        DEBUG_PRINT(", last ms: ");
+        DEBUG_PRINT(clock_stats.lastCorrectionMillis);
+        DEBUG_PRINT(", drift ppm: ");
+        DEBUG_PRINT(clock_stats.driftPpm);
+        DEBUG_PRINT("\r\n");
         return true;
     }
-    else if ((wifi_activated) && (hour_of_day != WIFI_ACTIVE_HOUR))
+    if (line == 4)
     {
-        // WiFi was activated in the last hour and it is no longer the time for WiFi activity
-        wifi_activated = false;
+        decision_cache_stats_t decision_stats;
+        DECISION_CACHE_GetStats(&decision_stats);
+        DEBUG_PRINT("Lingering reads: ");
+        DEBUG_PRINT(decision_stats.lingering);
+        DEBUG_PRINT(", repeats: ");
+        DEBUG_PRINT(decision_stats.repeats);
+        DEBUG_PRINT(", summaries: ");
+        DEBUG_PRINT(decision_stats.summaries);
+        DEBUG_PRINT(", evictions: ");
+        DEBUG_PRINT(decision_stats.evictions);
+        DEBUG_PRINT("\r\n");
+        return true;
     }
 
+    // A line for each channel, then for each task
+    line -= 5;
+    if (line < DOOR_CHANNEL_COUNT)
+    {
+        rfid_stats_t rfid_stats;
+        RFID_GetStats(line, &rfid_stats);
+        DEBUG_PRINT("RFID ");
+        DEBUG_PRINT(line);
+        DEBUG_PRINT(" tags: ");
+        DEBUG_PRINT(rfid_stats.tags);
+        DEBUG_PRINT(", frame errors: ");
+        DEBUG_PRINT(rfid_stats.frameErrors);
+        DEBUG_PRINT(", us per tag: ");
+        DEBUG_PRINT((rfid_stats.tags > 0) ? (rfid_stats.totalReadMicros / rfid_stats.tags) : 0);
+        DEBUG_PRINT(", max IRQ to UID us: ");
+        DEBUG_PRINT(rfid_stats.maxIrqToUidMicros);
+        DEBUG_PRINT("\r\n");
+        return true;
+    }
+    line -= DOOR_CHANNEL_COUNT;
+    if (line < SCHEDULER_GetTaskCount())
+    {
+        printTaskStats(line);
+        return (line + 1) < SCHEDULER_GetTaskCount();
+    }
     return false;
 }
 
 /**
- * @brief Handle the RFID authentication.
+ * @brief Print the statistics of a task of the loop.
+ * @param index The index of the task.
  */
-void handleRFID(void)
+void printTaskStats(uint8_t index)
 {
-    static unsigned long activityCounter_last = 0;
-    static uint8_t last_uid[RFID_UID_SIZE] = {0};
+    scheduler_stats_t stats;
+    SCHEDULER_GetStats(index, &stats);
+    DEBUG_PRINT("Task ");
+    DEBUG_PRINT(SCHEDULER_GetTaskName(index));
+    DEBUG_PRINT(" runs: ");
+    DEBUG_PRINT(stats.runs);
+    DEBUG_PRINT(", us: ");
+    DEBUG_PRINT(stats.totalMicros);
+    DEBUG_PRINT(", max us: ");
+    DEBUG_PRINT(stats.maxRunMicros);
+    DEBUG_PRINT(", max latency us: ");
+    DEBUG_PRINT(stats.maxLatencyMicros);
+    DEBUG_PRINT(", overruns: ");
+    DEBUG_PRINT(stats.overruns);
+    DEBUG_PRINT("\r\n");
+}
+#endif /* DEBUG */
 
-    if (!RFID_ReadTag())
+/**
+ * @brief Check if the logs have to be pushed to the central module before the daily communication.
+ * @return True if the log area is filled above the threshold, false otherwise.
+ * @note After a push, the next one is only attempted after #LOG_PUSH_RETRY_MS.
+ */
+bool checkLogPushActivity(void)
+{
+    uint32_t capacity = AUTHENTICATE_LOG_GetLogCapacity();
+    uint32_t count = AUTHENTICATE_LOG_GetLogCount();
+    if ((capacity == 0) || (count * 100 < capacity * LOG_PUSH_THRESHOLD_PERCENT))
+    {
+        return false;
+    }
+
+    if (logsPushed && ((TIMERS_Millis() - logsPushMillis) < LOG_PUSH_RETRY_MS))
+    {
+        return false;
+    }
+
+    logsPushed = true;
+    logsPushMillis = TIMERS_Millis();
+    return true;
+}
+
+/**
+ * @brief Handle the RFID authentication on a channel.
+ * @param channel The index of the channel, its reader found a tag.
+ */
+void handleRFID(uint8_t channel)
+{
+    const door_channel_t *door = &(doorChannels[channel]);
+
+    if (!RFID_ReadTag(channel))
     {
         // No tag was read
         return;
     }
 
-    DEBUG_PRINT(RFID_GetUidAsString());
-    DEBUG_PRINT("\r\n");
-
     const uint8_t *uid = RFID_GetUidAsByteArray();
 
-    if ((activityCounter == activityCounter_last) && RFID_UidEquals(uid, last_uid))
+    if (DECISION_CACHE_IsLingering(uid, channel, TIMERS_Millis()))
     {
-        // The same tag was read in the same activity period, ignore it
+        // The tag is still in the field of the reader, it was decided on already
         return;
     }
-    RFID_UidCopy(last_uid, uid);
-    activityCounter_last = activityCounter;
+
+    DEBUG_PRINT(RFID_GetUidAsString());
+    DEBUG_PRINT("\r\n");
 
     unixtime_t time = RTC_GetTime();
 
-    if (AUTHENTICATE_LOG_Authenticate(uid, time))
+    bool granted = authenticateCard(uid, time);
+    if (firstDecisionPending)
     {
-        // If the user is authenticated, switch on the green LED and close the relay for 10 seconds
-        ioPinOn(LED_GREEN_PIN, 10000);
-        ioPinOn(RELAY_SWITCH_PIN, 10000);
+        // millis() counts from the restart, which was the wakeup
+        firstDecisionPending = false;
+        wakeupDecisionMillis = millis();
+    }
 
-        AUTHENTICATE_LOG_WriteLog(uid, time, 1);
+    if (granted)
+    {
+        // If the user is authenticated, switch on the green LED and close the relay for 10 seconds
+        ioPinOn(door->ledGreenPin, 10000);
+        ioPinOn(door->relayPin, 10000);
     }
     else
     {
         // If the user is not authenticated, switch on the red LED for 3 seconds
-        ioPinOn(LED_RED_PIN, 3000);
+        ioPinOn(door->ledRedPin, 3000);
+    }
 
-        AUTHENTICATE_LOG_WriteLog(uid, time, 0);
+    // A repeated denial is only counted, a summary log carries the count
+    if (DECISION_CACHE_Record(uid, channel, granted, time, TIMERS_Millis()))
+    {
+        AUTHENTICATE_LOG_WriteLog(uid, time, AUTHENTICATE_LOG_AUTH(granted, channel));
     }
 }
 
-void ioPinsInit(void)
+/**
+ * @brief Decide if the card read by the RFID reader is granted access.
+ * @param uid The UID of the card.
+ * @param time The current time.
+ * @return True if the card is granted access, false otherwise.
+ *
+ * @details The records of the table decide for the cards they contain. With #CREDENTIAL_ENABLED
+ * the other cards are granted by a valid credential stored on them, so the table only holds the
+ * exceptions.
+ */
+bool authenticateCard(const uint8_t *uid, unixtime_t time)
 {
-    pinMode(WAKEUP_PIN, INPUT);
-
-    pinMode(RELAY_SWITCH_PIN, OUTPUT);
-    digitalWrite(RELAY_SWITCH_PIN, RELAY_OFF);
-
-    pinMode(LED_RED_PIN, OUTPUT);
-    digitalWrite(LED_RED_PIN, LED_OFF);
+    // A card revoked after the table image is denied even if the table or its credential grants it
+    if (REVOCATION_IsRevoked(uid))
+    {
+        return false;
+    }
 
-    pinMode(LED_GREEN_PIN, OUTPUT);
-    digitalWrite(LED_GREEN_PIN, LED_OFF);
+    authenticate_lookup_t lookup = AUTHENTICATE_LOG_Lookup(uid, time);
+    if (lookup != AUTHENTICATE_LOG_NOT_FOUND)
+    {
+        return lookup == AUTHENTICATE_LOG_GRANTED;
+    }
 
-    pinMode(RFID_IRQ_PIN, OUTPUT);
-    digitalWrite(RFID_IRQ_PIN, LOW);
+#if CREDENTIAL_ENABLED
+    uint8_t credential[CREDENTIAL_SIZE];
+    if (!RFID_ReadCredential(credential))
+    {
+        return false;
+    }
+    return CREDENTIAL_Verify(uid, credential, AUTHENTICATE_LOG_GetDoorId(), time, nullptr) ==
+           CREDENTIAL_VALID;
+#else
+    return false;
+#endif
 }
 
-void ioLedRedRegister(bool increment)
+/**
+ * @brief Set up the pins of the module, every output of the channels off.
+ */
+void ioPinsInit(void)
 {
-    static uint32_t redLedCount = 0;
+    pinMode(WAKEUP_PIN, INPUT);
 
-    if (increment)
+    for (uint8_t channel = 0; channel < DOOR_CHANNEL_COUNT; channel++)
     {
-        redLedCount++;
+        ioOutputAdd(doorChannels[channel].relayPin, RELAY_ON);
+        ioOutputAdd(doorChannels[channel].ledRedPin, LED_ON);
+        ioOutputAdd(doorChannels[channel].ledGreenPin, LED_ON);
+
+        // The reader pulls its interrupt line low, which wakes the module from light sleep
+        pinMode(doorChannels[channel].irqPin, INPUT);
     }
-    else
+}
+
+/**
+ * @brief Add an output, switched off, unless a channel added its pin already.
+ * @param pin The pin of the output.
+ * @param onLevel The level that switches the output on.
+ */
+void ioOutputAdd(uint8_t pin, uint8_t onLevel)
+{
+    for (uint8_t i = 0; i < ioOutputCount; i++)
     {
-        if (redLedCount > 0)
+        if (ioOutputs[i].pin == pin)
         {
-            redLedCount--;
+            return;
         }
     }
 
-    if (redLedCount > 0)
-    {
-        digitalWrite(LED_RED_PIN, LED_ON);
-    }
-    else
+    io_output_t *output = &(ioOutputs[ioOutputCount++]);
+    output->pin = pin;
+    output->onLevel = onLevel;
+    output->count = 0;
+    output->handle = TIMER_HANDLE_NONE;
+    output->timed = false;
+
+    pinMode(pin, OUTPUT);
+    digitalWrite(pin, (onLevel == HIGH) ? LOW : HIGH);
+}
+
+/**
+ * @brief Find the output of a pin.
+ * @param pin The pin of the output.
+ * @return The output, nullptr if no channel uses the pin.
+ */
+static io_output_t *ioOutputFind(uint8_t pin)
+{
+    for (uint8_t i = 0; i < ioOutputCount; i++)
     {
-        digitalWrite(LED_RED_PIN, LED_OFF);
+        if (ioOutputs[i].pin == pin)
+        {
+            return &(ioOutputs[i]);
+        }
     }
+    return nullptr;
 }
 
-void ioLedGreenRegister(bool increment)
+/**
+ * @brief Register or release a user of an output, the output is on while it has a user.
+ * @param output The output.
+ * @param increment True to register a user, false to release one.
+ */
+static void ioOutputRegister(io_output_t *output, bool increment)
 {
-    static uint32_t ledGreenCount = 0;
-
     if (increment)
     {
-        ledGreenCount++;
+        output->count++;
     }
     else
     {
-        if (ledGreenCount > 0)
+        if (output->count > 0)
         {
-            ledGreenCount--;
+            output->count--;
         }
     }
 
-    if (ledGreenCount > 0)
+    if (output->count > 0)
     {
-        digitalWrite(LED_GREEN_PIN, LED_ON);
+        digitalWrite(output->pin, output->onLevel);
     }
     else
     {
-        digitalWrite(LED_GREEN_PIN, LED_OFF);
+        digitalWrite(output->pin, (output->onLevel == HIGH) ? LOW : HIGH);
     }
 }
 
-void ioRelayRegister(bool increment)
+/**
+ * @brief Register or release a user of the output of a pin.
+ * @param pin The pin of the output.
+ * @param increment True to register a user, false to release one.
+ */
+void ioPinRegister(uint8_t pin, bool increment)
 {
-    static uint32_t relayCount = 0;
+    io_output_t *output = ioOutputFind(pin);
+    if (output != nullptr)
+    {
+        ioOutputRegister(output, increment);
+    }
+}
 
-    if (increment)
+/**
+ * @brief Register or release a user of the red LED of every channel.
+ * @param increment True to register a user, false to release one.
+ * @note A LED shared by channels gets a user per channel, and releases them the same way.
+ */
+void ioLedsRedRegister(bool increment)
+{
+    for (uint8_t channel = 0; channel < DOOR_CHANNEL_COUNT; channel++)
     {
-        relayCount++;
+        ioPinRegister(doorChannels[channel].ledRedPin, increment);
     }
-    else
+}
+
+/**
+ * @brief Switch on an output for a time.
+ * @param pin The LED or relay pin.
+ * @param millis_interval The time the output stays on.
+ * @note If the output is already on by an earlier call, its time is extended instead.
+ */
+void ioPinOn(uint8_t pin, unsigned long millis_interval)
+{
+    io_output_t *output = ioOutputFind(pin);
+    if (output == nullptr)
     {
-        if (relayCount > 0)
-        {
-            relayCount--;
-        }
+        return;
     }
 
-    if (relayCount > 0)
+    timer_event_t pin_off;
+    pin_off.millis_start = TIMERS_Millis();
+    pin_off.millis_period = millis_interval;
+    pin_off.handler = ioPinsOff;
+    pin_off.periodic = false;
+
+    if (TIMERS_Rearm(output->handle, pin_off.millis_start, millis_interval))
     {
-        digitalWrite(RELAY_SWITCH_PIN, RELAY_ON);
+        // Already on, only extend the time
+        return;
     }
-    else
+
+    output->handle = TIMERS_AddEvent(&pin_off);
+    if (output->handle != TIMER_HANDLE_NONE)
     {
-        digitalWrite(RELAY_SWITCH_PIN, RELAY_OFF);
+        output->timed = true;
+        ioOutputRegister(output, true);
     }
 }
 
-void ioPinOn(uint8_t pin, unsigned long millis_interval)
+/**
+ * @brief Release the outputs whose time is over.
+ * @param millis_real_period Unused.
+ * @note The handler of every output timer, the timer that fired is no longer pending.
+ */
+void ioPinsOff(unsigned long millis_real_period)
 {
-    timer_event_t pin_off;
-
-    switch (pin)
+    (void)millis_real_period;
+    for (uint8_t i = 0; i < ioOutputCount; i++)
     {
-    case LED_RED_PIN:
-        ioLedRedRegister(true);
-        pin_off.millis_start = millis();
-        pin_off.millis_period = millis_interval;
-        pin_off.handler = [](unsigned long __unused)
-        {
-            ioLedRedRegister(false);
-        };
-        break;
-
-    case LED_GREEN_PIN:
-        ioLedGreenRegister(true);
-        pin_off.millis_start = millis();
-        pin_off.millis_period = millis_interval;
-        pin_off.handler = [](unsigned long __unused)
-        {
-            ioLedGreenRegister(false);
-        };
-        break;
-
-    case RELAY_SWITCH_PIN:
-        ioRelayRegister(true);
-        pin_off.millis_start = millis();
-        pin_off.millis_period = millis_interval;
-        pin_off.handler = [](unsigned long __unused)
+        if (ioOutputs[i].timed && !TIMERS_IsPending(ioOutputs[i].handle))
         {
-            ioRelayRegister(false);
-        };
-        break;
+            // The slot of the timer may be reused by another output
+            ioOutputs[i].handle = TIMER_HANDLE_NONE;
+            ioOutputs[i].timed = false;
+            ioOutputRegister(&(ioOutputs[i]), false);
+        }
     }
-
-    TIMERS_AddEvent(&pin_off);
 }
@@ -4,13 +4,28 @@
  * @author Péter Varga
  * @date 2023. 05. 04.
  ***************************************************************************************************
- * @brief A circular buffer class template.
+ * @brief A circular buffer class template, and a lock-free variant for one producer and one
+ * consumer.
  ***************************************************************************************************
  */
 
 #ifndef CIRCULARBUFFER_HPP
 #define CIRCULARBUFFER_HPP
 
+#include <stdint.h>
+
+#include <atomic>
+
+/**
+ * @brief Place a function in IRAM on the ESP8266, so it can be called from an interrupt handler.
+ */
+#ifdef ARDUINO_ARCH_ESP8266
+#include <Arduino.h>
+#define CIRCULARBUFFER_ISR_ATTR IRAM_ATTR
+#else
+#define CIRCULARBUFFER_ISR_ATTR
+#endif
+
 /**
  * @brief A circular buffer class.
  * @tparam T The type of the elements in the buffer.
@@ -60,11 +75,15 @@ public:
 
     /**
      * @brief Get the element at the tail of the buffer.
-     * @return Pointer to the element at the tail of the buffer.
+     * @return Pointer to the element at the tail of the buffer, nullptr if the buffer is empty.
      */
     const T *peek() const
     {
-        return buffer[tail];
+        if (tail == head)
+        {
+            return nullptr;
+        }
+        return &(buffer[tail]);
     }
 
     /**
@@ -124,4 +143,145 @@ public:
     }
 };
 
+/**
+ * @brief A lock-free circular buffer for one producer and one consumer.
+ * @tparam T The type of the elements in the buffer.
+ * @tparam BUFFER_SIZE The number of elements the buffer holds, a power of two.
+ * @note The producer, for example an interrupt handler, only calls push() and pushSpan(), the
+ * consumer, for example the main loop, only calls pop(), popSpan() and peek(). Each side writes
+ * only its own index, and publishes it with a release store after the elements were copied, the
+ * other side reads it with an acquire load before it touches the elements. On the single core
+ * ESP8266 this keeps the compiler and the memory accesses in order between an interrupt and the
+ * loop, on the host between two threads.
+ */
+template <typename T, uint32_t BUFFER_SIZE>
+class SpscRingBuffer
+{
+    static_assert((BUFFER_SIZE > 0) && ((BUFFER_SIZE & (BUFFER_SIZE - 1)) == 0),
+                  "The size of the buffer must be a power of two");
+
+    static const uint32_t MASK = BUFFER_SIZE - 1;
+
+    T buffer[BUFFER_SIZE];
+    /** @brief The number of elements pushed, written by the producer only. */
+    std::atomic<uint32_t> head{0};
+    /** @brief The number of elements popped, written by the consumer only. */
+    std::atomic<uint32_t> tail{0};
+
+public:
+    /**
+     * @brief Put an element into the buffer.
+     * @param value The element to put into the buffer.
+     * @return True if the element was put into the buffer, false if the buffer is full.
+     */
+    CIRCULARBUFFER_ISR_ATTR bool push(const T &value)
+    {
+        uint32_t current = head.load(std::memory_order_relaxed);
+        if (current - tail.load(std::memory_order_acquire) >= BUFFER_SIZE)
+        {
+            return false;
+        }
+        buffer[current & MASK] = value;
+        head.store(current + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Put consecutive elements into the buffer.
+     * @param values The elements to put into the buffer.
+     * @param count The number of elements.
+     * @return The number of elements put into the buffer, less than @p count if it got full.
+     */
+    CIRCULARBUFFER_ISR_ATTR uint32_t pushSpan(const T *values, uint32_t count)
+    {
+        uint32_t current = head.load(std::memory_order_relaxed);
+        uint32_t space = BUFFER_SIZE - (current - tail.load(std::memory_order_acquire));
+        if (count > space)
+        {
+            count = space;
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            buffer[(current + i) & MASK] = values[i];
+        }
+        head.store(current + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * @brief Get an element from the buffer.
+     * @param value Pointer to the location where the element will be put.
+     * @return True if the element was got from the buffer, false if the buffer is empty.
+     */
+    bool pop(T *value)
+    {
+        uint32_t current = tail.load(std::memory_order_relaxed);
+        if (current == head.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+        *value = buffer[current & MASK];
+        tail.store(current + 1, std::memory_order_release);
+        return true;
+    }
+
+    /**
+     * @brief Get consecutive elements from the buffer.
+     * @param values The location where the elements will be put.
+     * @param count The maximum number of elements to get.
+     * @return The number of elements got from the buffer.
+     */
+    uint32_t popSpan(T *values, uint32_t count)
+    {
+        uint32_t current = tail.load(std::memory_order_relaxed);
+        uint32_t available = head.load(std::memory_order_acquire) - current;
+        if (count > available)
+        {
+            count = available;
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            values[i] = buffer[(current + i) & MASK];
+        }
+        tail.store(current + count, std::memory_order_release);
+        return count;
+    }
+
+    /**
+     * @brief Get the element at the tail of the buffer, without removing it.
+     * @return Pointer to the element, nullptr if the buffer is empty.
+     */
+    const T *peek() const
+    {
+        uint32_t current = tail.load(std::memory_order_relaxed);
+        if (current == head.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+        return &(buffer[current & MASK]);
+    }
+
+    /**
+     * @brief Get the number of elements in the buffer.
+     *
+     * The other side may push or pop at the same time, so the value is only a bound: an upper
+     * bound on the producer side, as the consumer may remove elements, and a lower bound on the
+     * consumer side, as the producer may add elements.
+     * @return The number of elements when the value was read.
+     */
+    uint32_t size() const
+    {
+        return head.load(std::memory_order_acquire) - tail.load(std::memory_order_acquire);
+    }
+
+    /**
+     * @brief Get the number of elements the buffer holds.
+     * @return The size of the buffer.
+     */
+    uint32_t capacity() const
+    {
+        return BUFFER_SIZE;
+    }
+};
+
 #endif /* CIRCULARBUFFER_HPP */
@@ -10,8 +10,12 @@
 
 #include "authenticate_log.h"
 
+#include <Arduino.h>
 #include <cstring>
 
+#include "BeleptetoRendszer_Tavoli.h"
+#include "crc32.h"
+#include "byteorder.h"
 #include "eeprom.h"
 
 /**
@@ -22,6 +26,7 @@
 #define UID_SIZE 10
 #define NAME_SIZE 16
 #define AUTHENTICATE_SIZE (UID_SIZE + NAME_SIZE + 4)
+#define AUTHENTICATE_DOORS_SIZE (AUTHENTICATE_SIZE + 4)
 #define LOG_SIZE (UID_SIZE + 4 + 1)
 /** @} */
 
@@ -36,10 +41,42 @@
 #define LOG_LENGTH_ADDRESS 6
 #define LOG_BASE_ADDRESS_ADDRESS 8
 #define LAST_TIME_UPDATE_ADDRESS 10
+#define TABLE_HASH_ADDRESS 14
+#define LOG_START_ADDRESS 46
+#define LOG_SEQUENCE_ADDRESS 48
+#define AUTHENTICATE_RECORD_SIZE_ADDRESS 52
+#define DOOR_ID_ADDRESS 54
+#define REVOCATION_VERSION_ADDRESS 56
 /** @} */
 
+static_assert((REVOCATION_VERSION_ADDRESS + 4 <= AUTHENTICATE_LOG_HEADER_AREA_SIZE) &&
+                  (AUTHENTICATE_LOG_HEADER_AREA_SIZE % EEPROM_PAGE_SIZE == 0),
+              "The header fields do not fit in the header area");
+
+/**
+ * @brief The door ID of a module that was not told its door by the central module yet.
+ */
+#define DOOR_ID_UNKNOWN 0xFF
+
 /**
  * @brief The header structure in the EEPROM.
+ *
+ * @details The header size, the authentication length and the authentication base address are
+ * owned by the central module, they are updated with the table image. The other fields are owned
+ * by the remote module and are kept when a new table image is received.
+ *
+ * The authentication record size is only present if the header size covers it. Without it the
+ * records have #AUTHENTICATE_SIZE bytes and the image belongs to this door only. A shared image of
+ * the site has #AUTHENTICATE_DOORS_SIZE byte records, every record ends with a bitmask of the doors
+ * it is valid on, and each module filters the records with its door ID.
+ *
+ * The revocation version is owned by the central module and is only present if the header size
+ * covers it. It is the number of revocations the table image already contains, the later ones
+ * are received by the revocation probe (revocation.h).
+ *
+ * The logs are stored from the log base address. The records before the log start were already
+ * stored by the central module, they are released. The first unreleased record has the sequence
+ * number log sequence, the following records are numbered consecutively.
  */
 typedef struct _eeprom_header_t
 {
@@ -49,6 +86,12 @@ typedef struct _eeprom_header_t
     uint16_t logLength;
     uint16_t logBaseAddress;
     uint32_t lastTimeUpdate;
+    uint8_t tableHash[SHA256_SIZE];
+    uint16_t logStart;
+    uint32_t logSequence;
+    uint16_t authenticationRecordSize;
+    uint8_t doorId;
+    uint32_t revocationVersion;
 } eeprom_header_t;
 
 /**
@@ -62,6 +105,7 @@ typedef struct _authenticate_t
     uint8_t beginMinute;
     uint8_t endHour;
     uint8_t endMinute;
+    uint32_t doors;
 } authenticate_t;
 
 /**
@@ -79,35 +123,292 @@ typedef struct _log_t
  */
 eeprom_header_t eepromHeader;
 
+/**
+ * @brief The number of records the authentication index can hold, a full table image of the
+ * smallest records.
+ */
+#define AUTHENTICATE_INDEX_CAPACITY 136
+
+/**
+ * @brief The authentication index, mirrored in the RTC user memory.
+ *
+ * @details The index holds a one byte fingerprint of the UID of every record, so a lookup only
+ * reads the records with the fingerprint of the card from the EEPROM. The index belongs to the
+ * table image it was built from, it is rebuilt when the image changes.
+ */
+typedef struct _authenticate_index_t
+{
+    uint32_t crc;                                       /**< CRC-32 of the rest. */
+    uint8_t tableHash[4];                               /**< The start of the table hash. */
+    uint16_t baseAddress;                               /**< The base address of the records. */
+    uint16_t length;                                    /**< The length of the records. */
+    uint16_t recordSize;                                /**< The size of one record. */
+    uint16_t count;                                     /**< The number of records. */
+    uint8_t fingerprints[AUTHENTICATE_INDEX_CAPACITY];  /**< The fingerprints of the records. */
+} authenticate_index_t;
+
+static_assert(sizeof(authenticate_index_t) <= RTC_MEMORY_AUTHENTICATE_INDEX_BLOCKS * 4,
+              "The authentication index does not fit in its RTC user memory area");
+
+/**
+ * @brief The authentication index.
+ */
+static authenticate_index_t authenticateIndex;
+/**
+ * @brief True if #authenticateIndex belongs to the current table image.
+ */
+static bool authenticateIndexValid = false;
+
+
+/**
+ * @brief Read a 16 bit big-endian number from the EEPROM.
+ * @param address The address to read from.
+ * @return The number read.
+ */
+static uint16_t AUTHENTICATE_LOG_ReadUint16(uint16_t address)
+{
+    uint8_t buffer[2];
+    EEPROM_Read(address, buffer, 2);
+    return ((uint16_t)(buffer[0]) << 8) | buffer[1];
+}
+
+/**
+ * @brief Read a 32 bit big-endian number from the EEPROM.
+ * @param address The address to read from.
+ * @return The number read.
+ */
+static uint32_t AUTHENTICATE_LOG_ReadUint32(uint16_t address)
+{
+    uint8_t buffer[4];
+    EEPROM_Read(address, buffer, 4);
+    return BYTEORDER_ReadUint32Be(buffer);
+}
+
+/**
+ * @brief Write a 16 bit big-endian number to the EEPROM memory image.
+ * @param address The address to write to.
+ * @param value The number to write.
+ */
+static void AUTHENTICATE_LOG_WriteUint16(uint16_t address, uint16_t value)
+{
+    uint8_t buffer[2];
+    buffer[0] = (uint8_t)(value >> 8);
+    buffer[1] = (uint8_t)(value & 0xFF);
+    EEPROM_Write(address, buffer, 2);
+}
+
+/**
+ * @brief Write a 32 bit big-endian number to the EEPROM memory image.
+ * @param address The address to write to.
+ * @param value The number to write.
+ */
+static void AUTHENTICATE_LOG_WriteUint32(uint16_t address, uint32_t value)
+{
+    uint8_t buffer[4];
+    BYTEORDER_WriteUint32Be(buffer, value);
+    EEPROM_Write(address, buffer, 4);
+}
+
+/**
+ * @brief Read the header fields owned by the central module from the EEPROM.
+ */
+static void AUTHENTICATE_LOG_ReadTableHeader(void)
+{
+    eepromHeader.headerSize = AUTHENTICATE_LOG_ReadUint16(AUTHENTICATE_HEADER_SIZE_ADDRESS);
+    eepromHeader.authenticationLength = AUTHENTICATE_LOG_ReadUint16(AUTHENTICATE_LENGTH_ADDRESS);
+    eepromHeader.authenticationBaseAddress =
+        AUTHENTICATE_LOG_ReadUint16(AUTHENTICATE_BASE_ADDRESS_ADDRESS);
+
+    eepromHeader.authenticationRecordSize = AUTHENTICATE_SIZE;
+    if (eepromHeader.headerSize >= AUTHENTICATE_RECORD_SIZE_ADDRESS + 2)
+    {
+        uint16_t record_size = AUTHENTICATE_LOG_ReadUint16(AUTHENTICATE_RECORD_SIZE_ADDRESS);
+        if (record_size == AUTHENTICATE_DOORS_SIZE)
+        {
+            eepromHeader.authenticationRecordSize = record_size;
+        }
+    }
+
+    eepromHeader.revocationVersion = 0;
+    if (eepromHeader.headerSize >= REVOCATION_VERSION_ADDRESS + 4)
+    {
+        eepromHeader.revocationVersion = AUTHENTICATE_LOG_ReadUint32(REVOCATION_VERSION_ADDRESS);
+    }
+}
+
+/**
+ * @brief Write the header fields owned by the remote module to the EEPROM memory image.
+ */
+static void AUTHENTICATE_LOG_WriteModuleHeader(void)
+{
+    AUTHENTICATE_LOG_WriteUint16(LOG_LENGTH_ADDRESS, eepromHeader.logLength);
+    AUTHENTICATE_LOG_WriteUint16(LOG_BASE_ADDRESS_ADDRESS, eepromHeader.logBaseAddress);
+    AUTHENTICATE_LOG_WriteUint32(LAST_TIME_UPDATE_ADDRESS, eepromHeader.lastTimeUpdate);
+    EEPROM_Write(TABLE_HASH_ADDRESS, eepromHeader.tableHash, SHA256_SIZE);
+    AUTHENTICATE_LOG_WriteUint16(LOG_START_ADDRESS, eepromHeader.logStart);
+    AUTHENTICATE_LOG_WriteUint32(LOG_SEQUENCE_ADDRESS, eepromHeader.logSequence);
+    EEPROM_Write(DOOR_ID_ADDRESS, &(eepromHeader.doorId), 1);
+}
+
+/**
+ * @brief Calculate the fingerprint of a UID in the authentication index.
+ * @param uid The UID.
+ * @return The lowest byte of the CRC-32 of the UID.
+ */
+static uint8_t AUTHENTICATE_LOG_Fingerprint(const uint8_t *uid)
+{
+    return (uint8_t)CRC32_Final(CRC32_Update(CRC32_Init(), uid, UID_SIZE));
+}
+
+/**
+ * @brief Calculate the CRC of the authentication index.
+ * @return The CRC of every field after the CRC.
+ */
+static uint32_t AUTHENTICATE_LOG_IndexCrc(void)
+{
+    const uint8_t *data = (const uint8_t *)&authenticateIndex + sizeof(authenticateIndex.crc);
+    return CRC32_Final(CRC32_Update(CRC32_Init(), data,
+                                    sizeof(authenticateIndex) - sizeof(authenticateIndex.crc)));
+}
+
+/**
+ * @brief Check if the authentication index belongs to the current table image.
+ * @return True if the index describes the records of the header, false otherwise.
+ */
+static bool AUTHENTICATE_LOG_IndexMatches(void)
+{
+    return (authenticateIndex.crc == AUTHENTICATE_LOG_IndexCrc()) &&
+           (memcmp(authenticateIndex.tableHash, eepromHeader.tableHash,
+                   sizeof(authenticateIndex.tableHash)) == 0) &&
+           (authenticateIndex.baseAddress == eepromHeader.authenticationBaseAddress) &&
+           (authenticateIndex.length == eepromHeader.authenticationLength) &&
+           (authenticateIndex.recordSize == eepromHeader.authenticationRecordSize);
+}
+
+/**
+ * @brief Build the authentication index from the records and save it to the RTC user memory.
+ * @note A table image with more records than #AUTHENTICATE_INDEX_CAPACITY is not indexed, every
+ * record is read by the lookups then.
+ */
+static void AUTHENTICATE_LOG_BuildIndex(void)
+{
+    uint16_t record_size = eepromHeader.authenticationRecordSize;
+    uint16_t count = (eepromHeader.authenticationLength + record_size - 1) / record_size;
+    authenticateIndexValid = false;
+    if (count > AUTHENTICATE_INDEX_CAPACITY)
+    {
+        return;
+    }
+
+    memset(&authenticateIndex, 0, sizeof(authenticateIndex));
+    memcpy(authenticateIndex.tableHash, eepromHeader.tableHash,
+           sizeof(authenticateIndex.tableHash));
+    authenticateIndex.baseAddress = eepromHeader.authenticationBaseAddress;
+    authenticateIndex.length = eepromHeader.authenticationLength;
+    authenticateIndex.recordSize = record_size;
+    authenticateIndex.count = count;
+    for (uint16_t i = 0; i < count; i++)
+    {
+        uint8_t uid[UID_SIZE];
+        EEPROM_Read(eepromHeader.authenticationBaseAddress + i * record_size, uid, UID_SIZE);
+        authenticateIndex.fingerprints[i] = AUTHENTICATE_LOG_Fingerprint(uid);
+    }
+    authenticateIndex.crc = AUTHENTICATE_LOG_IndexCrc();
+    authenticateIndexValid = true;
+
+    ESP.rtcUserMemoryWrite(RTC_MEMORY_AUTHENTICATE_INDEX_OFFSET, (uint32_t *)&authenticateIndex,
+                           sizeof(authenticateIndex));
+}
 
 /**
  * @brief Initializes the authenticate log module.
+ * @note The authentication index is taken from the RTC user memory if it belongs to the table
+ * image, so a module resuming from deep sleep does not read the records.
  */
 void AUTHENTICATE_LOG_Init(void)
 {
     // Read header from EEPROM
+    AUTHENTICATE_LOG_ReadTableHeader();
 
-    uint8_t buffer[4];
-    EEPROM_Read(AUTHENTICATE_HEADER_SIZE_ADDRESS, buffer, 2);
-    eepromHeader.headerSize = ((uint16_t)(buffer[0]) << 8) | buffer[1];
+    eepromHeader.logLength = AUTHENTICATE_LOG_ReadUint16(LOG_LENGTH_ADDRESS);
+    eepromHeader.logBaseAddress = AUTHENTICATE_LOG_ReadUint16(LOG_BASE_ADDRESS_ADDRESS);
+    eepromHeader.lastTimeUpdate = AUTHENTICATE_LOG_ReadUint32(LAST_TIME_UPDATE_ADDRESS);
+    EEPROM_Read(TABLE_HASH_ADDRESS, eepromHeader.tableHash, SHA256_SIZE);
+    eepromHeader.logStart = AUTHENTICATE_LOG_ReadUint16(LOG_START_ADDRESS);
+    eepromHeader.logSequence = AUTHENTICATE_LOG_ReadUint32(LOG_SEQUENCE_ADDRESS);
+    EEPROM_Read(DOOR_ID_ADDRESS, &(eepromHeader.doorId), 1);
 
-    EEPROM_Read(AUTHENTICATE_LENGTH_ADDRESS, buffer, 2);
-    eepromHeader.authenticationLength = ((uint16_t)(buffer[0]) << 8) | buffer[1];
+    if (eepromHeader.logStart > eepromHeader.logLength)
+    {
+        // The log start was never written, every record is unreleased
+        eepromHeader.logStart = 0;
+    }
 
-    EEPROM_Read(AUTHENTICATE_BASE_ADDRESS_ADDRESS, buffer, 2);
-    eepromHeader.authenticationBaseAddress = ((uint16_t)(buffer[0]) << 8) | buffer[1];
+    authenticateIndexValid =
+        ESP.rtcUserMemoryRead(RTC_MEMORY_AUTHENTICATE_INDEX_OFFSET, (uint32_t *)&authenticateIndex,
+                              sizeof(authenticateIndex)) &&
+        AUTHENTICATE_LOG_IndexMatches();
+    if (!authenticateIndexValid)
+    {
+        AUTHENTICATE_LOG_BuildIndex();
+    }
+}
+
+/**
+ * @brief Take over a new table image received from the central module.
+ * @param hash The SHA-256 hash of the table image.
+ * @param header The header area of the table image, #AUTHENTICATE_LOG_HEADER_AREA_SIZE bytes.
+ * @note The rest of the table image is already in the memory image. The header area overwrites
+ * the whole header, then the fields owned by the remote module are restored, so the unreleased
+ * logs, including the ones written during the download, are kept.
+ */
+void AUTHENTICATE_LOG_TableUpdated(const uint8_t *hash, const uint8_t *header)
+{
+    EEPROM_Write(0, header, AUTHENTICATE_LOG_HEADER_AREA_SIZE);
+    AUTHENTICATE_LOG_ReadTableHeader();
 
-    EEPROM_Read(LOG_LENGTH_ADDRESS, buffer, 2);
-    eepromHeader.logLength = ((uint16_t)(buffer[0]) << 8) | buffer[1];
+    if (eepromHeader.logStart == eepromHeader.logLength)
+    {
+        // There are no unreleased logs, the central module may move the log area
+        eepromHeader.logBaseAddress = AUTHENTICATE_LOG_ReadUint16(LOG_BASE_ADDRESS_ADDRESS);
+        eepromHeader.logStart = 0;
+        eepromHeader.logLength = 0;
+    }
+    memcpy(eepromHeader.tableHash, hash, SHA256_SIZE);
+
+    AUTHENTICATE_LOG_WriteModuleHeader();
 
-    EEPROM_Read(LOG_BASE_ADDRESS_ADDRESS, buffer, 2);
-    eepromHeader.logBaseAddress = ((uint16_t)(buffer[0]) << 8) | buffer[1];
+    // Commit the changes
+    EEPROM_MemoryImage_Commit();
 
-    EEPROM_Read(LAST_TIME_UPDATE_ADDRESS, buffer, 4);
-    eepromHeader.lastTimeUpdate = ((uint32_t)(buffer[0]) << 24) |
-                                  ((uint32_t)(buffer[1]) << 16) |
-                                  ((uint32_t)(buffer[2]) << 8) |
-                                  buffer[3];
+    AUTHENTICATE_LOG_BuildIndex();
+}
+
+/**
+ * @brief Set the door ID of the module, as told by the central module.
+ * @param doorId The door ID, the bit of the door in the door bitmasks of a shared image.
+ */
+void AUTHENTICATE_LOG_SetDoorId(uint8_t doorId)
+{
+    if (doorId == eepromHeader.doorId)
+    {
+        return;
+    }
+
+    eepromHeader.doorId = doorId;
+    EEPROM_Write(DOOR_ID_ADDRESS, &(eepromHeader.doorId), 1);
+
+    // Commit the changes
+    EEPROM_MemoryImage_Commit();
+}
+
+/**
+ * @brief Get the door ID of the module.
+ * @return The door ID, 32 or above if the central module did not tell it.
+ */
+uint8_t AUTHENTICATE_LOG_GetDoorId(void)
+{
+    return eepromHeader.doorId;
 }
 
 /**
@@ -118,9 +419,41 @@ void AUTHENTICATE_LOG_Init(void)
  */
 bool AUTHENTICATE_LOG_Authenticate(const uint8_t *uid, uint32_t timestamp)
 {
+    return AUTHENTICATE_LOG_Lookup(uid, timestamp) == AUTHENTICATE_LOG_GRANTED;
+}
+
+/**
+ * @brief Look up the records of the given uid.
+ * @param uid The uid to authenticate.
+ * @param timestamp The timestamp of the authentication.
+ * @return #AUTHENTICATE_LOG_GRANTED if a record of the uid grants access,
+ * #AUTHENTICATE_LOG_DENIED if the uid has records but none of them grants access,
+ * #AUTHENTICATE_LOG_NOT_FOUND if the uid has no record.
+ * @note With credentials (credential.h) the table only holds the exceptions: a record overrides
+ * the credential of the card, a record valid on no door or at no time denies the card.
+ */
+authenticate_lookup_t AUTHENTICATE_LOG_Lookup(const uint8_t *uid, uint32_t timestamp)
+{
+    bool shared_image = (eepromHeader.authenticationRecordSize == AUTHENTICATE_DOORS_SIZE);
+    if (shared_image && (eepromHeader.doorId >= 32))
+    {
+        // The records of a shared image cannot be filtered without knowing the door
+        return AUTHENTICATE_LOG_DENIED;
+    }
+    bool found = false;
+    uint8_t fingerprint = AUTHENTICATE_LOG_Fingerprint(uid);
+
     // Iterate through the authenticate structures
-    for (uint16_t i = 0; i < eepromHeader.authenticationLength; i += AUTHENTICATE_SIZE)
+    uint16_t record = 0;
+    for (uint16_t i = 0; i < eepromHeader.authenticationLength;
+         i += eepromHeader.authenticationRecordSize, record++)
     {
+        if (authenticateIndexValid && (authenticateIndex.fingerprints[record] != fingerprint))
+        {
+            // Only the records with the fingerprint of the uid can match
+            continue;
+        }
+
         authenticate_t authenticate;
         uint16_t read_address = eepromHeader.authenticationBaseAddress + i;
 
@@ -136,6 +469,13 @@ bool AUTHENTICATE_LOG_Authenticate(const uint8_t *uid, uint32_t timestamp)
         EEPROM_Read(read_address, &(authenticate.endHour), 1);
         read_address += 1;
         EEPROM_Read(read_address, &(authenticate.endMinute), 1);
+        read_address += 1;
+
+        authenticate.doors = 0xFFFFFFFF;
+        if (shared_image)
+        {
+            authenticate.doors = AUTHENTICATE_LOG_ReadUint32(read_address);
+        }
 
         // Check if the uid is the same and the timestamp is in the interval
         uint32_t interval_begin = (uint32_t)(authenticate.beginHour) * (60 * 60) +
@@ -143,42 +483,103 @@ bool AUTHENTICATE_LOG_Authenticate(const uint8_t *uid, uint32_t timestamp)
         uint32_t interval_end = (uint32_t)(authenticate.endHour) * (60 * 60) +
                                 (uint32_t)(authenticate.endMinute) * 60;
 
-        if ((memcmp(uid, authenticate.uid, UID_SIZE) == 0) &&
+        if (memcmp(uid, authenticate.uid, UID_SIZE) != 0)
+        {
+            continue;
+        }
+        found = true;
+        if (((authenticate.doors & ((uint32_t)1 << (eepromHeader.doorId & 0x1F))) != 0) &&
             (timestamp % (60 * 60 * 24) >= interval_begin) &&
             (timestamp % (60 * 60 * 24) <= interval_end))
         {
-            // Return true if the authetication is successful
-            return true;
+            // Return granted if the authetication is successful
+            return AUTHENTICATE_LOG_GRANTED;
         }
     }
 
-    // Return false if the authetication is unsuccessful
-    return false;
+    return found ? AUTHENTICATE_LOG_DENIED : AUTHENTICATE_LOG_NOT_FOUND;
+}
+
+/**
+ * @brief Get the number of logs that fit in the log area.
+ * @return The capacity of the log area in records.
+ */
+uint16_t AUTHENTICATE_LOG_GetLogCapacity(void)
+{
+    if (eepromHeader.logBaseAddress >= EEPROM_SIZE)
+    {
+        return 0;
+    }
+    return (EEPROM_SIZE - eepromHeader.logBaseAddress) / LOG_SIZE;
+}
+
+/**
+ * @brief Get the number of logs not yet stored by the central module.
+ * @return The number of unreleased logs.
+ */
+uint16_t AUTHENTICATE_LOG_GetLogCount(void)
+{
+    return (eepromHeader.logLength - eepromHeader.logStart) / LOG_SIZE;
+}
+
+/**
+ * @brief Move the unreleased logs to the beginning of the log area.
+ */
+static void AUTHENTICATE_LOG_CompactLogs(void)
+{
+    uint8_t buffer[EEPROM_PAGE_SIZE];
+    uint16_t length = eepromHeader.logLength - eepromHeader.logStart;
+
+    for (uint16_t i = 0; i < length; i += sizeof(buffer))
+    {
+        uint16_t chunk = length - i;
+        if (chunk > sizeof(buffer))
+        {
+            chunk = sizeof(buffer);
+        }
+        EEPROM_Read(eepromHeader.logBaseAddress + eepromHeader.logStart + i, buffer, chunk);
+        EEPROM_Write(eepromHeader.logBaseAddress + i, buffer, chunk);
+    }
+
+    eepromHeader.logStart = 0;
+    eepromHeader.logLength = length;
+    AUTHENTICATE_LOG_WriteUint16(LOG_START_ADDRESS, eepromHeader.logStart);
+    AUTHENTICATE_LOG_WriteUint16(LOG_LENGTH_ADDRESS, eepromHeader.logLength);
 }
 
 /**
  * @brief Writes a log to the EEPROM.
  * @param uid The uid to write.
  * @param timestamp The timestamp to write.
- * @param auth Authentication state: 0 = denied, 1 = granted.
+ * @param auth Authentication state, see #AUTHENTICATE_LOG_AUTH: bit 0 is set if access was
+ * granted, the upper bits tell the door channel of the reader and the repeats of a summary.
  */
 void AUTHENTICATE_LOG_WriteLog(const uint8_t *uid, uint32_t timestamp, uint8_t auth)
 {
     uint8_t log[LOG_SIZE];
 
+    if (eepromHeader.logLength + LOG_SIZE > AUTHENTICATE_LOG_GetLogCapacity() * LOG_SIZE)
+    {
+        // Make room by dropping the released logs
+        AUTHENTICATE_LOG_CompactLogs();
+        if (eepromHeader.logLength + LOG_SIZE > AUTHENTICATE_LOG_GetLogCapacity() * LOG_SIZE)
+        {
+            // The log area is full, the unreleased logs must not be overwritten
+            EEPROM_MemoryImage_Commit();
+            return;
+        }
+    }
+
     // Get the next address
     uint16_t log_next_address = eepromHeader.logBaseAddress + eepromHeader.logLength;
 
     uint8_t buffer[4];
-    buffer[0] = (uint8_t)(timestamp >> 24);
-    buffer[1] = (uint8_t)((timestamp >> 16) & 0xFF);
-    buffer[2] = (uint8_t)((timestamp >> 8) & 0xFF);
-    buffer[3] = (uint8_t)(timestamp & 0xFF);
+    BYTEORDER_WriteUint32Be(buffer, timestamp);
 
-    // Build the log the uid, the timestamp and the authentication state
+    // Build the log the uid, the timestamp and the authentication state with the channel
     memcpy(log, uid, UID_SIZE);
     memcpy(log + UID_SIZE, buffer, 4);
-    log[UID_SIZE + 4] = auth ? 1 : 0;
+    log[UID_SIZE + 4] = auth;
 
     // Write the log to the EEPROM
     EEPROM_Write(log_next_address, log, LOG_SIZE);
@@ -198,17 +599,72 @@ void AUTHENTICATE_LOG_WriteLog(const uint8_t *uid, uint32_t timestamp, uint8_t a
  */
 void AUTHENTICATE_LOG_ClearLogs(void)
 {
-    // Clear the logs
+    // Clear the logs, the sequence numbers of the dropped logs are not reused
+    eepromHeader.logSequence += AUTHENTICATE_LOG_GetLogCount();
+    eepromHeader.logStart = 0;
     eepromHeader.logLength = 0;
-    uint8_t buffer[2];
-    buffer[0] = (uint8_t)(eepromHeader.logLength >> 8);
-    buffer[1] = (uint8_t)(eepromHeader.logLength & 0xFF);
-    EEPROM_Write(LOG_LENGTH_ADDRESS, buffer, 2);
+    AUTHENTICATE_LOG_WriteUint16(LOG_START_ADDRESS, eepromHeader.logStart);
+    AUTHENTICATE_LOG_WriteUint16(LOG_LENGTH_ADDRESS, eepromHeader.logLength);
+    AUTHENTICATE_LOG_WriteUint32(LOG_SEQUENCE_ADDRESS, eepromHeader.logSequence);
 
     // Commit the changes
     EEPROM_MemoryImage_Commit();
 }
 
+/**
+ * @brief Read the oldest unreleased logs.
+ * @param buffer Buffer to store the log records in.
+ * @param size The size of the buffer.
+ * @param sequence Pointer to store the sequence number of the first record in.
+ * @return The number of bytes stored in the buffer, always a whole number of records.
+ */
+uint16_t AUTHENTICATE_LOG_ReadLogs(uint8_t *buffer, uint16_t size, uint32_t *sequence)
+{
+    uint16_t length = eepromHeader.logLength - eepromHeader.logStart;
+    if (length > (size / LOG_SIZE) * LOG_SIZE)
+    {
+        length = (size / LOG_SIZE) * LOG_SIZE;
+    }
+
+    EEPROM_Read(eepromHeader.logBaseAddress + eepromHeader.logStart, buffer, length);
+    *sequence = eepromHeader.logSequence;
+
+    return length;
+}
+
+/**
+ * @brief Release the logs stored by the central module.
+ * @param sequence The sequence number the central module expects next, every record before it is
+ * released.
+ * @return True if the logs were released, false if the sequence number is invalid.
+ */
+bool AUTHENTICATE_LOG_ReleaseLogs(uint32_t sequence)
+{
+    uint32_t released = sequence - eepromHeader.logSequence;
+    if (released > AUTHENTICATE_LOG_GetLogCount())
+    {
+        // The central module cannot have more logs than this module sent
+        return false;
+    }
+
+    eepromHeader.logSequence = sequence;
+    eepromHeader.logStart += (uint16_t)(released * LOG_SIZE);
+    if (eepromHeader.logStart == eepromHeader.logLength)
+    {
+        // Every log is released, start over at the beginning of the log area
+        eepromHeader.logStart = 0;
+        eepromHeader.logLength = 0;
+        AUTHENTICATE_LOG_WriteUint16(LOG_LENGTH_ADDRESS, eepromHeader.logLength);
+    }
+    AUTHENTICATE_LOG_WriteUint16(LOG_START_ADDRESS, eepromHeader.logStart);
+    AUTHENTICATE_LOG_WriteUint32(LOG_SEQUENCE_ADDRESS, eepromHeader.logSequence);
+
+    // Commit the changes
+    EEPROM_MemoryImage_Commit();
+
+    return true;
+}
+
 /**
  * @brief Set the last time update.
  * @param timestamp The timestamp to set.
@@ -218,12 +674,27 @@ void AUTHENTICATE_LOG_SetLastTimeUpdate(uint32_t timestamp)
     // Update the last time update
     eepromHeader.lastTimeUpdate = timestamp;
     uint8_t buffer[4];
-    buffer[0] = (uint8_t)(timestamp >> 24);
-    buffer[1] = (uint8_t)((timestamp >> 16) & 0xFF);
-    buffer[2] = (uint8_t)((timestamp >> 8) & 0xFF);
-    buffer[3] = (uint8_t)(timestamp & 0xFF);
+    BYTEORDER_WriteUint32Be(buffer, timestamp);
     EEPROM_Write(LAST_TIME_UPDATE_ADDRESS, buffer, 4);
 
     // Commit the changes
     EEPROM_MemoryImage_Commit();
 }
+
+/**
+ * @brief Get the hash of the current table image.
+ * @param hash Buffer of #SHA256_SIZE bytes to store the hash in.
+ */
+void AUTHENTICATE_LOG_GetTableHash(uint8_t *hash)
+{
+    memcpy(hash, eepromHeader.tableHash, SHA256_SIZE);
+}
+
+/**
+ * @brief Get the number of revocations the table image contains.
+ * @return The revocation version of the table image, 0 if the image has none.
+ */
+uint32_t AUTHENTICATE_LOG_GetRevocationVersion(void)
+{
+    return eepromHeader.revocationVersion;
+}
@@ -13,14 +13,75 @@
 
 #include <stdint.h>
 
+#include "sha256.h"
+
+/**
+ * @brief The result of looking up a card in the table.
+ */
+typedef enum _authenticate_lookup_t
+{
+    AUTHENTICATE_LOG_NOT_FOUND, /**< The card has no record. */
+    AUTHENTICATE_LOG_DENIED,    /**< The records of the card do not grant access now. */
+    AUTHENTICATE_LOG_GRANTED    /**< A record of the card grants access now. */
+} authenticate_lookup_t;
+
+/**
+ * @defgroup authlog_auth Log authentication state
+ * @brief The last byte of a log: whether access was granted, the door channel of the reader in
+ * bits 1-2, and in bits 3-7 the number of repeats the log stands for.
+ * @note A log with repeats is a summary: the card was denied that many more times on the channel
+ * since its previous log, the last time at the timestamp of the summary (decision_cache.h). The
+ * single decisions of channel 0 are logged as before the channels, 0 or 1.
+ * @{
+ */
+#define AUTHENTICATE_LOG_AUTH_GRANTED 0x01
+#define AUTHENTICATE_LOG_AUTH_CHANNEL_SHIFT 1
+#define AUTHENTICATE_LOG_AUTH_REPEAT_SHIFT 3
+#define AUTHENTICATE_LOG_AUTH_REPEAT_MAX 31
+#define AUTHENTICATE_LOG_AUTH_REPEATS(granted, channel, repeats) \
+    ((uint8_t)(((granted) ? AUTHENTICATE_LOG_AUTH_GRANTED : 0) | \
+               ((channel) << AUTHENTICATE_LOG_AUTH_CHANNEL_SHIFT) | \
+               ((repeats) << AUTHENTICATE_LOG_AUTH_REPEAT_SHIFT)))
+#define AUTHENTICATE_LOG_AUTH(granted, channel) AUTHENTICATE_LOG_AUTH_REPEATS(granted, channel, 0)
+/** @} */
+
+/**
+ * @brief The size of the header area at the start of the table image, whole EEPROM pages holding
+ * every header field.
+ * @note The header fields owned by the remote module are written while a new table image is
+ * downloaded, so the header area of the new image is only merged by
+ * AUTHENTICATE_LOG_TableUpdated().
+ */
+#define AUTHENTICATE_LOG_HEADER_AREA_SIZE 64
+
 void AUTHENTICATE_LOG_Init(void);
 
+void AUTHENTICATE_LOG_TableUpdated(const uint8_t *hash, const uint8_t *header);
+
+void AUTHENTICATE_LOG_SetDoorId(uint8_t doorId);
+
+uint8_t AUTHENTICATE_LOG_GetDoorId(void);
+
 bool AUTHENTICATE_LOG_Authenticate(const uint8_t *uid, uint32_t timestamp);
 
+authenticate_lookup_t AUTHENTICATE_LOG_Lookup(const uint8_t *uid, uint32_t timestamp);
+
 void AUTHENTICATE_LOG_WriteLog(const uint8_t *uid, uint32_t timestamp, uint8_t auth);
 
 void AUTHENTICATE_LOG_ClearLogs(void);
 
+uint16_t AUTHENTICATE_LOG_GetLogCapacity(void);
+
+uint16_t AUTHENTICATE_LOG_GetLogCount(void);
+
+uint16_t AUTHENTICATE_LOG_ReadLogs(uint8_t *buffer, uint16_t size, uint32_t *sequence);
+
+bool AUTHENTICATE_LOG_ReleaseLogs(uint32_t sequence);
+
 void AUTHENTICATE_LOG_SetLastTimeUpdate(uint32_t timestamp);
 
+void AUTHENTICATE_LOG_GetTableHash(uint8_t *hash);
+
+uint32_t AUTHENTICATE_LOG_GetRevocationVersion(void);
+
 #endif /* AUTHENTICATE_LOG_H */
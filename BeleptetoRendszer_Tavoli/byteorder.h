@@ -0,0 +1,71 @@
+/**
+ ***************************************************************************************************
+ * @file byteorder.h
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Reading and writing 32 bit numbers in a fixed byte order.
+ *
+ * The functions are inline, as they are only a few shifts and some of them run in the inner loops
+ * of the hashes.
+ ***************************************************************************************************
+ */
+
+#ifndef BYTEORDER_H
+#define BYTEORDER_H
+
+#include <stdint.h>
+
+/**
+ * @brief Read a 32 bit big-endian number from a buffer.
+ * @param buffer The buffer to read from.
+ * @return The number read.
+ */
+static inline uint32_t BYTEORDER_ReadUint32Be(const uint8_t *buffer)
+{
+    return ((uint32_t)(buffer[0]) << 24) |
+           ((uint32_t)(buffer[1]) << 16) |
+           ((uint32_t)(buffer[2]) << 8) |
+           buffer[3];
+}
+
+/**
+ * @brief Write a 32 bit big-endian number to a buffer.
+ * @param buffer The buffer to write to.
+ * @param value The number to write.
+ */
+static inline void BYTEORDER_WriteUint32Be(uint8_t *buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t)(value >> 24);
+    buffer[1] = (uint8_t)((value >> 16) & 0xFF);
+    buffer[2] = (uint8_t)((value >> 8) & 0xFF);
+    buffer[3] = (uint8_t)(value & 0xFF);
+}
+
+/**
+ * @brief Read a 32 bit little-endian number from a buffer.
+ * @param buffer The buffer to read from.
+ * @return The number read.
+ */
+static inline uint32_t BYTEORDER_ReadUint32Le(const uint8_t *buffer)
+{
+    return (uint32_t)(buffer[0]) |
+           ((uint32_t)(buffer[1]) << 8) |
+           ((uint32_t)(buffer[2]) << 16) |
+           ((uint32_t)(buffer[3]) << 24);
+}
+
+/**
+ * @brief Write a 32 bit little-endian number to a buffer.
+ * @param buffer The buffer to write to.
+ * @param value The number to write.
+ */
+static inline void BYTEORDER_WriteUint32Le(uint8_t *buffer, uint32_t value)
+{
+    buffer[0] = (uint8_t)(value & 0xFF);
+    buffer[1] = (uint8_t)((value >> 8) & 0xFF);
+    buffer[2] = (uint8_t)((value >> 16) & 0xFF);
+    buffer[3] = (uint8_t)(value >> 24);
+}
+
+#endif /* BYTEORDER_H */
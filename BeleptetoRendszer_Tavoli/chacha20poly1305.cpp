@@ -0,0 +1,363 @@
+/**
+ ***************************************************************************************************
+ * @file chacha20poly1305.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Implementation of chacha20poly1305.h.
+ *
+ * Poly1305 uses five 26 bit limbs, so every product fits in 64 bits and only 32x32 bit
+ * multiplications are needed, which the ESP8266 has in hardware.
+ ***************************************************************************************************
+ */
+
+#include "chacha20poly1305.h"
+
+#include <string.h>
+
+#include "byteorder.h"
+
+/**
+ * @brief Size of a ChaCha20 block in bytes.
+ */
+#define CHACHA_BLOCK_SIZE 64
+/**
+ * @brief Size of a Poly1305 block in bytes.
+ */
+#define POLY1305_BLOCK_SIZE 16
+
+/**
+ * @brief Rotate a 32 bit word to the left.
+ * @param x The word to rotate.
+ * @param n The number of bits to rotate by.
+ */
+#define ROTL(x, n) (((x) << (n)) | ((x) >> (32 - (n))))
+
+/**
+ * @brief The ChaCha20 quarter round on four words of the state.
+ */
+#define QUARTER_ROUND(a, b, c, d) \
+    a += b;                       \
+    d ^= a;                       \
+    d = ROTL(d, 16);              \
+    c += d;                       \
+    b ^= c;                       \
+    b = ROTL(b, 12);              \
+    a += b;                       \
+    d ^= a;                       \
+    d = ROTL(d, 8);               \
+    c += d;                       \
+    b ^= c;                       \
+    b = ROTL(b, 7);
+
+/**
+ * @brief The state of a running Poly1305 calculation.
+ */
+typedef struct _poly1305_context_t
+{
+    uint32_t r[5];   /**< The clamped multiplier, in 26 bit limbs. */
+    uint32_t h[5];   /**< The accumulator, in 26 bit limbs. */
+    uint32_t pad[4]; /**< The value added at the end. */
+} poly1305_context_t;
+
+/**
+ * @brief Calculate a ChaCha20 key stream block.
+ * @param key The key, #CHACHAPOLY_KEY_SIZE bytes.
+ * @param counter The block counter.
+ * @param nonce The nonce, #CHACHAPOLY_NONCE_SIZE bytes.
+ * @param block Buffer of #CHACHA_BLOCK_SIZE bytes to store the key stream in.
+ */
+static void CHACHAPOLY_Block(const uint8_t *key, uint32_t counter, const uint8_t *nonce,
+                             uint8_t *block)
+{
+    uint32_t state[16];
+    state[0] = 0x61707865;
+    state[1] = 0x3320646e;
+    state[2] = 0x79622d32;
+    state[3] = 0x6b206574;
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        state[4 + i] = BYTEORDER_ReadUint32Le(&(key[i * 4]));
+    }
+    state[12] = counter;
+    for (uint8_t i = 0; i < 3; i++)
+    {
+        state[13 + i] = BYTEORDER_ReadUint32Le(&(nonce[i * 4]));
+    }
+
+    uint32_t x[16];
+    memcpy(x, state, sizeof(x));
+    for (uint8_t round = 0; round < 10; round++)
+    {
+        QUARTER_ROUND(x[0], x[4], x[8], x[12]);
+        QUARTER_ROUND(x[1], x[5], x[9], x[13]);
+        QUARTER_ROUND(x[2], x[6], x[10], x[14]);
+        QUARTER_ROUND(x[3], x[7], x[11], x[15]);
+        QUARTER_ROUND(x[0], x[5], x[10], x[15]);
+        QUARTER_ROUND(x[1], x[6], x[11], x[12]);
+        QUARTER_ROUND(x[2], x[7], x[8], x[13]);
+        QUARTER_ROUND(x[3], x[4], x[9], x[14]);
+    }
+
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        BYTEORDER_WriteUint32Le(&(block[i * 4]), x[i] + state[i]);
+    }
+}
+
+/**
+ * @brief Encrypt or decrypt data in place with the ChaCha20 key stream.
+ * @param key The key.
+ * @param counter The block counter of the first block.
+ * @param nonce The nonce.
+ * @param data The data.
+ * @param length The length of the data.
+ */
+static void CHACHAPOLY_Xor(const uint8_t *key, uint32_t counter, const uint8_t *nonce,
+                           uint8_t *data, uint16_t length)
+{
+    uint8_t block[CHACHA_BLOCK_SIZE];
+    for (uint16_t position = 0; position < length; position += CHACHA_BLOCK_SIZE)
+    {
+        CHACHAPOLY_Block(key, counter++, nonce, block);
+        uint16_t count = length - position;
+        if (count > CHACHA_BLOCK_SIZE)
+        {
+            count = CHACHA_BLOCK_SIZE;
+        }
+        for (uint16_t i = 0; i < count; i++)
+        {
+            data[position + i] ^= block[i];
+        }
+    }
+}
+
+/**
+ * @brief Start a Poly1305 calculation.
+ * @param context The context of the calculation.
+ * @param key The one-time key, 32 bytes.
+ */
+static void POLY1305_Init(poly1305_context_t *context, const uint8_t *key)
+{
+    context->r[0] = BYTEORDER_ReadUint32Le(&(key[0])) & 0x3ffffff;
+    context->r[1] = (BYTEORDER_ReadUint32Le(&(key[3])) >> 2) & 0x3ffff03;
+    context->r[2] = (BYTEORDER_ReadUint32Le(&(key[6])) >> 4) & 0x3ffc0ff;
+    context->r[3] = (BYTEORDER_ReadUint32Le(&(key[9])) >> 6) & 0x3f03fff;
+    context->r[4] = (BYTEORDER_ReadUint32Le(&(key[12])) >> 8) & 0x00fffff;
+    memset(context->h, 0, sizeof(context->h));
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        context->pad[i] = BYTEORDER_ReadUint32Le(&(key[16 + i * 4]));
+    }
+}
+
+/**
+ * @brief Add a full 16 byte block to a Poly1305 calculation.
+ * @param context The context of the calculation.
+ * @param block The block.
+ */
+static void POLY1305_Block(poly1305_context_t *context, const uint8_t *block)
+{
+    const uint32_t *r = context->r;
+    uint32_t *h = context->h;
+    uint32_t s1 = r[1] * 5;
+    uint32_t s2 = r[2] * 5;
+    uint32_t s3 = r[3] * 5;
+    uint32_t s4 = r[4] * 5;
+
+    h[0] += BYTEORDER_ReadUint32Le(&(block[0])) & 0x3ffffff;
+    h[1] += (BYTEORDER_ReadUint32Le(&(block[3])) >> 2) & 0x3ffffff;
+    h[2] += (BYTEORDER_ReadUint32Le(&(block[6])) >> 4) & 0x3ffffff;
+    h[3] += (BYTEORDER_ReadUint32Le(&(block[9])) >> 6) & 0x3ffffff;
+    h[4] += (BYTEORDER_ReadUint32Le(&(block[12])) >> 8) | (1UL << 24);
+
+    uint64_t d0 = (uint64_t)h[0] * r[0] + (uint64_t)h[1] * s4 + (uint64_t)h[2] * s3 +
+                  (uint64_t)h[3] * s2 + (uint64_t)h[4] * s1;
+    uint64_t d1 = (uint64_t)h[0] * r[1] + (uint64_t)h[1] * r[0] + (uint64_t)h[2] * s4 +
+                  (uint64_t)h[3] * s3 + (uint64_t)h[4] * s2;
+    uint64_t d2 = (uint64_t)h[0] * r[2] + (uint64_t)h[1] * r[1] + (uint64_t)h[2] * r[0] +
+                  (uint64_t)h[3] * s4 + (uint64_t)h[4] * s3;
+    uint64_t d3 = (uint64_t)h[0] * r[3] + (uint64_t)h[1] * r[2] + (uint64_t)h[2] * r[1] +
+                  (uint64_t)h[3] * r[0] + (uint64_t)h[4] * s4;
+    uint64_t d4 = (uint64_t)h[0] * r[4] + (uint64_t)h[1] * r[3] + (uint64_t)h[2] * r[2] +
+                  (uint64_t)h[3] * r[1] + (uint64_t)h[4] * r[0];
+
+    // Carry the limbs back to 26 bits, the carry out of the top is multiplied by 5 (2^130 - 5)
+    uint32_t carry = (uint32_t)(d0 >> 26);
+    h[0] = (uint32_t)d0 & 0x3ffffff;
+    d1 += carry;
+    carry = (uint32_t)(d1 >> 26);
+    h[1] = (uint32_t)d1 & 0x3ffffff;
+    d2 += carry;
+    carry = (uint32_t)(d2 >> 26);
+    h[2] = (uint32_t)d2 & 0x3ffffff;
+    d3 += carry;
+    carry = (uint32_t)(d3 >> 26);
+    h[3] = (uint32_t)d3 & 0x3ffffff;
+    d4 += carry;
+    carry = (uint32_t)(d4 >> 26);
+    h[4] = (uint32_t)d4 & 0x3ffffff;
+    h[0] += carry * 5;
+    carry = h[0] >> 26;
+    h[0] &= 0x3ffffff;
+    h[1] += carry;
+}
+
+/**
+ * @brief Add data to a Poly1305 calculation, padding the last block with zeros.
+ * @param context The context of the calculation.
+ * @param data The data.
+ * @param length The length of the data.
+ */
+static void POLY1305_UpdatePadded(poly1305_context_t *context, const uint8_t *data,
+                                  uint16_t length)
+{
+    uint16_t position = 0;
+    for (; position + POLY1305_BLOCK_SIZE <= length; position += POLY1305_BLOCK_SIZE)
+    {
+        POLY1305_Block(context, &(data[position]));
+    }
+    if (position < length)
+    {
+        uint8_t block[POLY1305_BLOCK_SIZE] = {0};
+        memcpy(block, &(data[position]), length - position);
+        POLY1305_Block(context, block);
+    }
+}
+
+/**
+ * @brief Finish a Poly1305 calculation.
+ * @param context The context of the calculation.
+ * @param tag Buffer of #CHACHAPOLY_TAG_SIZE bytes to store the tag in.
+ */
+static void POLY1305_Final(poly1305_context_t *context, uint8_t *tag)
+{
+    uint32_t *h = context->h;
+
+    uint32_t carry = h[1] >> 26;
+    h[1] &= 0x3ffffff;
+    h[2] += carry;
+    carry = h[2] >> 26;
+    h[2] &= 0x3ffffff;
+    h[3] += carry;
+    carry = h[3] >> 26;
+    h[3] &= 0x3ffffff;
+    h[4] += carry;
+    carry = h[4] >> 26;
+    h[4] &= 0x3ffffff;
+    h[0] += carry * 5;
+    carry = h[0] >> 26;
+    h[0] &= 0x3ffffff;
+    h[1] += carry;
+
+    // Calculate h - (2^130 - 5), and keep it if it is not negative
+    uint32_t g[5];
+    g[0] = h[0] + 5;
+    carry = g[0] >> 26;
+    g[0] &= 0x3ffffff;
+    for (uint8_t i = 1; i < 4; i++)
+    {
+        g[i] = h[i] + carry;
+        carry = g[i] >> 26;
+        g[i] &= 0x3ffffff;
+    }
+    g[4] = h[4] + carry - (1UL << 26);
+
+    uint32_t mask = (g[4] >> 31) - 1;
+    for (uint8_t i = 0; i < 5; i++)
+    {
+        h[i] = (h[i] & ~mask) | (g[i] & mask);
+    }
+
+    // Add the pad modulo 2^128
+    uint32_t words[4];
+    words[0] = h[0] | (h[1] << 26);
+    words[1] = (h[1] >> 6) | (h[2] << 20);
+    words[2] = (h[2] >> 12) | (h[3] << 14);
+    words[3] = (h[3] >> 18) | (h[4] << 8);
+    uint64_t sum = 0;
+    for (uint8_t i = 0; i < 4; i++)
+    {
+        sum = (uint64_t)words[i] + context->pad[i] + (sum >> 32);
+        BYTEORDER_WriteUint32Le(&(tag[i * 4]), (uint32_t)sum);
+    }
+}
+
+/**
+ * @brief Calculate the tag over the additional data and the cipher text.
+ * @param key The key.
+ * @param nonce The nonce.
+ * @param aad The additional authenticated data.
+ * @param aadLength The length of the additional data.
+ * @param data The cipher text.
+ * @param length The length of the cipher text.
+ * @param tag Buffer of #CHACHAPOLY_TAG_SIZE bytes to store the tag in.
+ */
+static void CHACHAPOLY_Tag(const uint8_t *key, const uint8_t *nonce, const uint8_t *aad,
+                           uint16_t aadLength, const uint8_t *data, uint16_t length,
+                           uint8_t *tag)
+{
+    // The one-time key is the start of the key stream block 0
+    uint8_t block[CHACHA_BLOCK_SIZE];
+    CHACHAPOLY_Block(key, 0, nonce, block);
+
+    poly1305_context_t context;
+    POLY1305_Init(&context, block);
+    POLY1305_UpdatePadded(&context, aad, aadLength);
+    POLY1305_UpdatePadded(&context, data, length);
+
+    uint8_t lengths[POLY1305_BLOCK_SIZE] = {0};
+    BYTEORDER_WriteUint32Le(&(lengths[0]), aadLength);
+    BYTEORDER_WriteUint32Le(&(lengths[8]), length);
+    POLY1305_Block(&context, lengths);
+    POLY1305_Final(&context, tag);
+}
+
+/**
+ * @brief Encrypt data in place and calculate its authentication tag.
+ * @param key The key, #CHACHAPOLY_KEY_SIZE bytes.
+ * @param nonce The nonce, #CHACHAPOLY_NONCE_SIZE bytes, never reused with the same key.
+ * @param aad The additional data, authenticated but not encrypted.
+ * @param aadLength The length of the additional data.
+ * @param data The data to encrypt.
+ * @param length The length of the data.
+ * @param tag Buffer of #CHACHAPOLY_TAG_SIZE bytes to store the tag in.
+ */
+void CHACHAPOLY_Seal(const uint8_t *key, const uint8_t *nonce, const uint8_t *aad,
+                     uint16_t aadLength, uint8_t *data, uint16_t length, uint8_t *tag)
+{
+    CHACHAPOLY_Xor(key, 1, nonce, data, length);
+    CHACHAPOLY_Tag(key, nonce, aad, aadLength, data, length, tag);
+}
+
+/**
+ * @brief Verify the authentication tag of data and decrypt it in place.
+ * @param key The key, #CHACHAPOLY_KEY_SIZE bytes.
+ * @param nonce The nonce, #CHACHAPOLY_NONCE_SIZE bytes.
+ * @param aad The additional authenticated data.
+ * @param aadLength The length of the additional data.
+ * @param data The data to decrypt.
+ * @param length The length of the data.
+ * @param tag The received tag, #CHACHAPOLY_TAG_SIZE bytes.
+ * @return True if the tag was valid and the data was decrypted, false otherwise.
+ */
+bool CHACHAPOLY_Open(const uint8_t *key, const uint8_t *nonce, const uint8_t *aad,
+                     uint16_t aadLength, uint8_t *data, uint16_t length, const uint8_t *tag)
+{
+    uint8_t tag_calculated[CHACHAPOLY_TAG_SIZE];
+    CHACHAPOLY_Tag(key, nonce, aad, aadLength, data, length, tag_calculated);
+
+    // Compare every byte, so the time does not tell how much of the tag was right
+    uint8_t difference = 0;
+    for (uint8_t i = 0; i < CHACHAPOLY_TAG_SIZE; i++)
+    {
+        difference |= tag_calculated[i] ^ tag[i];
+    }
+    if (difference != 0)
+    {
+        return false;
+    }
+
+    CHACHAPOLY_Xor(key, 1, nonce, data, length);
+    return true;
+}
@@ -0,0 +1,32 @@
+/**
+ ***************************************************************************************************
+ * @file chacha20poly1305.h
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Header file for the ChaCha20-Poly1305 authenticated encryption (RFC 8439).
+ ***************************************************************************************************
+ */
+
+#ifndef CHACHA20POLY1305_H
+#define CHACHA20POLY1305_H
+
+#include <stdint.h>
+
+/**
+ * @defgroup chachapoly_sizes ChaCha20-Poly1305 sizes
+ * @brief The sizes of the key, the nonce and the authentication tag.
+ * @{
+ */
+#define CHACHAPOLY_KEY_SIZE 32
+#define CHACHAPOLY_NONCE_SIZE 12
+#define CHACHAPOLY_TAG_SIZE 16
+/** @} */
+
+void CHACHAPOLY_Seal(const uint8_t *key, const uint8_t *nonce, const uint8_t *aad,
+                     uint16_t aadLength, uint8_t *data, uint16_t length, uint8_t *tag);
+
+bool CHACHAPOLY_Open(const uint8_t *key, const uint8_t *nonce, const uint8_t *aad,
+                     uint16_t aadLength, uint8_t *data, uint16_t length, const uint8_t *tag);
+
+#endif /* CHACHA20POLY1305_H */
@@ -0,0 +1,59 @@
+/**
+ ***************************************************************************************************
+ * @file crc32.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Implementation of crc32.h.
+ ***************************************************************************************************
+ */
+
+#include "crc32.h"
+
+/**
+ * @brief Lookup table of the reflected CRC-32 (IEEE 802.3) polynomial, one entry for each nibble.
+ * @note A nibble table is used instead of the usual 256 entry table to save RAM.
+ */
+static const uint32_t crcNibbleTable[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC,
+    0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C,
+    0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C};
+
+/**
+ * @brief Get the initial value of a CRC-32 calculation.
+ * @return The initial value of the running CRC.
+ */
+uint32_t CRC32_Init(void)
+{
+    return 0xFFFFFFFF;
+}
+
+/**
+ * @brief Update a running CRC-32 with the given data.
+ * @param crc The running CRC.
+ * @param data The data to add to the CRC.
+ * @param length The length of the data.
+ * @return The updated running CRC.
+ */
+uint32_t CRC32_Update(uint32_t crc, const uint8_t *data, uint16_t length)
+{
+    for (uint16_t i = 0; i < length; i++)
+    {
+        crc ^= data[i];
+        crc = (crc >> 4) ^ crcNibbleTable[crc & 0x0F];
+        crc = (crc >> 4) ^ crcNibbleTable[crc & 0x0F];
+    }
+
+    return crc;
+}
+
+/**
+ * @brief Finish a CRC-32 calculation.
+ * @param crc The running CRC.
+ * @return The final CRC-32 value.
+ */
+uint32_t CRC32_Final(uint32_t crc)
+{
+    return crc ^ 0xFFFFFFFF;
+}
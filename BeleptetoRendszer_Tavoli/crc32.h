@@ -0,0 +1,22 @@
+/**
+ ***************************************************************************************************
+ * @file crc32.h
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Header file for the CRC-32 checksum functionality.
+ ***************************************************************************************************
+ */
+
+#ifndef CRC32_H
+#define CRC32_H
+
+#include <stdint.h>
+
+uint32_t CRC32_Init(void);
+
+uint32_t CRC32_Update(uint32_t crc, const uint8_t *data, uint16_t length);
+
+uint32_t CRC32_Final(uint32_t crc);
+
+#endif /* CRC32_H */
@@ -0,0 +1,150 @@
+/**
+ ***************************************************************************************************
+ * @file credential.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Implementation of credential.h.
+ *
+ * The verification costs one HMAC-SHA256 over 26 bytes, four SHA-256 blocks, independently of
+ * the content of the credential, so it takes the same bounded time for every card.
+ ***************************************************************************************************
+ */
+
+#include "credential.h"
+
+#include <string.h>
+
+#include "byteorder.h"
+#include "sha256.h"
+
+/**
+ * @defgroup credential_keys Credential keys
+ * @brief The keys shared with the central module, selected by the key index of the credential.
+ *
+ * Two keys allow rotating the key: the central module signs with the new key while the
+ * credentials signed with the old one are still accepted.
+ * @{
+ */
+#ifndef CREDENTIAL_KEY_0
+#define CREDENTIAL_KEY_0 "belepteto_rendszer_credential_00"
+#endif
+#ifndef CREDENTIAL_KEY_1
+#define CREDENTIAL_KEY_1 "belepteto_rendszer_credential_01"
+#endif
+/** @} */
+
+/**
+ * @brief The credential keys, by key index.
+ */
+static const char *const credentialKeys[] = {CREDENTIAL_KEY_0, CREDENTIAL_KEY_1};
+
+/**
+ * @brief Calculate the MAC of a credential.
+ * @param key The credential key.
+ * @param keyLength The length of the key.
+ * @param uid The UID of the card, #CREDENTIAL_UID_SIZE bytes.
+ * @param data The first #CREDENTIAL_DATA_SIZE bytes of the credential.
+ * @param mac Buffer of #SHA256_SIZE bytes to store the MAC in.
+ */
+static void CREDENTIAL_Mac(const uint8_t *key, uint16_t keyLength, const uint8_t *uid,
+                           const uint8_t *data, uint8_t *mac)
+{
+    sha256_hmac_context_t context;
+    SHA256_HmacInit(&context, key, keyLength);
+    SHA256_HmacUpdate(&context, uid, CREDENTIAL_UID_SIZE);
+    SHA256_HmacUpdate(&context, data, CREDENTIAL_DATA_SIZE);
+    SHA256_HmacFinal(&context, mac);
+}
+
+/**
+ * @brief Verify the credential read from a card.
+ * @param uid The UID of the card, #CREDENTIAL_UID_SIZE bytes.
+ * @param data The credential, #CREDENTIAL_SIZE bytes.
+ * @param doorId The door of the module, see AUTHENTICATE_LOG_GetDoorId().
+ * @param timestamp The current time.
+ * @param credential Pointer to store the decoded grant in, can be nullptr.
+ * @return The result of the verification, see #credential_result_t.
+ * @note A module that does not know its door accepts no credential.
+ */
+credential_result_t CREDENTIAL_Verify(const uint8_t *uid, const uint8_t *data, uint8_t doorId,
+                                      uint32_t timestamp, credential_t *credential)
+{
+    uint8_t key_index = data[0] & 0x0F;
+    if (((data[0] >> 4) != CREDENTIAL_FORMAT) ||
+        (key_index >= sizeof(credentialKeys) / sizeof(credentialKeys[0])))
+    {
+        return CREDENTIAL_INVALID;
+    }
+
+    uint8_t mac[SHA256_SIZE];
+    const char *key = credentialKeys[key_index];
+    CREDENTIAL_Mac((const uint8_t *)key, (uint16_t)strlen(key), uid, data, mac);
+    uint8_t difference = 0;
+    for (uint8_t i = 0; i < CREDENTIAL_MAC_SIZE; i++)
+    {
+        difference |= mac[i] ^ data[CREDENTIAL_DATA_SIZE + i];
+    }
+    if (difference != 0)
+    {
+        return CREDENTIAL_INVALID;
+    }
+
+    credential_t grant;
+    grant.keyIndex = key_index;
+    grant.userId = BYTEORDER_ReadUint32Be(data) & 0x00FFFFFF;
+    grant.doors = BYTEORDER_ReadUint32Be(&(data[4]));
+    grant.beginHour = data[8];
+    grant.beginMinute = data[9];
+    grant.endHour = data[10];
+    grant.endMinute = data[11];
+    grant.expiry = BYTEORDER_ReadUint32Be(&(data[12]));
+    if (credential != nullptr)
+    {
+        *credential = grant;
+    }
+
+    if (timestamp > grant.expiry)
+    {
+        return CREDENTIAL_EXPIRED;
+    }
+
+    // The daily interval is checked like the interval of a table record
+    uint32_t time_of_day = timestamp % (60 * 60 * 24);
+    uint32_t interval_begin = (uint32_t)(grant.beginHour) * (60 * 60) +
+                              (uint32_t)(grant.beginMinute) * 60;
+    uint32_t interval_end = (uint32_t)(grant.endHour) * (60 * 60) +
+                            (uint32_t)(grant.endMinute) * 60;
+    if ((doorId >= 32) || ((grant.doors & ((uint32_t)1 << doorId)) == 0) ||
+        (time_of_day < interval_begin) || (time_of_day > interval_end))
+    {
+        return CREDENTIAL_NOT_ALLOWED;
+    }
+
+    return CREDENTIAL_VALID;
+}
+
+/**
+ * @brief Sign a credential for a card, on the central module's side.
+ * @param credential The grant, its key index selects the format byte.
+ * @param key The credential key of the key index.
+ * @param keyLength The length of the key.
+ * @param uid The UID of the card, #CREDENTIAL_UID_SIZE bytes.
+ * @param data Buffer of #CREDENTIAL_SIZE bytes to store the credential in.
+ */
+void CREDENTIAL_Issue(const credential_t *credential, const uint8_t *key, uint16_t keyLength,
+                      const uint8_t *uid, uint8_t *data)
+{
+    BYTEORDER_WriteUint32Be(data, credential->userId & 0x00FFFFFF);
+    data[0] = (uint8_t)((CREDENTIAL_FORMAT << 4) | (credential->keyIndex & 0x0F));
+    BYTEORDER_WriteUint32Be(&(data[4]), credential->doors);
+    data[8] = credential->beginHour;
+    data[9] = credential->beginMinute;
+    data[10] = credential->endHour;
+    data[11] = credential->endMinute;
+    BYTEORDER_WriteUint32Be(&(data[12]), credential->expiry);
+
+    uint8_t mac[SHA256_SIZE];
+    CREDENTIAL_Mac(key, keyLength, uid, data, mac);
+    memcpy(&(data[CREDENTIAL_DATA_SIZE]), mac, CREDENTIAL_MAC_SIZE);
+}
@@ -0,0 +1,80 @@
+/**
+ ***************************************************************************************************
+ * @file credential.h
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Header file for the signed credentials carried by the cards.
+ *
+ * A credential grants access without a record in the table image. It is stored on the card and
+ * signed by the central module, the module verifies it offline with the shared credential keys.
+ *
+ * | Offset | Size | Field                                                     |
+ * |--------|------|-----------------------------------------------------------|
+ * | 0      | 1    | Format (high nibble) and index of the key (low nibble)    |
+ * | 1      | 3    | User ID                                                   |
+ * | 4      | 4    | Bitmask of the doors                                      |
+ * | 8      | 4    | Begin hour, begin minute, end hour, end minute of the day |
+ * | 12     | 4    | Expiry, Unix time                                         |
+ * | 16     | 16   | MAC                                                       |
+ *
+ * Numbers are big-endian. The MAC is the first #CREDENTIAL_MAC_SIZE bytes of the HMAC-SHA256 of
+ * the UID of the card and the first #CREDENTIAL_DATA_SIZE bytes, so a credential cannot be copied
+ * to another card.
+ ***************************************************************************************************
+ */
+
+#ifndef CREDENTIAL_H
+#define CREDENTIAL_H
+
+#include <stdint.h>
+
+/**
+ * @defgroup credential_constants Credential constants
+ * @brief Sizes and format of the credentials.
+ * @{
+ */
+/** @brief Set to 1 to accept the credentials of the cards not in the table image. */
+#ifndef CREDENTIAL_ENABLED
+#define CREDENTIAL_ENABLED 0
+#endif
+#define CREDENTIAL_SIZE 32
+#define CREDENTIAL_DATA_SIZE 16
+#define CREDENTIAL_MAC_SIZE (CREDENTIAL_SIZE - CREDENTIAL_DATA_SIZE)
+#define CREDENTIAL_UID_SIZE 10
+#define CREDENTIAL_FORMAT 1
+/** @} */
+
+/**
+ * @brief The grant of a credential.
+ */
+typedef struct _credential_t
+{
+    uint8_t keyIndex;    /**< The index of the key the credential is signed with. */
+    uint32_t userId;     /**< The ID of the user, 24 bits. */
+    uint32_t doors;      /**< The bitmask of the doors the credential is valid on. */
+    uint8_t beginHour;   /**< The begin of the daily interval, hour. */
+    uint8_t beginMinute; /**< The begin of the daily interval, minute. */
+    uint8_t endHour;     /**< The end of the daily interval, hour. */
+    uint8_t endMinute;   /**< The end of the daily interval, minute. */
+    uint32_t expiry;     /**< The last valid time of the credential. */
+} credential_t;
+
+/**
+ * @brief The result of the verification of a credential.
+ */
+typedef enum _credential_result_t
+{
+    CREDENTIAL_VALID,       /**< The credential grants access now. */
+    CREDENTIAL_INVALID,     /**< The format, the key or the MAC is wrong. */
+    CREDENTIAL_EXPIRED,     /**< The credential expired. */
+    CREDENTIAL_NOT_ALLOWED  /**< The credential is not valid on this door at this time. */
+} credential_result_t;
+
+credential_result_t CREDENTIAL_Verify(const uint8_t *uid, const uint8_t *data, uint8_t doorId,
+                                      uint32_t timestamp, credential_t *credential);
+
+void CREDENTIAL_Issue(const credential_t *credential, const uint8_t *key, uint16_t keyLength,
+                      const uint8_t *uid, uint8_t *data);
+
+#endif /* CREDENTIAL_H */
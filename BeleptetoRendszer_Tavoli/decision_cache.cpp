@@ -0,0 +1,260 @@
+/**
+ ***************************************************************************************************
+ * @file decision_cache.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Implementation of decision_cache.h.
+ *
+ * A card resting on a reader is read again every few tens of milliseconds, these reads are ignored
+ * until the card is away for #DECISION_CACHE_HOLDOFF_MS. A card denied again within
+ * #DECISION_CACHE_REPEAT_WINDOW_MS is only counted, and one summary log carries the count (see
+ * #AUTHENTICATE_LOG_AUTH_REPEATS) when the repeats stop, the count is full, the card is evicted or
+ * the logs leave the module. So a card presented over and over costs two logs per burst instead of
+ * one per read, and every denial is still accounted for. The granted decisions are logged every
+ * time, they open the door.
+ ***************************************************************************************************
+ */
+
+#include "decision_cache.h"
+
+#include <string.h>
+
+#include "BeleptetoRendszer_Tavoli.h"
+#include "authenticate_log.h"
+#include "rfid.h"
+
+static_assert(DOOR_CHANNEL_MAX <= (1 << (AUTHENTICATE_LOG_AUTH_REPEAT_SHIFT -
+                                         AUTHENTICATE_LOG_AUTH_CHANNEL_SHIFT)),
+              "The channel does not fit in the authentication state of the logs");
+
+/**
+ * @brief A card recently decided on.
+ */
+typedef struct _decision_cache_entry_t
+{
+    uint8_t uid[RFID_UID_SIZE];  /**< The UID of the card. */
+    uint8_t channel;             /**< The channel of the reader. */
+    bool used;                   /**< True if the entry holds a card. */
+    bool granted;                /**< The last decision on the card. */
+    uint8_t repeats;             /**< The denials counted since the last log of the card. */
+    unsigned long seenMillis;    /**< Value of TIMERS_Millis() at the last read of the card. */
+    unsigned long decidedMillis; /**< Value of TIMERS_Millis() at the last decision. */
+    unsigned long repeatMillis;  /**< Value of TIMERS_Millis() at the first counted repeat. */
+    unixtime_t repeatTime;       /**< The time of the last counted repeat. */
+} decision_cache_entry_t;
+
+/**
+ * @brief The recent decisions.
+ */
+static decision_cache_entry_t decisionCache[DECISION_CACHE_SIZE];
+
+/**
+ * @brief Statistics of the cache.
+ */
+static decision_cache_stats_t decisionCacheStats;
+
+/**
+ * @brief Find the entry of a card.
+ * @param uid The UID of the card.
+ * @param channel The channel of the reader.
+ * @return The entry, nullptr if the card is not in the cache.
+ */
+static decision_cache_entry_t *DECISION_CACHE_Find(const uint8_t *uid, uint8_t channel)
+{
+    for (uint8_t i = 0; i < DECISION_CACHE_SIZE; i++)
+    {
+        decision_cache_entry_t *entry = &(decisionCache[i]);
+        if (entry->used && (entry->channel == channel) && RFID_UidEquals(entry->uid, uid))
+        {
+            return entry;
+        }
+    }
+    return nullptr;
+}
+
+/**
+ * @brief Write the summary log of the counted repeats of a card.
+ * @param entry The entry of the card.
+ */
+static void DECISION_CACHE_WriteSummary(decision_cache_entry_t *entry)
+{
+    if (entry->repeats == 0)
+    {
+        return;
+    }
+    AUTHENTICATE_LOG_WriteLog(entry->uid, entry->repeatTime,
+                              AUTHENTICATE_LOG_AUTH_REPEATS(false, entry->channel, entry->repeats));
+    entry->repeats = 0;
+    decisionCacheStats.summaries++;
+}
+
+/**
+ * @brief Check if the counted repeats of a card have to be logged.
+ * @param entry The entry of the card.
+ * @param millis The current value of TIMERS_Millis().
+ * @return True if the card has repeats, and they stopped or waited long enough, false otherwise.
+ */
+static bool DECISION_CACHE_IsEntrySummaryDue(const decision_cache_entry_t *entry,
+                                             unsigned long millis)
+{
+    return (entry->repeats > 0) &&
+           (((millis - entry->decidedMillis) >= DECISION_CACHE_REPEAT_WINDOW_MS) ||
+            ((millis - entry->repeatMillis) >= DECISION_CACHE_SUMMARY_MAX_MS));
+}
+
+/**
+ * @brief Get an entry for a new card: a free one, or the one read the longest ago.
+ * @param millis The current value of TIMERS_Millis().
+ * @return The entry, its former card is logged.
+ */
+static decision_cache_entry_t *DECISION_CACHE_Allocate(unsigned long millis)
+{
+    decision_cache_entry_t *oldest = &(decisionCache[0]);
+    for (uint8_t i = 0; i < DECISION_CACHE_SIZE; i++)
+    {
+        decision_cache_entry_t *entry = &(decisionCache[i]);
+        if (!entry->used)
+        {
+            return entry;
+        }
+        if ((millis - entry->seenMillis) > (millis - oldest->seenMillis))
+        {
+            oldest = entry;
+        }
+    }
+    DECISION_CACHE_WriteSummary(oldest);
+    decisionCacheStats.evictions++;
+    return oldest;
+}
+
+/**
+ * @brief Check if a card read is the same presentation as its previous read.
+ * @param uid The UID of the card.
+ * @param channel The channel of the reader.
+ * @param millis The current value of TIMERS_Millis().
+ * @return True if the card was read within #DECISION_CACHE_HOLDOFF_MS, ignore the read then, false
+ * if it has to be decided on.
+ * @note The hold-off starts again at every read, so it lasts while the card stays in the field.
+ */
+bool DECISION_CACHE_IsLingering(const uint8_t *uid, uint8_t channel, unsigned long millis)
+{
+    decision_cache_entry_t *entry = DECISION_CACHE_Find(uid, channel);
+    if (entry == nullptr)
+    {
+        return false;
+    }
+    bool lingering = (millis - entry->seenMillis) < DECISION_CACHE_HOLDOFF_MS;
+    entry->seenMillis = millis;
+    if (lingering)
+    {
+        decisionCacheStats.lingering++;
+    }
+    return lingering;
+}
+
+/**
+ * @brief Record a decision on a card.
+ * @param uid The UID of the card.
+ * @param channel The channel of the reader.
+ * @param granted True if the card was granted access.
+ * @param time The time of the decision.
+ * @param millis The current value of TIMERS_Millis().
+ * @return True if the decision has to be logged, false if it was counted as a repeat.
+ * @note The counted repeats of the card are logged first if the decision changed.
+ */
+bool DECISION_CACHE_Record(const uint8_t *uid, uint8_t channel, bool granted, unixtime_t time,
+                           unsigned long millis)
+{
+    decision_cache_entry_t *entry = DECISION_CACHE_Find(uid, channel);
+    if (entry == nullptr)
+    {
+        entry = DECISION_CACHE_Allocate(millis);
+        RFID_UidCopy(entry->uid, uid);
+        entry->channel = channel;
+        entry->used = true;
+        entry->repeats = 0;
+    }
+    else if (!granted && !entry->granted &&
+             ((millis - entry->decidedMillis) < DECISION_CACHE_REPEAT_WINDOW_MS))
+    {
+        if (entry->repeats == 0)
+        {
+            entry->repeatMillis = millis;
+        }
+        entry->repeats++;
+        entry->repeatTime = time;
+        entry->seenMillis = millis;
+        entry->decidedMillis = millis;
+        decisionCacheStats.repeats++;
+        if (entry->repeats == AUTHENTICATE_LOG_AUTH_REPEAT_MAX)
+        {
+            DECISION_CACHE_WriteSummary(entry);
+        }
+        return false;
+    }
+    else
+    {
+        DECISION_CACHE_WriteSummary(entry);
+    }
+
+    entry->granted = granted;
+    entry->seenMillis = millis;
+    entry->decidedMillis = millis;
+    return true;
+}
+
+/**
+ * @brief Check if the counted repeats of a card have to be logged.
+ * @param millis The current value of TIMERS_Millis().
+ * @return True if the repeats of a card stopped for #DECISION_CACHE_REPEAT_WINDOW_MS, or waited
+ * #DECISION_CACHE_SUMMARY_MAX_MS, false otherwise.
+ */
+bool DECISION_CACHE_IsSummaryDue(unsigned long millis)
+{
+    for (uint8_t i = 0; i < DECISION_CACHE_SIZE; i++)
+    {
+        if (DECISION_CACHE_IsEntrySummaryDue(&(decisionCache[i]), millis))
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief Log the counted repeats that are due, see DECISION_CACHE_IsSummaryDue().
+ * @param millis The current value of TIMERS_Millis().
+ */
+void DECISION_CACHE_WriteDueSummaries(unsigned long millis)
+{
+    for (uint8_t i = 0; i < DECISION_CACHE_SIZE; i++)
+    {
+        if (DECISION_CACHE_IsEntrySummaryDue(&(decisionCache[i]), millis))
+        {
+            DECISION_CACHE_WriteSummary(&(decisionCache[i]));
+        }
+    }
+}
+
+/**
+ * @brief Log every counted repeat.
+ * @note Called before the logs are uploaded and before the deep sleep, which loses the cache. The
+ * cards stay in the cache, a later denial starts a new count.
+ */
+void DECISION_CACHE_WriteSummaries(void)
+{
+    for (uint8_t i = 0; i < DECISION_CACHE_SIZE; i++)
+    {
+        DECISION_CACHE_WriteSummary(&(decisionCache[i]));
+    }
+}
+
+/**
+ * @brief Get the statistics of the cache.
+ * @param stats Pointer to the location where the statistics will be put.
+ */
+void DECISION_CACHE_GetStats(decision_cache_stats_t *stats)
+{
+    *stats = decisionCacheStats;
+}
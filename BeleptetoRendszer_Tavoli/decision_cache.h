@@ -0,0 +1,63 @@
+/**
+ ***************************************************************************************************
+ * @file decision_cache.h
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Header file for the cache of the recent decisions, which coalesces the repeated reads of
+ * a card into fewer logs.
+ ***************************************************************************************************
+ */
+
+#ifndef DECISION_CACHE_H
+#define DECISION_CACHE_H
+
+#include <stdint.h>
+
+#include "rtc.h"
+
+/**
+ * @defgroup decision_cache_constants Decision cache constants
+ * @{
+ */
+/** @brief The number of cards remembered, a card read on two channels takes two. */
+#define DECISION_CACHE_SIZE 8
+/** @brief A card read again within this time after its last read is still the same presentation. */
+#ifndef DECISION_CACHE_HOLDOFF_MS
+#define DECISION_CACHE_HOLDOFF_MS 3000UL
+#endif
+/** @brief A denial within this time after the last one of the card only counts as a repeat. */
+#ifndef DECISION_CACHE_REPEAT_WINDOW_MS
+#define DECISION_CACHE_REPEAT_WINDOW_MS 60000UL
+#endif
+/** @brief The longest time the repeats of a card wait for their log. */
+#ifndef DECISION_CACHE_SUMMARY_MAX_MS
+#define DECISION_CACHE_SUMMARY_MAX_MS (10UL * 60UL * 1000UL)
+#endif
+/** @} */
+
+/**
+ * @brief Statistics of the cache since the start of the module.
+ */
+typedef struct _decision_cache_stats_t
+{
+    uint32_t lingering; /**< The reads of a card still in the field, ignored. */
+    uint32_t repeats;   /**< The repeated denials counted instead of logged. */
+    uint32_t summaries; /**< The logs written for the counted repeats. */
+    uint32_t evictions; /**< The cards dropped for a new one. */
+} decision_cache_stats_t;
+
+bool DECISION_CACHE_IsLingering(const uint8_t *uid, uint8_t channel, unsigned long millis);
+
+bool DECISION_CACHE_Record(const uint8_t *uid, uint8_t channel, bool granted, unixtime_t time,
+                           unsigned long millis);
+
+bool DECISION_CACHE_IsSummaryDue(unsigned long millis);
+
+void DECISION_CACHE_WriteDueSummaries(unsigned long millis);
+
+void DECISION_CACHE_WriteSummaries(void);
+
+void DECISION_CACHE_GetStats(decision_cache_stats_t *stats);
+
+#endif /* DECISION_CACHE_H */
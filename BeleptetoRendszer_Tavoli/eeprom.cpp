@@ -10,6 +10,9 @@
 
 #include "eeprom.h"
 
+#include <Arduino.h>
+#include <string.h>
+
 #include "EEPROM_24LC64.h"
 
 /**
@@ -32,12 +35,126 @@ static uint8_t memoryImage[EEPROM_24LC64_SIZE];
  */
 static bool updatedPage[EEPROM_24LC64_SIZE_IN_PAGES];
 
+/**
+ * @brief The pages of the memory image read from the EEPROM.
+ * @note The pages are read on their first use, so a module resuming from deep sleep only reads
+ * the header and the records it looks up, not the whole EEPROM.
+ */
+static bool loadedPage[EEPROM_24LC64_SIZE_IN_PAGES];
+
+/**
+ * @defgroup eeprom_commit EEPROM commit
+ * @brief The committed pages waiting to be written to the EEPROM.
+ *
+ * EEPROM_MemoryImage_Commit() only marks the updated pages, and EEPROM_MemoryImage_CommitStep()
+ * writes one of them per write cycle of the EEPROM, so a commit of many pages does not block the
+ * loop. The time of the last write tells when the EEPROM accepts the next access.
+ * @{
+ */
+static bool pendingPage[EEPROM_24LC64_SIZE_IN_PAGES];
+static uint16_t pendingCount = 0;
+static uint16_t pendingNext = 0;
+static bool writeBusy = false;
+static unsigned long writeMillis = 0;
+/** @} */
+
+/**
+ * @defgroup eeprom_staging EEPROM staging
+ * @brief The staged range of the memory image.
+ *
+ * The changes of the staged pages are not committed and not visible to EEPROM_Read() until the
+ * staging ends, so data can be assembled in the memory image over a longer time, while the rest of
+ * the EEPROM is used normally.
+ * @{
+ */
+static bool staging = false;
+static uint16_t stagingFirstPage = 0;
+static uint16_t stagingEndPage = 0;
+/** @} */
+
+/**
+ * @brief Check if a page contains staged changes.
+ * @param page The index of the page.
+ * @return True if the page is in the staged range and it was updated, false otherwise.
+ */
+static bool EEPROM_IsStagedPage(uint16_t page)
+{
+    return staging && updatedPage[page] && (page >= stagingFirstPage) && (page < stagingEndPage);
+}
+
+/**
+ * @brief Check if the write cycle of the last written page ended.
+ * @return True if the EEPROM accepts the next access, false otherwise.
+ */
+static bool EEPROM_IsReady(void)
+{
+    return !writeBusy || ((millis() - writeMillis) > EEPROM_24LC64_WRITE_DELAY_MS);
+}
+
+/**
+ * @brief Wait until the write cycle of the last written page ends.
+ */
+static void EEPROM_WaitReady(void)
+{
+    while (!EEPROM_IsReady())
+    {
+        delay(1);
+    }
+    writeBusy = false;
+}
+
+/**
+ * @brief Write a committed page to the EEPROM.
+ * @param page The index of the page.
+ * @note The EEPROM has to be ready.
+ */
+static void EEPROM_WritePage(uint16_t page)
+{
+    pendingPage[page] = false;
+    pendingCount--;
+    eeprom.writePage(page * EEPROM_24LC64_PAGE_SIZE,
+                     &(memoryImage[page * EEPROM_24LC64_PAGE_SIZE]),
+                     EEPROM_24LC64_PAGE_SIZE);
+    writeBusy = true;
+    writeMillis = millis();
+}
+
+/**
+ * @brief Drop the changes of a page by reading it back from the EEPROM.
+ * @param page The index of the page.
+ */
+static void EEPROM_RestorePage(uint16_t page)
+{
+    updatedPage[page] = false;
+    loadedPage[page] = true;
+    EEPROM_WaitReady();
+    eeprom.readMultiBytes(page * EEPROM_24LC64_PAGE_SIZE,
+                          &(memoryImage[page * EEPROM_24LC64_PAGE_SIZE]),
+                          EEPROM_24LC64_PAGE_SIZE);
+}
+
+/**
+ * @brief Read a page into the memory image if it was not read yet.
+ * @param page The index of the page.
+ */
+static void EEPROM_LoadPage(uint16_t page)
+{
+    if (loadedPage[page])
+    {
+        return;
+    }
+    EEPROM_RestorePage(page);
+}
+
 /**
  * @brief Initialize the EEPROM.
+ * @note Nothing is read here, the pages of the memory image are read on their first use.
  */
 void EEPROM_Init()
 {
-    EEPROM_MemoryImage_Update();
+    memset(loadedPage, 0, sizeof(loadedPage));
+    memset(pendingPage, 0, sizeof(pendingPage));
+    pendingCount = 0;
 }
 
 /**
@@ -55,6 +172,10 @@ uint16_t EEPROM_GetSize(void)
  */
 const uint8_t *EEPROM_GetMemoryImage(void)
 {
+    for (uint16_t i = 0; i < EEPROM_24LC64_SIZE_IN_PAGES; i++)
+    {
+        EEPROM_LoadPage(i);
+    }
     return memoryImage;
 }
 
@@ -75,19 +196,28 @@ void EEPROM_Write(uint16_t address, const uint8_t *data, uint16_t length)
 
     for (uint16_t i = 0; i < length; i++)
     {
+        uint16_t page = (address + i) / EEPROM_24LC64_PAGE_SIZE;
+        EEPROM_LoadPage(page);
         if (memoryImage[address + i] == data[i])
         {
             // The data is the same as in the memory image
             continue;
         }
+        if (pendingPage[page])
+        {
+            // Write the committed content of the page before it changes again
+            EEPROM_WaitReady();
+            EEPROM_WritePage(page);
+        }
         memoryImage[address + i] = data[i];
-        updatedPage[(address + i) / EEPROM_24LC64_PAGE_SIZE] = true;
+        updatedPage[page] = true;
     }
 }
 
 /**
  * @brief Read data from the EEPROM.
  * @note The data is read from the memory image, not from the EEPROM. Update the memory image to read the data actually stored in the EEPROM.
+ * The staged pages are the exception, they are read from the EEPROM until the staging ends.
  * @param address The address to read from.
  * @param data The data to read.
  * @param length The length of the data.
@@ -100,9 +230,32 @@ void EEPROM_Read(uint16_t address, uint8_t *data, uint16_t length)
         return;
     }
 
-    for (uint16_t i = 0; i < length; i++)
+    uint16_t i = 0;
+    while (i < length)
     {
-        data[i] = memoryImage[address + i];
+        // Read until the end of the current page
+        uint16_t page = (address + i) / EEPROM_24LC64_PAGE_SIZE;
+        uint16_t chunk = EEPROM_24LC64_PAGE_SIZE - ((address + i) % EEPROM_24LC64_PAGE_SIZE);
+        if (chunk > length - i)
+        {
+            chunk = length - i;
+        }
+
+        if (EEPROM_IsStagedPage(page))
+        {
+            // The staged data is not valid yet, read the committed data
+            EEPROM_WaitReady();
+            eeprom.readMultiBytes(address + i, &(data[i]), chunk);
+        }
+        else
+        {
+            EEPROM_LoadPage(page);
+            for (uint16_t j = 0; j < chunk; j++)
+            {
+                data[i + j] = memoryImage[address + i + j];
+            }
+        }
+        i += chunk;
     }
 }
 
@@ -111,9 +264,12 @@ void EEPROM_Read(uint16_t address, uint8_t *data, uint16_t length)
  */
 void EEPROM_MemoryImage_Update(void)
 {
+    EEPROM_MemoryImage_Flush();
+
     // Read the whole EEPROM in page size chunks
     for (uint16_t i = 0; i < EEPROM_24LC64_SIZE_IN_PAGES; i++)
     {
+        loadedPage[i] = true;
         eeprom.readMultiBytes(i * EEPROM_24LC64_PAGE_SIZE,
                               &(memoryImage[i * EEPROM_24LC64_PAGE_SIZE]),
                               EEPROM_24LC64_PAGE_SIZE);
@@ -122,27 +278,148 @@ void EEPROM_MemoryImage_Update(void)
 
 /**
  * @brief Commit the EEPROM memory image.
+ * @note The updated pages are only marked here, EEPROM_MemoryImage_CommitStep() writes them one by
+ * one. The committed changes stay in the memory image, so they are read back even before they are
+ * written.
  */
 void EEPROM_MemoryImage_Commit(void)
 {
     // Note: At each write operation, the EEPROM updates the whole page that contains the write
     // address. Therefore, it is most efficient to write data in page size chunks.
 
-    // Make sure the EEPROM is not busy
-    delay(EEPROM_24LC64_WRITE_DELAY_MS);
+    for (uint16_t i = 0; i < EEPROM_24LC64_SIZE_IN_PAGES; i++)
+    {
+        if (!updatedPage[i] || EEPROM_IsStagedPage(i))
+        {
+            // Only write pages that have been updated, and are not staged
+            continue;
+        }
+        updatedPage[i] = false;
+        if (!pendingPage[i])
+        {
+            pendingPage[i] = true;
+            pendingCount++;
+        }
+    }
+}
+
+/**
+ * @brief Check if committed pages are waiting to be written.
+ * @return True if a page is waiting, false otherwise.
+ */
+bool EEPROM_MemoryImage_IsCommitPending(void)
+{
+    return pendingCount > 0;
+}
+
+/**
+ * @brief Check if the next committed page can be written without waiting.
+ * @return True if a page is waiting and the EEPROM is ready, false otherwise.
+ */
+bool EEPROM_MemoryImage_IsCommitReady(void)
+{
+    return (pendingCount > 0) && EEPROM_IsReady();
+}
+
+/**
+ * @brief Write the next committed page to the EEPROM, if the EEPROM is ready.
+ * @return True if committed pages are still waiting, false otherwise.
+ * @note This does not wait for the write cycle, call it again after
+ * EEPROM_MemoryImage_IsCommitReady() returns true.
+ */
+bool EEPROM_MemoryImage_CommitStep(void)
+{
+    if ((pendingCount == 0) || !EEPROM_IsReady())
+    {
+        return pendingCount > 0;
+    }
+
+    // Continue after the last written page, so the pages are written in address order
+    while (!pendingPage[pendingNext])
+    {
+        pendingNext = (pendingNext + 1) % EEPROM_24LC64_SIZE_IN_PAGES;
+    }
+    EEPROM_WritePage(pendingNext);
+    return pendingCount > 0;
+}
+
+/**
+ * @brief Write every committed page to the EEPROM, and wait for the last write cycle.
+ * @note Call this before the module stops, for example before the deep sleep.
+ */
+void EEPROM_MemoryImage_Flush(void)
+{
+    while (pendingCount > 0)
+    {
+        EEPROM_WaitReady();
+        EEPROM_MemoryImage_CommitStep();
+    }
+    EEPROM_WaitReady();
+}
+
+/**
+ * @brief Discard the uncommitted changes of the EEPROM memory image.
+ * @note Only the updated pages are read back from the EEPROM.
+ */
+void EEPROM_MemoryImage_Discard(void)
+{
+    EEPROM_MemoryImage_Flush();
 
-    // Write all updated pages to the EEPROM
     for (uint16_t i = 0; i < EEPROM_24LC64_SIZE_IN_PAGES; i++)
     {
         if (!updatedPage[i])
         {
-            // Only write pages that have been updated
+            // Only restore pages that have been updated
             continue;
         }
-        updatedPage[i] = false;
-        eeprom.writePage(i * EEPROM_24LC64_PAGE_SIZE,
-                         &(memoryImage[i * EEPROM_24LC64_PAGE_SIZE]),
-                         EEPROM_24LC64_PAGE_SIZE);
-        delay(EEPROM_24LC64_WRITE_DELAY_MS);
+        EEPROM_RestorePage(i);
+    }
+}
+
+/**
+ * @brief Start staging the changes of a range of the memory image.
+ * @param address The start address of the range.
+ * @param length The length of the range.
+ * @note The range is extended to whole pages.
+ */
+void EEPROM_Staging_Begin(uint16_t address, uint16_t length)
+{
+    if (address + length > EEPROM_24LC64_SIZE)
+    {
+        // Trying to stage outside of the EEPROM
+        return;
+    }
+
+    staging = true;
+    stagingFirstPage = address / EEPROM_24LC64_PAGE_SIZE;
+    stagingEndPage = (address + length + EEPROM_24LC64_PAGE_SIZE - 1) / EEPROM_24LC64_PAGE_SIZE;
+}
+
+/**
+ * @brief End the staging, the staged changes become normal uncommitted changes.
+ */
+void EEPROM_Staging_End(void)
+{
+    staging = false;
+}
+
+/**
+ * @brief End the staging and discard the staged changes.
+ */
+void EEPROM_Staging_Discard(void)
+{
+    if (!staging)
+    {
+        return;
+    }
+
+    for (uint16_t i = stagingFirstPage; i < stagingEndPage; i++)
+    {
+        if (!updatedPage[i])
+        {
+            continue;
+        }
+        EEPROM_RestorePage(i);
     }
+    staging = false;
 }
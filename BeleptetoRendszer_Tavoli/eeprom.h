@@ -18,6 +18,11 @@
  */
 #define EEPROM_SIZE 8192
 
+/**
+ * @brief Size of one page of the EEPROM in bytes.
+ */
+#define EEPROM_PAGE_SIZE 32
+
 void EEPROM_Init(void);
 
 uint16_t EEPROM_GetSize(void);
@@ -32,4 +37,20 @@ void EEPROM_MemoryImage_Update(void);
 
 void EEPROM_MemoryImage_Commit(void);
 
+bool EEPROM_MemoryImage_IsCommitPending(void);
+
+bool EEPROM_MemoryImage_IsCommitReady(void);
+
+bool EEPROM_MemoryImage_CommitStep(void);
+
+void EEPROM_MemoryImage_Flush(void);
+
+void EEPROM_MemoryImage_Discard(void);
+
+void EEPROM_Staging_Begin(uint16_t address, uint16_t length);
+
+void EEPROM_Staging_End(void);
+
+void EEPROM_Staging_Discard(void);
+
 #endif /* EEPROM_H */
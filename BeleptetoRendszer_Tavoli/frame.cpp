@@ -0,0 +1,142 @@
+/**
+ ***************************************************************************************************
+ * @file frame.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Implementation of frame.h.
+ ***************************************************************************************************
+ */
+
+#include "frame.h"
+
+#include <string.h>
+
+#include "byteorder.h"
+#include "crc32.h"
+
+/**
+ * @brief Encode a frame.
+ * @param buffer Buffer of at least #FRAME_MAX_SIZE bytes to store the encoded frame in.
+ * @param type The type of the frame.
+ * @param offset The offset of the payload in the transferred data.
+ * @param total The total size of the transferred data.
+ * @param payload The payload of the frame, can be nullptr if length is 0.
+ * @param length The length of the payload.
+ * @return The size of the encoded frame, 0 if the payload is too long.
+ */
+uint16_t FRAME_Encode(uint8_t *buffer, uint8_t type, uint16_t offset, uint16_t total,
+                      const uint8_t *payload, uint16_t length)
+{
+    if (length > FRAME_MAX_WIRE_PAYLOAD)
+    {
+        return 0;
+    }
+
+    buffer[0] = FRAME_MAGIC;
+    buffer[1] = type;
+    buffer[2] = (uint8_t)(offset >> 8);
+    buffer[3] = (uint8_t)(offset & 0xFF);
+    buffer[4] = (uint8_t)(total >> 8);
+    buffer[5] = (uint8_t)(total & 0xFF);
+    buffer[6] = (uint8_t)(length >> 8);
+    buffer[7] = (uint8_t)(length & 0xFF);
+    if (length > 0)
+    {
+        memcpy(&(buffer[FRAME_HEADER_SIZE]), payload, length);
+    }
+
+    uint16_t size = FRAME_HEADER_SIZE + length;
+    uint32_t crc = CRC32_Final(CRC32_Update(CRC32_Init(), buffer, size));
+    BYTEORDER_WriteUint32Be(&(buffer[size]), crc);
+
+    return size + FRAME_CRC_SIZE;
+}
+
+/**
+ * @brief Reset the frame decoder to wait for the start of a new frame.
+ * @param parser The frame decoder.
+ */
+void FRAME_ParserReset(frame_parser_t *parser)
+{
+    parser->position = 0;
+    parser->crc = CRC32_Init();
+    parser->crcReceived = 0;
+}
+
+/**
+ * @brief Feed a received byte to the frame decoder.
+ * @param parser The frame decoder.
+ * @param frame The frame to decode into.
+ * @param byte The received byte.
+ * @return #FRAME_PARSE_COMPLETE if the byte completed a valid frame, #FRAME_PARSE_ERROR if the
+ * frame is invalid, #FRAME_PARSE_PENDING otherwise.
+ * @note The decoder resets itself after a complete frame or an error.
+ */
+frame_parse_result_t FRAME_ParserFeed(frame_parser_t *parser, frame_t *frame, uint8_t byte)
+{
+    uint16_t position = parser->position++;
+
+    if (position < FRAME_HEADER_SIZE)
+    {
+        parser->crc = CRC32_Update(parser->crc, &byte, 1);
+
+        switch (position)
+        {
+        case 0:
+            if (byte != FRAME_MAGIC)
+            {
+                FRAME_ParserReset(parser);
+                return FRAME_PARSE_ERROR;
+            }
+            break;
+        case 1:
+            frame->type = byte;
+            break;
+        case 2:
+            frame->offset = (uint16_t)(byte) << 8;
+            break;
+        case 3:
+            frame->offset |= byte;
+            break;
+        case 4:
+            frame->total = (uint16_t)(byte) << 8;
+            break;
+        case 5:
+            frame->total |= byte;
+            break;
+        case 6:
+            frame->length = (uint16_t)(byte) << 8;
+            break;
+        default:
+            frame->length |= byte;
+            if (frame->length > FRAME_MAX_WIRE_PAYLOAD)
+            {
+                FRAME_ParserReset(parser);
+                return FRAME_PARSE_ERROR;
+            }
+            break;
+        }
+
+        return FRAME_PARSE_PENDING;
+    }
+
+    if (position < FRAME_HEADER_SIZE + frame->length)
+    {
+        parser->crc = CRC32_Update(parser->crc, &byte, 1);
+        frame->payload[position - FRAME_HEADER_SIZE] = byte;
+        return FRAME_PARSE_PENDING;
+    }
+
+    // The remaining bytes are the CRC
+    parser->crcReceived = (parser->crcReceived << 8) | byte;
+    if (position < FRAME_HEADER_SIZE + frame->length + FRAME_CRC_SIZE - 1)
+    {
+        return FRAME_PARSE_PENDING;
+    }
+
+    bool valid = (CRC32_Final(parser->crc) == parser->crcReceived);
+    FRAME_ParserReset(parser);
+
+    return valid ? FRAME_PARSE_COMPLETE : FRAME_PARSE_ERROR;
+}
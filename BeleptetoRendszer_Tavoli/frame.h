@@ -0,0 +1,132 @@
+/**
+ ***************************************************************************************************
+ * @file frame.h
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Header file for the binary frames of the sync protocol.
+ *
+ * Layout of a frame, all numbers are big-endian:
+ * | Magic | Type | Offset | Total | Length | Payload      | CRC-32 |
+ * | 1     | 1    | 2      | 2     | 2      | Length bytes | 4      |
+ *
+ * The CRC-32 covers every byte of the frame before it.
+ *
+ * On a secure channel (secure.h) the type of every frame after the key exchange has
+ * #FRAME_TYPE_SEALED set, and the payload is encrypted and followed by its authentication tag.
+ ***************************************************************************************************
+ */
+
+#ifndef FRAME_H
+#define FRAME_H
+
+#include <stdint.h>
+
+/**
+ * @defgroup frame_sizes Frame sizes
+ * @brief The sizes of the parts of a frame.
+ * @{
+ */
+#define FRAME_MAGIC 0xA5
+#define FRAME_HEADER_SIZE 8
+#define FRAME_CRC_SIZE 4
+#define FRAME_MAX_PAYLOAD 256
+/** @brief Size of the authentication tag after the payload of a sealed frame. */
+#define FRAME_SEAL_SIZE 16
+#define FRAME_MAX_WIRE_PAYLOAD (FRAME_MAX_PAYLOAD + FRAME_SEAL_SIZE)
+#define FRAME_MAX_SIZE (FRAME_HEADER_SIZE + FRAME_MAX_WIRE_PAYLOAD + FRAME_CRC_SIZE)
+/** @} */
+
+/**
+ * @defgroup frame_types Frame types
+ * @brief The types of the frames exchanged with the central module.
+ * @{
+ */
+/** @brief Start of a session. Request payload: chip ID (4 bytes), answer payload: door ID (1). */
+#define FRAME_TYPE_HELLO 'H'
+/** @brief Batch of log records. Payload: sequence number of the first record (4 bytes), records. */
+#define FRAME_TYPE_LOG 'L'
+/** @brief Request of new memory from offset. Payload: current hash, hash of the resumed memory. */
+#define FRAME_TYPE_NEW_MEMORY 'N'
+/** @brief Answer to #FRAME_TYPE_NEW_MEMORY if the memory of the central module is the same. */
+#define FRAME_TYPE_NOT_MODIFIED 'S'
+/** @brief Answer to #FRAME_TYPE_NEW_MEMORY. Offset: first data offset, payload: hash of memory. */
+#define FRAME_TYPE_IMAGE_INFO 'I'
+/**
+ * @brief Request of a range of the memory. Offset: start of the range, total: length of the range,
+ * payload: hash of the memory. Answered with data frames if the memory has the same hash, with
+ * #FRAME_TYPE_IMAGE_INFO of the current memory otherwise.
+ */
+#define FRAME_TYPE_RANGE 'R'
+/**
+ * @brief Chunk of the downloaded memory at offset, total is the size of the memory. The central
+ * module broadcasts the shared memory as #FRAME_TYPE_IMAGE_INFO and chunks of
+ * #FRAME_MAX_PAYLOAD bytes, one frame per datagram.
+ */
+#define FRAME_TYPE_DATA 'D'
+/**
+ * @brief Acknowledgement, offset is the number of contiguous bytes stored by the receiver. The
+ * answer to #FRAME_TYPE_LOG has the sequence number the central module expects next as payload.
+ */
+#define FRAME_TYPE_ACK 'A'
+/**
+ * @brief Request of the current time. Answer payload: UNIX time (4 bytes), optionally followed by
+ * the sync slot assigned to the module, in seconds after the start of the sync hour (2 bytes).
+ */
+#define FRAME_TYPE_TIME 'T'
+/**
+ * @brief Revocation probe. Request payload: revocation version of the module (4 bytes), nonce (4).
+ * Answer: total is the number of revocations left after this answer, payload: base version (4),
+ * version (4), UIDs of the cards revoked after the base version (10 bytes each), HMAC-SHA256 of
+ * the chip ID, the nonce and the preceding payload.
+ */
+#define FRAME_TYPE_REVOCATION 'V'
+/**
+ * @brief Key exchange of the secure channel, before any other frame. Offset: handshake mode, see
+ * secure.h. An empty answer rejects the session ticket of the module.
+ */
+#define FRAME_TYPE_KEY 'K'
+/** @brief Flag of the type of a sealed frame, see secure.h. */
+#define FRAME_TYPE_SEALED 0x80
+/** @} */
+
+/**
+ * @brief A decoded frame.
+ */
+typedef struct _frame_t
+{
+    uint8_t type;                            /**< The type of the frame, see @ref frame_types. */
+    uint16_t offset;                         /**< The offset of the payload in the data. */
+    uint16_t total;                          /**< The total size of the transferred data. */
+    uint16_t length;                         /**< The length of the payload. */
+    uint8_t payload[FRAME_MAX_WIRE_PAYLOAD]; /**< The payload of the frame. */
+} frame_t;
+
+/**
+ * @brief The state of the incremental frame decoder.
+ */
+typedef struct _frame_parser_t
+{
+    uint16_t position; /**< The number of bytes of the current frame received so far. */
+    uint32_t crc;      /**< The running CRC of the current frame. */
+    uint32_t crcReceived; /**< The CRC received at the end of the current frame. */
+} frame_parser_t;
+
+/**
+ * @brief The result of feeding a byte to the frame decoder.
+ */
+typedef enum _frame_parse_result_t
+{
+    FRAME_PARSE_PENDING,  /**< The frame is not complete yet. */
+    FRAME_PARSE_COMPLETE, /**< A valid frame was decoded. */
+    FRAME_PARSE_ERROR     /**< The frame is malformed or corrupted. */
+} frame_parse_result_t;
+
+uint16_t FRAME_Encode(uint8_t *buffer, uint8_t type, uint16_t offset, uint16_t total,
+                      const uint8_t *payload, uint16_t length);
+
+void FRAME_ParserReset(frame_parser_t *parser);
+
+frame_parse_result_t FRAME_ParserFeed(frame_parser_t *parser, frame_t *frame, uint8_t byte);
+
+#endif /* FRAME_H */
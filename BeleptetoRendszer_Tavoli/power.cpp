@@ -0,0 +1,283 @@
+/**
+ ***************************************************************************************************
+ * @file power.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Implementation of power.h.
+ * @note The module sleeps in the forced light sleep of the ESP8266: the CPU and the modem are
+ * stopped, the outputs keep their level, and the sleep ends at the requested time or when a wakeup
+ * pin goes to its active level. Only the GPIO0 - GPIO15 pins can wake the CPU, so the wakeup
+ * button on GPIO16 is polled by limiting the length of the sleep.
+ *
+ * In the deep sleep only the RTC of the ESP8266 runs. The module restarts when the wakeup button
+ * or the countdown timer of the PCF8523 pulls its reset input, and resumes from the state saved in
+ * the RTC user memory.
+ ***************************************************************************************************
+ */
+
+#include "power.h"
+
+#include <Arduino.h>
+
+extern "C"
+{
+#include <user_interface.h>
+}
+
+#include "BeleptetoRendszer_Tavoli.h"
+#include "crc32.h"
+#include "timers.h"
+#include "wifi.h"
+
+/**
+ * @defgroup power_constants Power constants
+ * @{
+ */
+/**
+ * @brief The shortest light sleep, a shorter wait is a delay() since the wakeup costs a few
+ * milliseconds.
+ */
+#define POWER_MIN_SLEEP_MS 10
+
+/**
+ * @brief The longest light sleep if the wakeup button cannot wake the CPU, this is the latency of
+ * the button.
+ */
+#ifndef POWER_WAKEUP_POLL_MS
+#define POWER_WAKEUP_POLL_MS 100
+#endif
+/** @} */
+
+/**
+ * @defgroup power_current_constants Power current constants
+ * @brief The typical current of the module in each mode, from the datasheet of the ESP8266, for
+ * the estimate of the average current. The RFID reader is not included.
+ * @{
+ */
+#define POWER_AWAKE_UA 20000UL
+#define POWER_LIGHT_SLEEP_UA 900UL
+#define POWER_DEEP_SLEEP_UA 20UL
+/** @} */
+
+/**
+ * @brief The state of the sleep, mirrored in the RTC user memory.
+ */
+typedef struct _power_state_t
+{
+    uint32_t crc;         /**< CRC-32 of the rest of the structure. */
+    uint32_t suspended;   /**< Nonzero if the module went to deep sleep and has not resumed yet. */
+    uint32_t millis;      /**< TIMERS_Millis() when the module went to deep sleep. */
+    unixtime_t time;      /**< The time when the module went to deep sleep. */
+    unixtime_t timerTime; /**< The time when the timer of the RTC wakes the module. */
+    power_stats_t stats;  /**< The statistics, see #power_stats_t. */
+} power_state_t;
+
+static_assert(sizeof(power_state_t) <= RTC_MEMORY_POWER_STATE_BLOCKS * 4,
+              "The sleep state does not fit in its RTC user memory area");
+
+/**
+ * @brief True if the wakeup button can end the light sleep.
+ */
+#define POWER_WAKEUP_PIN_CAN_WAKE (WAKEUP_PIN < 16)
+
+/**
+ * @brief True if the light sleep has ended, set by the wakeup callback.
+ */
+static volatile bool powerAwake = false;
+
+/**
+ * @brief The state of the sleep.
+ */
+static power_state_t powerState;
+
+/**
+ * @brief Called by the SDK when the forced light sleep ends.
+ */
+static void POWER_WakeupCallback(void)
+{
+    powerAwake = true;
+}
+
+/**
+ * @brief Get the level at which a pin wakes the CPU.
+ * @param pressed The level of the pin when it is active.
+ * @return The wakeup level for gpio_pin_wakeup_enable().
+ */
+static GPIO_INT_TYPE POWER_WakeupLevel(uint8_t pressed)
+{
+    return (pressed == LOW) ? GPIO_PIN_INTR_LOLEVEL : GPIO_PIN_INTR_HILEVEL;
+}
+
+/**
+ * @brief Sleep until the given time passes, the wakeup button is pressed or the RFID reader
+ * raises its interrupt.
+ * @param millis_sleep The longest time to sleep in milliseconds.
+ * @note The modem has to be off, so this must not be called during a synchronization. The time
+ * slept is measured with the RTC timer and added to TIMERS_Millis(), since millis() may not count
+ * it.
+ */
+void POWER_Sleep(unsigned long millis_sleep)
+{
+#if !POWER_WAKEUP_PIN_CAN_WAKE
+    if (millis_sleep > POWER_WAKEUP_POLL_MS)
+    {
+        millis_sleep = POWER_WAKEUP_POLL_MS;
+    }
+#endif
+    if (millis_sleep < POWER_MIN_SLEEP_MS)
+    {
+        delay(millis_sleep);
+        return;
+    }
+
+    // The UART stops in the sleep, let the debug output leave first
+    Serial.flush();
+
+    uint32_t rtcStart = system_get_rtc_time();
+    unsigned long millisStart = millis();
+
+    wifi_fpm_close();
+    wifi_set_opmode_current(NULL_MODE);
+    wifi_fpm_set_sleep_type(LIGHT_SLEEP_T);
+    wifi_fpm_open();
+    gpio_pin_wakeup_enable(GPIO_ID_PIN(RFID_IRQ_PIN), GPIO_PIN_INTR_LOLEVEL);
+#if POWER_WAKEUP_PIN_CAN_WAKE
+    gpio_pin_wakeup_enable(GPIO_ID_PIN(WAKEUP_PIN), POWER_WakeupLevel(WAKEUP_PRESSED));
+#endif
+    wifi_fpm_set_wakeup_cb(POWER_WakeupCallback);
+
+    powerAwake = false;
+    bool slept = (wifi_fpm_do_sleep(millis_sleep * 1000UL) == 0);
+    if (slept)
+    {
+        // The CPU goes to sleep once it is idle in delay(), and the callback runs on the wakeup,
+        // whether millis() counted the sleep or not
+        while (!powerAwake && ((millis() - millisStart) <= millis_sleep))
+        {
+            delay(1);
+        }
+    }
+    else
+    {
+        delay(millis_sleep);
+    }
+
+    gpio_pin_wakeup_disable();
+    wifi_fpm_close();
+    WIFI_ModemSleep();
+
+    uint32_t rtcTicks = system_get_rtc_time() - rtcStart;
+    unsigned long millisSlept =
+        (unsigned long)((((uint64_t)rtcTicks * system_rtc_clock_cali_proc()) >> 12) / 1000);
+    unsigned long millisCounted = millis() - millisStart;
+    if (millisSlept > millisCounted)
+    {
+        TIMERS_AddSleepMillis(millisSlept - millisCounted);
+    }
+
+    if (slept)
+    {
+        powerState.stats.sleepCount++;
+        powerState.stats.sleepMillis += millisSlept;
+        if (millisSlept + 1 < millis_sleep)
+        {
+            powerState.stats.pinWakeups++;
+        }
+    }
+}
+
+/**
+ * @brief Calculate the CRC of the sleep state.
+ * @return The CRC of every field after the CRC.
+ */
+static uint32_t POWER_StateCrc(void)
+{
+    const uint8_t *data = (const uint8_t *)&powerState + sizeof(powerState.crc);
+    return CRC32_Final(CRC32_Update(CRC32_Init(), data,
+                                    sizeof(powerState) - sizeof(powerState.crc)));
+}
+
+/**
+ * @brief Save the sleep state to the RTC user memory.
+ */
+static void POWER_StateSave(void)
+{
+    powerState.crc = POWER_StateCrc();
+    ESP.rtcUserMemoryWrite(RTC_MEMORY_POWER_STATE_OFFSET, (uint32_t *)&powerState,
+                           sizeof(powerState));
+}
+
+/**
+ * @brief Resume from the deep sleep.
+ * @param time The current time.
+ * @return The reason of the start, #POWER_WAKEUP_RESET if the module did not sleep.
+ * @note The time slept is added to TIMERS_Millis(), so the intervals measured with it continue
+ * over the deep sleep. The statistics are kept until the module starts without resuming.
+ */
+power_wakeup_t POWER_Resume(unixtime_t time)
+{
+    if (!ESP.rtcUserMemoryRead(RTC_MEMORY_POWER_STATE_OFFSET, (uint32_t *)&powerState,
+                               sizeof(powerState)) ||
+        (powerState.crc != POWER_StateCrc()) || !powerState.suspended)
+    {
+        // TIMERS_Millis() starts again, so do the statistics
+        memset(&powerState, 0, sizeof(powerState));
+        return POWER_WAKEUP_RESET;
+    }
+
+    RTC_ClearWakeupTimer();
+    uint32_t seconds_slept = (time > powerState.time) ? (time - powerState.time) : 0;
+    TIMERS_AddSleepMillis(powerState.millis + seconds_slept * 1000UL);
+    // The software clock was set from the RTC before, the jump is not time passed since
+    RTC_ShiftTimeBase(powerState.millis + seconds_slept * 1000UL);
+    powerState.stats.deepSleepSeconds += seconds_slept;
+    powerState.suspended = 0;
+    POWER_StateSave();
+
+    return (time >= powerState.timerTime) ? POWER_WAKEUP_ALARM : POWER_WAKEUP_BUTTON;
+}
+
+/**
+ * @brief Go to deep sleep until the given time or the wakeup button.
+ * @param time The current time.
+ * @param wakeTime The time to wake up, a sleep longer than the RTC timer wakes up earlier.
+ * @note This does not return, the module restarts. Save the state of the other modules first.
+ */
+void POWER_DeepSleep(unixtime_t time, unixtime_t wakeTime)
+{
+    uint32_t seconds = (wakeTime > time) ? (wakeTime - time) : 1;
+    powerState.timerTime = time + RTC_SetWakeupTimer(seconds);
+    powerState.time = time;
+    powerState.millis = TIMERS_Millis();
+    powerState.suspended = 1;
+    powerState.stats.deepSleepCount++;
+    POWER_StateSave();
+
+    Serial.flush();
+    ESP.deepSleep(0);
+}
+
+/**
+ * @brief Get the statistics of the sleep.
+ * @param stats The statistics since the module started without resuming.
+ */
+void POWER_GetStats(power_stats_t *stats)
+{
+    *stats = powerState.stats;
+
+    // TIMERS_Millis() counts both sleeps since the start
+    uint64_t total_millis = TIMERS_Millis();
+    uint64_t deep_millis = (uint64_t)stats->deepSleepSeconds * 1000;
+    uint64_t light_millis = stats->sleepMillis;
+    if (total_millis <= deep_millis + light_millis)
+    {
+        stats->averageMicroamps = 0;
+        return;
+    }
+    uint64_t awake_millis = total_millis - deep_millis - light_millis;
+    stats->averageMicroamps = (uint32_t)((awake_millis * POWER_AWAKE_UA +
+                                          light_millis * POWER_LIGHT_SLEEP_UA +
+                                          deep_millis * POWER_DEEP_SLEEP_UA) /
+                                         total_millis);
+}
@@ -0,0 +1,58 @@
+/**
+ ***************************************************************************************************
+ * @file power.h
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Header file for the light and deep sleep of the module between the events.
+ ***************************************************************************************************
+ */
+
+#ifndef POWER_H
+#define POWER_H
+
+#include <stdint.h>
+
+#include "rtc.h"
+
+/**
+ * @brief Enable the deep sleep between the events.
+ * @note The deep sleep needs the wakeup button and the interrupt output of the PCF8523 wired to
+ * the reset input of the ESP8266, the module restarts on both.
+ */
+#ifndef POWER_DEEP_SLEEP_ENABLED
+#define POWER_DEEP_SLEEP_ENABLED 0
+#endif
+
+/**
+ * @brief The reason of the start of the module.
+ */
+typedef enum _power_wakeup_t
+{
+    POWER_WAKEUP_RESET,  /**< Power on or reset, not a wakeup from deep sleep. */
+    POWER_WAKEUP_BUTTON, /**< The wakeup button ended the deep sleep. */
+    POWER_WAKEUP_ALARM   /**< The timer of the RTC ended the deep sleep. */
+} power_wakeup_t;
+
+/**
+ * @brief Statistics of the sleep since the module started without resuming.
+ */
+typedef struct _power_stats_t
+{
+    uint32_t sleepCount;       /**< The number of light sleeps. */
+    uint32_t sleepMillis;      /**< The time spent in light sleep. */
+    uint32_t pinWakeups;       /**< The light sleeps ended early by a wakeup pin. */
+    uint32_t deepSleepCount;   /**< The number of deep sleeps. */
+    uint32_t deepSleepSeconds; /**< The time spent in deep sleep. */
+    uint32_t averageMicroamps; /**< The average current, estimated from the time in each mode. */
+} power_stats_t;
+
+void POWER_Sleep(unsigned long millis_sleep);
+
+power_wakeup_t POWER_Resume(unixtime_t time);
+
+void POWER_DeepSleep(unixtime_t time, unixtime_t wakeTime);
+
+void POWER_GetStats(power_stats_t *stats);
+
+#endif /* POWER_H */
@@ -0,0 +1,227 @@
+/**
+ ***************************************************************************************************
+ * @file revocation.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Implementation of revocation.h.
+ *
+ * The central module numbers the revoked cards consecutively, the version is the number of
+ * revocations. The table image carries the version it already contains, the module asks for the
+ * revocations after its version and keeps them in RAM until the next table image. A delta is only
+ * accepted with a valid MAC over the challenge of the probe, so an answer cannot be replayed, and
+ * as long as #REVOCATION_KEY is kept secret it cannot be forged to bring a revoked card back.
+ *
+ * The revoked cards are kept as the CRC-32 of their UID, and mirrored in the RTC user memory, so
+ * they survive the deep sleep and the resets. A collision can only deny a card, never grant one.
+ ***************************************************************************************************
+ */
+
+#include "revocation.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+#include "BeleptetoRendszer_Tavoli.h"
+#include "authenticate_log.h"
+#include "byteorder.h"
+#include "crc32.h"
+
+/**
+ * @defgroup revocation_key Revocation key
+ * @brief The key shared with the central module for the MAC of the revocation deltas.
+ *
+ * The default key is only meant for development: it is in the repository, so anyone can forge a
+ * delta with it. A deployment defines its own key for the build.
+ * @{
+ */
+#ifndef REVOCATION_KEY
+/** @brief The key of the revocation MAC. */
+#define REVOCATION_KEY "belepteto_rendszer_revocation_01"
+#endif
+/** @} */
+
+/**
+ * @brief The revoked cards, mirrored in the RTC user memory.
+ */
+typedef struct _revocation_state_t
+{
+    uint32_t crc;                          /**< CRC-32 of the rest of the structure. */
+    uint32_t tableVersion;                 /**< The revocation version of the table image. */
+    uint32_t version;                      /**< The number of revocations known by the module. */
+    uint32_t count;                        /**< The number of digests in #revoked. */
+    uint32_t revoked[REVOCATION_CAPACITY]; /**< The digests of the revoked cards. */
+} revocation_state_t;
+
+static_assert(sizeof(revocation_state_t) <= RTC_MEMORY_REVOCATION_BLOCKS * 4,
+              "The revoked cards do not fit in their RTC user memory area");
+
+/**
+ * @brief The cards revoked after the table image.
+ */
+static revocation_state_t revocationState;
+
+/**
+ * @brief Calculate the CRC of the revocation state.
+ * @return The CRC of every field after the CRC.
+ */
+static uint32_t REVOCATION_StateCrc(void)
+{
+    const uint8_t *data = (const uint8_t *)&revocationState + sizeof(revocationState.crc);
+    return CRC32_Final(CRC32_Update(CRC32_Init(), data,
+                                    sizeof(revocationState) - sizeof(revocationState.crc)));
+}
+
+/**
+ * @brief Save the revoked cards to the RTC user memory.
+ */
+static void REVOCATION_StateSave(void)
+{
+    revocationState.crc = REVOCATION_StateCrc();
+    ESP.rtcUserMemoryWrite(RTC_MEMORY_REVOCATION_OFFSET, (uint32_t *)&revocationState,
+                           sizeof(revocationState));
+}
+
+/**
+ * @brief Calculate the digest a card is revoked by.
+ * @param uid The UID of the card.
+ * @return The CRC-32 of the UID.
+ */
+static uint32_t REVOCATION_Digest(const uint8_t *uid)
+{
+    return CRC32_Final(CRC32_Update(CRC32_Init(), uid, REVOCATION_UID_SIZE));
+}
+
+/**
+ * @brief Initialize the revoked cards from the version of the table image.
+ * @note The revoked cards saved in the RTC user memory are kept if they belong to the same table
+ * image.
+ */
+void REVOCATION_Init(void)
+{
+    uint32_t table_version = AUTHENTICATE_LOG_GetRevocationVersion();
+    if (ESP.rtcUserMemoryRead(RTC_MEMORY_REVOCATION_OFFSET, (uint32_t *)&revocationState,
+                              sizeof(revocationState)) &&
+        (revocationState.crc == REVOCATION_StateCrc()) &&
+        (revocationState.tableVersion == table_version) &&
+        (revocationState.count <= REVOCATION_CAPACITY))
+    {
+        return;
+    }
+
+    REVOCATION_Reset(table_version);
+}
+
+/**
+ * @brief Drop the revoked cards, a new table image already contains them.
+ * @param version The revocation version of the table image.
+ */
+void REVOCATION_Reset(uint32_t version)
+{
+    revocationState.tableVersion = version;
+    revocationState.version = version;
+    revocationState.count = 0;
+    REVOCATION_StateSave();
+}
+
+/**
+ * @brief Get the number of revocations known by the module.
+ * @return The revocation version, asked for in the probe.
+ */
+uint32_t REVOCATION_GetVersion(void)
+{
+    return revocationState.version;
+}
+
+/**
+ * @brief Check if there is no room for more revoked cards.
+ * @return True if further revocations need a new table image, false otherwise.
+ */
+bool REVOCATION_IsFull(void)
+{
+    return revocationState.count >= REVOCATION_CAPACITY;
+}
+
+/**
+ * @brief Verify a revocation delta received from the central module and take over its cards.
+ * @param challenge The chip ID and the nonce of the probe, #REVOCATION_CHALLENGE_SIZE bytes.
+ * @param delta The payload of the answer.
+ * @param length The length of the payload.
+ * @return True if the delta was valid, false otherwise.
+ *
+ * @details A delta based on version 0 replaces the revoked cards, the central module restarted
+ * its numbering. If there is not enough room, only the first cards are taken over and the version
+ * is advanced by their number, so the rest is asked for again after the next table image.
+ */
+bool REVOCATION_ApplyDelta(const uint8_t *challenge, const uint8_t *delta, uint16_t length)
+{
+    if ((length < REVOCATION_DELTA_HEADER_SIZE + REVOCATION_MAC_SIZE) ||
+        ((length - REVOCATION_DELTA_HEADER_SIZE - REVOCATION_MAC_SIZE) % REVOCATION_UID_SIZE != 0))
+    {
+        return false;
+    }
+    uint16_t signed_length = length - REVOCATION_MAC_SIZE;
+    uint16_t count = (signed_length - REVOCATION_DELTA_HEADER_SIZE) / REVOCATION_UID_SIZE;
+
+    uint8_t mac[REVOCATION_MAC_SIZE];
+    sha256_hmac_context_t context;
+    SHA256_HmacInit(&context, (const uint8_t *)REVOCATION_KEY, sizeof(REVOCATION_KEY) - 1);
+    SHA256_HmacUpdate(&context, challenge, REVOCATION_CHALLENGE_SIZE);
+    SHA256_HmacUpdate(&context, delta, signed_length);
+    SHA256_HmacFinal(&context, mac);
+
+    // Compare every byte, so the time does not tell how much of the MAC was right
+    uint8_t difference = 0;
+    for (uint8_t i = 0; i < REVOCATION_MAC_SIZE; i++)
+    {
+        difference |= mac[i] ^ delta[signed_length + i];
+    }
+    if (difference != 0)
+    {
+        return false;
+    }
+
+    uint32_t base = BYTEORDER_ReadUint32Be(delta);
+    uint32_t version = BYTEORDER_ReadUint32Be(&(delta[4]));
+    if (((base != revocationState.version) && (base != 0)) || (version - base != count))
+    {
+        return false;
+    }
+
+    if (base != revocationState.version)
+    {
+        revocationState.version = 0;
+        revocationState.count = 0;
+    }
+
+    const uint8_t *uid = &(delta[REVOCATION_DELTA_HEADER_SIZE]);
+    for (uint16_t i = 0; (i < count) && !REVOCATION_IsFull(); i++)
+    {
+        revocationState.revoked[revocationState.count] = REVOCATION_Digest(uid);
+        revocationState.count++;
+        revocationState.version++;
+        uid += REVOCATION_UID_SIZE;
+    }
+    REVOCATION_StateSave();
+
+    return true;
+}
+
+/**
+ * @brief Check if a card was revoked after the table image.
+ * @param uid The UID of the card.
+ * @return True if the card is revoked, false otherwise.
+ */
+bool REVOCATION_IsRevoked(const uint8_t *uid)
+{
+    uint32_t digest = REVOCATION_Digest(uid);
+    for (uint8_t i = 0; i < revocationState.count; i++)
+    {
+        if (revocationState.revoked[i] == digest)
+        {
+            return true;
+        }
+    }
+
+    return false;
+}
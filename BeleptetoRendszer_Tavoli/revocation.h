@@ -0,0 +1,45 @@
+/**
+ ***************************************************************************************************
+ * @file revocation.h
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Header file for the revoked cards received between the table updates.
+ ***************************************************************************************************
+ */
+
+#ifndef REVOCATION_H
+#define REVOCATION_H
+
+#include <stdint.h>
+
+#include "sha256.h"
+
+/**
+ * @defgroup revocation_sizes Revocation sizes
+ * @brief The sizes of the parts of a revocation delta, see #FRAME_TYPE_REVOCATION.
+ * @{
+ */
+#define REVOCATION_UID_SIZE 10
+/** @brief The base version and the version of the delta. */
+#define REVOCATION_DELTA_HEADER_SIZE 8
+#define REVOCATION_MAC_SIZE SHA256_SIZE
+/** @brief The chip ID and the nonce of the probe, covered by the MAC of the answer. */
+#define REVOCATION_CHALLENGE_SIZE 8
+/** @brief The number of revoked cards kept until the next table update. */
+#define REVOCATION_CAPACITY 32
+/** @} */
+
+void REVOCATION_Init(void);
+
+void REVOCATION_Reset(uint32_t version);
+
+uint32_t REVOCATION_GetVersion(void);
+
+bool REVOCATION_IsFull(void);
+
+bool REVOCATION_ApplyDelta(const uint8_t *challenge, const uint8_t *delta, uint16_t length);
+
+bool REVOCATION_IsRevoked(const uint8_t *uid);
+
+#endif /* REVOCATION_H */
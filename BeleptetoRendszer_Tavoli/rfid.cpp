@@ -5,6 +5,22 @@
  * @date 2023. 05. 04.
  ***************************************************************************************************
  * @brief Implementation of rfid.h.
+ *
+ * The detection of a tag is asynchronous: RFID_StartDetection() sends InListPassiveTarget, and the
+ * PN532 searches for a tag on its own, without a retry limit. When it finds one, it raises its IRQ
+ * line and sends the response, which RFID_ReadTag() collects. The loop keeps running meanwhile,
+ * the interrupt handler of the IRQ line only records the time of the IRQ.
+ *
+ * The module may have a reader per channel of #DOOR_CHANNELS, each with its own state in
+ * #rfidReaders. The host interface of a reader is chosen by its channel, the RFID_Transport
+ * functions hide the differences. On a serial port the first bytes of the response also tell that
+ * a tag was found, on I2C the reader holds the response until it is read, and the IRQ line tells
+ * it. The objects of an interface are only constructed when a channel uses it, so the pins of the
+ * other interfaces stay free.
+ *
+ * Between the activity periods the reader is in power-down, with its RF field off. RFID_WakeUp()
+ * only sends the wakeup sequence, so the oscillator of the reader starts while the module does
+ * other work, the first command waits for the rest of #RFID_WAKEUP_MS.
  ***************************************************************************************************
  */
 
@@ -12,58 +28,572 @@
 
 #include <stdio.h>
 #include <stdint.h>
+#include <string.h>
 
-#include <PN532_SWHSU.h>
+#include <Arduino.h>
 #include <PN532.h>
 
 #include "BeleptetoRendszer_Tavoli.h"
+#include "CircularBuffer.hpp"
+
+#include <PN532_SWHSU.h>
+#include <PN532_HSU.h>
+#include <PN532_I2C.h>
+#include <Wire.h>
+
+/**
+ * @defgroup rfid_detection_constants RFID detection constants
+ * @brief The reader searches until a tag arrives, the response is only read after that.
+ * @{
+ */
+#ifndef RFID_PASSIVE_ACTIVATION_RETRIES
+#define RFID_PASSIVE_ACTIVATION_RETRIES 0xFF
+#endif
+/** @brief The time the rest of the response may take after its first byte or the IRQ. */
+#ifndef RFID_RESPONSE_TIMEOUT_MS
+#define RFID_RESPONSE_TIMEOUT_MS 10
+#endif
+/**
+ * @brief InListPassiveTarget response: NbTg, Tg, SENS_RES (2), SEL_RES, NFCIDLength, NFCID, and
+ * the ATS of an ISO-DEP card.
+ */
+#define RFID_RESPONSE_SIZE 64
+#define RFID_IRQ_EVENT_BUFFER_SIZE 4
+/** @brief The time the reader needs after the wakeup sequence, before the first command. */
+#ifndef RFID_WAKEUP_MS
+#define RFID_WAKEUP_MS 2
+#endif
+/** @brief The interface that wakes the reader up from power-down (WakeUpEnable of PowerDown). */
+#define RFID_POWER_DOWN_WAKEUP_SERIAL 0x10
+#define RFID_POWER_DOWN_WAKEUP_I2C 0x80
+/** @brief The I2C address of the PN532. */
+#define RFID_I2C_ADDRESS 0x24
+/** @brief The PN532 stretches the clock while it prepares the response. */
+#define RFID_I2C_CLOCK_STRETCH_LIMIT_US 1500
+/** @} */
 
 /**
  * @brief The buffer for the UID of the tag.
  */
 static char rfidBuffer[64];
 
+uint8_t uid[RFID_UID_SIZE];
+/**
+ * @brief The UID of the last tag as read, for the authentication of its sectors.
+ */
+static uint8_t uidRead[RFID_UID_SIZE];
+/**
+ * @brief The length of #uidRead.
+ */
+static uint8_t uidReadLength = 0;
 /**
- * @brief Serial object for the RFID reader.
+ * @brief The reader of the last tag.
  */
-SoftwareSerial rfidSerial(RFID_RX_PIN, RFID_TX_PIN);
-PN532_SWHSU pn532swhsu(rfidSerial);
-PN532 nfc(pn532swhsu);
+static uint8_t uidReader = 0;
 
-uint8_t uid[RFID_UID_SIZE];
+/**
+ * @brief The power state of a reader.
+ */
+typedef enum _rfid_power_t
+{
+    RFID_POWER_DOWN,   /**< In power-down, the RF field is off. */
+    RFID_POWER_WAKING, /**< The wakeup sequence was sent, the oscillator starts. */
+    RFID_POWER_UP      /**< Ready for commands. */
+} rfid_power_t;
+
+/**
+ * @brief The state of a reader.
+ */
+typedef struct _rfid_reader_t
+{
+    uint8_t transport;          /**< The host interface, see #RFID_TRANSPORT. */
+    uint8_t irqPin;             /**< The pin of the IRQ line. */
+    Stream *serial;             /**< The serial port of the reader, nullptr on I2C. */
+    PN532Interface *interface;  /**< The host interface, nullptr before the first wakeup. */
+    PN532 *nfc;                 /**< The commands of the reader. */
+    /** @brief The values of micros() at the falling edges of the IRQ line. */
+    SpscRingBuffer<uint32_t, RFID_IRQ_EVENT_BUFFER_SIZE> irqEvents;
+    rfid_power_t power;         /**< The power state, in power-down after a restart possibly. */
+    unsigned long wakeMillis;   /**< Value of millis() when the wakeup sequence was sent. */
+    bool detecting;             /**< True while the reader searches for a tag. */
+    uint32_t startMicros;       /**< The time the start of the running detection took. */
+    rfid_stats_t stats;         /**< Statistics of the detections. */
+} rfid_reader_t;
+
+/**
+ * @brief The channels of the module, a reader each.
+ */
+static const door_channel_t rfidChannels[] = DOOR_CHANNELS;
+
+#define RFID_READER_COUNT (sizeof(rfidChannels) / sizeof(rfidChannels[0]))
+
+static_assert(RFID_READER_COUNT <= DOOR_CHANNEL_MAX, "Too many door channels");
+
+/**
+ * @brief The state of the readers, in the order of #rfidChannels.
+ */
+static rfid_reader_t rfidReaders[RFID_READER_COUNT];
+
+/**
+ * @brief Record the time of the IRQ of a reader.
+ * @param arg The state of the reader.
+ */
+static void IRAM_ATTR RFID_IrqHandler(void *arg)
+{
+    ((rfid_reader_t *)arg)->irqEvents.push(micros());
+}
+
+/**
+ * @brief Construct the interface objects of a reader and start its host interface.
+ * @param reader The state of the reader.
+ * @param transport The host interface of the reader.
+ * @return True if the transport is known, false otherwise.
+ * @note The wakeup of the interface is not used, it waits for the reader on I2C.
+ */
+static bool RFID_TransportBegin(rfid_reader_t *reader, uint8_t transport)
+{
+    switch (transport)
+    {
+    case RFID_TRANSPORT_SWHSU:
+    {
+        static SoftwareSerial serial(RFID_RX_PIN, RFID_TX_PIN);
+        static PN532_SWHSU interface(serial);
+        static PN532 nfc(interface);
+        reader->serial = &serial;
+        reader->interface = &interface;
+        reader->nfc = &nfc;
+        break;
+    }
+
+    case RFID_TRANSPORT_HSU:
+    {
+        static PN532_HSU interface(Serial);
+        static PN532 nfc(interface);
+        reader->serial = &Serial;
+        reader->interface = &interface;
+        reader->nfc = &nfc;
+        break;
+    }
+
+    case RFID_TRANSPORT_I2C:
+    {
+        static PN532_I2C interface(Wire);
+        static PN532 nfc(interface);
+        reader->serial = nullptr;
+        reader->interface = &interface;
+        reader->nfc = &nfc;
+        break;
+    }
+
+    default:
+        return false;
+    }
+
+    reader->transport = transport;
+    reader->interface->begin();
+    if (transport == RFID_TRANSPORT_HSU)
+    {
+        // The UART starts on the pins of the USB serial port
+        Serial.swap();
+    }
+    else if (transport == RFID_TRANSPORT_I2C)
+    {
+        // Starting the bus again resets the stretch limit to the default of the core, far shorter
+        // than the PN532 holds the clock
+        Wire.setClockStretchLimit(RFID_I2C_CLOCK_STRETCH_LIMIT_US);
+    }
+    return true;
+}
+
+/**
+ * @brief Send the wakeup sequence to a reader, without waiting for it.
+ * @param reader The state of the reader.
+ */
+static void RFID_TransportWake(rfid_reader_t *reader)
+{
+    static const uint8_t wakeup[] = {0x55, 0x55, 0x00, 0x00, 0x00};
+
+    if (reader->serial == nullptr)
+    {
+        // The address of the reader on the bus wakes it up
+        Wire.beginTransmission(RFID_I2C_ADDRESS);
+        Wire.endTransmission();
+        return;
+    }
+    reader->serial->write(wakeup, sizeof(wakeup));
+}
+
+/**
+ * @brief Check if a reader has data for the host.
+ * @param reader The state of the reader.
+ * @return True if bytes of a frame arrived, or the reader holds a response, false otherwise.
+ */
+static bool RFID_TransportHasData(rfid_reader_t *reader)
+{
+    if (reader->serial == nullptr)
+    {
+        return digitalRead(reader->irqPin) == LOW;
+    }
+    return reader->serial->available() > 0;
+}
+
+/**
+ * @brief Drop the bytes of a reader that were not read.
+ * @param reader The state of the reader.
+ */
+static void RFID_TransportDrop(rfid_reader_t *reader)
+{
+    if (reader->serial == nullptr)
+    {
+        return;
+    }
+    while (reader->serial->available() > 0)
+    {
+        reader->serial->read();
+    }
+}
+
+/**
+ * @brief Send a frame to a reader as it is.
+ * @param reader The state of the reader.
+ * @param frame The frame.
+ * @param length The length of the frame.
+ */
+static void RFID_TransportWriteFrame(rfid_reader_t *reader, const uint8_t *frame, uint8_t length)
+{
+    if (reader->serial == nullptr)
+    {
+        Wire.beginTransmission(RFID_I2C_ADDRESS);
+        Wire.write(frame, length);
+        Wire.endTransmission();
+        return;
+    }
+    reader->serial->write(frame, length);
+}
+
+/**
+ * @brief Drop the recorded IRQ events and the unread bytes of a reader.
+ * @param reader The state of the reader.
+ */
+static void RFID_DropPending(rfid_reader_t *reader)
+{
+    uint32_t irqMicros;
+    while (reader->irqEvents.pop(&irqMicros))
+    {
+    }
+    RFID_TransportDrop(reader);
+}
+
+/**
+ * @brief Start waking a reader up from power-down, and start its host interface first if needed.
+ * @param reader The state of the reader.
+ * @return True if the reader has a host interface, false if its transport is unknown.
+ */
+static bool RFID_ReaderWake(rfid_reader_t *reader)
+{
+    if (reader->interface == nullptr)
+    {
+        const door_channel_t *channel = &(rfidChannels[reader - rfidReaders]);
+        reader->irqPin = channel->irqPin;
+        if (!RFID_TransportBegin(reader, channel->transport))
+        {
+            return false;
+        }
+    }
+    if (reader->power != RFID_POWER_DOWN)
+    {
+        return true;
+    }
+    RFID_TransportWake(reader);
+    reader->wakeMillis = millis();
+    reader->power = RFID_POWER_WAKING;
+    reader->stats.wakeups++;
+    return true;
+}
+
+/**
+ * @brief Check if a reader is ready for commands.
+ * @param reader The state of the reader.
+ * @return True if the reader is awake, false if it is in power-down or still waking up.
+ */
+static bool RFID_ReaderIsAwake(rfid_reader_t *reader)
+{
+    if ((reader->power == RFID_POWER_WAKING) &&
+        ((millis() - reader->wakeMillis) >= RFID_WAKEUP_MS))
+    {
+        reader->power = RFID_POWER_UP;
+    }
+    return reader->power == RFID_POWER_UP;
+}
+
+/**
+ * @brief Wait until a reader is ready for commands, and wake it up if needed.
+ * @param reader The state of the reader.
+ * @return True if the reader is awake, false if its transport is unknown.
+ */
+static bool RFID_WaitAwake(rfid_reader_t *reader)
+{
+    if (!RFID_ReaderWake(reader))
+    {
+        return false;
+    }
+    while (!RFID_ReaderIsAwake(reader))
+    {
+        delay(1);
+    }
+    return true;
+}
 
 /**
- * @brief Initializes the RFID reader module.
+ * @brief Stop the search of a reader.
+ * @param reader The state of the reader.
+ * @note An ACK frame sent to the reader aborts the running command.
+ */
+static void RFID_ReaderCancel(rfid_reader_t *reader)
+{
+    static const uint8_t ack[] = {0x00, 0x00, 0xFF, 0x00, 0xFF, 0x00};
+
+    if (!reader->detecting)
+    {
+        return;
+    }
+    RFID_TransportWriteFrame(reader, ack, sizeof(ack));
+    reader->detecting = false;
+    RFID_DropPending(reader);
+}
+
+/**
+ * @brief Put a reader into power-down, its RF field goes off.
+ * @param reader The state of the reader.
+ * @note A running detection is cancelled. If the reader does not answer, it is considered awake,
+ * and the next call tries again.
+ */
+static void RFID_ReaderPowerDown(rfid_reader_t *reader)
+{
+    if ((reader->power == RFID_POWER_DOWN) || (reader->interface == nullptr))
+    {
+        return;
+    }
+    RFID_ReaderCancel(reader);
+    RFID_WaitAwake(reader);
+
+    uint8_t command[] = {PN532_COMMAND_POWERDOWN,
+                         (reader->serial == nullptr) ? (uint8_t)RFID_POWER_DOWN_WAKEUP_I2C
+                                                     : (uint8_t)RFID_POWER_DOWN_WAKEUP_SERIAL};
+    uint8_t response[1];
+    if ((reader->interface->writeCommand(command, sizeof(command)) != 0) ||
+        (reader->interface->readResponse(response, sizeof(response), RFID_RESPONSE_TIMEOUT_MS) < 0))
+    {
+        reader->stats.frameErrors++;
+        return;
+    }
+    RFID_DropPending(reader);
+    reader->power = RFID_POWER_DOWN;
+    reader->stats.powerDowns++;
+}
+
+/**
+ * @brief Get the number of readers of the module.
+ * @return The number of channels in #DOOR_CHANNELS.
+ */
+uint8_t RFID_GetReaderCount(void)
+{
+    return RFID_READER_COUNT;
+}
+
+/**
+ * @brief Start waking every reader up from power-down.
+ * @note Returns after sending the wakeup sequences, RFID_IsAwake() tells when a reader is ready.
+ */
+void RFID_WakeUp(void)
+{
+    for (uint8_t i = 0; i < RFID_READER_COUNT; i++)
+    {
+        RFID_ReaderWake(&(rfidReaders[i]));
+    }
+}
+
+/**
+ * @brief Check if a reader is ready for commands.
+ * @param reader The index of the reader.
+ * @return True if the reader is awake, false if it is in power-down or still waking up.
+ */
+bool RFID_IsAwake(uint8_t reader)
+{
+    return (reader < RFID_READER_COUNT) && RFID_ReaderIsAwake(&(rfidReaders[reader]));
+}
+
+/**
+ * @brief Put every reader into power-down, their RF fields go off.
+ * @note The running detections are cancelled.
+ */
+void RFID_PowerDown(void)
+{
+    for (uint8_t i = 0; i < RFID_READER_COUNT; i++)
+    {
+        RFID_ReaderPowerDown(&(rfidReaders[i]));
+    }
+}
+
+/**
+ * @brief Initializes a reader.
+ * @param reader The index of the reader.
  * @return True if the initialization was successful, false otherwise.
+ * @note Call RFID_WakeUp() earlier, to do other work while the readers wake up.
  */
-bool RFID_Init(void)
+bool RFID_Init(uint8_t reader)
 {
-    nfc.begin();
-    uint32_t versiondata = nfc.getFirmwareVersion();
+    if (reader >= RFID_READER_COUNT)
+    {
+        return false;
+    }
+    rfid_reader_t *state = &(rfidReaders[reader]);
+    if (!RFID_WaitAwake(state))
+    {
+        return false;
+    }
+    uint32_t versiondata = state->nfc->getFirmwareVersion();
     if (!versiondata)
     {
         return false;
     }
-    nfc.SAMConfig();
+    state->nfc->SAMConfig();
+    state->nfc->setPassiveActivationRetries(RFID_PASSIVE_ACTIVATION_RETRIES);
 
+    attachInterruptArg(digitalPinToInterrupt(state->irqPin), RFID_IrqHandler, state, FALLING);
+
+    return true;
+}
+
+/**
+ * @brief Start searching for a tag with a reader.
+ * @param reader The index of the reader.
+ * @return True if the reader accepted the command, false otherwise.
+ * @note Returns after the acknowledgement of the reader, a few milliseconds, the reader is woken
+ * up first if needed. Check RFID_IsTagDetected() later, and read the tag with RFID_ReadTag().
+ */
+bool RFID_StartDetection(uint8_t reader)
+{
+    uint8_t command[] = {PN532_COMMAND_INLISTPASSIVETARGET, 1, PN532_MIFARE_ISO14443A};
+
+    if (reader >= RFID_READER_COUNT)
+    {
+        return false;
+    }
+    rfid_reader_t *state = &(rfidReaders[reader]);
+    if (!RFID_WaitAwake(state))
+    {
+        return false;
+    }
+    RFID_DropPending(state);
+    unsigned long start = micros();
+    if (state->interface->writeCommand(command, sizeof(command)) != 0)
+    {
+        state->stats.frameErrors++;
+        return false;
+    }
+    state->startMicros = micros() - start;
+    // The IRQ of the acknowledgement is not a detection
+    RFID_DropPending(state);
+    state->detecting = true;
+    state->stats.detections++;
     return true;
 }
 
 /**
- * @brief Reads the tag from the RFID reader.
+ * @brief Stop searching for a tag with a reader.
+ * @param reader The index of the reader.
+ */
+void RFID_CancelDetection(uint8_t reader)
+{
+    if (reader < RFID_READER_COUNT)
+    {
+        RFID_ReaderCancel(&(rfidReaders[reader]));
+    }
+}
+
+/**
+ * @brief Check if a reader searches for a tag.
+ * @param reader The index of the reader.
+ * @return True if a detection was started and the tag was not read yet, false otherwise.
+ */
+bool RFID_IsDetecting(uint8_t reader)
+{
+    return (reader < RFID_READER_COUNT) && rfidReaders[reader].detecting;
+}
+
+/**
+ * @brief Check if a reader found a tag.
+ * @param reader The index of the reader.
+ * @return True if the reader raised its IRQ line or started sending the response, false
+ * otherwise.
+ * @note Cheap enough to call on every round of the loop.
+ */
+bool RFID_IsTagDetected(uint8_t reader)
+{
+    if (!RFID_IsDetecting(reader))
+    {
+        return false;
+    }
+    rfid_reader_t *state = &(rfidReaders[reader]);
+    return (state->irqEvents.peek() != nullptr) || RFID_TransportHasData(state);
+}
+
+/**
+ * @brief Reads the tag found by the detection started by RFID_StartDetection().
+ * @param reader The index of the reader.
  * @return True if the tag was read successfully, false otherwise.
+ * @note The detection ends either way, start a new one for the next tag.
  */
-bool RFID_ReadTag(void)
+bool RFID_ReadTag(uint8_t reader)
 {
-    bool success;
+    if (!RFID_IsDetecting(reader))
+    {
+        return false;
+    }
+    rfid_reader_t *state = &(rfidReaders[reader]);
+    state->detecting = false;
+
+    uint8_t response[RFID_RESPONSE_SIZE];
+    unsigned long start = micros();
+    int16_t length = state->interface->readResponse(response, sizeof(response),
+                                                    RFID_RESPONSE_TIMEOUT_MS);
+    unsigned long readMicros = micros() - start;
+    uint32_t irqMicros;
+    bool irq = state->irqEvents.pop(&irqMicros);
+    RFID_DropPending(state);
 
-    uint8_t uid_read[RFID_UID_SIZE] = {0};
-    uint8_t uidLength;
-    success = nfc.readPassiveTargetID(PN532_MIFARE_ISO14443A, uid_read, &uidLength);
-    if (!success)
+    if (length < 0)
+    {
+        // Timeout, or a frame with a bad checksum or length
+        state->stats.frameErrors++;
+        return false;
+    }
+    // One target with a UID that fits
+    if ((length < 6) || (response[0] != 1) || (response[5] > RFID_UID_SIZE) ||
+        (length < 6 + response[5]))
     {
+        state->stats.failures++;
         return false;
     }
+    uint8_t uidLength = response[5];
+    const uint8_t *uid_read = &(response[6]);
+
+    state->stats.tags++;
+    state->stats.lastReadMicros = state->startMicros + readMicros;
+    state->stats.totalReadMicros += state->stats.lastReadMicros;
+    if (irq)
+    {
+        state->stats.lastIrqToUidMicros = micros() - irqMicros;
+        if (state->stats.lastIrqToUidMicros > state->stats.maxIrqToUidMicros)
+        {
+            state->stats.maxIrqToUidMicros = state->stats.lastIrqToUidMicros;
+        }
+    }
+
+    memcpy(uidRead, uid_read, uidLength);
+    uidReadLength = uidLength;
+    uidReader = reader;
 
     // Copy the uid to the last bytes of the uid array
     for (uint8_t i = 0; i < uidLength; i++)
@@ -79,6 +609,57 @@ bool RFID_ReadTag(void)
     return true;
 }
 
+/**
+ * @brief Get the statistics of the detections of a reader.
+ * @param reader The index of the reader.
+ * @param stats Pointer to the location where the statistics will be put.
+ */
+void RFID_GetStats(uint8_t reader, rfid_stats_t *stats)
+{
+    if (reader < RFID_READER_COUNT)
+    {
+        *stats = rfidReaders[reader].stats;
+    }
+    else
+    {
+        memset(stats, 0, sizeof(*stats));
+    }
+}
+
+/**
+ * @brief Reads the credential (credential.h) of the last tag read by RFID_ReadTag().
+ * @param data Buffer of #RFID_CREDENTIAL_BLOCKS * 16 bytes to store the credential in.
+ * @return True if the credential blocks were read, false if the tag is not a MIFARE Classic card
+ * or its sector cannot be authenticated.
+ * @note Costs one sector authentication and #RFID_CREDENTIAL_BLOCKS block reads on the reader of
+ * the tag. The tag has to be still in the field, so it is called right after RFID_ReadTag().
+ */
+bool RFID_ReadCredential(uint8_t *data)
+{
+    // MIFARE Classic cards have 4 or 7 byte UIDs
+    if ((uidReadLength != 4) && (uidReadLength != 7))
+    {
+        return false;
+    }
+
+    PN532 *nfc = rfidReaders[uidReader].nfc;
+    uint8_t key[6] = RFID_CREDENTIAL_SECTOR_KEY;
+    if (!nfc->mifareclassic_AuthenticateBlock(uidRead, uidReadLength, RFID_CREDENTIAL_BLOCK, 0,
+                                              key))
+    {
+        return false;
+    }
+    for (uint8_t i = 0; i < RFID_CREDENTIAL_BLOCKS; i++)
+    {
+        if (!nfc->mifareclassic_ReadDataBlock(RFID_CREDENTIAL_BLOCK + i, &(data[i * 16])))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
 /**
  * @brief Gets the UID of the tag as a string.
  * @return The UID of the tag as a string.
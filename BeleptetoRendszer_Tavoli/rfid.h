@@ -16,9 +16,60 @@
 /** @brief The size of the UID of the tag. */
 #define RFID_UID_SIZE 10
 
-bool RFID_Init(void);
+/**
+ * @defgroup rfid_credential RFID credential storage
+ * @brief Location of the credential (credential.h) on a MIFARE Classic card.
+ * @{
+ */
+/** @brief The first block of the credential, two consecutive blocks of the same sector. */
+#define RFID_CREDENTIAL_BLOCK 4
+#define RFID_CREDENTIAL_BLOCKS 2
+/** @brief Key A of the sector. The credential is signed, the key only keeps other readers out. */
+#ifndef RFID_CREDENTIAL_SECTOR_KEY
+#define RFID_CREDENTIAL_SECTOR_KEY {0xFF, 0xFF, 0xFF, 0xFF, 0xFF, 0xFF}
+#endif
+/** @} */
+
+/**
+ * @brief Statistics of a reader since the start of the module.
+ */
+typedef struct _rfid_stats_t
+{
+    uint32_t wakeups;            /**< The number of wakeups from power-down. */
+    uint32_t powerDowns;         /**< The number of power-downs. */
+    uint32_t detections;         /**< The number of detections started. */
+    uint32_t tags;               /**< The number of tags read. */
+    uint32_t failures;           /**< The responses that did not contain a tag. */
+    uint32_t frameErrors;        /**< Missing acknowledgements and responses, bad frames. */
+    uint32_t lastReadMicros;     /**< The time spent on the interface for the last tag. */
+    uint32_t totalReadMicros;    /**< The time spent on the interface for every tag read. */
+    uint32_t lastIrqToUidMicros; /**< The time from the IRQ of the last tag to its UID. */
+    uint32_t maxIrqToUidMicros;  /**< The longest time from an IRQ to the UID. */
+} rfid_stats_t;
+
+uint8_t RFID_GetReaderCount(void);
+
+bool RFID_Init(uint8_t reader);
+
+void RFID_WakeUp(void);
+
+bool RFID_IsAwake(uint8_t reader);
+
+void RFID_PowerDown(void);
+
+bool RFID_StartDetection(uint8_t reader);
+
+void RFID_CancelDetection(uint8_t reader);
+
+bool RFID_IsDetecting(uint8_t reader);
+
+bool RFID_IsTagDetected(uint8_t reader);
+
+bool RFID_ReadTag(uint8_t reader);
+
+void RFID_GetStats(uint8_t reader, rfid_stats_t *stats);
 
-bool RFID_ReadTag(void);
+bool RFID_ReadCredential(uint8_t *data);
 
 const char *RFID_GetUidAsString(void);
 
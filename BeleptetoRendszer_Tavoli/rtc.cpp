@@ -5,18 +5,150 @@
  * @date 2023. 05. 04.
  ***************************************************************************************************
  * @brief Implementation of rtc.h.
+ *
+ * The time is kept by a software clock, so reading it costs no I2C transaction. The clock reads the
+ * RTC at the initialization and every #RTC_RESYNC_MS, and extrapolates from TIMERS_Millis() in
+ * between. The RTC only tells the whole second, so a read moves the clock only if it is outside
+ * that second, to its nearest edge. The sum of these corrections over #RTC_DRIFT_LEARN_MS is the
+ * drift of the local oscillator against the RTC, half of it is added to the drift correction of
+ * the clock at a time. The clock may step back by less than a second at a read. The drift and the
+ * corrections summed up for it are kept in the RTC user memory over the deep sleep.
  ***************************************************************************************************
  */
 
 #include "rtc.h"
 
+#include <Arduino.h>
 #include <RTClib.h>
 
+#include "BeleptetoRendszer_Tavoli.h"
+#include "crc32.h"
+#include "timers.h"
+
+/**
+ * @defgroup rtc_clock_constants Software clock constants
+ * @{
+ */
+/** @brief The period of the RTC reads, see RTC_IsResyncDue(). */
+#ifndef RTC_RESYNC_MS
+#define RTC_RESYNC_MS (60UL * 1000UL)
+#endif
+/** @brief RTC_GetTime() reads the RTC itself if the clock was not read for this long. */
+#define RTC_MAX_EXTRAPOLATION_MS (4UL * RTC_RESYNC_MS)
+/** @brief The time over which the corrections are summed up for the drift. */
+#define RTC_DRIFT_LEARN_MS (6UL * 60UL * 60UL * 1000UL)
+/** @brief The limit of the drift correction, in parts per million. */
+#define RTC_DRIFT_MAX_PPM 500
+/** @brief A larger correction is a step of the time, not drift. */
+#define RTC_STEP_MS 2000
+/** @brief The guess of the millisecond within the second at the first read. */
+#define RTC_FIRST_READ_PHASE_MS 500
+/** @} */
+
 /**
  * @brief The RTC object.
  */
 RTC_PCF8523 rtc;
 
+/**
+ * @brief True once the software clock was set.
+ */
+static bool clockRunning = false;
+
+/**
+ * @brief The time of the software clock at #clockLocalMillis, in milliseconds since the epoch.
+ */
+static uint64_t clockBaseMillis = 0;
+
+/**
+ * @brief Value of TIMERS_Millis() at #clockBaseMillis, the time of the last RTC read.
+ */
+static unsigned long clockLocalMillis = 0;
+
+/**
+ * @brief The local milliseconds summed up for the drift since its last update.
+ */
+static unsigned long clockLearnMillis = 0;
+
+/**
+ * @brief The corrections summed up for the drift since its last update, in milliseconds.
+ */
+static int32_t clockLearnCorrection = 0;
+
+/**
+ * @brief Statistics of the software clock.
+ */
+static rtc_clock_stats_t clockStats;
+
+/**
+ * @brief The learned drift saved in the RTC user memory during the deep sleep.
+ */
+typedef struct _rtc_clock_state_t
+{
+    uint32_t crc;            /**< CRC-32 of the rest of the structure. */
+    int32_t driftPpm;        /**< See #rtc_clock_stats_t::driftPpm. */
+    uint32_t learnMillis;    /**< See #clockLearnMillis. */
+    int32_t learnCorrection; /**< See #clockLearnCorrection. */
+} rtc_clock_state_t;
+
+static_assert(sizeof(rtc_clock_state_t) <= RTC_MEMORY_CLOCK_STATE_BLOCKS * 4,
+              "The clock state does not fit in its RTC user memory area");
+
+/**
+ * @brief Calculate the CRC of the saved clock state.
+ * @param state The saved clock state.
+ * @return The CRC of every field after the CRC.
+ */
+static uint32_t RTC_ClockStateCrc(const rtc_clock_state_t *state)
+{
+    const uint8_t *data = (const uint8_t *)state + sizeof(state->crc);
+    return CRC32_Final(CRC32_Update(CRC32_Init(), data, sizeof(*state) - sizeof(state->crc)));
+}
+
+/**
+ * @brief Restore the learned drift from the RTC user memory after the deep sleep.
+ */
+static void RTC_ClockStateLoad(void)
+{
+    rtc_clock_state_t state;
+    if (!ESP.rtcUserMemoryRead(RTC_MEMORY_CLOCK_STATE_OFFSET, (uint32_t *)&state,
+                               sizeof(state)) ||
+        (state.crc != RTC_ClockStateCrc(&state)) || (state.driftPpm > RTC_DRIFT_MAX_PPM) ||
+        (state.driftPpm < -RTC_DRIFT_MAX_PPM))
+    {
+        return;
+    }
+    clockStats.driftPpm = state.driftPpm;
+    clockLearnMillis = state.learnMillis;
+    clockLearnCorrection = state.learnCorrection;
+}
+
+/**
+ * @brief Get the time of the software clock.
+ * @param local The current value of TIMERS_Millis().
+ * @return The time in milliseconds since the epoch.
+ * @note The unsigned difference of the local times stays right across the wraparound of
+ * TIMERS_Millis(), since the clock is read far more often than every 49 days.
+ */
+static uint64_t RTC_ClockMillis(unsigned long local)
+{
+    unsigned long elapsed = local - clockLocalMillis;
+    int64_t drift = (int64_t)elapsed * clockStats.driftPpm / 1000000;
+    return clockBaseMillis + elapsed + drift;
+}
+
+/**
+ * @brief Set the software clock.
+ * @param millis The time in milliseconds since the epoch.
+ * @param local The value of TIMERS_Millis() at the time.
+ */
+static void RTC_ClockSet(uint64_t millis, unsigned long local)
+{
+    clockBaseMillis = millis;
+    clockLocalMillis = local;
+    clockRunning = true;
+}
+
 /**
  * @brief Initializes the RTC.
  * @return True if the initialization was successful, false otherwise.
@@ -35,23 +167,181 @@ bool RTC_Init(void)
 
     rtc.start();
 
+    RTC_ClockStateLoad();
+    clockRunning = false;
+    RTC_Resync();
+
     return true;
 }
 
 /**
- * @brief Gets the current time from the RTC.
+ * @brief Gets the current time from the software clock.
  * @return The current time.
+ * @note Reads the RTC only if the clock was not started, or its last read is older than
+ * #RTC_MAX_EXTRAPOLATION_MS because RTC_Resync() was not called.
  */
 unixtime_t RTC_GetTime(void)
 {
-    return rtc.now().unixtime();
+    if (!clockRunning || ((TIMERS_Millis() - clockLocalMillis) >= RTC_MAX_EXTRAPOLATION_MS))
+    {
+        RTC_Resync();
+    }
+    return (unixtime_t)(RTC_ClockMillis(TIMERS_Millis()) / 1000);
 }
 
 /**
- * @brief Sets the current time of the RTC.
+ * @brief Sets the current time of the RTC and the software clock.
  * @param time The time to set.
+ * @note Setting the time restarts the second of the RTC, so the clock is at its start.
  */
 void RTC_SetTime(unixtime_t time)
 {
     rtc.adjust(DateTime(time));
+    RTC_ClockSet((uint64_t)time * 1000, TIMERS_Millis());
+    // The corrections before are not comparable with the ones after, the drift correction stays
+    clockLearnMillis = 0;
+    clockLearnCorrection = 0;
+}
+
+/**
+ * @brief Account for a jump of TIMERS_Millis() that is not time passed since the last RTC read.
+ * @param millis The milliseconds added to TIMERS_Millis().
+ * @note After the deep sleep the uptime before it and the time slept are added to TIMERS_Millis(),
+ * but the clock was already set by the RTC read of RTC_Init().
+ */
+void RTC_ShiftTimeBase(unsigned long millis)
+{
+    clockLocalMillis += millis;
+}
+
+/**
+ * @brief Save the learned drift to the RTC user memory before the deep sleep.
+ */
+void RTC_Suspend(void)
+{
+    rtc_clock_state_t state;
+    state.driftPpm = clockStats.driftPpm;
+    state.learnMillis = clockLearnMillis;
+    state.learnCorrection = clockLearnCorrection;
+    state.crc = RTC_ClockStateCrc(&state);
+    ESP.rtcUserMemoryWrite(RTC_MEMORY_CLOCK_STATE_OFFSET, (uint32_t *)&state, sizeof(state));
+}
+
+/**
+ * @brief Check if the software clock has to read the RTC.
+ * @return True if #RTC_RESYNC_MS passed since the last read, false otherwise.
+ * @note Call RTC_Resync() then when the I2C bus is idle.
+ */
+bool RTC_IsResyncDue(void)
+{
+    return clockRunning && ((TIMERS_Millis() - clockLocalMillis) >= RTC_RESYNC_MS);
+}
+
+/**
+ * @brief Read the RTC and correct the software clock by it.
+ */
+void RTC_Resync(void)
+{
+    uint64_t rtcMillis = (uint64_t)rtc.now().unixtime() * 1000;
+    unsigned long local = TIMERS_Millis();
+    clockStats.reads++;
+
+    if (!clockRunning)
+    {
+        RTC_ClockSet(rtcMillis + RTC_FIRST_READ_PHASE_MS, local);
+        return;
+    }
+
+    // Move the clock into the second read, to its nearest edge
+    uint64_t clockMillis = RTC_ClockMillis(local);
+    int64_t correction = 0;
+    if (clockMillis < rtcMillis)
+    {
+        correction = (int64_t)(rtcMillis - clockMillis);
+    }
+    else if (clockMillis > rtcMillis + 999)
+    {
+        correction = -(int64_t)(clockMillis - (rtcMillis + 999));
+    }
+
+    unsigned long elapsed = local - clockLocalMillis;
+    clockBaseMillis = clockMillis + correction;
+    clockLocalMillis = local;
+    if (correction != 0)
+    {
+        clockStats.corrections++;
+        clockStats.lastCorrectionMillis = (int32_t)correction;
+    }
+    if ((correction > RTC_STEP_MS) || (correction < -RTC_STEP_MS))
+    {
+        // The RTC was set, or the light sleeps were accounted wrong
+        clockLearnMillis = 0;
+        clockLearnCorrection = 0;
+        return;
+    }
+
+    clockLearnMillis += elapsed;
+    clockLearnCorrection += (int32_t)correction;
+    if (clockLearnMillis >= RTC_DRIFT_LEARN_MS)
+    {
+        int64_t learned = (int64_t)clockLearnCorrection * 1000000 / (int64_t)clockLearnMillis;
+        int32_t drift = clockStats.driftPpm + (int32_t)(learned / 2);
+        if (drift > RTC_DRIFT_MAX_PPM)
+        {
+            drift = RTC_DRIFT_MAX_PPM;
+        }
+        else if (drift < -RTC_DRIFT_MAX_PPM)
+        {
+            drift = -RTC_DRIFT_MAX_PPM;
+        }
+        clockStats.driftPpm = drift;
+        clockLearnMillis = 0;
+        clockLearnCorrection = 0;
+    }
+}
+
+/**
+ * @brief Get the statistics of the software clock.
+ * @param stats Pointer to the location where the statistics will be put.
+ */
+void RTC_GetClockStats(rtc_clock_stats_t *stats)
+{
+    *stats = clockStats;
+}
+
+/**
+ * @brief Start the countdown timer of the RTC, its interrupt output wakes the module from deep
+ * sleep.
+ * @param seconds The time until the wakeup.
+ * @return The time until the timer fires, at most the requested time.
+ * @note The timer counts at most 255 periods: up to 255 seconds it counts seconds, above it counts
+ * minutes, rounded down. A longer sleep needs several wakeups.
+ */
+uint32_t RTC_SetWakeupTimer(uint32_t seconds)
+{
+    if (seconds == 0)
+    {
+        seconds = 1;
+    }
+    if (seconds <= 255)
+    {
+        rtc.enableCountdownTimer(PCF8523_FrequencySecond, (uint8_t)seconds);
+        return seconds;
+    }
+
+    uint32_t minutes = seconds / 60;
+    if (minutes > 255)
+    {
+        minutes = 255;
+    }
+    rtc.enableCountdownTimer(PCF8523_FrequencyMinute, (uint8_t)minutes);
+    return minutes * 60;
+}
+
+/**
+ * @brief Stop the countdown timer of the RTC.
+ */
+void RTC_ClearWakeupTimer(void)
+{
+    rtc.disableCountdownTimer();
 }
@@ -40,10 +40,35 @@
  */
 typedef uint32_t unixtime_t;
 
+/**
+ * @brief Statistics of the software clock since the start of the module.
+ */
+typedef struct _rtc_clock_stats_t
+{
+    uint32_t reads;               /**< The number of RTC reads. */
+    uint32_t corrections;         /**< The reads that moved the clock. */
+    int32_t lastCorrectionMillis; /**< The last move, positive if the clock was behind. */
+    int32_t driftPpm;             /**< The drift correction in parts per million. */
+} rtc_clock_stats_t;
+
 bool RTC_Init(void);
 
 unixtime_t RTC_GetTime(void);
 
 void RTC_SetTime(unixtime_t time);
 
+void RTC_ShiftTimeBase(unsigned long millis);
+
+void RTC_Suspend(void);
+
+bool RTC_IsResyncDue(void);
+
+void RTC_Resync(void);
+
+void RTC_GetClockStats(rtc_clock_stats_t *stats);
+
+uint32_t RTC_SetWakeupTimer(uint32_t seconds);
+
+void RTC_ClearWakeupTimer(void);
+
 #endif /* RTC_H */
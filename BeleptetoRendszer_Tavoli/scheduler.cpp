@@ -0,0 +1,188 @@
+/**
+ ***************************************************************************************************
+ * @file scheduler.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Implementation of scheduler.h.
+ *
+ * The tasks are ordered by their priority, the first one is the most important. Every round polls
+ * every task, and runs one step of the first ready task, so after each step the more important
+ * tasks are checked again, before the less important ones continue. A step is never interrupted,
+ * the steps of the background tasks are kept short so the door is not blocked by them.
+ ***************************************************************************************************
+ */
+
+#include "scheduler.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+/**
+ * @brief The tasks in the order of their priority.
+ */
+static const scheduler_task_t *scheduler_tasks = nullptr;
+
+/**
+ * @brief The number of tasks.
+ */
+static uint8_t scheduler_count = 0;
+
+/**
+ * @brief The state of a task.
+ */
+typedef struct _scheduler_state_t
+{
+    bool ready;                /**< True if the last poll found the task ready. */
+    unsigned long readyMicros; /**< The value of micros() when the task got ready. */
+    scheduler_stats_t stats;   /**< The statistics of the task. */
+} scheduler_state_t;
+
+/**
+ * @brief The states of the tasks.
+ */
+static scheduler_state_t scheduler_states[SCHEDULER_MAX_TASKS];
+
+/**
+ * @defgroup scheduler_last_step Last step
+ * @brief The step of the previous round, if a task ran in it.
+ *
+ * A task found ready after a step may have got ready any time during the step, so its latency
+ * counts from the start of the step, an upper bound that includes the step it waited for. The task
+ * that ran the step counts from its end.
+ * @{
+ */
+static bool lastStepRan = false;
+static uint8_t lastStepTask = 0;
+static unsigned long lastStepStartMicros = 0;
+static unsigned long lastStepEndMicros = 0;
+/** @} */
+
+/**
+ * @brief Initialize the scheduler.
+ * @param tasks The tasks in the order of their priority, the first is the most important.
+ * @param count The number of tasks, at most #SCHEDULER_MAX_TASKS.
+ * @note The tasks are not copied, they have to stay valid.
+ */
+void SCHEDULER_Init(const scheduler_task_t *tasks, uint8_t count)
+{
+    if (count > SCHEDULER_MAX_TASKS)
+    {
+        count = SCHEDULER_MAX_TASKS;
+    }
+    scheduler_tasks = tasks;
+    scheduler_count = count;
+    memset(scheduler_states, 0, sizeof(scheduler_states));
+    lastStepRan = false;
+}
+
+/**
+ * @brief Run one step of the most important ready task.
+ * @return True if a task ran, false if no task was ready.
+ */
+bool SCHEDULER_RunOnce(void)
+{
+    int8_t selected = -1;
+    unsigned long now = micros();
+
+    // Poll every task, so the latency of the less important ones is measured too
+    for (uint8_t i = 0; i < scheduler_count; i++)
+    {
+        scheduler_state_t *state = &(scheduler_states[i]);
+        if (!scheduler_tasks[i].poll())
+        {
+            state->ready = false;
+            continue;
+        }
+        if (!state->ready)
+        {
+            state->ready = true;
+            state->readyMicros = now;
+            if (lastStepRan)
+            {
+                state->readyMicros = (i == lastStepTask) ? lastStepEndMicros : lastStepStartMicros;
+            }
+        }
+        if (selected < 0)
+        {
+            selected = i;
+        }
+    }
+
+    if (selected < 0)
+    {
+        // The loop waits for the next event now, the sleep does not count as latency
+        lastStepRan = false;
+        return false;
+    }
+
+    const scheduler_task_t *task = &(scheduler_tasks[selected]);
+    scheduler_state_t *state = &(scheduler_states[selected]);
+    unsigned long start = micros();
+    uint32_t latency = start - state->readyMicros;
+    task->run();
+    unsigned long end = micros();
+    uint32_t duration = end - start;
+
+    lastStepRan = true;
+    lastStepTask = selected;
+    lastStepStartMicros = start;
+    lastStepEndMicros = end;
+
+    // The task has to get ready again for the next step, the latency counts from there
+    state->ready = false;
+    state->stats.runs++;
+    state->stats.totalMicros += duration;
+    if (duration > state->stats.maxRunMicros)
+    {
+        state->stats.maxRunMicros = duration;
+    }
+    if (latency > state->stats.maxLatencyMicros)
+    {
+        state->stats.maxLatencyMicros = latency;
+    }
+    if (duration > task->budgetMicros)
+    {
+        state->stats.overruns++;
+    }
+    return true;
+}
+
+/**
+ * @brief Get the number of tasks.
+ * @return The number of tasks.
+ */
+uint8_t SCHEDULER_GetTaskCount(void)
+{
+    return scheduler_count;
+}
+
+/**
+ * @brief Get the name of a task.
+ * @param index The index of the task.
+ * @return The name of the task, nullptr if there is no such task.
+ */
+const char *SCHEDULER_GetTaskName(uint8_t index)
+{
+    if (index >= scheduler_count)
+    {
+        return nullptr;
+    }
+    return scheduler_tasks[index].name;
+}
+
+/**
+ * @brief Get the statistics of a task.
+ * @param index The index of the task.
+ * @param stats Pointer to the location where the statistics will be put.
+ * @return True if the task exists, false otherwise.
+ */
+bool SCHEDULER_GetStats(uint8_t index, scheduler_stats_t *stats)
+{
+    if (index >= scheduler_count)
+    {
+        return false;
+    }
+    *stats = scheduler_states[index].stats;
+    return true;
+}
@@ -0,0 +1,68 @@
+/**
+ ***************************************************************************************************
+ * @file scheduler.h
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Header file for the cooperative scheduler of the main loop.
+ ***************************************************************************************************
+ */
+
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+
+/**
+ * @brief The maximum number of tasks.
+ */
+#define SCHEDULER_MAX_TASKS 8
+
+/**
+ * @brief The type of the function that checks if a task has work to do.
+ * @return True if the task is ready to run, false otherwise.
+ * @note This is called on every round of the scheduler, so it has to be cheap.
+ */
+typedef bool scheduler_poll_t(void);
+
+/**
+ * @brief The type of the function that does one step of the work of a task.
+ * @note The step has to return within the budget of the task. A longer work is split into steps,
+ * the task stays ready until it is done.
+ */
+typedef void scheduler_run_t(void);
+
+/**
+ * @brief A task of the scheduler.
+ */
+typedef struct _scheduler_task_t
+{
+    const char *name;           /**< The name of the task in the statistics. */
+    scheduler_poll_t *poll;     /**< Checks if the task is ready. */
+    scheduler_run_t *run;       /**< Does one step of the task. */
+    unsigned long budgetMicros; /**< The longest step the task is expected to take. */
+} scheduler_task_t;
+
+/**
+ * @brief Statistics of a task since the scheduler started.
+ */
+typedef struct _scheduler_stats_t
+{
+    uint32_t runs;             /**< The number of steps. */
+    uint32_t totalMicros;      /**< The time spent in the steps. */
+    uint32_t maxRunMicros;     /**< The longest step. */
+    uint32_t maxLatencyMicros; /**< The longest time from the task getting ready to its step. */
+    uint32_t overruns;         /**< The number of steps longer than the budget. */
+} scheduler_stats_t;
+
+void SCHEDULER_Init(const scheduler_task_t *tasks, uint8_t count);
+
+bool SCHEDULER_RunOnce(void);
+
+uint8_t SCHEDULER_GetTaskCount(void);
+
+const char *SCHEDULER_GetTaskName(uint8_t index);
+
+bool SCHEDULER_GetStats(uint8_t index, scheduler_stats_t *stats);
+
+#endif /* SCHEDULER_H */
@@ -0,0 +1,458 @@
+/**
+ ***************************************************************************************************
+ * @file secure.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Implementation of secure.h.
+ ***************************************************************************************************
+ */
+
+#include "secure.h"
+
+#include <string.h>
+
+#include "byteorder.h"
+
+/**
+ * @defgroup secure_labels Secure channel labels
+ * @brief Labels separating the uses of the same key.
+ * @{
+ */
+#define SECURE_LABEL_DEVICE "device"
+#define SECURE_LABEL_HELLO "K0"
+#define SECURE_LABEL_REPLY "K1"
+#define SECURE_LABEL_CLIENT_KEY "c2s"
+#define SECURE_LABEL_SERVER_KEY "s2c"
+#define SECURE_LABEL_RESUMPTION "res"
+/** @} */
+
+/**
+ * @brief Calculate the HMAC-SHA256 of a label followed by two pieces of data.
+ * @param key The key.
+ * @param label The label.
+ * @param first The first piece of data, can be nullptr if its length is 0.
+ * @param firstLength The length of the first piece.
+ * @param second The second piece of data, can be nullptr if its length is 0.
+ * @param secondLength The length of the second piece.
+ * @param mac Buffer of #SECURE_MAC_SIZE bytes to store the MAC in.
+ */
+static void SECURE_Mac(const uint8_t *key, const char *label, const uint8_t *first,
+                       uint16_t firstLength, const uint8_t *second, uint16_t secondLength,
+                       uint8_t *mac)
+{
+    sha256_hmac_context_t context;
+    SHA256_HmacInit(&context, key, SECURE_KEY_SIZE);
+    SHA256_HmacUpdate(&context, (const uint8_t *)label, (uint16_t)strlen(label));
+    SHA256_HmacUpdate(&context, first, firstLength);
+    SHA256_HmacUpdate(&context, second, secondLength);
+    SHA256_HmacFinal(&context, mac);
+}
+
+/**
+ * @brief Compare two MACs in constant time.
+ * @return True if the MACs are equal, false otherwise.
+ */
+static bool SECURE_MacEquals(const uint8_t *mac1, const uint8_t *mac2)
+{
+    uint8_t difference = 0;
+    for (uint8_t i = 0; i < SECURE_MAC_SIZE; i++)
+    {
+        difference |= mac1[i] ^ mac2[i];
+    }
+    return difference == 0;
+}
+
+/**
+ * @brief Derive the session keys and the resumption secret from the master secret.
+ * @param master The master secret of the session.
+ * @param client True on the module's side, false on the central module's side.
+ * @param session The session to set up.
+ * @param resumption Buffer of #SECURE_KEY_SIZE bytes to store the resumption secret in.
+ */
+static void SECURE_DeriveKeys(const uint8_t *master, bool client, secure_session_t *session,
+                              uint8_t *resumption)
+{
+    uint8_t *client_key = client ? session->sendKey : session->receiveKey;
+    uint8_t *server_key = client ? session->receiveKey : session->sendKey;
+    SECURE_Mac(master, SECURE_LABEL_CLIENT_KEY, nullptr, 0, nullptr, 0, client_key);
+    SECURE_Mac(master, SECURE_LABEL_SERVER_KEY, nullptr, 0, nullptr, 0, server_key);
+    SECURE_Mac(master, SECURE_LABEL_RESUMPTION, nullptr, 0, nullptr, 0, resumption);
+    session->sendCounter = 0;
+    session->receiveCounter = 0;
+}
+
+/**
+ * @brief Build the nonce of a sealed frame from its counter.
+ * @param counter The frame counter of the direction.
+ * @param nonce Buffer of #CHACHAPOLY_NONCE_SIZE bytes.
+ */
+static void SECURE_Nonce(uint32_t counter, uint8_t *nonce)
+{
+    memset(nonce, 0, CHACHAPOLY_NONCE_SIZE);
+    BYTEORDER_WriteUint32Be(&(nonce[CHACHAPOLY_NONCE_SIZE - 4]), counter);
+}
+
+/**
+ * @brief Build the additional data of a sealed frame from its header.
+ * @param type The type of the frame, with #FRAME_TYPE_SEALED set.
+ * @param offset The offset of the frame.
+ * @param total The total of the frame.
+ * @param aad Buffer of 5 bytes.
+ */
+static void SECURE_Aad(uint8_t type, uint16_t offset, uint16_t total, uint8_t *aad)
+{
+    aad[0] = type;
+    aad[1] = (uint8_t)(offset >> 8);
+    aad[2] = (uint8_t)(offset & 0xFF);
+    aad[3] = (uint8_t)(total >> 8);
+    aad[4] = (uint8_t)(total & 0xFF);
+}
+
+/**
+ * @brief Issue a session ticket.
+ * @param server The keys of the central module.
+ * @param nonce The random nonce of the ticket.
+ * @param chipId The chip ID of the module.
+ * @param resumption The resumption secret of the session.
+ * @param now The current time.
+ * @param ticket Buffer of #SECURE_TICKET_SIZE bytes.
+ */
+static void SECURE_IssueTicket(const secure_server_t *server, const uint8_t *nonce,
+                               uint32_t chipId, const uint8_t *resumption, uint32_t now,
+                               uint8_t *ticket)
+{
+    uint8_t *content = &(ticket[CHACHAPOLY_NONCE_SIZE]);
+    memcpy(ticket, nonce, CHACHAPOLY_NONCE_SIZE);
+    BYTEORDER_WriteUint32Be(content, chipId);
+    memcpy(&(content[4]), resumption, SECURE_KEY_SIZE);
+    BYTEORDER_WriteUint32Be(&(content[4 + SECURE_KEY_SIZE]), now);
+    CHACHAPOLY_Seal(server->ticketKey, nonce, nullptr, 0, content, 8 + SECURE_KEY_SIZE,
+                    &(content[8 + SECURE_KEY_SIZE]));
+}
+
+/**
+ * @brief Decrypt a session ticket.
+ * @param server The keys of the central module.
+ * @param ticket The ticket.
+ * @param now The current time.
+ * @param chipId Pointer to store the chip ID of the ticket in.
+ * @param resumption Buffer of #SECURE_KEY_SIZE bytes to store the resumption secret in.
+ * @return True if the ticket was issued by the central module and did not expire, false
+ * otherwise.
+ */
+static bool SECURE_OpenTicket(const secure_server_t *server, const uint8_t *ticket, uint32_t now,
+                              uint32_t *chipId, uint8_t *resumption)
+{
+    uint8_t content[8 + SECURE_KEY_SIZE];
+    memcpy(content, &(ticket[CHACHAPOLY_NONCE_SIZE]), sizeof(content));
+    if (!CHACHAPOLY_Open(server->ticketKey, ticket, nullptr, 0, content, sizeof(content),
+                         &(ticket[CHACHAPOLY_NONCE_SIZE + sizeof(content)])))
+    {
+        return false;
+    }
+
+    uint32_t issued = BYTEORDER_ReadUint32Be(&(content[4 + SECURE_KEY_SIZE]));
+    if ((now < issued) || (now - issued > server->ticketLifetime))
+    {
+        return false;
+    }
+    *chipId = BYTEORDER_ReadUint32Be(content);
+    memcpy(resumption, &(content[4]), SECURE_KEY_SIZE);
+
+    return true;
+}
+
+/**
+ * @brief Derive the pre-shared key of a module.
+ * @param siteKey The key of the site.
+ * @param siteKeyLength The length of the site key.
+ * @param chipId The chip ID of the module.
+ * @param deviceKey Buffer of #SECURE_KEY_SIZE bytes to store the device key in.
+ */
+void SECURE_DeriveDeviceKey(const uint8_t *siteKey, uint16_t siteKeyLength, uint32_t chipId,
+                            uint8_t *deviceKey)
+{
+    uint8_t chip_id[4];
+    BYTEORDER_WriteUint32Be(chip_id, chipId);
+
+    sha256_hmac_context_t context;
+    SHA256_HmacInit(&context, siteKey, siteKeyLength);
+    SHA256_HmacUpdate(&context, (const uint8_t *)SECURE_LABEL_DEVICE,
+                      sizeof(SECURE_LABEL_DEVICE) - 1);
+    SHA256_HmacUpdate(&context, chip_id, sizeof(chip_id));
+    SHA256_HmacFinal(&context, deviceKey);
+}
+
+/**
+ * @brief Initialize the module's side of the handshake, without a ticket.
+ * @param client The state of the handshake.
+ * @param deviceKey The pre-shared key of the module.
+ * @param chipId The chip ID of the module.
+ */
+void SECURE_ClientInit(secure_client_t *client, const uint8_t *deviceKey, uint32_t chipId)
+{
+    memset(client, 0, sizeof(secure_client_t));
+    memcpy(client->deviceKey, deviceKey, SECURE_KEY_SIZE);
+    client->chipId = chipId;
+}
+
+/**
+ * @brief Build the request of the handshake, a resumption if there is a ticket.
+ * @param client The state of the handshake.
+ * @param random #SECURE_CLIENT_RANDOM_SIZE random bytes.
+ * @param mode Pointer to store the mode of the request in, the offset of the frame.
+ * @param hello Buffer of #SECURE_HELLO_RESUME_SIZE bytes to store the request in.
+ * @return The length of the request.
+ * @note The full handshake calculates the public key, one X25519 scalar multiplication.
+ */
+uint16_t SECURE_ClientHello(secure_client_t *client, const uint8_t *random, uint8_t *mode,
+                            uint8_t *hello)
+{
+    uint8_t *position = client->hello;
+    BYTEORDER_WriteUint32Be(position, client->chipId);
+    position += 4;
+    memcpy(position, random, SECURE_RANDOM_SIZE);
+    position += SECURE_RANDOM_SIZE;
+
+    const uint8_t *key;
+    if (client->hasTicket)
+    {
+        client->mode = SECURE_MODE_RESUME;
+        memcpy(position, client->ticket, SECURE_TICKET_SIZE);
+        position += SECURE_TICKET_SIZE;
+        key = client->resumptionSecret;
+    }
+    else
+    {
+        client->mode = SECURE_MODE_FULL;
+        memcpy(client->privateKey, &(random[SECURE_RANDOM_SIZE]), X25519_SIZE);
+        X25519_PublicKey(position, client->privateKey);
+        position += X25519_SIZE;
+        key = client->deviceKey;
+    }
+
+    uint16_t signed_length = (uint16_t)(position - client->hello);
+    SECURE_Mac(key, SECURE_LABEL_HELLO, client->hello, signed_length, nullptr, 0, position);
+    client->helloLength = signed_length + SECURE_MAC_SIZE;
+
+    *mode = client->mode;
+    memcpy(hello, client->hello, client->helloLength);
+    return client->helloLength;
+}
+
+/**
+ * @brief Process the answer of the central module to the request of the handshake.
+ * @param client The state of the handshake.
+ * @param reply The payload of the answer.
+ * @param length The length of the answer.
+ * @param session The session to set up.
+ * @return #SECURE_HANDSHAKE_DONE if the channel is established, #SECURE_HANDSHAKE_RETRY if the
+ * ticket was rejected and a full handshake has to follow, #SECURE_HANDSHAKE_FAILED otherwise.
+ * @note The full handshake calculates the shared secret, one X25519 scalar multiplication.
+ */
+secure_handshake_result_t SECURE_ClientFinish(secure_client_t *client, const uint8_t *reply,
+                                              uint16_t length, secure_session_t *session)
+{
+    bool resume = (client->mode == SECURE_MODE_RESUME);
+    if (resume && (length == 0))
+    {
+        client->hasTicket = false;
+        return SECURE_HANDSHAKE_RETRY;
+    }
+    if (length != (resume ? SECURE_REPLY_RESUME_SIZE : SECURE_REPLY_FULL_SIZE))
+    {
+        return SECURE_HANDSHAKE_FAILED;
+    }
+
+    uint16_t signed_length = length - SECURE_MAC_SIZE;
+    const uint8_t *key = resume ? client->resumptionSecret : client->deviceKey;
+    uint8_t mac[SECURE_MAC_SIZE];
+    SECURE_Mac(key, SECURE_LABEL_REPLY, client->hello, client->helloLength, reply, signed_length,
+               mac);
+    if (!SECURE_MacEquals(mac, &(reply[signed_length])))
+    {
+        return SECURE_HANDSHAKE_FAILED;
+    }
+
+    uint8_t master[SECURE_KEY_SIZE];
+    const uint8_t *ticket;
+    if (resume)
+    {
+        SECURE_Mac(key, SECURE_LABEL_RESUMPTION, client->hello, client->helloLength, reply,
+                   SECURE_RANDOM_SIZE, master);
+        ticket = &(reply[SECURE_RANDOM_SIZE]);
+    }
+    else
+    {
+        uint8_t shared[X25519_SIZE];
+        if (!X25519_SharedSecret(shared, client->privateKey, &(reply[SECURE_RANDOM_SIZE])))
+        {
+            return SECURE_HANDSHAKE_FAILED;
+        }
+        sha256_hmac_context_t context;
+        SHA256_HmacInit(&context, key, SECURE_KEY_SIZE);
+        SHA256_HmacUpdate(&context, shared, X25519_SIZE);
+        SHA256_HmacUpdate(&context, client->hello, client->helloLength);
+        SHA256_HmacUpdate(&context, reply, SECURE_RANDOM_SIZE + X25519_SIZE);
+        SHA256_HmacFinal(&context, master);
+        memset(client->privateKey, 0, X25519_SIZE);
+        ticket = &(reply[SECURE_RANDOM_SIZE + X25519_SIZE]);
+    }
+
+    SECURE_DeriveKeys(master, true, session, client->resumptionSecret);
+    memcpy(client->ticket, ticket, SECURE_TICKET_SIZE);
+    client->hasTicket = true;
+
+    return SECURE_HANDSHAKE_DONE;
+}
+
+/**
+ * @brief Answer the request of the handshake on the central module's side.
+ * @param server The keys of the central module.
+ * @param mode The mode of the request, the offset of the frame.
+ * @param hello The payload of the request.
+ * @param length The length of the request.
+ * @param random #SECURE_SERVER_RANDOM_SIZE random bytes.
+ * @param now The current time, for the tickets.
+ * @param reply Buffer of #SECURE_REPLY_FULL_SIZE bytes to store the answer in.
+ * @param replyLength Pointer to store the length of the answer in.
+ * @param session The session to set up.
+ * @param chipId Pointer to store the authenticated chip ID of the module in.
+ * @return #SECURE_HANDSHAKE_DONE if the channel is established, #SECURE_HANDSHAKE_RETRY if the
+ * ticket is rejected with the empty answer, #SECURE_HANDSHAKE_FAILED otherwise.
+ */
+secure_handshake_result_t SECURE_ServerAccept(const secure_server_t *server, uint8_t mode,
+                                              const uint8_t *hello, uint16_t length,
+                                              const uint8_t *random, uint32_t now,
+                                              uint8_t *reply, uint16_t *replyLength,
+                                              secure_session_t *session, uint32_t *chipId)
+{
+    bool resume = (mode == SECURE_MODE_RESUME);
+    if (((mode != SECURE_MODE_FULL) && !resume) ||
+        (length != (resume ? SECURE_HELLO_RESUME_SIZE : SECURE_HELLO_FULL_SIZE)))
+    {
+        return SECURE_HANDSHAKE_FAILED;
+    }
+    uint32_t chip_id = BYTEORDER_ReadUint32Be(hello);
+    uint16_t signed_length = length - SECURE_MAC_SIZE;
+
+    uint8_t key[SECURE_KEY_SIZE];
+    if (resume)
+    {
+        uint32_t ticket_chip_id;
+        if (!SECURE_OpenTicket(server, &(hello[4 + SECURE_RANDOM_SIZE]), now, &ticket_chip_id,
+                               key) ||
+            (ticket_chip_id != chip_id))
+        {
+            *replyLength = 0;
+            return SECURE_HANDSHAKE_RETRY;
+        }
+    }
+    else
+    {
+        SECURE_DeriveDeviceKey(server->siteKey, SECURE_KEY_SIZE, chip_id, key);
+    }
+
+    uint8_t mac[SECURE_MAC_SIZE];
+    SECURE_Mac(key, SECURE_LABEL_HELLO, hello, signed_length, nullptr, 0, mac);
+    if (!SECURE_MacEquals(mac, &(hello[signed_length])))
+    {
+        return SECURE_HANDSHAKE_FAILED;
+    }
+
+    uint8_t *position = reply;
+    memcpy(position, random, SECURE_RANDOM_SIZE);
+    position += SECURE_RANDOM_SIZE;
+
+    uint8_t master[SECURE_KEY_SIZE];
+    if (resume)
+    {
+        SECURE_Mac(key, SECURE_LABEL_RESUMPTION, hello, length, reply, SECURE_RANDOM_SIZE,
+                   master);
+    }
+    else
+    {
+        const uint8_t *private_key = &(random[SECURE_RANDOM_SIZE]);
+        X25519_PublicKey(position, private_key);
+        position += X25519_SIZE;
+
+        uint8_t shared[X25519_SIZE];
+        if (!X25519_SharedSecret(shared, private_key, &(hello[4 + SECURE_RANDOM_SIZE])))
+        {
+            return SECURE_HANDSHAKE_FAILED;
+        }
+        sha256_hmac_context_t context;
+        SHA256_HmacInit(&context, key, SECURE_KEY_SIZE);
+        SHA256_HmacUpdate(&context, shared, X25519_SIZE);
+        SHA256_HmacUpdate(&context, hello, length);
+        SHA256_HmacUpdate(&context, reply, SECURE_RANDOM_SIZE + X25519_SIZE);
+        SHA256_HmacFinal(&context, master);
+    }
+
+    uint8_t resumption[SECURE_KEY_SIZE];
+    SECURE_DeriveKeys(master, false, session, resumption);
+    SECURE_IssueTicket(server, &(random[SECURE_RANDOM_SIZE + X25519_SIZE]), chip_id, resumption,
+                       now, position);
+    position += SECURE_TICKET_SIZE;
+
+    uint16_t reply_signed_length = (uint16_t)(position - reply);
+    SECURE_Mac(key, SECURE_LABEL_REPLY, hello, length, reply, reply_signed_length, position);
+    *replyLength = reply_signed_length + SECURE_MAC_SIZE;
+    *chipId = chip_id;
+
+    return SECURE_HANDSHAKE_DONE;
+}
+
+/**
+ * @brief Seal the payload of a frame in place.
+ * @param session The established session.
+ * @param type The type of the frame, with #FRAME_TYPE_SEALED set.
+ * @param offset The offset of the frame.
+ * @param total The total of the frame.
+ * @param payload The payload, in a buffer with room for #FRAME_SEAL_SIZE more bytes.
+ * @param length The length of the payload.
+ * @return The length of the sealed payload.
+ */
+uint16_t SECURE_Seal(secure_session_t *session, uint8_t type, uint16_t offset, uint16_t total,
+                     uint8_t *payload, uint16_t length)
+{
+    uint8_t nonce[CHACHAPOLY_NONCE_SIZE];
+    uint8_t aad[5];
+    SECURE_Nonce(session->sendCounter++, nonce);
+    SECURE_Aad(type, offset, total, aad);
+    CHACHAPOLY_Seal(session->sendKey, nonce, aad, sizeof(aad), payload, length,
+                    &(payload[length]));
+
+    return length + FRAME_SEAL_SIZE;
+}
+
+/**
+ * @brief Verify and decrypt a sealed frame in place.
+ * @param session The established session.
+ * @param frame The received frame. On success its type and length are those of the plain frame.
+ * @return True if the frame is the next one sealed by the peer, false otherwise.
+ */
+bool SECURE_Open(secure_session_t *session, frame_t *frame)
+{
+    if (((frame->type & FRAME_TYPE_SEALED) == 0) || (frame->length < FRAME_SEAL_SIZE))
+    {
+        return false;
+    }
+
+    uint16_t length = frame->length - FRAME_SEAL_SIZE;
+    uint8_t nonce[CHACHAPOLY_NONCE_SIZE];
+    uint8_t aad[5];
+    SECURE_Nonce(session->receiveCounter, nonce);
+    SECURE_Aad(frame->type, frame->offset, frame->total, aad);
+    if (!CHACHAPOLY_Open(session->receiveKey, nonce, aad, sizeof(aad), frame->payload, length,
+                         &(frame->payload[length])))
+    {
+        return false;
+    }
+
+    session->receiveCounter++;
+    frame->type &= (uint8_t)~FRAME_TYPE_SEALED;
+    frame->length = length;
+    return true;
+}
@@ -0,0 +1,141 @@
+/**
+ ***************************************************************************************************
+ * @file secure.h
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Header file for the secure channel of the sync protocol.
+ *
+ * Every module has its own pre-shared key, derived from the key of the site and the chip ID, so
+ * the central module can calculate it. The connection starts with a #FRAME_TYPE_KEY exchange:
+ *
+ * - Full handshake (#SECURE_MODE_FULL): ephemeral X25519 keys, authenticated with the device key.
+ *   Request: chip ID (4), random (16), public key (32), MAC (32). Answer: random (16), public key
+ *   (32), session ticket, MAC (32).
+ * - Resumption (#SECURE_MODE_RESUME): the ticket of the previous session and its resumption
+ *   secret replace the key exchange. Request: chip ID (4), random (16), ticket, MAC (32). Answer:
+ *   random (16), new ticket, MAC (32), or an empty answer if the ticket is not accepted.
+ *
+ * The MACs are HMAC-SHA256 over everything sent before them. The session keys are derived from
+ * the shared secret (or the resumption secret) and both randoms, one key for each direction. The
+ * following frames are sealed with ChaCha20-Poly1305: the nonce is the frame counter of the
+ * direction, the header is the additional data, the tag follows the encrypted payload.
+ *
+ * The ticket is opaque to the module: the central module encrypts the chip ID, the resumption
+ * secret and the time of issue in it with its own ticket key.
+ *
+ * The functions only use the given random bytes and time, so the same code runs on the module and
+ * on the host tools.
+ ***************************************************************************************************
+ */
+
+#ifndef SECURE_H
+#define SECURE_H
+
+#include <stdint.h>
+
+#include "chacha20poly1305.h"
+#include "frame.h"
+#include "sha256.h"
+#include "x25519.h"
+
+/**
+ * @defgroup secure_sizes Secure channel sizes
+ * @brief The sizes of the keys and of the handshake messages.
+ * @{
+ */
+#define SECURE_KEY_SIZE 32
+#define SECURE_RANDOM_SIZE 16
+#define SECURE_MAC_SIZE SHA256_SIZE
+/** @brief Nonce, chip ID, resumption secret, time of issue and tag. */
+#define SECURE_TICKET_SIZE (CHACHAPOLY_NONCE_SIZE + 4 + SECURE_KEY_SIZE + 4 + CHACHAPOLY_TAG_SIZE)
+/** @brief Random bytes needed by SECURE_ClientHello(): the random and the private key. */
+#define SECURE_CLIENT_RANDOM_SIZE (SECURE_RANDOM_SIZE + X25519_SIZE)
+/** @brief Random bytes needed by SECURE_ServerAccept(): the random, private key, ticket nonce. */
+#define SECURE_SERVER_RANDOM_SIZE (SECURE_RANDOM_SIZE + X25519_SIZE + CHACHAPOLY_NONCE_SIZE)
+#define SECURE_HELLO_FULL_SIZE (4 + SECURE_RANDOM_SIZE + X25519_SIZE + SECURE_MAC_SIZE)
+#define SECURE_HELLO_RESUME_SIZE (4 + SECURE_RANDOM_SIZE + SECURE_TICKET_SIZE + SECURE_MAC_SIZE)
+#define SECURE_REPLY_FULL_SIZE \
+    (SECURE_RANDOM_SIZE + X25519_SIZE + SECURE_TICKET_SIZE + SECURE_MAC_SIZE)
+#define SECURE_REPLY_RESUME_SIZE (SECURE_RANDOM_SIZE + SECURE_TICKET_SIZE + SECURE_MAC_SIZE)
+/** @} */
+
+/**
+ * @defgroup secure_modes Secure channel handshake modes
+ * @brief The offset of a #FRAME_TYPE_KEY frame.
+ * @{
+ */
+#define SECURE_MODE_FULL 0
+#define SECURE_MODE_RESUME 1
+/** @} */
+
+/**
+ * @brief The keys and frame counters of an established channel.
+ */
+typedef struct _secure_session_t
+{
+    uint8_t sendKey[SECURE_KEY_SIZE];    /**< The key of the frames sent. */
+    uint8_t receiveKey[SECURE_KEY_SIZE]; /**< The key of the frames received. */
+    uint32_t sendCounter;                /**< The number of frames sent. */
+    uint32_t receiveCounter;             /**< The number of frames received. */
+} secure_session_t;
+
+/**
+ * @brief The module's side of the handshake, with the ticket kept between the sessions.
+ */
+typedef struct _secure_client_t
+{
+    uint8_t deviceKey[SECURE_KEY_SIZE];         /**< The pre-shared key of the module. */
+    uint32_t chipId;                            /**< The chip ID of the module. */
+    uint8_t mode;                               /**< The mode of the pending request. */
+    uint8_t privateKey[X25519_SIZE];            /**< The ephemeral key of a full handshake. */
+    uint8_t hello[SECURE_HELLO_RESUME_SIZE];    /**< The pending request. */
+    uint16_t helloLength;                       /**< The length of the pending request. */
+    bool hasTicket;                             /**< True if a session can be resumed. */
+    uint8_t ticket[SECURE_TICKET_SIZE];         /**< The ticket of the last session. */
+    uint8_t resumptionSecret[SECURE_KEY_SIZE];  /**< The resumption secret of the ticket. */
+} secure_client_t;
+
+/**
+ * @brief The central module's keys.
+ */
+typedef struct _secure_server_t
+{
+    uint8_t siteKey[SECURE_KEY_SIZE];   /**< The key the device keys are derived from. */
+    uint8_t ticketKey[SECURE_KEY_SIZE]; /**< The key the tickets are encrypted with. */
+    uint32_t ticketLifetime;            /**< The time a ticket is accepted for, in seconds. */
+} secure_server_t;
+
+/**
+ * @brief The result of a handshake step.
+ */
+typedef enum _secure_handshake_result_t
+{
+    SECURE_HANDSHAKE_DONE,  /**< The channel is established. */
+    SECURE_HANDSHAKE_RETRY, /**< The ticket was rejected, a full handshake is needed. */
+    SECURE_HANDSHAKE_FAILED /**< The peer could not be authenticated. */
+} secure_handshake_result_t;
+
+void SECURE_DeriveDeviceKey(const uint8_t *siteKey, uint16_t siteKeyLength, uint32_t chipId,
+                            uint8_t *deviceKey);
+
+void SECURE_ClientInit(secure_client_t *client, const uint8_t *deviceKey, uint32_t chipId);
+
+uint16_t SECURE_ClientHello(secure_client_t *client, const uint8_t *random, uint8_t *mode,
+                            uint8_t *hello);
+
+secure_handshake_result_t SECURE_ClientFinish(secure_client_t *client, const uint8_t *reply,
+                                              uint16_t length, secure_session_t *session);
+
+secure_handshake_result_t SECURE_ServerAccept(const secure_server_t *server, uint8_t mode,
+                                              const uint8_t *hello, uint16_t length,
+                                              const uint8_t *random, uint32_t now,
+                                              uint8_t *reply, uint16_t *replyLength,
+                                              secure_session_t *session, uint32_t *chipId);
+
+uint16_t SECURE_Seal(secure_session_t *session, uint8_t type, uint16_t offset, uint16_t total,
+                     uint8_t *payload, uint16_t length);
+
+bool SECURE_Open(secure_session_t *session, frame_t *frame);
+
+#endif /* SECURE_H */
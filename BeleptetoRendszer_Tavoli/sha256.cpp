@@ -0,0 +1,225 @@
+/**
+ ***************************************************************************************************
+ * @file sha256.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Implementation of sha256.h.
+ ***************************************************************************************************
+ */
+
+#include "sha256.h"
+
+#include <string.h>
+
+#include "byteorder.h"
+
+/**
+ * @brief The round constants of SHA-256.
+ */
+static const uint32_t sha256RoundConstants[64] = {
+    0x428a2f98, 0x71374491, 0xb5c0fbcf, 0xe9b5dba5, 0x3956c25b, 0x59f111f1, 0x923f82a4, 0xab1c5ed5,
+    0xd807aa98, 0x12835b01, 0x243185be, 0x550c7dc3, 0x72be5d74, 0x80deb1fe, 0x9bdc06a7, 0xc19bf174,
+    0xe49b69c1, 0xefbe4786, 0x0fc19dc6, 0x240ca1cc, 0x2de92c6f, 0x4a7484aa, 0x5cb0a9dc, 0x76f988da,
+    0x983e5152, 0xa831c66d, 0xb00327c8, 0xbf597fc7, 0xc6e00bf3, 0xd5a79147, 0x06ca6351, 0x14292967,
+    0x27b70a85, 0x2e1b2138, 0x4d2c6dfc, 0x53380d13, 0x650a7354, 0x766a0abb, 0x81c2c92e, 0x92722c85,
+    0xa2bfe8a1, 0xa81a664b, 0xc24b8b70, 0xc76c51a3, 0xd192e819, 0xd6990624, 0xf40e3585, 0x106aa070,
+    0x19a4c116, 0x1e376c08, 0x2748774c, 0x34b0bcb5, 0x391c0cb3, 0x4ed8aa4a, 0x5b9cca4f, 0x682e6ff3,
+    0x748f82ee, 0x78a5636f, 0x84c87814, 0x8cc70208, 0x90befffa, 0xa4506ceb, 0xbef9a3f7, 0xc67178f2};
+
+/**
+ * @brief Rotate a 32 bit word to the right.
+ * @param x The word to rotate.
+ * @param n The number of bits to rotate by.
+ */
+#define ROTR(x, n) (((x) >> (n)) | ((x) << (32 - (n))))
+
+/**
+ * @brief Process one 64 byte block.
+ * @param context The context of the calculation.
+ * @param block The block to process.
+ */
+static void SHA256_ProcessBlock(sha256_context_t *context, const uint8_t *block)
+{
+    uint32_t w[64];
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        w[i] = BYTEORDER_ReadUint32Be(&(block[i * 4]));
+    }
+    for (uint8_t i = 16; i < 64; i++)
+    {
+        uint32_t s0 = ROTR(w[i - 15], 7) ^ ROTR(w[i - 15], 18) ^ (w[i - 15] >> 3);
+        uint32_t s1 = ROTR(w[i - 2], 17) ^ ROTR(w[i - 2], 19) ^ (w[i - 2] >> 10);
+        w[i] = w[i - 16] + s0 + w[i - 7] + s1;
+    }
+
+    uint32_t a = context->state[0];
+    uint32_t b = context->state[1];
+    uint32_t c = context->state[2];
+    uint32_t d = context->state[3];
+    uint32_t e = context->state[4];
+    uint32_t f = context->state[5];
+    uint32_t g = context->state[6];
+    uint32_t h = context->state[7];
+
+    for (uint8_t i = 0; i < 64; i++)
+    {
+        uint32_t s1 = ROTR(e, 6) ^ ROTR(e, 11) ^ ROTR(e, 25);
+        uint32_t ch = (e & f) ^ ((~e) & g);
+        uint32_t t1 = h + s1 + ch + sha256RoundConstants[i] + w[i];
+        uint32_t s0 = ROTR(a, 2) ^ ROTR(a, 13) ^ ROTR(a, 22);
+        uint32_t maj = (a & b) ^ (a & c) ^ (b & c);
+        uint32_t t2 = s0 + maj;
+
+        h = g;
+        g = f;
+        f = e;
+        e = d + t1;
+        d = c;
+        c = b;
+        b = a;
+        a = t1 + t2;
+    }
+
+    context->state[0] += a;
+    context->state[1] += b;
+    context->state[2] += c;
+    context->state[3] += d;
+    context->state[4] += e;
+    context->state[5] += f;
+    context->state[6] += g;
+    context->state[7] += h;
+}
+
+/**
+ * @brief Start a new SHA-256 calculation.
+ * @param context The context of the calculation.
+ */
+void SHA256_Init(sha256_context_t *context)
+{
+    context->state[0] = 0x6a09e667;
+    context->state[1] = 0xbb67ae85;
+    context->state[2] = 0x3c6ef372;
+    context->state[3] = 0xa54ff53a;
+    context->state[4] = 0x510e527f;
+    context->state[5] = 0x9b05688c;
+    context->state[6] = 0x1f83d9ab;
+    context->state[7] = 0x5be0cd19;
+    context->length = 0;
+}
+
+/**
+ * @brief Add data to a running SHA-256 calculation.
+ * @param context The context of the calculation.
+ * @param data The data to hash.
+ * @param length The length of the data.
+ */
+void SHA256_Update(sha256_context_t *context, const uint8_t *data, uint16_t length)
+{
+    uint8_t used = (uint8_t)(context->length % SHA256_BLOCK_SIZE);
+    context->length += length;
+
+    for (uint16_t i = 0; i < length; i++)
+    {
+        context->block[used++] = data[i];
+        if (used == SHA256_BLOCK_SIZE)
+        {
+            SHA256_ProcessBlock(context, context->block);
+            used = 0;
+        }
+    }
+}
+
+/**
+ * @brief Finish a SHA-256 calculation.
+ * @param context The context of the calculation.
+ * @param digest Buffer of #SHA256_SIZE bytes to store the digest in.
+ */
+void SHA256_Final(sha256_context_t *context, uint8_t *digest)
+{
+    uint64_t bit_length = context->length * 8;
+    uint8_t used = (uint8_t)(context->length % SHA256_BLOCK_SIZE);
+
+    // Append the 0x80 byte, then pad with zeros until 8 bytes are left in the block
+    context->block[used++] = 0x80;
+    if (used > SHA256_BLOCK_SIZE - 8)
+    {
+        memset(&(context->block[used]), 0, SHA256_BLOCK_SIZE - used);
+        SHA256_ProcessBlock(context, context->block);
+        used = 0;
+    }
+    memset(&(context->block[used]), 0, SHA256_BLOCK_SIZE - 8 - used);
+
+    // Append the length of the message in bits
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        context->block[SHA256_BLOCK_SIZE - 1 - i] = (uint8_t)(bit_length >> (i * 8));
+    }
+    SHA256_ProcessBlock(context, context->block);
+
+    for (uint8_t i = 0; i < 8; i++)
+    {
+        BYTEORDER_WriteUint32Be(&(digest[i * 4]), context->state[i]);
+    }
+}
+
+/**
+ * @brief Start a new HMAC-SHA256 calculation.
+ * @param context The context of the calculation.
+ * @param key The key.
+ * @param length The length of the key, a key longer than a block is hashed first.
+ */
+void SHA256_HmacInit(sha256_hmac_context_t *context, const uint8_t *key, uint16_t length)
+{
+    memset(context->key, 0, SHA256_BLOCK_SIZE);
+    if (length > SHA256_BLOCK_SIZE)
+    {
+        SHA256_Init(&(context->context));
+        SHA256_Update(&(context->context), key, length);
+        SHA256_Final(&(context->context), context->key);
+    }
+    else
+    {
+        memcpy(context->key, key, length);
+    }
+
+    uint8_t pad[SHA256_BLOCK_SIZE];
+    for (uint8_t i = 0; i < SHA256_BLOCK_SIZE; i++)
+    {
+        pad[i] = context->key[i] ^ 0x36;
+    }
+    SHA256_Init(&(context->context));
+    SHA256_Update(&(context->context), pad, SHA256_BLOCK_SIZE);
+}
+
+/**
+ * @brief Add data to a running HMAC-SHA256 calculation.
+ * @param context The context of the calculation.
+ * @param data The data to authenticate.
+ * @param length The length of the data.
+ */
+void SHA256_HmacUpdate(sha256_hmac_context_t *context, const uint8_t *data, uint16_t length)
+{
+    SHA256_Update(&(context->context), data, length);
+}
+
+/**
+ * @brief Finish an HMAC-SHA256 calculation.
+ * @param context The context of the calculation.
+ * @param mac Buffer of #SHA256_SIZE bytes to store the MAC in.
+ */
+void SHA256_HmacFinal(sha256_hmac_context_t *context, uint8_t *mac)
+{
+    uint8_t inner[SHA256_SIZE];
+    SHA256_Final(&(context->context), inner);
+
+    uint8_t pad[SHA256_BLOCK_SIZE];
+    for (uint8_t i = 0; i < SHA256_BLOCK_SIZE; i++)
+    {
+        pad[i] = context->key[i] ^ 0x5c;
+    }
+    SHA256_Init(&(context->context));
+    SHA256_Update(&(context->context), pad, SHA256_BLOCK_SIZE);
+    SHA256_Update(&(context->context), inner, SHA256_SIZE);
+    SHA256_Final(&(context->context), mac);
+}
@@ -0,0 +1,52 @@
+/**
+ ***************************************************************************************************
+ * @file sha256.h
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Header file for the SHA-256 hash functionality.
+ ***************************************************************************************************
+ */
+
+#ifndef SHA256_H
+#define SHA256_H
+
+#include <stdint.h>
+
+/** @brief Size of a SHA-256 digest in bytes. */
+#define SHA256_SIZE 32
+/** @brief Size of a SHA-256 block in bytes. */
+#define SHA256_BLOCK_SIZE 64
+
+/**
+ * @brief The context of a running SHA-256 calculation.
+ */
+typedef struct _sha256_context_t
+{
+    uint32_t state[8];               /**< The intermediate hash value. */
+    uint64_t length;                 /**< The number of bytes hashed so far. */
+    uint8_t block[SHA256_BLOCK_SIZE]; /**< The partial block waiting for more data. */
+} sha256_context_t;
+
+/**
+ * @brief The context of a running HMAC-SHA256 calculation.
+ */
+typedef struct _sha256_hmac_context_t
+{
+    sha256_context_t context;       /**< The running inner hash. */
+    uint8_t key[SHA256_BLOCK_SIZE]; /**< The key, padded to a block. */
+} sha256_hmac_context_t;
+
+void SHA256_Init(sha256_context_t *context);
+
+void SHA256_Update(sha256_context_t *context, const uint8_t *data, uint16_t length);
+
+void SHA256_Final(sha256_context_t *context, uint8_t *digest);
+
+void SHA256_HmacInit(sha256_hmac_context_t *context, const uint8_t *key, uint16_t length);
+
+void SHA256_HmacUpdate(sha256_hmac_context_t *context, const uint8_t *data, uint16_t length);
+
+void SHA256_HmacFinal(sha256_hmac_context_t *context, uint8_t *mac);
+
+#endif /* SHA256_H */
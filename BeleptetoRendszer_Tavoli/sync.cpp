@@ -0,0 +1,1413 @@
+/**
+ ***************************************************************************************************
+ * @file sync.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Implementation of sync.h.
+ *
+ * The synchronization is a state machine, every call of SYNC_Step() does at most one short step:
+ * it sends a frame or processes a received one, but it never waits for the central module. A
+ * failed step closes the connection, the next attempt reconnects and resumes the interrupted
+ * transfer from the last acknowledged chunk.
+ *
+ * A full synchronization first listens to the broadcast of the shared table image for a short
+ * time. The received chunks are tracked in a bitmap, only the missing ranges are downloaded over
+ * the connection to the central module.
+ *
+ * Between the daily synchronizations the module probes for revoked cards every
+ * #SYNC_PROBE_INTERVAL_MS. The probe only introduces the module and asks for the revocations, so
+ * the modem is on for a fraction of a full synchronization.
+ *
+ * With #SYNC_SECURE every frame after the handshake is sealed with ChaCha20-Poly1305. The first
+ * handshake authenticates with the pre-shared device key and agrees on the session keys with
+ * X25519. It returns a session ticket, the later synchronizations resume with the ticket and skip
+ * the key exchange. The broadcast of the table image is not sealed, so it is not used then.
+ ***************************************************************************************************
+ */
+
+#include "sync.h"
+
+#include <Arduino.h>
+#include <string.h>
+
+#include "transport.h"
+#include "frame.h"
+#include "sha256.h"
+#include "eeprom.h"
+#include "authenticate_log.h"
+#include "rtc.h"
+#include "byteorder.h"
+#include "crc32.h"
+#include "revocation.h"
+#include "secure.h"
+#include "timers.h"
+#include "BeleptetoRendszer_Tavoli.h"
+
+/**
+ * @defgroup sync_constants Sync constants
+ * @brief Constants of the synchronization.
+ * @{
+ */
+#define SYNC_MAX_ATTEMPTS 5
+#define SYNC_RESPONSE_TIMEOUT_MS 5000
+/** @brief Size of the table image received from the central module, starting at address 0. */
+#define SYNC_TABLE_IMAGE_SIZE (EEPROM_SIZE / 2)
+/** @brief The table image is tracked in chunks of this size, the size of the broadcast chunks. */
+#define SYNC_CHUNK_SIZE FRAME_MAX_PAYLOAD
+#define SYNC_CHUNK_COUNT ((SYNC_TABLE_IMAGE_SIZE + SYNC_CHUNK_SIZE - 1) / SYNC_CHUNK_SIZE)
+#define SYNC_CHUNKS_ALL ((uint32_t)((1ULL << SYNC_CHUNK_COUNT) - 1))
+/** @brief The maximum time of listening to the broadcast of the table image. */
+#define SYNC_MULTICAST_LISTEN_MS 4000
+/** @brief Listening to the broadcast stops if nothing was received for this time. */
+#define SYNC_MULTICAST_IDLE_MS 1000
+/** @} */
+
+#if SYNC_CHUNK_COUNT > 32
+#error "The chunks of the table image do not fit in the bitmap"
+#endif
+
+/**
+ * @defgroup sync_secure_constants Sync secure channel constants
+ * @brief Configuration of the secure channel to the central module.
+ *
+ * The pre-shared key of the module is #SYNC_DEVICE_KEY if it is provisioned at build time.
+ * Otherwise it is derived from #SYNC_SITE_KEY and the chip ID, the way the central module derives
+ * it, which is only meant for development: every module knows the site key then.
+ * @{
+ */
+#ifndef SYNC_SECURE
+#define SYNC_SECURE 1
+#endif
+#ifndef SYNC_SITE_KEY
+/** @brief The key of the site, #SECURE_KEY_SIZE characters. */
+#define SYNC_SITE_KEY "belepteto_rendszer_site_key_0001"
+#endif
+/** @} */
+
+/**
+ * @defgroup sync_schedule_constants Sync schedule constants
+ * @brief Constants of the daily synchronization schedule.
+ *
+ * The modules of the site share the central access point, so they sync in different slots of the
+ * sync hour. By default the slot is derived from the chip ID, the central module can assign a
+ * different one in the time answer. A failed sync is retried later in the hour with a randomized,
+ * exponentially growing backoff.
+ * @{
+ */
+#define SYNC_ACTIVE_HOUR 1
+#define SYNC_SLOT_COUNT 30
+#define SYNC_SLOT_LENGTH_S 60
+#define SYNC_BACKOFF_MIN_S 30
+#define SYNC_BACKOFF_MAX_S 600
+/** @brief The sync after boot is delayed randomly, so a site restarting after power loss does not
+ * sync at once. */
+#define SYNC_BOOT_JITTER_MS 30000
+/** @brief The time between two revocation probes. */
+#define SYNC_PROBE_INTERVAL_MS (5UL * 60UL * 1000UL)
+/** @} */
+
+/**
+ * @brief The states of the synchronization.
+ */
+typedef enum _sync_state_t
+{
+    SYNC_STATE_IDLE,
+    SYNC_STATE_CONNECT,
+    SYNC_STATE_MULTICAST,
+    SYNC_STATE_OPEN,
+#if SYNC_SECURE
+    SYNC_STATE_HANDSHAKE,
+#endif
+    SYNC_STATE_HELLO,
+    SYNC_STATE_UPLOAD,
+    SYNC_STATE_UPLOAD_ACK,
+    SYNC_STATE_DOWNLOAD,
+    SYNC_STATE_DOWNLOAD_INFO,
+    SYNC_STATE_DOWNLOAD_DATA,
+    SYNC_STATE_COMMIT,
+    SYNC_STATE_REVOCATION,
+    SYNC_STATE_REVOCATION_REPLY,
+    SYNC_STATE_TIME,
+    SYNC_STATE_TIME_REPLY
+} sync_state_t;
+
+/**
+ * @brief The current state of the synchronization.
+ */
+static sync_state_t syncState = SYNC_STATE_IDLE;
+/**
+ * @brief The kind of the current synchronization.
+ */
+static sync_mode_t syncMode = SYNC_MODE_FULL;
+/**
+ * @brief Value of millis() when the current state was entered.
+ */
+static unsigned long stateMillis = 0;
+/**
+ * @brief The number of failed connection attempts of the current synchronization.
+ */
+static uint8_t attempts = 0;
+/**
+ * @brief True if the last finished synchronization succeeded.
+ */
+static bool lastSucceeded = false;
+/**
+ * @brief Value of millis() when the last broadcast frame was received.
+ */
+static unsigned long multicastMillis = 0;
+
+/**
+ * @brief The cost of the secure channel in the current synchronization.
+ */
+static sync_stats_t syncStats;
+
+#if SYNC_SECURE
+/**
+ * @defgroup sync_secure Sync secure channel
+ * @brief State of the secure channel, the ticket is kept between the synchronizations.
+ * @{
+ */
+/** @brief The handshake state of the module, with the ticket of the last session. */
+static secure_client_t secureClient;
+/** @brief The keys and frame counters of the current session. */
+static secure_session_t secureSession;
+/** @brief True if the handshake of the current connection finished, every frame is sealed. */
+static bool sessionEstablished = false;
+/** @brief The last received frame, opened. */
+static frame_t openedFrame;
+/** @} */
+#endif
+
+/**
+ * @defgroup sync_schedule Sync schedule
+ * @brief State of the daily synchronization schedule.
+ * @{
+ */
+/** @brief The start of the slot of the module, in seconds after the start of the sync hour. */
+static uint16_t slotOffset = 0;
+/** @brief True if the sync after boot has not been started yet. */
+static bool bootSyncPending = true;
+/** @brief Value of TIMERS_Millis() when the sync after boot is due. */
+static unsigned long bootSyncMillis = 0;
+/** @brief True if the daily synchronization succeeded in the current sync hour. */
+static bool scheduleDone = false;
+/** @brief The earliest time of the next attempt of the daily synchronization. */
+static unixtime_t retryTime = 0;
+/** @brief The current backoff after a failed synchronization, in seconds. */
+static uint16_t backoffSeconds = SYNC_BACKOFF_MIN_S;
+/** @brief Value of TIMERS_Millis() when the last revocation probe was started. */
+static unsigned long probeMillis = 0;
+/** @} */
+
+/**
+ * @brief The schedule saved in the RTC user memory during the deep sleep.
+ */
+typedef struct _sync_schedule_save_t
+{
+    uint32_t crc;            /**< CRC-32 of the rest of the structure. */
+    unixtime_t suspendTime;  /**< The time the module went to deep sleep. */
+    uint32_t bootSyncMillis; /**< See #bootSyncMillis. */
+    uint32_t probeMillis;    /**< See #probeMillis. */
+    unixtime_t retryTime;    /**< See #retryTime. */
+    uint16_t slotOffset;     /**< See #slotOffset. */
+    uint16_t backoffSeconds; /**< See #backoffSeconds. */
+    uint8_t bootSyncPending; /**< See #bootSyncPending. */
+    uint8_t scheduleDone;    /**< See #scheduleDone. */
+} sync_schedule_save_t;
+
+static_assert(sizeof(sync_schedule_save_t) <= RTC_MEMORY_SYNC_STATE_BLOCKS * 4,
+              "The sync schedule does not fit in its RTC user memory area");
+
+/**
+ * @defgroup sync_progress Sync progress
+ * @brief Progress of the current synchronization, kept between connection attempts.
+ * @{
+ */
+/** @brief True if every log was stored by the central module. */
+static bool logsSent = false;
+/** @brief True if the table is up to date. */
+static bool memoryReceived = false;
+/** @brief True if the revoked cards are up to date. */
+static bool revocationsReceived = false;
+/** @brief The nonce of the last revocation probe, the answer is signed with it. */
+static uint32_t revocationNonce = 0;
+/** @brief The sequence number of the first log in the batch waiting for acknowledgement. */
+static uint32_t logSequenceSent = 0;
+/** @brief True if the new memory is being assembled in the staged range of the EEPROM. */
+static bool newMemoryStaged = false;
+/** @brief The number of contiguous bytes of the new memory received from its start. */
+static uint16_t newMemoryReceived = 0;
+/** @brief The received chunks of the new memory, one bit per #SYNC_CHUNK_SIZE bytes. */
+static uint32_t newMemoryChunks = 0;
+/** @brief The hash of the new memory, as announced by the central module. */
+static uint8_t newMemoryHash[SHA256_SIZE];
+/**
+ * @brief The header area of the new memory.
+ * @note It is kept out of the staged range, so the log header fields written during the download
+ * are committed as usual.
+ */
+static uint8_t newMemoryHeader[AUTHENTICATE_LOG_HEADER_AREA_SIZE];
+/** @brief The start of the range of the new memory being downloaded. */
+static uint16_t rangeStart = 0;
+/** @brief The offset of the next expected chunk of the range being downloaded. */
+static uint16_t rangeNext = 0;
+/** @brief The end of the range being downloaded. */
+static uint16_t rangeEnd = 0;
+/** @} */
+
+/**
+ * @brief Enter a new state.
+ * @param state The new state.
+ */
+static void SYNC_SetState(sync_state_t state)
+{
+    syncState = state;
+    stateMillis = millis();
+}
+
+/**
+ * @brief Drop the partially received new memory.
+ */
+static void SYNC_DropNewMemory(void)
+{
+    if (newMemoryStaged)
+    {
+        EEPROM_Staging_Discard();
+        newMemoryStaged = false;
+    }
+    newMemoryReceived = 0;
+    newMemoryChunks = 0;
+    memset(newMemoryHash, 0, SHA256_SIZE);
+    memset(newMemoryHeader, 0, AUTHENTICATE_LOG_HEADER_AREA_SIZE);
+}
+
+/**
+ * @brief Start assembling a new memory in the staged range of the EEPROM, so the current table
+ * stays in use until the new one is verified.
+ * @param hash The hash of the new memory.
+ */
+static void SYNC_StartNewMemory(const uint8_t *hash)
+{
+    SYNC_DropNewMemory();
+    memcpy(newMemoryHash, hash, SHA256_SIZE);
+    EEPROM_Staging_Begin(AUTHENTICATE_LOG_HEADER_AREA_SIZE,
+                         SYNC_TABLE_IMAGE_SIZE - AUTHENTICATE_LOG_HEADER_AREA_SIZE);
+    newMemoryStaged = true;
+}
+
+/**
+ * @brief Store received data of the new memory.
+ * @param offset The offset of the data in the new memory.
+ * @param data The data.
+ * @param length The length of the data.
+ */
+static void SYNC_WriteNewMemory(uint16_t offset, const uint8_t *data, uint16_t length)
+{
+    // The header area goes to RAM, the rest to the staged range
+    while ((length > 0) && (offset < AUTHENTICATE_LOG_HEADER_AREA_SIZE))
+    {
+        newMemoryHeader[offset] = *data;
+        offset++;
+        data++;
+        length--;
+    }
+    EEPROM_Write(offset, data, length);
+}
+
+/**
+ * @brief Mark the chunks of the new memory that are completely received.
+ * @param start The start of the received range.
+ * @param end The end of the received range.
+ */
+static void SYNC_MarkChunks(uint16_t start, uint16_t end)
+{
+    for (uint16_t chunk = (start + SYNC_CHUNK_SIZE - 1) / SYNC_CHUNK_SIZE;
+         chunk < SYNC_CHUNK_COUNT; chunk++)
+    {
+        uint16_t chunk_end = (chunk + 1) * SYNC_CHUNK_SIZE;
+        if (chunk_end > SYNC_TABLE_IMAGE_SIZE)
+        {
+            chunk_end = SYNC_TABLE_IMAGE_SIZE;
+        }
+        if (chunk_end > end)
+        {
+            break;
+        }
+        newMemoryChunks |= (uint32_t)1 << chunk;
+    }
+
+    // Update the contiguous part, a resumed download continues from there
+    newMemoryReceived = 0;
+    for (uint16_t chunk = 0;
+         (chunk < SYNC_CHUNK_COUNT) && (newMemoryChunks & ((uint32_t)1 << chunk)); chunk++)
+    {
+        newMemoryReceived = ((chunk + 1) * SYNC_CHUNK_SIZE > SYNC_TABLE_IMAGE_SIZE)
+                                ? SYNC_TABLE_IMAGE_SIZE
+                                : (chunk + 1) * SYNC_CHUNK_SIZE;
+    }
+}
+
+/**
+ * @brief Finish the synchronization and put the modem to sleep.
+ * @param success True if the synchronization succeeded, false otherwise.
+ */
+static void SYNC_Finish(bool success)
+{
+    TRANSPORT_Close();
+    TRANSPORT_BroadcastClose();
+    SYNC_DropNewMemory();
+    TRANSPORT_Sleep();
+    SYNC_SetState(SYNC_STATE_IDLE);
+    lastSucceeded = success;
+
+    if (syncMode != SYNC_MODE_FULL)
+    {
+        return;
+    }
+
+    if (success)
+    {
+        scheduleDone = true;
+        backoffSeconds = SYNC_BACKOFF_MIN_S;
+    }
+    else
+    {
+        // Retry after a random part of the backoff on top of the backoff, so the modules that
+        // failed together do not retry together
+        retryTime = RTC_GetTime() + backoffSeconds + (ESP.random() % backoffSeconds);
+        backoffSeconds = (backoffSeconds * 2 > SYNC_BACKOFF_MAX_S) ? SYNC_BACKOFF_MAX_S
+                                                                   : backoffSeconds * 2;
+    }
+}
+
+/**
+ * @brief Handle a failed step: reconnect, or give up after #SYNC_MAX_ATTEMPTS attempts.
+ */
+static void SYNC_Fail(void)
+{
+    TRANSPORT_Close();
+    attempts++;
+    if (attempts >= SYNC_MAX_ATTEMPTS)
+    {
+        SYNC_Finish(false);
+        return;
+    }
+    SYNC_SetState(SYNC_STATE_OPEN);
+}
+
+/**
+ * @brief Continue with the next unfinished part of the synchronization.
+ */
+static void SYNC_Next(void)
+{
+    if ((syncMode != SYNC_MODE_REVOCATION) && !logsSent)
+    {
+        SYNC_SetState(SYNC_STATE_UPLOAD);
+    }
+    else if (syncMode == SYNC_MODE_LOGS)
+    {
+        SYNC_Finish(true);
+    }
+    else if ((syncMode == SYNC_MODE_FULL) && !memoryReceived)
+    {
+        SYNC_SetState(SYNC_STATE_DOWNLOAD);
+    }
+    else if (!revocationsReceived)
+    {
+        SYNC_SetState(SYNC_STATE_REVOCATION);
+    }
+    else if (syncMode == SYNC_MODE_REVOCATION)
+    {
+        SYNC_Finish(true);
+    }
+    else
+    {
+        SYNC_SetState(SYNC_STATE_TIME);
+    }
+}
+
+/**
+ * @brief Check for the response of the central module.
+ * @param frame Pointer to store the received frame in.
+ * @return #TRANSPORT_RESULT_DONE if a frame was received, #TRANSPORT_RESULT_FAILED if the
+ * connection broke or the response timed out, #TRANSPORT_RESULT_PENDING otherwise.
+ */
+static transport_result_t SYNC_Await(const frame_t **frame)
+{
+    transport_result_t result = TRANSPORT_PollFrame(frame);
+    if ((result == TRANSPORT_RESULT_PENDING) &&
+        ((millis() - stateMillis) > SYNC_RESPONSE_TIMEOUT_MS))
+    {
+        return TRANSPORT_RESULT_FAILED;
+    }
+
+#if SYNC_SECURE
+    if ((result == TRANSPORT_RESULT_DONE) && sessionEstablished)
+    {
+        // A plain frame is refused after the handshake, the channel cannot be downgraded
+        unsigned long start = micros();
+        openedFrame.type = (*frame)->type;
+        openedFrame.offset = (*frame)->offset;
+        openedFrame.total = (*frame)->total;
+        openedFrame.length = (*frame)->length;
+        memcpy(openedFrame.payload, (*frame)->payload, (*frame)->length);
+        bool opened = SECURE_Open(&secureSession, &openedFrame);
+        syncStats.cryptoMicros += micros() - start;
+        if (!opened)
+        {
+            return TRANSPORT_RESULT_FAILED;
+        }
+        syncStats.cryptoBytes += openedFrame.length;
+        *frame = &openedFrame;
+    }
+#endif
+
+    return result;
+}
+
+/**
+ * @brief Send a frame to the central module, sealed if the secure channel is established.
+ * @param type The type of the frame.
+ * @param offset The offset of the payload.
+ * @param total The total size of the transferred data.
+ * @param payload The payload, can be nullptr if the length is 0.
+ * @param length The length of the payload, at most #FRAME_MAX_PAYLOAD.
+ * @return True if the frame was sent, false otherwise.
+ */
+static bool SYNC_SendFrame(uint8_t type, uint16_t offset, uint16_t total, const uint8_t *payload,
+                           uint16_t length)
+{
+#if SYNC_SECURE
+    if (sessionEstablished)
+    {
+        static uint8_t sealed[FRAME_MAX_WIRE_PAYLOAD];
+        unsigned long start = micros();
+        if (length > 0)
+        {
+            memcpy(sealed, payload, length);
+        }
+        type |= FRAME_TYPE_SEALED;
+        uint16_t sealed_length = SECURE_Seal(&secureSession, type, offset, total, sealed, length);
+        syncStats.cryptoMicros += micros() - start;
+        syncStats.cryptoBytes += length;
+        return TRANSPORT_SendFrame(type, offset, total, sealed, sealed_length);
+    }
+#endif
+
+    return TRANSPORT_SendFrame(type, offset, total, payload, length);
+}
+
+/**
+ * @brief Wait for the transport to reach the network of the central module.
+ */
+static void SYNC_StepConnect(void)
+{
+    transport_result_t result = TRANSPORT_ConnectPoll();
+    if (result == TRANSPORT_RESULT_FAILED)
+    {
+        SYNC_Finish(false);
+    }
+    else if (result == TRANSPORT_RESULT_DONE)
+    {
+        // The broadcast is not sealed, a secure module downloads the table over the channel
+        if ((syncMode == SYNC_MODE_FULL) && !SYNC_SECURE && TRANSPORT_BroadcastOpen())
+        {
+            multicastMillis = millis();
+            SYNC_SetState(SYNC_STATE_MULTICAST);
+        }
+        else
+        {
+            SYNC_SetState(SYNC_STATE_OPEN);
+        }
+    }
+}
+
+/**
+ * @brief Process a frame of the broadcast of the table image.
+ * @param frame The received frame.
+ */
+static void SYNC_ProcessMulticastFrame(const frame_t *frame)
+{
+    if ((frame->type == FRAME_TYPE_IMAGE_INFO) && (frame->total == SYNC_TABLE_IMAGE_SIZE) &&
+        (frame->length == SHA256_SIZE))
+    {
+        uint8_t table_hash[SHA256_SIZE];
+        AUTHENTICATE_LOG_GetTableHash(table_hash);
+        if (memcmp(frame->payload, table_hash, SHA256_SIZE) == 0)
+        {
+            // The broadcast table is the current one
+            SYNC_DropNewMemory();
+            memoryReceived = true;
+        }
+        else if (!newMemoryStaged || (memcmp(frame->payload, newMemoryHash, SHA256_SIZE) != 0))
+        {
+            // A new table is broadcast, the chunks of an older one are dropped
+            SYNC_StartNewMemory(frame->payload);
+        }
+        return;
+    }
+
+    if ((frame->type != FRAME_TYPE_DATA) || !newMemoryStaged ||
+        (frame->total != SYNC_TABLE_IMAGE_SIZE) || (frame->offset % SYNC_CHUNK_SIZE != 0) ||
+        (frame->offset >= SYNC_TABLE_IMAGE_SIZE))
+    {
+        return;
+    }
+
+    uint16_t chunk = frame->offset / SYNC_CHUNK_SIZE;
+    uint16_t length = SYNC_TABLE_IMAGE_SIZE - frame->offset;
+    if (length > SYNC_CHUNK_SIZE)
+    {
+        length = SYNC_CHUNK_SIZE;
+    }
+    if ((frame->length != length) || (newMemoryChunks & ((uint32_t)1 << chunk)))
+    {
+        return;
+    }
+
+    SYNC_WriteNewMemory(frame->offset, frame->payload, length);
+    SYNC_MarkChunks(frame->offset, frame->offset + length);
+}
+
+/**
+ * @brief Collect the chunks of the broadcast table image.
+ *
+ * @details Listening stops when the table is complete or up to date, when nothing was received
+ * for #SYNC_MULTICAST_IDLE_MS, so a central module without broadcast costs little, or after
+ * #SYNC_MULTICAST_LISTEN_MS.
+ */
+static void SYNC_StepMulticast(void)
+{
+    const frame_t *frame = nullptr;
+    if (TRANSPORT_BroadcastPollFrame(&frame) == TRANSPORT_RESULT_DONE)
+    {
+        multicastMillis = millis();
+        SYNC_ProcessMulticastFrame(frame);
+    }
+
+    if (memoryReceived || (newMemoryChunks == SYNC_CHUNKS_ALL) ||
+        ((millis() - multicastMillis) > SYNC_MULTICAST_IDLE_MS) ||
+        ((millis() - stateMillis) > SYNC_MULTICAST_LISTEN_MS))
+    {
+        TRANSPORT_BroadcastClose();
+        SYNC_SetState(SYNC_STATE_OPEN);
+    }
+}
+
+/**
+ * @brief Introduce the module with its chip ID.
+ */
+static void SYNC_SendHello(void)
+{
+    uint8_t payload[4];
+    BYTEORDER_WriteUint32Be(payload, ESP.getChipId());
+
+    if (!SYNC_SendFrame(FRAME_TYPE_HELLO, 0, 0, payload, sizeof(payload)))
+    {
+        SYNC_Fail();
+        return;
+    }
+    SYNC_SetState(SYNC_STATE_HELLO);
+}
+
+#if SYNC_SECURE
+/**
+ * @brief Start the handshake of the secure channel, resuming the last session if there is a
+ * ticket.
+ */
+static void SYNC_SendHandshake(void)
+{
+    uint8_t random[SECURE_CLIENT_RANDOM_SIZE];
+    for (uint8_t i = 0; i < sizeof(random); i += 4)
+    {
+        BYTEORDER_WriteUint32Be(&(random[i]), ESP.random());
+    }
+
+    uint8_t hello[SECURE_HELLO_RESUME_SIZE];
+    uint8_t mode;
+    unsigned long start = micros();
+    uint16_t length = SECURE_ClientHello(&secureClient, random, &mode, hello);
+    syncStats.handshakeMicros += micros() - start;
+    syncStats.resumed = (mode == SECURE_MODE_RESUME);
+
+    if (!TRANSPORT_SendFrame(FRAME_TYPE_KEY, mode, 0, hello, length))
+    {
+        SYNC_Fail();
+        return;
+    }
+    SYNC_SetState(SYNC_STATE_HANDSHAKE);
+}
+
+/**
+ * @brief Wait for the answer to the handshake and establish the secure channel.
+ *
+ * @details If the central module refused the ticket, for example because it expired or the
+ * central module restarted, the handshake is repeated with the key exchange.
+ */
+static void SYNC_StepHandshake(void)
+{
+    const frame_t *frame = nullptr;
+    transport_result_t result = SYNC_Await(&frame);
+    if (result == TRANSPORT_RESULT_PENDING)
+    {
+        return;
+    }
+    if ((result == TRANSPORT_RESULT_FAILED) || (frame->type != FRAME_TYPE_KEY))
+    {
+        SYNC_Fail();
+        return;
+    }
+
+    unsigned long start = micros();
+    secure_handshake_result_t handshake =
+        SECURE_ClientFinish(&secureClient, frame->payload, frame->length, &secureSession);
+    syncStats.handshakeMicros += micros() - start;
+
+    if (handshake == SECURE_HANDSHAKE_RETRY)
+    {
+        SYNC_SendHandshake();
+        return;
+    }
+    if (handshake != SECURE_HANDSHAKE_DONE)
+    {
+        // The central module could not prove that it knows the key of the module
+        SYNC_Fail();
+        return;
+    }
+
+    sessionEstablished = true;
+    SYNC_SendHello();
+}
+#endif
+
+/**
+ * @brief Connect to the central module and start the handshake or the introduction.
+ */
+static void SYNC_StepOpen(void)
+{
+    if (!TRANSPORT_Open())
+    {
+        SYNC_Fail();
+        return;
+    }
+
+#if SYNC_SECURE
+    sessionEstablished = false;
+    SYNC_SendHandshake();
+#else
+    SYNC_SendHello();
+#endif
+}
+
+/**
+ * @brief Wait for the answer to the introduction, which can contain the door ID of the module.
+ */
+static void SYNC_StepHello(void)
+{
+    const frame_t *frame = nullptr;
+    transport_result_t result = SYNC_Await(&frame);
+    if (result == TRANSPORT_RESULT_PENDING)
+    {
+        return;
+    }
+    if ((result == TRANSPORT_RESULT_FAILED) || (frame->type != FRAME_TYPE_HELLO))
+    {
+        SYNC_Fail();
+        return;
+    }
+
+    if (frame->length >= 1)
+    {
+        // The central module told the door of the module, used to filter a shared table image
+        AUTHENTICATE_LOG_SetDoorId(frame->payload[0]);
+    }
+
+    SYNC_Next();
+}
+
+/**
+ * @brief Send the next batch of logs.
+ */
+static void SYNC_StepUpload(void)
+{
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    uint16_t length = AUTHENTICATE_LOG_ReadLogs(&(payload[4]), FRAME_MAX_PAYLOAD - 4,
+                                                &logSequenceSent);
+    if (length == 0)
+    {
+        // Every log is stored by the central module
+        logsSent = true;
+        SYNC_Next();
+        return;
+    }
+    BYTEORDER_WriteUint32Be(payload, logSequenceSent);
+
+    if (!SYNC_SendFrame(FRAME_TYPE_LOG, 0, 0, payload, length + 4))
+    {
+        SYNC_Fail();
+        return;
+    }
+    SYNC_SetState(SYNC_STATE_UPLOAD_ACK);
+}
+
+/**
+ * @brief Wait for the acknowledgement of the batch of logs, and release the stored logs.
+ */
+static void SYNC_StepUploadAck(void)
+{
+    const frame_t *frame = nullptr;
+    transport_result_t result = SYNC_Await(&frame);
+    if (result == TRANSPORT_RESULT_PENDING)
+    {
+        return;
+    }
+    if ((result == TRANSPORT_RESULT_FAILED) || (frame->type != FRAME_TYPE_ACK) ||
+        (frame->length != 4))
+    {
+        SYNC_Fail();
+        return;
+    }
+
+    uint32_t sequence_acked = BYTEORDER_ReadUint32Be(frame->payload);
+    if ((sequence_acked == logSequenceSent) || !AUTHENTICATE_LOG_ReleaseLogs(sequence_acked))
+    {
+        // The central module did not store anything, or acknowledged logs this module never sent
+        SYNC_Fail();
+        return;
+    }
+
+    SYNC_SetState(SYNC_STATE_UPLOAD);
+}
+
+/**
+ * @brief Request the first missing range of the new memory received from the broadcast.
+ */
+static void SYNC_RequestRange(void)
+{
+    uint16_t chunk = newMemoryReceived / SYNC_CHUNK_SIZE;
+    uint16_t chunk_end = chunk + 1;
+    while ((chunk_end < SYNC_CHUNK_COUNT) && !(newMemoryChunks & ((uint32_t)1 << chunk_end)))
+    {
+        chunk_end++;
+    }
+
+    rangeStart = newMemoryReceived;
+    rangeNext = rangeStart;
+    rangeEnd = (chunk_end * SYNC_CHUNK_SIZE > SYNC_TABLE_IMAGE_SIZE) ? SYNC_TABLE_IMAGE_SIZE
+                                                                     : chunk_end * SYNC_CHUNK_SIZE;
+
+    if (!SYNC_SendFrame(FRAME_TYPE_RANGE, rangeStart, rangeEnd - rangeStart, newMemoryHash,
+                        SHA256_SIZE))
+    {
+        SYNC_Fail();
+        return;
+    }
+    SYNC_SetState(SYNC_STATE_DOWNLOAD_DATA);
+}
+
+/**
+ * @brief Request the new memory, resuming the partially received one.
+ *
+ * @details If the chunks received from the broadcast have gaps, only the gaps are requested.
+ * Otherwise the request contains the hash of the current table, the hash of the partially
+ * received memory and the offset to resume from.
+ */
+static void SYNC_StepDownload(void)
+{
+    if (newMemoryStaged && (newMemoryChunks == SYNC_CHUNKS_ALL))
+    {
+        SYNC_SetState(SYNC_STATE_COMMIT);
+        return;
+    }
+
+    uint32_t contiguous_chunks = ((uint32_t)1 << (newMemoryReceived / SYNC_CHUNK_SIZE)) - 1;
+    if (newMemoryStaged && (newMemoryChunks != contiguous_chunks))
+    {
+        SYNC_RequestRange();
+        return;
+    }
+
+    uint8_t request[2 * SHA256_SIZE];
+    AUTHENTICATE_LOG_GetTableHash(request);
+    memcpy(&(request[SHA256_SIZE]), newMemoryHash, SHA256_SIZE);
+
+    if (!SYNC_SendFrame(FRAME_TYPE_NEW_MEMORY, newMemoryReceived, SYNC_TABLE_IMAGE_SIZE, request,
+                        sizeof(request)))
+    {
+        SYNC_Fail();
+        return;
+    }
+    SYNC_SetState(SYNC_STATE_DOWNLOAD_INFO);
+}
+
+/**
+ * @brief Wait for the answer to the memory request.
+ *
+ * @details The central module answers with #FRAME_TYPE_NOT_MODIFIED if its memory has the same
+ * hash as the current table. Otherwise it answers with #FRAME_TYPE_IMAGE_INFO, containing the hash
+ * of its memory and the offset it continues from: the requested offset if the partially received
+ * memory is still the same, 0 otherwise.
+ */
+static void SYNC_StepDownloadInfo(void)
+{
+    const frame_t *frame = nullptr;
+    transport_result_t result = SYNC_Await(&frame);
+    if (result == TRANSPORT_RESULT_PENDING)
+    {
+        return;
+    }
+    if (result == TRANSPORT_RESULT_FAILED)
+    {
+        SYNC_Fail();
+        return;
+    }
+
+    if (frame->type == FRAME_TYPE_NOT_MODIFIED)
+    {
+        // The memory of the central module is the same as the current one
+        SYNC_DropNewMemory();
+        memoryReceived = true;
+        SYNC_Next();
+        return;
+    }
+
+    if ((frame->type != FRAME_TYPE_IMAGE_INFO) || (frame->total != SYNC_TABLE_IMAGE_SIZE) ||
+        (frame->length != SHA256_SIZE))
+    {
+        SYNC_Fail();
+        return;
+    }
+
+    if (frame->offset == 0)
+    {
+        // Start a new transfer
+        SYNC_StartNewMemory(frame->payload);
+    }
+    else if ((frame->offset != newMemoryReceived) ||
+             (memcmp(frame->payload, newMemoryHash, SHA256_SIZE) != 0))
+    {
+        // The central module can only continue from where this module stopped
+        SYNC_Fail();
+        return;
+    }
+
+    rangeStart = frame->offset;
+    rangeNext = rangeStart;
+    rangeEnd = SYNC_TABLE_IMAGE_SIZE;
+    SYNC_SetState(SYNC_STATE_DOWNLOAD_DATA);
+}
+
+/**
+ * @brief Receive the next chunk of the new memory and acknowledge it.
+ */
+static void SYNC_StepDownloadData(void)
+{
+    const frame_t *frame = nullptr;
+    transport_result_t result = SYNC_Await(&frame);
+    if (result == TRANSPORT_RESULT_PENDING)
+    {
+        return;
+    }
+    if (result == TRANSPORT_RESULT_FAILED)
+    {
+        SYNC_Fail();
+        return;
+    }
+
+    if (frame->type == FRAME_TYPE_IMAGE_INFO)
+    {
+        // The range was refused, the memory of the central module changed since the broadcast
+        SYNC_DropNewMemory();
+        SYNC_SetState(SYNC_STATE_DOWNLOAD);
+        return;
+    }
+
+    if ((frame->type != FRAME_TYPE_DATA) ||
+        (frame->offset != rangeNext) ||
+        (frame->length == 0) ||
+        (frame->offset + frame->length > rangeEnd))
+    {
+        SYNC_Fail();
+        return;
+    }
+
+    SYNC_WriteNewMemory(frame->offset, frame->payload, frame->length);
+    rangeNext += frame->length;
+    SYNC_MarkChunks(rangeStart, rangeNext);
+
+    if (!SYNC_SendFrame(FRAME_TYPE_ACK, rangeNext, SYNC_TABLE_IMAGE_SIZE, nullptr, 0))
+    {
+        SYNC_Fail();
+        return;
+    }
+
+    if (rangeNext < rangeEnd)
+    {
+        SYNC_SetState(SYNC_STATE_DOWNLOAD_DATA);
+    }
+    else
+    {
+        // Request the next missing range, or commit the complete memory
+        SYNC_SetState(SYNC_STATE_DOWNLOAD);
+    }
+}
+
+/**
+ * @brief Verify the assembled memory and commit it.
+ */
+static void SYNC_StepCommit(void)
+{
+    // The chunks were received out of order, the hash is calculated over the assembled memory
+    uint8_t hash_calculated[SHA256_SIZE];
+    sha256_context_t context;
+    SHA256_Init(&context);
+    SHA256_Update(&context, newMemoryHeader, AUTHENTICATE_LOG_HEADER_AREA_SIZE);
+    SHA256_Update(&context, EEPROM_GetMemoryImage() + AUTHENTICATE_LOG_HEADER_AREA_SIZE,
+                  SYNC_TABLE_IMAGE_SIZE - AUTHENTICATE_LOG_HEADER_AREA_SIZE);
+    SHA256_Final(&context, hash_calculated);
+    if (memcmp(hash_calculated, newMemoryHash, SHA256_SIZE) != 0)
+    {
+        // The assembled memory is not the one the central module announced, start over
+        SYNC_DropNewMemory();
+        SYNC_Fail();
+        return;
+    }
+
+    // Take over the header fields of the new table image and commit it
+    EEPROM_Staging_End();
+    newMemoryStaged = false;
+    newMemoryReceived = 0;
+    newMemoryChunks = 0;
+    AUTHENTICATE_LOG_TableUpdated(hash_calculated, newMemoryHeader);
+    // The new table contains the revocations up to its version
+    REVOCATION_Reset(AUTHENTICATE_LOG_GetRevocationVersion());
+
+    memoryReceived = true;
+    SYNC_Next();
+}
+
+/**
+ * @brief Ask for the cards revoked after the revocation version of the module.
+ */
+static void SYNC_StepRevocation(void)
+{
+    uint8_t payload[8];
+    revocationNonce = ESP.random();
+    BYTEORDER_WriteUint32Be(payload, REVOCATION_GetVersion());
+    BYTEORDER_WriteUint32Be(&(payload[4]), revocationNonce);
+
+    if (!SYNC_SendFrame(FRAME_TYPE_REVOCATION, 0, 0, payload, sizeof(payload)))
+    {
+        SYNC_Fail();
+        return;
+    }
+    SYNC_SetState(SYNC_STATE_REVOCATION_REPLY);
+}
+
+/**
+ * @brief Wait for the revoked cards and take them over.
+ *
+ * @details An answer that does not fit in one frame is continued with another probe. If there is
+ * no room for the revoked cards, a full synchronization is requested for a new table image.
+ */
+static void SYNC_StepRevocationReply(void)
+{
+    const frame_t *frame = nullptr;
+    transport_result_t result = SYNC_Await(&frame);
+    if (result == TRANSPORT_RESULT_PENDING)
+    {
+        return;
+    }
+    if ((result == TRANSPORT_RESULT_FAILED) || (frame->type != FRAME_TYPE_REVOCATION))
+    {
+        SYNC_Fail();
+        return;
+    }
+
+    uint8_t challenge[REVOCATION_CHALLENGE_SIZE];
+    BYTEORDER_WriteUint32Be(challenge, ESP.getChipId());
+    BYTEORDER_WriteUint32Be(&(challenge[4]), revocationNonce);
+    if (!REVOCATION_ApplyDelta(challenge, frame->payload, frame->length))
+    {
+        // Forged, replayed or corrupted answer
+        SYNC_Fail();
+        return;
+    }
+
+    if ((frame->total > 0) && !REVOCATION_IsFull())
+    {
+        SYNC_SetState(SYNC_STATE_REVOCATION);
+        return;
+    }
+
+    if ((frame->total > 0) && (syncMode != SYNC_MODE_FULL))
+    {
+        // Start the full synchronization like after boot
+        bootSyncPending = true;
+        bootSyncMillis = TIMERS_Millis();
+    }
+
+    revocationsReceived = true;
+    SYNC_Next();
+}
+
+/**
+ * @brief Request the current time.
+ */
+static void SYNC_StepTime(void)
+{
+    if (!SYNC_SendFrame(FRAME_TYPE_TIME, 0, 0, nullptr, 0))
+    {
+        SYNC_Fail();
+        return;
+    }
+    SYNC_SetState(SYNC_STATE_TIME_REPLY);
+}
+
+/**
+ * @brief Wait for the current time and set the RTC, which finishes the synchronization.
+ */
+static void SYNC_StepTimeReply(void)
+{
+    const frame_t *frame = nullptr;
+    transport_result_t result = SYNC_Await(&frame);
+    if (result == TRANSPORT_RESULT_PENDING)
+    {
+        return;
+    }
+    if ((result == TRANSPORT_RESULT_FAILED) || (frame->type != FRAME_TYPE_TIME) ||
+        (frame->length < 4))
+    {
+        SYNC_Fail();
+        return;
+    }
+
+    uint32_t time = BYTEORDER_ReadUint32Be(frame->payload);
+    if (time == 0)
+    {
+        SYNC_Fail();
+        return;
+    }
+    RTC_SetTime(time);
+
+    if (frame->length >= 6)
+    {
+        // The central module assigned a slot to the module
+        uint16_t offset = ((uint16_t)(frame->payload[4]) << 8) | frame->payload[5];
+        if (offset < 3600)
+        {
+            slotOffset = offset;
+        }
+    }
+
+    SYNC_Finish(true);
+}
+
+/**
+ * @brief Initialize the synchronization schedule.
+ */
+void SYNC_Init(void)
+{
+    // Derive the default slot from the chip ID, the CRC spreads consecutive IDs over the slots
+    uint8_t chip_id[4];
+    BYTEORDER_WriteUint32Be(chip_id, ESP.getChipId());
+    uint32_t hash = CRC32_Final(CRC32_Update(CRC32_Init(), chip_id, sizeof(chip_id)));
+    slotOffset = (uint16_t)((hash % SYNC_SLOT_COUNT) * SYNC_SLOT_LENGTH_S);
+
+    bootSyncPending = true;
+    bootSyncMillis = TIMERS_Millis() + (ESP.random() % SYNC_BOOT_JITTER_MS);
+
+#if SYNC_SECURE
+#ifdef SYNC_DEVICE_KEY
+    SECURE_ClientInit(&secureClient, (const uint8_t *)SYNC_DEVICE_KEY, ESP.getChipId());
+#else
+    static_assert(sizeof(SYNC_SITE_KEY) - 1 == SECURE_KEY_SIZE, "Invalid size of the site key");
+    uint8_t device_key[SECURE_KEY_SIZE];
+    SECURE_DeriveDeviceKey((const uint8_t *)SYNC_SITE_KEY, SECURE_KEY_SIZE, ESP.getChipId(),
+                           device_key);
+    SECURE_ClientInit(&secureClient, device_key, ESP.getChipId());
+#endif
+#endif
+}
+
+/**
+ * @brief Check if the full synchronization has to be started.
+ * @param time The current time.
+ * @return True if the synchronization after boot or the daily synchronization is due, false
+ * otherwise.
+ */
+bool SYNC_IsScheduled(unixtime_t time)
+{
+    if (syncState != SYNC_STATE_IDLE)
+    {
+        return false;
+    }
+
+    if (bootSyncPending)
+    {
+        if ((long)(TIMERS_Millis() - bootSyncMillis) < 0)
+        {
+            return false;
+        }
+        bootSyncPending = false;
+        return true;
+    }
+
+    if (UNIXTIME_TO_HOUR_OF_DAY(time) != SYNC_ACTIVE_HOUR)
+    {
+        // Prepare for the next sync hour
+        scheduleDone = false;
+        retryTime = 0;
+        backoffSeconds = SYNC_BACKOFF_MIN_S;
+        return false;
+    }
+
+    if (scheduleDone || ((time % 3600) < slotOffset) || (time < retryTime))
+    {
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Check if the revocation probe has to be started.
+ * @return True if #SYNC_PROBE_INTERVAL_MS passed since the last probe, false otherwise.
+ * @note The full synchronization also probes, the first probe follows the sync after boot.
+ */
+bool SYNC_IsProbeDue(void)
+{
+    if ((syncState != SYNC_STATE_IDLE) || bootSyncPending)
+    {
+        return false;
+    }
+
+    return (TIMERS_Millis() - probeMillis) >= SYNC_PROBE_INTERVAL_MS;
+}
+
+/**
+ * @brief Convert a time from now in TIMERS_Millis() to a time of the RTC.
+ * @param time The current time.
+ * @param millis_due The value of TIMERS_Millis() at the event.
+ * @return The time of the event, rounded up to seconds, or the current time if it is due.
+ */
+static unixtime_t SYNC_MillisToTime(unixtime_t time, unsigned long millis_due)
+{
+    long millis_left = (long)(millis_due - TIMERS_Millis());
+    if (millis_left <= 0)
+    {
+        return time;
+    }
+    return time + ((unsigned long)millis_left + 999) / 1000;
+}
+
+/**
+ * @brief Get the time the module has to be awake for the next synchronization.
+ * @param time The current time.
+ * @return The time of the next sync after boot, daily synchronization or revocation probe.
+ */
+unixtime_t SYNC_GetNextWakeTime(unixtime_t time)
+{
+    unixtime_t hour_start = time - (time % (24 * 3600)) + SYNC_ACTIVE_HOUR * 3600;
+    if ((UNIXTIME_TO_HOUR_OF_DAY(time) != SYNC_ACTIVE_HOUR) || scheduleDone)
+    {
+        // The next sync hour, today or tomorrow
+        if (hour_start <= time)
+        {
+            hour_start += 24 * 3600;
+        }
+    }
+    unixtime_t wake_time = hour_start + slotOffset;
+    if ((hour_start <= time) && (retryTime > wake_time))
+    {
+        wake_time = retryTime;
+    }
+
+    unixtime_t sync_time = bootSyncPending
+                               ? SYNC_MillisToTime(time, bootSyncMillis)
+                               : SYNC_MillisToTime(time, probeMillis + SYNC_PROBE_INTERVAL_MS);
+    return (sync_time < wake_time) ? sync_time : wake_time;
+}
+
+/**
+ * @brief Calculate the CRC of the saved schedule.
+ * @param save The saved schedule.
+ * @return The CRC of every field after the CRC.
+ */
+static uint32_t SYNC_ScheduleCrc(const sync_schedule_save_t *save)
+{
+    const uint8_t *data = (const uint8_t *)save + sizeof(save->crc);
+    return CRC32_Final(CRC32_Update(CRC32_Init(), data, sizeof(*save) - sizeof(save->crc)));
+}
+
+/**
+ * @brief Save the schedule to the RTC user memory before the deep sleep.
+ * @param time The current time.
+ */
+void SYNC_Suspend(unixtime_t time)
+{
+    sync_schedule_save_t save;
+    memset(&save, 0, sizeof(save));
+    save.suspendTime = time;
+    save.bootSyncMillis = bootSyncMillis;
+    save.probeMillis = probeMillis;
+    save.retryTime = retryTime;
+    save.slotOffset = slotOffset;
+    save.backoffSeconds = backoffSeconds;
+    save.bootSyncPending = bootSyncPending;
+    save.scheduleDone = scheduleDone;
+    save.crc = SYNC_ScheduleCrc(&save);
+    ESP.rtcUserMemoryWrite(RTC_MEMORY_SYNC_STATE_OFFSET, (uint32_t *)&save, sizeof(save));
+}
+
+/**
+ * @brief Restore the schedule from the RTC user memory after the deep sleep.
+ * @param time The current time.
+ * @return True if the schedule was restored, false if it was lost and the sync after boot follows.
+ * @note Call after SYNC_Init(), and after the time base of TIMERS_Millis() was restored.
+ */
+bool SYNC_Resume(unixtime_t time)
+{
+    sync_schedule_save_t save;
+    if (!ESP.rtcUserMemoryRead(RTC_MEMORY_SYNC_STATE_OFFSET, (uint32_t *)&save, sizeof(save)) ||
+        (save.crc != SYNC_ScheduleCrc(&save)))
+    {
+        return false;
+    }
+
+    bootSyncMillis = save.bootSyncMillis;
+    probeMillis = save.probeMillis;
+    retryTime = save.retryTime;
+    slotOffset = save.slotOffset;
+    backoffSeconds = save.backoffSeconds;
+    bootSyncPending = save.bootSyncPending;
+    scheduleDone = save.scheduleDone;
+
+    if ((time / 3600) != (save.suspendTime / 3600))
+    {
+        // The sync hour passed during the sleep, prepare for the next one like SYNC_IsScheduled()
+        scheduleDone = false;
+        retryTime = 0;
+        backoffSeconds = SYNC_BACKOFF_MIN_S;
+    }
+    return true;
+}
+
+/**
+ * @brief Start a synchronization with the central module.
+ * @param mode The kind of the synchronization.
+ * @note Nothing happens if a synchronization is already active. Drive it with SYNC_Step().
+ */
+void SYNC_Start(sync_mode_t mode)
+{
+    if (syncState != SYNC_STATE_IDLE)
+    {
+        return;
+    }
+
+    syncMode = mode;
+    attempts = 0;
+    logsSent = false;
+    memoryReceived = false;
+    revocationsReceived = false;
+    memset(&syncStats, 0, sizeof(syncStats));
+    SYNC_DropNewMemory();
+    if (mode != SYNC_MODE_LOGS)
+    {
+        probeMillis = TIMERS_Millis();
+    }
+
+    TRANSPORT_Wakeup();
+    TRANSPORT_ConnectStart();
+    SYNC_SetState(SYNC_STATE_CONNECT);
+}
+
+/**
+ * @brief Check if a synchronization is active.
+ * @return True if a synchronization is active, false otherwise.
+ */
+bool SYNC_IsActive(void)
+{
+    return syncState != SYNC_STATE_IDLE;
+}
+
+/**
+ * @brief Check the result of the last finished synchronization.
+ * @return True if the last finished synchronization succeeded, false otherwise.
+ */
+bool SYNC_Succeeded(void)
+{
+    return lastSucceeded;
+}
+
+/**
+ * @brief Get the cost of the secure channel in the last synchronization.
+ * @param stats Pointer to store the statistics in.
+ */
+void SYNC_GetStats(sync_stats_t *stats)
+{
+    *stats = syncStats;
+}
+
+/**
+ * @brief Advance the synchronization by one step.
+ * @return True if the synchronization is still active, false if it finished.
+ */
+bool SYNC_Step(void)
+{
+    switch (syncState)
+    {
+    case SYNC_STATE_IDLE:
+        break;
+    case SYNC_STATE_CONNECT:
+        SYNC_StepConnect();
+        break;
+    case SYNC_STATE_MULTICAST:
+        SYNC_StepMulticast();
+        break;
+    case SYNC_STATE_OPEN:
+        SYNC_StepOpen();
+        break;
+#if SYNC_SECURE
+    case SYNC_STATE_HANDSHAKE:
+        SYNC_StepHandshake();
+        break;
+#endif
+    case SYNC_STATE_HELLO:
+        SYNC_StepHello();
+        break;
+    case SYNC_STATE_UPLOAD:
+        SYNC_StepUpload();
+        break;
+    case SYNC_STATE_UPLOAD_ACK:
+        SYNC_StepUploadAck();
+        break;
+    case SYNC_STATE_DOWNLOAD:
+        SYNC_StepDownload();
+        break;
+    case SYNC_STATE_DOWNLOAD_INFO:
+        SYNC_StepDownloadInfo();
+        break;
+    case SYNC_STATE_DOWNLOAD_DATA:
+        SYNC_StepDownloadData();
+        break;
+    case SYNC_STATE_COMMIT:
+        SYNC_StepCommit();
+        break;
+    case SYNC_STATE_REVOCATION:
+        SYNC_StepRevocation();
+        break;
+    case SYNC_STATE_REVOCATION_REPLY:
+        SYNC_StepRevocationReply();
+        break;
+    case SYNC_STATE_TIME:
+        SYNC_StepTime();
+        break;
+    case SYNC_STATE_TIME_REPLY:
+        SYNC_StepTimeReply();
+        break;
+    }
+
+    return SYNC_IsActive();
+}
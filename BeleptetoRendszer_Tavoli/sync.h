@@ -0,0 +1,61 @@
+/**
+ ***************************************************************************************************
+ * @file sync.h
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Header file for the synchronization with the central module.
+ ***************************************************************************************************
+ */
+
+#ifndef SYNC_H
+#define SYNC_H
+
+#include <stdint.h>
+
+#include "rtc.h"
+
+/**
+ * @brief The kind of synchronization.
+ */
+typedef enum _sync_mode_t
+{
+    SYNC_MODE_FULL,      /**< Upload the logs, download the table, revocations and time. */
+    SYNC_MODE_LOGS,      /**< Only upload the logs. */
+    SYNC_MODE_REVOCATION /**< Only download the cards revoked since the last probe. */
+} sync_mode_t;
+
+/**
+ * @brief The cost of the secure channel in the last synchronization.
+ */
+typedef struct _sync_stats_t
+{
+    uint32_t handshakeMicros; /**< The time spent on the handshakes. */
+    bool resumed;             /**< True if the session was resumed with a ticket. */
+    uint32_t cryptoMicros;    /**< The time spent on sealing and opening the frames. */
+    uint32_t cryptoBytes;     /**< The number of payload bytes sealed and opened. */
+} sync_stats_t;
+
+void SYNC_Init(void);
+
+bool SYNC_IsScheduled(unixtime_t time);
+
+bool SYNC_IsProbeDue(void);
+
+unixtime_t SYNC_GetNextWakeTime(unixtime_t time);
+
+void SYNC_Suspend(unixtime_t time);
+
+bool SYNC_Resume(unixtime_t time);
+
+void SYNC_Start(sync_mode_t mode);
+
+bool SYNC_IsActive(void);
+
+bool SYNC_Succeeded(void);
+
+bool SYNC_Step(void);
+
+void SYNC_GetStats(sync_stats_t *stats);
+
+#endif /* SYNC_H */
@@ -5,12 +5,17 @@
  * @date 2023. 05. 04.
  ***************************************************************************************************
  * @brief Implementation of timers.h.
+ *
+ * The events are kept in slots, and a binary min-heap of the slots orders them by their deadline,
+ * so the next deadline is at the top, and adding, cancelling and firing an event take O(log n)
+ * steps. The deadlines are compared relative to each other, so they may wrap around, as long as
+ * every pending deadline is within 24 days.
  ***************************************************************************************************
  */
 
 #include "timers.h"
 
-#include "CircularBuffer.hpp"
+#include <Arduino.h>
 
 /**
  * @brief The maximum number of timer events.
@@ -18,9 +23,190 @@
 #define TIMER_MAX_EVENT_NUMBER 16
 
 /**
- * @brief The timer event buffer.
+ * @brief The heap index of a free slot.
  */
-CircularBuffer<timer_event_t, TIMER_MAX_EVENT_NUMBER> timer_events;
+#define TIMER_SLOT_FREE 0xFF
+
+/**
+ * @brief The bits of the generation of the slot in a handle.
+ */
+#define TIMER_GENERATION_MASK 0x00FFFFFFUL
+
+/**
+ * @brief A slot of a timer event.
+ */
+typedef struct _timer_slot_t
+{
+    timer_event_t event;    /**< The timer event. */
+    unsigned long deadline; /**< The value of TIMERS_Millis() when the event fires. */
+    uint32_t generation;    /**< Incremented when the slot is freed, invalidates the old handles. */
+    uint8_t heapIndex;      /**< The position of the slot in the heap, or #TIMER_SLOT_FREE. */
+} timer_slot_t;
+
+/**
+ * @brief The slots of the timer events.
+ */
+static timer_slot_t timer_slots[TIMER_MAX_EVENT_NUMBER];
+
+/**
+ * @brief The min-heap of the indices of the used slots, ordered by their deadline.
+ */
+static uint8_t timer_heap[TIMER_MAX_EVENT_NUMBER];
+
+/**
+ * @brief The number of used slots.
+ */
+static uint8_t timer_count = 0;
+
+/**
+ * @brief True once the slots were marked free.
+ */
+static bool timer_slots_ready = false;
+
+/**
+ * @brief The time spent in light sleep that millis() did not count.
+ */
+static unsigned long millis_asleep = 0;
+
+/**
+ * @brief Mark every slot free, on the first use of the engine.
+ */
+static void TIMERS_InitSlots(void)
+{
+    if (timer_slots_ready)
+    {
+        return;
+    }
+    for (uint8_t i = 0; i < TIMER_MAX_EVENT_NUMBER; i++)
+    {
+        timer_slots[i].generation = 0;
+        timer_slots[i].heapIndex = TIMER_SLOT_FREE;
+    }
+    timer_slots_ready = true;
+}
+
+/**
+ * @brief Check if a slot is due earlier than another.
+ * @param a The index of the first slot.
+ * @param b The index of the second slot.
+ * @return True if the deadline of the first slot is before the one of the second.
+ */
+static bool TIMERS_IsEarlier(uint8_t a, uint8_t b)
+{
+    return (long)(timer_slots[a].deadline - timer_slots[b].deadline) < 0;
+}
+
+/**
+ * @brief Put a slot to a position of the heap.
+ * @param position The position in the heap.
+ * @param slot The index of the slot.
+ */
+static void TIMERS_HeapSet(uint8_t position, uint8_t slot)
+{
+    timer_heap[position] = slot;
+    timer_slots[slot].heapIndex = position;
+}
+
+/**
+ * @brief Move the slot at a position of the heap to its place.
+ * @param position The position in the heap.
+ */
+static void TIMERS_HeapFix(uint8_t position)
+{
+    uint8_t slot = timer_heap[position];
+
+    // Towards the top while earlier than the parent
+    while (position > 0)
+    {
+        uint8_t parent = (position - 1) / 2;
+        if (!TIMERS_IsEarlier(slot, timer_heap[parent]))
+        {
+            break;
+        }
+        TIMERS_HeapSet(position, timer_heap[parent]);
+        position = parent;
+    }
+
+    // Towards the bottom while a child is earlier
+    while (true)
+    {
+        uint8_t child = 2 * position + 1;
+        if (child >= timer_count)
+        {
+            break;
+        }
+        if ((child + 1 < timer_count) && TIMERS_IsEarlier(timer_heap[child + 1], timer_heap[child]))
+        {
+            child++;
+        }
+        if (!TIMERS_IsEarlier(timer_heap[child], slot))
+        {
+            break;
+        }
+        TIMERS_HeapSet(position, timer_heap[child]);
+        position = child;
+    }
+
+    TIMERS_HeapSet(position, slot);
+}
+
+/**
+ * @brief Remove a slot from the heap, the slot stays used.
+ * @param slot The index of the slot.
+ */
+static void TIMERS_HeapRemove(uint8_t slot)
+{
+    uint8_t position = timer_slots[slot].heapIndex;
+    timer_count--;
+    if (position != timer_count)
+    {
+        TIMERS_HeapSet(position, timer_heap[timer_count]);
+        TIMERS_HeapFix(position);
+    }
+}
+
+/**
+ * @brief Insert a used slot into the heap.
+ * @param slot The index of the slot.
+ */
+static void TIMERS_HeapInsert(uint8_t slot)
+{
+    TIMERS_HeapSet(timer_count, slot);
+    timer_count++;
+    TIMERS_HeapFix(timer_count - 1);
+}
+
+/**
+ * @brief Free a slot, its handles become invalid.
+ * @param slot The index of the slot.
+ */
+static void TIMERS_FreeSlot(uint8_t slot)
+{
+    timer_slots[slot].heapIndex = TIMER_SLOT_FREE;
+    timer_slots[slot].generation++;
+}
+
+/**
+ * @brief Find the slot of a handle.
+ * @param handle The handle of the timer event.
+ * @param slot The index of the slot.
+ * @return True if the handle refers to a pending event, false otherwise.
+ */
+static bool TIMERS_FindSlot(timer_handle_t handle, uint8_t *slot)
+{
+    uint8_t index = (uint8_t)(handle & 0xFF) - 1;
+    if ((handle == TIMER_HANDLE_NONE) || (index >= TIMER_MAX_EVENT_NUMBER) || !timer_slots_ready)
+    {
+        return false;
+    }
+    if ((timer_slots[index].heapIndex == TIMER_SLOT_FREE) ||
+        ((timer_slots[index].generation & TIMER_GENERATION_MASK) != (handle >> 8)))
+    {
+        return false;
+    }
+    *slot = index;
+    return true;
+}
 
 /**
  * @brief Get the maximum number of timer events.
@@ -34,29 +220,151 @@ int TIMERS_GetMaxEventNumber(void)
 /**
  * @brief Add a timer event.
  * @param event The timer event to add.
- * @return True if the timer event was added successfully, false otherwise.
+ * @return The handle of the timer event, #TIMER_HANDLE_NONE if there is no free slot.
+ * @note A periodic event needs a period of at least 1 ms.
  */
-bool TIMERS_AddEvent(const timer_event_t *event)
+timer_handle_t TIMERS_AddEvent(const timer_event_t *event)
 {
-    return timer_events.enqueue(event);
+    TIMERS_InitSlots();
+    if ((timer_count >= TIMER_MAX_EVENT_NUMBER) || (event->periodic && (event->millis_period == 0)))
+    {
+        return TIMER_HANDLE_NONE;
+    }
+
+    uint8_t slot = 0;
+    while (timer_slots[slot].heapIndex != TIMER_SLOT_FREE)
+    {
+        slot++;
+    }
+    timer_slots[slot].event = *event;
+    timer_slots[slot].deadline = event->millis_start + event->millis_period;
+    TIMERS_HeapInsert(slot);
+
+    return ((timer_slots[slot].generation & TIMER_GENERATION_MASK) << 8) | (slot + 1);
+}
+
+/**
+ * @brief Cancel a timer event, its handler is not called.
+ * @param handle The handle of the timer event.
+ * @return True if the event was pending, false otherwise.
+ */
+bool TIMERS_Cancel(timer_handle_t handle)
+{
+    uint8_t slot;
+    if (!TIMERS_FindSlot(handle, &slot))
+    {
+        return false;
+    }
+    TIMERS_HeapRemove(slot);
+    TIMERS_FreeSlot(slot);
+    return true;
+}
+
+/**
+ * @brief Start the period of a pending timer event again.
+ * @param handle The handle of the timer event.
+ * @param millis_current The current value of TIMERS_Millis(), the new start of the event.
+ * @param millis_period The new period of the event in milliseconds.
+ * @return True if the event was pending, false otherwise.
+ */
+bool TIMERS_Rearm(timer_handle_t handle, unsigned long millis_current, unsigned long millis_period)
+{
+    uint8_t slot;
+    if (!TIMERS_FindSlot(handle, &slot) ||
+        (timer_slots[slot].event.periodic && (millis_period == 0)))
+    {
+        return false;
+    }
+    timer_slots[slot].event.millis_start = millis_current;
+    timer_slots[slot].event.millis_period = millis_period;
+    timer_slots[slot].deadline = millis_current + millis_period;
+    TIMERS_HeapFix(timer_slots[slot].heapIndex);
+    return true;
+}
+
+/**
+ * @brief Check if a timer event is pending.
+ * @param handle The handle of the timer event.
+ * @return True if the event has not fired and was not cancelled, false otherwise.
+ */
+bool TIMERS_IsPending(timer_handle_t handle)
+{
+    uint8_t slot;
+    return TIMERS_FindSlot(handle, &slot);
 }
 
 /**
  * @brief Handle the timer events.
- * @param millis_current The current value of millis().
+ * @param millis_current The current value of TIMERS_Millis().
+ * @note Every event due at @p millis_current fires, in the order of the deadlines. A periodic event
+ * is re-armed before its handler is called, so the handler may cancel or re-arm it. It fires once
+ * even if several periods passed, the next period starts from the current time then.
  */
 void TIMERS_HandleEvents(unsigned long millis_current)
 {
-    timer_event_t event;
-    for(int i = 0; i < timer_events.size(); i++)
+    while ((timer_count > 0) &&
+           ((long)(millis_current - timer_slots[timer_heap[0]].deadline) >= 0))
     {
-        const timer_event_t *event = timer_events[i];
-        unsigned long millis_real_period = millis_current - event->millis_start;
-        if (millis_real_period >= event->millis_period)
+        uint8_t slot = timer_heap[0];
+        timer_slot_t *timer = &(timer_slots[slot]);
+        timer_event_handler_t *handler = timer->event.handler;
+        unsigned long millis_real_period = millis_current - timer->event.millis_start;
+
+        if (timer->event.periodic)
         {
-            event->handler(millis_real_period);
-            timer_events.remove(i);
-            break;
+            timer->event.millis_start = timer->deadline;
+            if ((long)(millis_current - timer->deadline) >= (long)timer->event.millis_period)
+            {
+                // Fell behind by more than a period, skip the missed ones
+                timer->event.millis_start = millis_current;
+            }
+            timer->deadline = timer->event.millis_start + timer->event.millis_period;
+            TIMERS_HeapFix(0);
         }
+        else
+        {
+            TIMERS_HeapRemove(slot);
+            TIMERS_FreeSlot(slot);
+        }
+
+        handler(millis_real_period);
+    }
+}
+
+/**
+ * @brief Get the time until the earliest timer event is due.
+ * @param millis_current The current value of TIMERS_Millis().
+ * @param millis_remaining The milliseconds until the earliest event, 0 if one is already due.
+ * @return True if there is a timer event, false otherwise.
+ */
+bool TIMERS_GetNextDeadline(unsigned long millis_current, unsigned long *millis_remaining)
+{
+    if (timer_count == 0)
+    {
+        return false;
     }
+
+    long millis_left = (long)(timer_slots[timer_heap[0]].deadline - millis_current);
+    *millis_remaining = (millis_left > 0) ? (unsigned long)millis_left : 0;
+    return true;
+}
+
+/**
+ * @brief Get the time base of the timer events.
+ * @return The value of millis() plus the time spent in light sleep.
+ * @note The intervals that can span a light sleep have to be measured with this instead of
+ * millis(), which may stop while the CPU sleeps.
+ */
+unsigned long TIMERS_Millis(void)
+{
+    return millis() + millis_asleep;
+}
+
+/**
+ * @brief Account for the time spent in light sleep.
+ * @param millis_slept The milliseconds slept that millis() did not count.
+ */
+void TIMERS_AddSleepMillis(unsigned long millis_slept)
+{
+    millis_asleep += millis_slept;
 }
@@ -24,15 +24,41 @@ typedef void timer_event_handler_t(unsigned long millis_real_period);
  */
 typedef struct _timer_event
 {
-    unsigned long millis_start; /**< Value of millis() when the timer event was added. */
+    unsigned long millis_start; /**< Value of TIMERS_Millis() when the timer event was added. */
     unsigned long millis_period; /**< The period of the timer event in milliseconds. */
     timer_event_handler_t *handler; /**< The handler function of the timer event. */
+    bool periodic; /**< True if the event is re-armed with the same period after it fired. */
 } timer_event_t;
 
+/**
+ * @brief The handle of an added timer event: the generation of its slot in the upper 24 bits, the
+ * slot plus one in the lower 8 bits.
+ * @note A handle stays invalid after its event fired or was cancelled, even if the slot of the
+ * event is reused, until the slot is reused 2^24 times.
+ */
+typedef uint32_t timer_handle_t;
+
+/**
+ * @brief The handle that refers to no timer event.
+ */
+#define TIMER_HANDLE_NONE 0
+
 int TIMERS_GetMaxEventNumber(void);
 
-bool TIMERS_AddEvent(const timer_event_t *event);
+timer_handle_t TIMERS_AddEvent(const timer_event_t *event);
+
+bool TIMERS_Cancel(timer_handle_t handle);
+
+bool TIMERS_Rearm(timer_handle_t handle, unsigned long millis_current, unsigned long millis_period);
+
+bool TIMERS_IsPending(timer_handle_t handle);
 
 void TIMERS_HandleEvents(unsigned long millis_current);
 
+bool TIMERS_GetNextDeadline(unsigned long millis_current, unsigned long *millis_remaining);
+
+unsigned long TIMERS_Millis(void);
+
+void TIMERS_AddSleepMillis(unsigned long millis_slept);
+
 #endif /* TIMERS_H */
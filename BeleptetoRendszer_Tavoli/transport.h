@@ -0,0 +1,77 @@
+/**
+ ***************************************************************************************************
+ * @file transport.h
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Header file for the transport of the sync frames to the central module.
+ *
+ * The synchronization only exchanges frames through this interface. The back end is selected at
+ * build time with #TRANSPORT_BACKEND, exactly one of the transport_*.cpp files implements it:
+ * - #TRANSPORT_BACKEND_TCP: TCP over the WiFi network of the central module (transport_tcp.cpp).
+ * - #TRANSPORT_BACKEND_ESPNOW: ESP-NOW frames to the MAC address of the central module, without
+ *   association and IP stack (transport_espnow.cpp). The address and the channel of the central
+ *   module are set with #TRANSPORT_ESPNOW_CENTRAL_MAC and #TRANSPORT_ESPNOW_CHANNEL.
+ * - #TRANSPORT_BACKEND_LOOPBACK: POSIX sockets to localhost, for running the synchronization on a
+ *   Linux host against the stand-in central module (transport_loopback.cpp).
+ ***************************************************************************************************
+ */
+
+#ifndef TRANSPORT_H
+#define TRANSPORT_H
+
+#include <stdint.h>
+
+#include "frame.h"
+
+/**
+ * @defgroup transport_backends Transport back ends
+ * @brief The available back ends of the transport.
+ * @{
+ */
+#define TRANSPORT_BACKEND_TCP 0
+#define TRANSPORT_BACKEND_ESPNOW 1
+#define TRANSPORT_BACKEND_LOOPBACK 2
+/** @} */
+
+/**
+ * @brief The back end of the transport used by the build.
+ */
+#ifndef TRANSPORT_BACKEND
+#define TRANSPORT_BACKEND TRANSPORT_BACKEND_TCP
+#endif
+
+/**
+ * @brief The result of a non-blocking transport operation.
+ */
+typedef enum _transport_result_t
+{
+    TRANSPORT_RESULT_PENDING, /**< The operation is still in progress. */
+    TRANSPORT_RESULT_DONE,    /**< The operation finished successfully. */
+    TRANSPORT_RESULT_FAILED   /**< The operation failed. */
+} transport_result_t;
+
+void TRANSPORT_Wakeup(void);
+
+void TRANSPORT_Sleep(void);
+
+void TRANSPORT_ConnectStart(void);
+
+transport_result_t TRANSPORT_ConnectPoll(void);
+
+bool TRANSPORT_Open(void);
+
+void TRANSPORT_Close(void);
+
+bool TRANSPORT_SendFrame(uint8_t type, uint16_t offset, uint16_t total, const uint8_t *payload,
+                         uint16_t length);
+
+transport_result_t TRANSPORT_PollFrame(const frame_t **frame);
+
+bool TRANSPORT_BroadcastOpen(void);
+
+transport_result_t TRANSPORT_BroadcastPollFrame(const frame_t **frame);
+
+void TRANSPORT_BroadcastClose(void);
+
+#endif /* TRANSPORT_H */
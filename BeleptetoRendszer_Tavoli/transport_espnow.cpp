@@ -0,0 +1,322 @@
+/**
+ ***************************************************************************************************
+ * @file transport_espnow.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Implementation of transport.h over ESP-NOW.
+ *
+ * The frames are sent directly to the MAC address of the central module on its channel, so there
+ * is no association, DHCP or connection setup. An encoded frame is longer than an ESP-NOW packet,
+ * so it is sent in consecutive packets and the received packets are decoded as a byte stream. A
+ * lost packet corrupts the frame, which the synchronization handles like a broken connection.
+ *
+ * The table image broadcast is not supported, the image is downloaded with the memory request.
+ ***************************************************************************************************
+ */
+
+#include "transport.h"
+
+#if TRANSPORT_BACKEND == TRANSPORT_BACKEND_ESPNOW
+
+#include <Arduino.h>
+#include <ESP8266WiFi.h>
+#include <espnow.h>
+#include <string.h>
+
+#include "wifi.h"
+
+extern "C"
+{
+#include <user_interface.h>
+}
+
+/**
+ * @defgroup transport_espnow_constants ESP-NOW transport constants
+ * @brief Constants of the ESP-NOW communication with the central module.
+ * @{
+ */
+/**
+ * @brief The MAC address of the central module, as an initializer of 6 bytes. The default is a
+ * placeholder, every installation sets the station MAC address of its central module in the build,
+ * for example -DTRANSPORT_ESPNOW_CENTRAL_MAC="{0x5E,0xCF,0x7F,0x12,0x34,0x56}".
+ */
+#ifndef TRANSPORT_ESPNOW_CENTRAL_MAC
+#define TRANSPORT_ESPNOW_CENTRAL_MAC {0x5E, 0xCF, 0x7F, 0x00, 0x00, 0x01}
+#endif
+/** @brief The WiFi channel of the central module, both ends have to be on the same channel. */
+#ifndef TRANSPORT_ESPNOW_CHANNEL
+#define TRANSPORT_ESPNOW_CHANNEL 1
+#endif
+#define TRANSPORT_ESPNOW_MAX_PACKET 250
+#define TRANSPORT_ESPNOW_SEND_TIMEOUT_MS 20
+/** @brief Size of the receive ring, must be a power of two. */
+#define TRANSPORT_ESPNOW_RING_SIZE 1024
+/** @} */
+
+/**
+ * @brief The MAC address of the central module.
+ */
+static uint8_t centralMac[6] = TRANSPORT_ESPNOW_CENTRAL_MAC;
+
+/**
+ * @brief True if ESP-NOW was initialized successfully.
+ */
+static bool initialized = false;
+
+/**
+ * @defgroup transport_espnow_ring Receive ring
+ * @brief The bytes received from the central module, written by the receive callback and read
+ * by TRANSPORT_PollFrame().
+ * @{
+ */
+static uint8_t ring[TRANSPORT_ESPNOW_RING_SIZE];
+static volatile uint16_t ringHead = 0;
+static volatile uint16_t ringTail = 0;
+/** @brief True if a packet did not fit in the ring, the byte stream is broken. */
+static volatile bool ringOverflow = false;
+/** @} */
+
+/**
+ * @defgroup transport_espnow_send Send state
+ * @brief The state of the last sent packet, updated by the send callback.
+ * @{
+ */
+static volatile bool sendPending = false;
+static volatile uint8_t sendStatus = 0;
+/** @} */
+
+/**
+ * @brief The frame decoder of the received bytes.
+ */
+static frame_parser_t frameParser;
+/**
+ * @brief The last received frame.
+ */
+static frame_t frameReceived;
+/**
+ * @brief Buffer for encoding the sent frames.
+ */
+static uint8_t frameBuffer[FRAME_MAX_SIZE];
+
+/**
+ * @brief Store the packets received from the central module in the ring.
+ * @param mac The MAC address of the sender.
+ * @param data The received packet.
+ * @param length The length of the packet.
+ */
+static void TRANSPORT_OnReceive(uint8_t *mac, uint8_t *data, uint8_t length)
+{
+    if (memcmp(mac, centralMac, sizeof(centralMac)) != 0)
+    {
+        return;
+    }
+
+    uint16_t used = (uint16_t)(ringHead - ringTail);
+    if (length > TRANSPORT_ESPNOW_RING_SIZE - used)
+    {
+        ringOverflow = true;
+        return;
+    }
+
+    uint16_t head = ringHead;
+    for (uint8_t i = 0; i < length; i++)
+    {
+        ring[(head + i) & (TRANSPORT_ESPNOW_RING_SIZE - 1)] = data[i];
+    }
+    ringHead = head + length;
+}
+
+/**
+ * @brief Store the result of the last sent packet.
+ * @param mac The MAC address of the receiver.
+ * @param status 0 if the packet was acknowledged by the receiver.
+ */
+static void TRANSPORT_OnSent(uint8_t *mac, uint8_t status)
+{
+    (void)mac;
+    sendStatus = status;
+    sendPending = false;
+}
+
+/**
+ * @brief Drop the received bytes and the partially decoded frame.
+ */
+static void TRANSPORT_ResetReceive(void)
+{
+    ringTail = ringHead;
+    ringOverflow = false;
+    FRAME_ParserReset(&frameParser);
+}
+
+/**
+ * @brief Wake up the modem.
+ */
+void TRANSPORT_Wakeup(void)
+{
+    WIFI_ModemWakeup();
+}
+
+/**
+ * @brief Stop ESP-NOW and put the modem to sleep.
+ */
+void TRANSPORT_Sleep(void)
+{
+    if (initialized)
+    {
+        esp_now_unregister_recv_cb();
+        esp_now_deinit();
+        initialized = false;
+    }
+    WIFI_ModemSleep();
+}
+
+/**
+ * @brief Initialize ESP-NOW on the channel of the central module.
+ */
+void TRANSPORT_ConnectStart(void)
+{
+    WiFi.mode(WIFI_STA);
+    WiFi.disconnect();
+    wifi_set_channel(TRANSPORT_ESPNOW_CHANNEL);
+
+    initialized = (esp_now_init() == 0);
+    if (!initialized)
+    {
+        return;
+    }
+    esp_now_set_self_role(ESP_NOW_ROLE_COMBO);
+    esp_now_add_peer(centralMac, ESP_NOW_ROLE_COMBO, TRANSPORT_ESPNOW_CHANNEL, nullptr, 0);
+    esp_now_register_recv_cb(TRANSPORT_OnReceive);
+    esp_now_register_send_cb(TRANSPORT_OnSent);
+}
+
+/**
+ * @brief Check if ESP-NOW is ready, there is nothing to wait for.
+ * @return #TRANSPORT_RESULT_DONE if ESP-NOW was initialized, #TRANSPORT_RESULT_FAILED otherwise.
+ */
+transport_result_t TRANSPORT_ConnectPoll(void)
+{
+    return initialized ? TRANSPORT_RESULT_DONE : TRANSPORT_RESULT_FAILED;
+}
+
+/**
+ * @brief Start a new exchange with the central module.
+ * @return True if ESP-NOW is ready, false otherwise.
+ */
+bool TRANSPORT_Open(void)
+{
+    TRANSPORT_ResetReceive();
+    return initialized;
+}
+
+/**
+ * @brief Finish the exchange with the central module.
+ */
+void TRANSPORT_Close(void)
+{
+    TRANSPORT_ResetReceive();
+}
+
+/**
+ * @brief Send a frame to the central module in consecutive packets.
+ * @return True if every packet was acknowledged by the central module, false otherwise.
+ */
+bool TRANSPORT_SendFrame(uint8_t type, uint16_t offset, uint16_t total, const uint8_t *payload,
+                         uint16_t length)
+{
+    uint16_t size = FRAME_Encode(frameBuffer, type, offset, total, payload, length);
+    if ((size == 0) || !initialized)
+    {
+        return false;
+    }
+
+    for (uint16_t sent = 0; sent < size; sent += TRANSPORT_ESPNOW_MAX_PACKET)
+    {
+        uint16_t packet = size - sent;
+        if (packet > TRANSPORT_ESPNOW_MAX_PACKET)
+        {
+            packet = TRANSPORT_ESPNOW_MAX_PACKET;
+        }
+
+        sendPending = true;
+        if (esp_now_send(centralMac, &(frameBuffer[sent]), packet) != 0)
+        {
+            return false;
+        }
+
+        // Wait for the acknowledgement, so the packets are not reordered or dropped by the queue
+        unsigned long start = millis();
+        while (sendPending && ((millis() - start) < TRANSPORT_ESPNOW_SEND_TIMEOUT_MS))
+        {
+            yield();
+        }
+        if (sendPending || (sendStatus != 0))
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Process the received bytes without waiting for more.
+ * @param frame Pointer to store the received frame in. The frame is valid until the next call.
+ * @return #TRANSPORT_RESULT_DONE if a valid frame was received, #TRANSPORT_RESULT_FAILED if a
+ * corrupted frame was received or bytes were lost, #TRANSPORT_RESULT_PENDING otherwise.
+ */
+transport_result_t TRANSPORT_PollFrame(const frame_t **frame)
+{
+    if (ringOverflow)
+    {
+        return TRANSPORT_RESULT_FAILED;
+    }
+
+    while (ringTail != ringHead)
+    {
+        uint8_t byte = ring[ringTail & (TRANSPORT_ESPNOW_RING_SIZE - 1)];
+        ringTail = ringTail + 1;
+
+        frame_parse_result_t result = FRAME_ParserFeed(&frameParser, &frameReceived, byte);
+        if (result == FRAME_PARSE_COMPLETE)
+        {
+            *frame = &frameReceived;
+            return TRANSPORT_RESULT_DONE;
+        }
+        if (result == FRAME_PARSE_ERROR)
+        {
+            return TRANSPORT_RESULT_FAILED;
+        }
+    }
+
+    return TRANSPORT_RESULT_PENDING;
+}
+
+/**
+ * @brief The broadcast is not supported over ESP-NOW.
+ * @return False.
+ */
+bool TRANSPORT_BroadcastOpen(void)
+{
+    return false;
+}
+
+/**
+ * @brief The broadcast is not supported over ESP-NOW.
+ * @return #TRANSPORT_RESULT_PENDING.
+ */
+transport_result_t TRANSPORT_BroadcastPollFrame(const frame_t **frame)
+{
+    (void)frame;
+    return TRANSPORT_RESULT_PENDING;
+}
+
+/**
+ * @brief The broadcast is not supported over ESP-NOW.
+ */
+void TRANSPORT_BroadcastClose(void)
+{
+}
+
+#endif /* TRANSPORT_BACKEND == TRANSPORT_BACKEND_ESPNOW */
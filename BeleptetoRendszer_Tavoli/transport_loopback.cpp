@@ -0,0 +1,300 @@
+/**
+ ***************************************************************************************************
+ * @file transport_loopback.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Implementation of transport.h over POSIX sockets, for running the synchronization on a
+ * Linux host.
+ *
+ * The frames are exchanged with the stand-in central module of tools/central_stub over TCP, and
+ * the table image broadcast is received from its multicast group. See tools/sync_loopback for the
+ * host build.
+ ***************************************************************************************************
+ */
+
+#include "transport.h"
+
+#if TRANSPORT_BACKEND == TRANSPORT_BACKEND_LOOPBACK
+
+#include <arpa/inet.h>
+#include <errno.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <unistd.h>
+
+/**
+ * @defgroup transport_loopback_constants Loopback transport constants
+ * @brief The addresses of the stand-in central module, can be overridden by the build.
+ * @{
+ */
+#ifndef TRANSPORT_LOOPBACK_HOST
+#define TRANSPORT_LOOPBACK_HOST "127.0.0.1"
+#endif
+#ifndef TRANSPORT_LOOPBACK_PORT
+#define TRANSPORT_LOOPBACK_PORT 5000
+#endif
+#ifndef TRANSPORT_LOOPBACK_MULTICAST_GROUP
+#define TRANSPORT_LOOPBACK_MULTICAST_GROUP "239.255.0.1"
+#endif
+#ifndef TRANSPORT_LOOPBACK_MULTICAST_PORT
+#define TRANSPORT_LOOPBACK_MULTICAST_PORT 5001
+#endif
+/** @} */
+
+/**
+ * @brief The socket of the connection to the central module, -1 if closed.
+ */
+static int connectionFd = -1;
+/**
+ * @brief The socket receiving the broadcast, -1 if closed.
+ */
+static int broadcastFd = -1;
+
+/**
+ * @brief The frame decoder of the received bytes.
+ */
+static frame_parser_t frameParser;
+/**
+ * @brief The last received frame.
+ */
+static frame_t frameReceived;
+/**
+ * @brief Buffer for the encoded and the received frames.
+ */
+static uint8_t frameBuffer[FRAME_MAX_SIZE];
+/**
+ * @brief The bytes received from the connection, not decoded yet.
+ */
+static uint8_t receiveBuffer[512];
+static uint16_t receiveLength = 0;
+static uint16_t receivePosition = 0;
+
+/**
+ * @brief There is no modem on the host.
+ */
+void TRANSPORT_Wakeup(void)
+{
+}
+
+/**
+ * @brief There is no modem on the host.
+ */
+void TRANSPORT_Sleep(void)
+{
+}
+
+/**
+ * @brief There is no network to connect to on the host.
+ */
+void TRANSPORT_ConnectStart(void)
+{
+}
+
+/**
+ * @brief There is no network to connect to on the host.
+ * @return #TRANSPORT_RESULT_DONE.
+ */
+transport_result_t TRANSPORT_ConnectPoll(void)
+{
+    return TRANSPORT_RESULT_DONE;
+}
+
+/**
+ * @brief Open a connection to the stand-in central module.
+ * @return True if the connection was opened, false otherwise.
+ */
+bool TRANSPORT_Open(void)
+{
+    TRANSPORT_Close();
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(TRANSPORT_LOOPBACK_PORT);
+    inet_pton(AF_INET, TRANSPORT_LOOPBACK_HOST, &(address.sin_addr));
+
+    connectionFd = socket(AF_INET, SOCK_STREAM, 0);
+    if (connectionFd < 0)
+    {
+        return false;
+    }
+    if (connect(connectionFd, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        TRANSPORT_Close();
+        return false;
+    }
+
+    int flag = 1;
+    setsockopt(connectionFd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+    FRAME_ParserReset(&frameParser);
+    receiveLength = 0;
+    receivePosition = 0;
+
+    return true;
+}
+
+/**
+ * @brief Close the connection to the stand-in central module.
+ */
+void TRANSPORT_Close(void)
+{
+    if (connectionFd >= 0)
+    {
+        close(connectionFd);
+        connectionFd = -1;
+    }
+}
+
+/**
+ * @brief Send a frame to the stand-in central module.
+ * @return True if the frame was sent, false otherwise.
+ */
+bool TRANSPORT_SendFrame(uint8_t type, uint16_t offset, uint16_t total, const uint8_t *payload,
+                         uint16_t length)
+{
+    uint16_t size = FRAME_Encode(frameBuffer, type, offset, total, payload, length);
+    if ((size == 0) || (connectionFd < 0))
+    {
+        return false;
+    }
+
+    return send(connectionFd, frameBuffer, size, MSG_NOSIGNAL) == (ssize_t)size;
+}
+
+/**
+ * @brief Process the received bytes without waiting for more.
+ * @param frame Pointer to store the received frame in. The frame is valid until the next call.
+ * @return #TRANSPORT_RESULT_DONE if a valid frame was received, #TRANSPORT_RESULT_FAILED if a
+ * corrupted frame was received or the connection was closed, #TRANSPORT_RESULT_PENDING otherwise.
+ */
+transport_result_t TRANSPORT_PollFrame(const frame_t **frame)
+{
+    if (connectionFd < 0)
+    {
+        return TRANSPORT_RESULT_FAILED;
+    }
+
+    for (;;)
+    {
+        while (receivePosition < receiveLength)
+        {
+            frame_parse_result_t result = FRAME_ParserFeed(&frameParser, &frameReceived,
+                                                           receiveBuffer[receivePosition++]);
+            if (result == FRAME_PARSE_COMPLETE)
+            {
+                *frame = &frameReceived;
+                return TRANSPORT_RESULT_DONE;
+            }
+            if (result == FRAME_PARSE_ERROR)
+            {
+                return TRANSPORT_RESULT_FAILED;
+            }
+        }
+
+        ssize_t length = recv(connectionFd, receiveBuffer, sizeof(receiveBuffer), MSG_DONTWAIT);
+        if (length == 0)
+        {
+            return TRANSPORT_RESULT_FAILED;
+        }
+        if (length < 0)
+        {
+            return ((errno == EAGAIN) || (errno == EWOULDBLOCK)) ? TRANSPORT_RESULT_PENDING
+                                                                 : TRANSPORT_RESULT_FAILED;
+        }
+        receiveLength = (uint16_t)length;
+        receivePosition = 0;
+    }
+}
+
+/**
+ * @brief Join the multicast group of the table image broadcast.
+ * @return True if the group was joined, false otherwise.
+ */
+bool TRANSPORT_BroadcastOpen(void)
+{
+    TRANSPORT_BroadcastClose();
+
+    broadcastFd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (broadcastFd < 0)
+    {
+        return false;
+    }
+
+    int flag = 1;
+    setsockopt(broadcastFd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(TRANSPORT_LOOPBACK_MULTICAST_PORT);
+
+    struct ip_mreq membership;
+    inet_pton(AF_INET, TRANSPORT_LOOPBACK_MULTICAST_GROUP, &(membership.imr_multiaddr));
+    inet_pton(AF_INET, TRANSPORT_LOOPBACK_HOST, &(membership.imr_interface));
+
+    if ((bind(broadcastFd, (struct sockaddr *)&address, sizeof(address)) < 0) ||
+        (setsockopt(broadcastFd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) <
+         0))
+    {
+        TRANSPORT_BroadcastClose();
+        return false;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Process the next received datagram without waiting. Every datagram is one frame.
+ * @param frame Pointer to store the received frame in. The frame is valid until the next call.
+ * @return #TRANSPORT_RESULT_DONE if a valid frame was received, #TRANSPORT_RESULT_FAILED if a
+ * corrupted datagram was received, #TRANSPORT_RESULT_PENDING if there is no datagram.
+ */
+transport_result_t TRANSPORT_BroadcastPollFrame(const frame_t **frame)
+{
+    if (broadcastFd < 0)
+    {
+        return TRANSPORT_RESULT_PENDING;
+    }
+
+    ssize_t length = recv(broadcastFd, frameBuffer, sizeof(frameBuffer), MSG_DONTWAIT);
+    if (length <= 0)
+    {
+        return TRANSPORT_RESULT_PENDING;
+    }
+
+    frame_parser_t parser;
+    FRAME_ParserReset(&parser);
+    for (ssize_t i = 0; i < length; i++)
+    {
+        frame_parse_result_t result = FRAME_ParserFeed(&parser, &frameReceived, frameBuffer[i]);
+        if (result == FRAME_PARSE_COMPLETE)
+        {
+            *frame = &frameReceived;
+            return TRANSPORT_RESULT_DONE;
+        }
+        if (result == FRAME_PARSE_ERROR)
+        {
+            break;
+        }
+    }
+
+    return TRANSPORT_RESULT_FAILED;
+}
+
+/**
+ * @brief Leave the multicast group of the table image broadcast.
+ */
+void TRANSPORT_BroadcastClose(void)
+{
+    if (broadcastFd >= 0)
+    {
+        close(broadcastFd);
+        broadcastFd = -1;
+    }
+}
+
+#endif /* TRANSPORT_BACKEND == TRANSPORT_BACKEND_LOOPBACK */
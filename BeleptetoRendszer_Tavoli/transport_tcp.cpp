@@ -0,0 +1,123 @@
+/**
+ ***************************************************************************************************
+ * @file transport_tcp.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Implementation of transport.h over TCP, using the WiFi network of the central module.
+ ***************************************************************************************************
+ */
+
+#include "transport.h"
+
+#if TRANSPORT_BACKEND == TRANSPORT_BACKEND_TCP
+
+#include "wifi.h"
+
+/**
+ * @brief The client used for the communication with the central module.
+ */
+static WiFiClient client;
+/**
+ * @brief The socket used for receiving the broadcast of the table image.
+ */
+static WiFiUDP udp;
+
+/**
+ * @brief Wake up the modem.
+ */
+void TRANSPORT_Wakeup(void)
+{
+    WIFI_ModemWakeup();
+}
+
+/**
+ * @brief Put the modem to sleep.
+ */
+void TRANSPORT_Sleep(void)
+{
+    WIFI_ModemSleep();
+}
+
+/**
+ * @brief Start connecting to the WiFi network of the central module.
+ */
+void TRANSPORT_ConnectStart(void)
+{
+    WIFI_ConnectStart();
+}
+
+/**
+ * @brief Check the progress of the connection to the WiFi network.
+ * @return See WIFI_ConnectPoll().
+ */
+transport_result_t TRANSPORT_ConnectPoll(void)
+{
+    return WIFI_ConnectPoll();
+}
+
+/**
+ * @brief Open a connection to the central module.
+ * @return True if the connection was opened, false otherwise.
+ */
+bool TRANSPORT_Open(void)
+{
+    return WIFI_ClientOpen(client);
+}
+
+/**
+ * @brief Close the connection to the central module.
+ */
+void TRANSPORT_Close(void)
+{
+    client.stop();
+}
+
+/**
+ * @brief Send a frame to the central module.
+ * @return True if the frame was sent, false otherwise.
+ */
+bool TRANSPORT_SendFrame(uint8_t type, uint16_t offset, uint16_t total, const uint8_t *payload,
+                         uint16_t length)
+{
+    return WIFI_ClientSendFrame(client, type, offset, total, payload, length);
+}
+
+/**
+ * @brief Process the received bytes without waiting for more.
+ * @param frame Pointer to store the received frame in. The frame is valid until the next call.
+ * @return See WIFI_ClientPollFrame().
+ */
+transport_result_t TRANSPORT_PollFrame(const frame_t **frame)
+{
+    return WIFI_ClientPollFrame(client, frame);
+}
+
+/**
+ * @brief Start listening to the table image broadcast of the central module.
+ * @return True if listening, false otherwise.
+ */
+bool TRANSPORT_BroadcastOpen(void)
+{
+    return WIFI_MulticastOpen(udp);
+}
+
+/**
+ * @brief Process the next received broadcast frame without waiting.
+ * @param frame Pointer to store the received frame in. The frame is valid until the next call.
+ * @return See WIFI_MulticastPollFrame().
+ */
+transport_result_t TRANSPORT_BroadcastPollFrame(const frame_t **frame)
+{
+    return WIFI_MulticastPollFrame(udp, frame);
+}
+
+/**
+ * @brief Stop listening to the table image broadcast.
+ */
+void TRANSPORT_BroadcastClose(void)
+{
+    udp.stop();
+}
+
+#endif /* TRANSPORT_BACKEND == TRANSPORT_BACKEND_TCP */
@@ -12,13 +12,24 @@
 
 #include <Arduino.h>
 
+#include "BeleptetoRendszer_Tavoli.h"
+#include "crc32.h"
+
 /**
  * @defgroup wifi_time_constants WiFi time constants
  * @brief Constants for timing the WiFi communication.
  * @{
  */
 #define WIFI_CONNECT_TIMEOUT_MS 10000
-#define CLIENT_TIMEOUT_MS 30000
+#define WIFI_FAST_CONNECT_TIMEOUT_MS 1500
+/**
+ * @brief The longest wait for the TCP connection to the central module. The connection is made on
+ * the local network of the central module within a few milliseconds, a longer wait only blocks the
+ * loop, the synchronization retries later.
+ */
+#ifndef WIFI_CLIENT_CONNECT_TIMEOUT_MS
+#define WIFI_CLIENT_CONNECT_TIMEOUT_MS 100
+#endif
 /** @} */
 
 /**
@@ -30,6 +41,9 @@
 #define WIFI_CENTRAL_PASS "0123456789abcdef"
 #define WIFI_CENTRAL_IP "192.168.4.1"
 #define WIFI_CENTRAL_PORT 80
+/** @brief The multicast group the central module broadcasts the shared table image on. */
+#define WIFI_MULTICAST_GROUP "239.255.0.1"
+#define WIFI_MULTICAST_PORT 5001
 /** @} */
 
 /**
@@ -49,170 +63,342 @@ const char *host = WIFI_CENTRAL_IP;
  */
 const uint16_t port = WIFI_CENTRAL_PORT;
 
-bool WIFI_ClientWaitForResponse(WiFiClient &client, unsigned long timeout);
-
 /**
- * @brief Connect to the WiFi network.
- * @return True if the connection was successful, false otherwise.
- *
- * @details The function checks if the ESP8266 is already connected to the WiFi network. If not, it
- * tries to connect to the network. Connection may take a few seconds.
- * @note The function uses delay() to wait for the connection to be established.
+ * @brief The settings of the last successful connection, kept in the RTC user memory.
  */
-bool WIFI_Connect(void)
+typedef struct _wifi_cache_t
 {
-    if (WiFi.isConnected())
-    {
-        return true;
-    }
+    uint32_t crc;          /**< CRC-32 of the rest of the structure. */
+    uint8_t bssid[6];      /**< The BSSID of the access point. */
+    uint8_t channel;       /**< The channel of the access point. */
+    uint8_t valid;         /**< Nonzero if the connection settings are valid. */
+    uint32_t ip;           /**< The IP address of the module. */
+    uint32_t gateway;      /**< The IP address of the gateway. */
+    uint32_t subnet;       /**< The subnet mask. */
+    uint32_t dns;          /**< The IP address of the DNS server. */
+    uint16_t fastAttempts; /**< See wifi_connect_stats_t. */
+    uint16_t fastHits;     /**< See wifi_connect_stats_t. */
+} wifi_cache_t;
 
-    // Connect to the WiFi network
-    WiFi.mode(WIFI_STA);
-    WiFi.begin(ssid, password);
+static_assert(sizeof(wifi_cache_t) <= RTC_MEMORY_WIFI_CACHE_BLOCKS * 4,
+              "The WiFi cache does not fit in its RTC user memory area");
 
-    // Wait for connection
-    unsigned long startMillis = millis();
-    while ((millis() - startMillis) < WIFI_CONNECT_TIMEOUT_MS)
-    {
-        delay(500);
+/**
+ * @brief The connection cache, mirrored in the RTC user memory.
+ */
+static wifi_cache_t wifiCache;
+/**
+ * @brief True if the current connection uses the cached settings.
+ */
+static bool fastConnect = false;
+/**
+ * @brief Value of millis() when the connection to the WiFi network was started.
+ */
+static unsigned long connectStartMillis = 0;
+/**
+ * @brief The duration of the last successful connection.
+ */
+static unsigned long lastConnectMillis = 0;
 
-        if (WiFi.status() == WL_CONNECTED)
-        {
-            return true;
-        }
-    }
+/**
+ * @brief Buffer for encoding the frames to send.
+ */
+static uint8_t frameBuffer[FRAME_MAX_SIZE];
+/**
+ * @brief The last received frame.
+ */
+static frame_t frameReceived;
+/**
+ * @brief The decoder of the received frames.
+ */
+static frame_parser_t frameParser;
 
-    return false;
+/**
+ * @brief Wake up the WiFi modem.
+ */
+void WIFI_ModemWakeup(void)
+{
+    WiFi.forceSleepWake();
 }
 
 /**
- * @brief Wait for the client response.
- * @param client The client to use for communication.
- * @param timeout The timeout in milliseconds.
- * @return True if the response was received, false otherwise.
+ * @brief Put the WiFi modem to sleep.
  */
-bool WIFI_ClientWaitForResponse(WiFiClient &client, unsigned long timeout)
+void WIFI_ModemSleep(void)
 {
-    unsigned long startMillis = millis();
-    while (client.available() == 0)
+    WiFi.forceSleepBegin();
+}
+
+/**
+ * @brief Calculate the CRC of the connection cache.
+ * @return The CRC of every field after the CRC.
+ */
+static uint32_t WIFI_CacheCrc(void)
+{
+    const uint8_t *data = (const uint8_t *)&wifiCache + sizeof(wifiCache.crc);
+    return CRC32_Final(CRC32_Update(CRC32_Init(), data, sizeof(wifiCache) - sizeof(wifiCache.crc)));
+}
+
+/**
+ * @brief Load the connection cache from the RTC user memory.
+ * @note The cache is cleared if its CRC is invalid, for example after power loss.
+ */
+static void WIFI_CacheLoad(void)
+{
+    ESP.rtcUserMemoryRead(RTC_MEMORY_WIFI_CACHE_OFFSET, (uint32_t *)&wifiCache, sizeof(wifiCache));
+    if (wifiCache.crc != WIFI_CacheCrc())
     {
-        if ((millis() - startMillis) > timeout)
-        {
-            return false;
-        }
+        memset(&wifiCache, 0, sizeof(wifiCache));
     }
+}
 
-    return true;
+/**
+ * @brief Save the connection cache to the RTC user memory.
+ */
+static void WIFI_CacheSave(void)
+{
+    wifiCache.crc = WIFI_CacheCrc();
+    ESP.rtcUserMemoryWrite(RTC_MEMORY_WIFI_CACHE_OFFSET, (uint32_t *)&wifiCache, sizeof(wifiCache));
 }
 
 /**
- * @brief Request the current time from the central module.
- * @param client The WiFi client to use for communication.
- * @param time Pointer to the variable to store the time in.
- * @return True if the time was received successfully, false otherwise.
+ * @brief Start the full connection: scan for the access point and request an address with DHCP.
  */
-bool WIFI_ClientRequestTime(WiFiClient &client, uint32_t *time)
+static void WIFI_ConnectStartFull(void)
 {
-    if (!client.connect(host, port))
+    fastConnect = false;
+
+    // Unset addresses switch back to DHCP
+    WiFi.config(IPAddress(), IPAddress(), IPAddress());
+    WiFi.begin(ssid, password);
+}
+
+/**
+ * @brief Start connecting to the WiFi network.
+ * @note Poll the connection with WIFI_ConnectPoll().
+ *
+ * @details If the settings of the last successful connection are cached, the module connects
+ * directly to the same access point on the same channel with the same static IP configuration,
+ * which skips the scan and DHCP. If that fails, it falls back to the full connection.
+ */
+void WIFI_ConnectStart(void)
+{
+    connectStartMillis = millis();
+
+    if (WiFi.isConnected())
     {
-        return false;
+        return;
     }
 
-    // Send the request symbol and the size
-    client.print("T 0\n");
+    // Do not write the connection settings to the flash on every connection
+    WiFi.persistent(false);
+    WiFi.mode(WIFI_STA);
 
-    if (!WIFI_ClientWaitForResponse(client, CLIENT_TIMEOUT_MS))
+    WIFI_CacheLoad();
+    if (!wifiCache.valid)
     {
-        client.stop();
-        return false;
+        WIFI_ConnectStartFull();
+        return;
     }
 
-    String response = client.readStringUntil('\n');
-    while (client.available())
+    fastConnect = true;
+    wifiCache.fastAttempts++;
+    WIFI_CacheSave();
+
+    WiFi.config(IPAddress(wifiCache.ip), IPAddress(wifiCache.gateway),
+                IPAddress(wifiCache.subnet), IPAddress(wifiCache.dns));
+    WiFi.begin(ssid, password, wifiCache.channel, wifiCache.bssid);
+}
+
+/**
+ * @brief Check the connection to the WiFi network started by WIFI_ConnectStart().
+ * @return #TRANSPORT_RESULT_DONE if connected, #TRANSPORT_RESULT_FAILED if the connection timed
+ * out, #TRANSPORT_RESULT_PENDING otherwise.
+ */
+transport_result_t WIFI_ConnectPoll(void)
+{
+    wl_status_t status = WiFi.status();
+
+    if (status == WL_CONNECTED)
     {
-        client.read();
+        lastConnectMillis = millis() - connectStartMillis;
+
+        if (fastConnect)
+        {
+            wifiCache.fastHits++;
+        }
+        else
+        {
+            // Cache the settings of the connection for the next time
+            memcpy(wifiCache.bssid, WiFi.BSSID(), sizeof(wifiCache.bssid));
+            wifiCache.channel = (uint8_t)WiFi.channel();
+            wifiCache.ip = (uint32_t)WiFi.localIP();
+            wifiCache.gateway = (uint32_t)WiFi.gatewayIP();
+            wifiCache.subnet = (uint32_t)WiFi.subnetMask();
+            wifiCache.dns = (uint32_t)WiFi.dnsIP();
+            wifiCache.valid = 1;
+        }
+        WIFI_CacheSave();
+
+        return TRANSPORT_RESULT_DONE;
     }
 
-    long time_parsed = response.toInt();
-    if (time_parsed == 0)
+    if (fastConnect &&
+        (((millis() - connectStartMillis) > WIFI_FAST_CONNECT_TIMEOUT_MS) ||
+         (status == WL_NO_SSID_AVAIL) || (status == WL_CONNECT_FAILED)))
     {
-        client.stop();
-        return false;
+        // The cached settings are outdated, forget them and fall back to the full connection
+        wifiCache.valid = 0;
+        WIFI_CacheSave();
+        WiFi.disconnect();
+        WIFI_ConnectStartFull();
+        return TRANSPORT_RESULT_PENDING;
     }
 
-    *time = (uint32_t)time_parsed;
+    if ((millis() - connectStartMillis) > WIFI_CONNECT_TIMEOUT_MS)
+    {
+        return TRANSPORT_RESULT_FAILED;
+    }
 
-    client.stop();
-    return true;
+    return TRANSPORT_RESULT_PENDING;
+}
+
+/**
+ * @brief Get the statistics of the connections to the WiFi network.
+ * @param stats Pointer to store the statistics in.
+ */
+void WIFI_GetConnectStats(wifi_connect_stats_t *stats)
+{
+    stats->fastAttempts = wifiCache.fastAttempts;
+    stats->fastHits = wifiCache.fastHits;
+    stats->lastConnectMillis = lastConnectMillis;
 }
 
 /**
- * @brief Request new memory from the central module for the EEPROM.
- * @param client The client object.
- * @param buffer Buffer to store the received memory.
- * @param size The size of the memory.
- * @return True if the memory was received, false otherwise.
+ * @brief Connect the client to the central module.
+ * @param client The client to connect.
+ * @return True if the client is connected, false otherwise.
+ * @note The TCP connection itself is established synchronously, which takes a few milliseconds on
+ * the local network of the central module. If the central module does not answer, the call
+ * returns after #WIFI_CLIENT_CONNECT_TIMEOUT_MS instead of the 5 s default of the client.
  */
-bool WIFI_ClientRequestNewMemory(WiFiClient &client, uint8_t *buffer, uint16_t size)
+bool WIFI_ClientOpen(WiFiClient &client)
 {
+    client.stop();
+    client.setTimeout(WIFI_CLIENT_CONNECT_TIMEOUT_MS);
     if (!client.connect(host, port))
     {
         return false;
     }
+    client.setNoDelay(true);
+    FRAME_ParserReset(&frameParser);
 
-    // Send the request symbol and the size
-    client.print("N ");
-    client.print(size);
-    client.print('\n');
+    return true;
+}
 
-    if (!WIFI_ClientWaitForResponse(client, CLIENT_TIMEOUT_MS))
+/**
+ * @brief Send a frame to the central module.
+ * @param client The client to use for communication.
+ * @param type The type of the frame.
+ * @param offset The offset of the payload in the transferred data.
+ * @param total The total size of the transferred data.
+ * @param payload The payload of the frame.
+ * @param length The length of the payload.
+ * @return True if the frame was sent, false otherwise.
+ */
+bool WIFI_ClientSendFrame(WiFiClient &client, uint8_t type, uint16_t offset, uint16_t total,
+                          const uint8_t *payload, uint16_t length)
+{
+    uint16_t size = FRAME_Encode(frameBuffer, type, offset, total, payload, length);
+    if (size == 0)
     {
-        client.stop();
         return false;
     }
 
-    size_t i = 0;
-    while (size > i)
+    return client.write(frameBuffer, size) == size;
+}
+
+/**
+ * @brief Process the received bytes without waiting for more.
+ * @param client The client to use for communication.
+ * @param frame Pointer to store the received frame in. The frame is valid until the next call.
+ * @return #TRANSPORT_RESULT_DONE if a valid frame was received, #TRANSPORT_RESULT_FAILED if a
+ * corrupted frame was received or the connection was closed, #TRANSPORT_RESULT_PENDING otherwise.
+ */
+transport_result_t WIFI_ClientPollFrame(WiFiClient &client, const frame_t **frame)
+{
+    while (client.available() > 0)
     {
-        size_t readSize = client.readBytes(&(buffer[i]), size > 8 ? 8 : size);
-        i += readSize;
+        frame_parse_result_t result = FRAME_ParserFeed(&frameParser, &frameReceived,
+                                                       (uint8_t)client.read());
+        if (result == FRAME_PARSE_COMPLETE)
+        {
+            *frame = &frameReceived;
+            return TRANSPORT_RESULT_DONE;
+        }
+        if (result == FRAME_PARSE_ERROR)
+        {
+            return TRANSPORT_RESULT_FAILED;
+        }
     }
-    if (i != size)
+
+    if (!client.connected())
     {
-        client.stop();
-        return false;
+        return TRANSPORT_RESULT_FAILED;
     }
 
-    client.stop();
-    return true;
+    return TRANSPORT_RESULT_PENDING;
 }
 
 /**
- * @brief Send the EEPROM memory to the central module.
- * @param client The client object
- * @param buffer The buffer that contains the memory
- * @param size The size of the buffer
- * @return True if the memory was sent, false otherwise
+ * @brief Start listening to the table image broadcast of the central module.
+ * @param udp The UDP socket to use.
+ * @return True if the multicast group was joined, false otherwise.
  */
-bool WIFI_ClientSendMemory(WiFiClient &client, const uint8_t *buffer, uint16_t size)
+bool WIFI_MulticastOpen(WiFiUDP &udp)
 {
-    if (!client.connect(host, port))
+    IPAddress group;
+    group.fromString(WIFI_MULTICAST_GROUP);
+
+    return udp.beginMulticast(WiFi.localIP(), group, WIFI_MULTICAST_PORT) == 1;
+}
+
+/**
+ * @brief Process the next received datagram without waiting. Every datagram is one frame.
+ * @param udp The UDP socket to use.
+ * @param frame Pointer to store the received frame in. The frame is valid until the next call.
+ * @return #TRANSPORT_RESULT_DONE if a valid frame was received, #TRANSPORT_RESULT_FAILED if a
+ * corrupted datagram was received, #TRANSPORT_RESULT_PENDING if there is no datagram.
+ */
+transport_result_t WIFI_MulticastPollFrame(WiFiUDP &udp, const frame_t **frame)
+{
+    int size = udp.parsePacket();
+    if (size <= 0)
     {
-        return false;
+        return TRANSPORT_RESULT_PENDING;
+    }
+    if (size > FRAME_MAX_SIZE)
+    {
+        // Not a frame, the rest of the datagram is dropped by the next parsePacket()
+        return TRANSPORT_RESULT_FAILED;
     }
 
-    // Send the request symbol and the size
-    client.print("M ");
-    client.print(size);
-    client.print('\n');
-
-    size_t s = client.write(buffer, size);
-    if (s != size)
+    int length = udp.read(frameBuffer, FRAME_MAX_SIZE);
+    frame_parser_t parser;
+    FRAME_ParserReset(&parser);
+    for (int i = 0; i < length; i++)
     {
-        client.stop();
-        return false;
+        frame_parse_result_t result = FRAME_ParserFeed(&parser, &frameReceived, frameBuffer[i]);
+        if (result == FRAME_PARSE_COMPLETE)
+        {
+            *frame = &frameReceived;
+            return TRANSPORT_RESULT_DONE;
+        }
+        if (result == FRAME_PARSE_ERROR)
+        {
+            break;
+        }
     }
 
-    client.stop();
-    return true;
+    return TRANSPORT_RESULT_FAILED;
 }
@@ -12,13 +12,40 @@
 #define WIFI_H
 
 #include <ESP8266WiFi.h>
+#include <WiFiUdp.h>
 
-bool WIFI_Connect(void);
+#include "frame.h"
+#include "transport.h"
 
-bool WIFI_ClientRequestTime(WiFiClient &client, uint32_t *time);
+/**
+ * @brief Statistics of the connections to the WiFi network.
+ */
+typedef struct _wifi_connect_stats_t
+{
+    uint16_t fastAttempts;           /**< The connections tried with the cached settings. */
+    uint16_t fastHits;               /**< The successful connections with the cached settings. */
+    unsigned long lastConnectMillis; /**< The duration of the last successful connection. */
+} wifi_connect_stats_t;
+
+void WIFI_ModemWakeup(void);
+
+void WIFI_ModemSleep(void);
+
+void WIFI_ConnectStart(void);
+
+transport_result_t WIFI_ConnectPoll(void);
+
+void WIFI_GetConnectStats(wifi_connect_stats_t *stats);
+
+bool WIFI_ClientOpen(WiFiClient &client);
+
+bool WIFI_ClientSendFrame(WiFiClient &client, uint8_t type, uint16_t offset, uint16_t total,
+                          const uint8_t *payload, uint16_t length);
+
+transport_result_t WIFI_ClientPollFrame(WiFiClient &client, const frame_t **frame);
 
-bool WIFI_ClientRequestNewMemory(WiFiClient &client, uint8_t *buffer, uint16_t size);
+bool WIFI_MulticastOpen(WiFiUDP &udp);
 
-bool WIFI_ClientSendMemory(WiFiClient &client, const uint8_t *buffer, uint16_t size);
+transport_result_t WIFI_MulticastPollFrame(WiFiUDP &udp, const frame_t **frame);
 
 #endif /* WIFI_H */
@@ -0,0 +1,266 @@
+/**
+ ***************************************************************************************************
+ * @file x25519.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Implementation of x25519.h.
+ *
+ * The field elements are sixteen 16 bit limbs in 64 bit words, after TweetNaCl. It is compact and
+ * runs in constant time, but it is slow on the ESP8266: a key exchange takes two scalar
+ * multiplications, which is why the sync channel resumes sessions with tickets (secure.h).
+ ***************************************************************************************************
+ */
+
+#include "x25519.h"
+
+#include <string.h>
+
+/**
+ * @brief A field element modulo 2^255 - 19.
+ */
+typedef int64_t field_t[16];
+
+/**
+ * @brief The constant (A - 2) / 4 of the Montgomery ladder.
+ */
+static const field_t x25519A24 = {0xDB41, 1};
+
+/**
+ * @brief Carry the limbs of a field element back to 16 bits.
+ * @param o The field element.
+ */
+static void X25519_Carry(field_t o)
+{
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        o[i] += (int64_t)1 << 16;
+        int64_t carry = o[i] >> 16;
+        if (i < 15)
+        {
+            o[i + 1] += carry - 1;
+        }
+        else
+        {
+            // 2^256 = 38 modulo 2^255 - 19
+            o[0] += 38 * (carry - 1);
+        }
+        o[i] -= carry * 65536;
+    }
+}
+
+/**
+ * @brief Swap two field elements if a bit is set, in constant time.
+ * @param p The first field element.
+ * @param q The second field element.
+ * @param bit 1 to swap, 0 to keep.
+ */
+static void X25519_Swap(field_t p, field_t q, int64_t bit)
+{
+    int64_t mask = ~(bit - 1);
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        int64_t t = mask & (p[i] ^ q[i]);
+        p[i] ^= t;
+        q[i] ^= t;
+    }
+}
+
+/**
+ * @brief Encode a field element in its unique 32 byte form.
+ * @param out Buffer of #X25519_SIZE bytes.
+ * @param n The field element.
+ */
+static void X25519_Pack(uint8_t *out, const field_t n)
+{
+    field_t t;
+    field_t m;
+    memcpy(t, n, sizeof(field_t));
+    X25519_Carry(t);
+    X25519_Carry(t);
+    X25519_Carry(t);
+
+    // Subtract the modulus twice if the result is not negative
+    for (uint8_t j = 0; j < 2; j++)
+    {
+        m[0] = t[0] - 0xffed;
+        for (uint8_t i = 1; i < 15; i++)
+        {
+            m[i] = t[i] - 0xffff - ((m[i - 1] >> 16) & 1);
+            m[i - 1] &= 0xffff;
+        }
+        m[15] = t[15] - 0x7fff - ((m[14] >> 16) & 1);
+        int64_t borrow = (m[15] >> 16) & 1;
+        m[14] &= 0xffff;
+        X25519_Swap(t, m, 1 - borrow);
+    }
+
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        out[2 * i] = (uint8_t)(t[i] & 0xff);
+        out[2 * i + 1] = (uint8_t)((t[i] >> 8) & 0xff);
+    }
+}
+
+/**
+ * @brief Decode a field element, ignoring the top bit.
+ * @param o The field element.
+ * @param n The encoded element, #X25519_SIZE bytes.
+ */
+static void X25519_Unpack(field_t o, const uint8_t *n)
+{
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        o[i] = n[2 * i] + ((int64_t)(n[2 * i + 1]) << 8);
+    }
+    o[15] &= 0x7fff;
+}
+
+/**
+ * @brief Add two field elements, without carrying.
+ */
+static void X25519_Add(field_t o, const field_t a, const field_t b)
+{
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        o[i] = a[i] + b[i];
+    }
+}
+
+/**
+ * @brief Subtract two field elements, without carrying.
+ */
+static void X25519_Subtract(field_t o, const field_t a, const field_t b)
+{
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        o[i] = a[i] - b[i];
+    }
+}
+
+/**
+ * @brief Multiply two field elements.
+ */
+static void X25519_Multiply(field_t o, const field_t a, const field_t b)
+{
+    int64_t t[31] = {0};
+    for (uint8_t i = 0; i < 16; i++)
+    {
+        for (uint8_t j = 0; j < 16; j++)
+        {
+            t[i + j] += a[i] * b[j];
+        }
+    }
+    for (uint8_t i = 0; i < 15; i++)
+    {
+        t[i] += 38 * t[i + 16];
+    }
+    memcpy(o, t, sizeof(field_t));
+    X25519_Carry(o);
+    X25519_Carry(o);
+}
+
+/**
+ * @brief Invert a field element, as its power of 2^255 - 21.
+ * @param o The inverse.
+ * @param a The field element.
+ */
+static void X25519_Invert(field_t o, const field_t a)
+{
+    field_t c;
+    memcpy(c, a, sizeof(field_t));
+    for (int16_t i = 253; i >= 0; i--)
+    {
+        X25519_Multiply(c, c, c);
+        if ((i != 2) && (i != 4))
+        {
+            X25519_Multiply(c, c, a);
+        }
+    }
+    memcpy(o, c, sizeof(field_t));
+}
+
+/**
+ * @brief Multiply a point by a scalar with the Montgomery ladder.
+ * @param out Buffer of #X25519_SIZE bytes to store the u coordinate of the result in.
+ * @param scalar The scalar, clamped before use.
+ * @param point The u coordinate of the point.
+ */
+static void X25519_ScalarMultiply(uint8_t *out, const uint8_t *scalar, const uint8_t *point)
+{
+    uint8_t z[X25519_SIZE];
+    memcpy(z, scalar, X25519_SIZE);
+    z[31] = (z[31] & 127) | 64;
+    z[0] &= 248;
+
+    field_t x;
+    field_t a = {1};
+    field_t b;
+    field_t c = {0};
+    field_t d = {1};
+    field_t e;
+    field_t f;
+    X25519_Unpack(x, point);
+    memcpy(b, x, sizeof(field_t));
+
+    for (int16_t i = 254; i >= 0; i--)
+    {
+        int64_t bit = (z[i >> 3] >> (i & 7)) & 1;
+        X25519_Swap(a, b, bit);
+        X25519_Swap(c, d, bit);
+        X25519_Add(e, a, c);
+        X25519_Subtract(a, a, c);
+        X25519_Add(c, b, d);
+        X25519_Subtract(b, b, d);
+        X25519_Multiply(d, e, e);
+        X25519_Multiply(f, a, a);
+        X25519_Multiply(a, c, a);
+        X25519_Multiply(c, b, e);
+        X25519_Add(e, a, c);
+        X25519_Subtract(a, a, c);
+        X25519_Multiply(b, a, a);
+        X25519_Subtract(c, d, f);
+        X25519_Multiply(a, c, x25519A24);
+        X25519_Add(a, a, d);
+        X25519_Multiply(c, c, a);
+        X25519_Multiply(a, d, f);
+        X25519_Multiply(d, b, x);
+        X25519_Multiply(b, e, e);
+        X25519_Swap(a, b, bit);
+        X25519_Swap(c, d, bit);
+    }
+
+    X25519_Invert(c, c);
+    X25519_Multiply(a, a, c);
+    X25519_Pack(out, a);
+}
+
+/**
+ * @brief Calculate the public key of a private key.
+ * @param publicKey Buffer of #X25519_SIZE bytes to store the public key in.
+ * @param privateKey The private key, #X25519_SIZE random bytes.
+ */
+void X25519_PublicKey(uint8_t *publicKey, const uint8_t *privateKey)
+{
+    static const uint8_t base_point[X25519_SIZE] = {9};
+    X25519_ScalarMultiply(publicKey, privateKey, base_point);
+}
+
+/**
+ * @brief Calculate the shared secret of a private key and the public key of the peer.
+ * @param secret Buffer of #X25519_SIZE bytes to store the shared secret in.
+ * @param privateKey The own private key.
+ * @param publicKey The public key of the peer.
+ * @return True if the secret is valid, false if the public key was of small order.
+ */
+bool X25519_SharedSecret(uint8_t *secret, const uint8_t *privateKey, const uint8_t *publicKey)
+{
+    X25519_ScalarMultiply(secret, privateKey, publicKey);
+
+    uint8_t bits = 0;
+    for (uint8_t i = 0; i < X25519_SIZE; i++)
+    {
+        bits |= secret[i];
+    }
+    return bits != 0;
+}
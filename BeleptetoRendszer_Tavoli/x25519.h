@@ -0,0 +1,23 @@
+/**
+ ***************************************************************************************************
+ * @file x25519.h
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Header file for the X25519 key exchange (RFC 7748).
+ ***************************************************************************************************
+ */
+
+#ifndef X25519_H
+#define X25519_H
+
+#include <stdint.h>
+
+/** @brief Size of a private key, a public key and a shared secret in bytes. */
+#define X25519_SIZE 32
+
+void X25519_PublicKey(uint8_t *publicKey, const uint8_t *privateKey);
+
+bool X25519_SharedSecret(uint8_t *secret, const uint8_t *privateKey, const uint8_t *publicKey);
+
+#endif /* X25519_H */
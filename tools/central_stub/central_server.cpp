@@ -0,0 +1,931 @@
+/**
+ ***************************************************************************************************
+ * @file central_server.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Stand-in of the central module for benchmarking on a Linux host.
+ *
+ * Implements the central module's side of the sync protocol of the remote module (see frame.h and
+ * sync.cpp): it answers the introduction, stores the uploaded logs per chip ID, serves the table
+ * image with resume support, answers the time requests and the revocation probes with signed
+ * deltas. Every connection is served on its own thread.
+ *
+ * The table image contains no revocations (version 0). The revoked cards are taken from the
+ * records of the image, so the modules can be checked to deny them before the next table image.
+ *
+ * A module can start the connection with a handshake (see secure.h), every later frame of the
+ * connection is sealed then. The device keys are derived from the site key and the chip IDs, the
+ * tickets are encrypted with a random key generated at start, so they do not survive a restart.
+ ***************************************************************************************************
+ */
+
+#include <signal.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <atomic>
+#include <cstdio>
+#include <cstdlib>
+#include <map>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "host_io.h"
+#include "frame.h"
+#include "secure.h"
+#include "sha256.h"
+
+/**
+ * @defgroup server_constants Server constants
+ * @brief Constants of the stand-in central module, matching the remote module.
+ * @{
+ */
+#define SERVER_IMAGE_SIZE 4096
+#define SERVER_LOG_SIZE 15
+#define SERVER_AUTHENTICATE_SIZE 30
+#define SERVER_AUTHENTICATE_DOORS_SIZE 34
+#define SERVER_HEADER_SIZE 60
+#define SERVER_IDLE_TIMEOUT_MS 30000
+#define SERVER_UID_SIZE 10
+/** @brief The revoked cards fitting in one answer, after the versions and before the MAC. */
+#define SERVER_REVOCATIONS_PER_FRAME ((FRAME_MAX_PAYLOAD - 8 - SHA256_SIZE) / SERVER_UID_SIZE)
+/** @brief The key of the revocation MAC, the REVOCATION_KEY of the remote module. */
+#define SERVER_REVOCATION_KEY "belepteto_rendszer_revocation_01"
+/** @brief The key the device keys are derived from, the SYNC_SITE_KEY of the remote module. */
+#define SERVER_SITE_KEY "belepteto_rendszer_site_key_0001"
+#define SERVER_TICKET_LIFETIME_S (7 * 24 * 3600)
+/** @} */
+
+/**
+ * @brief The configuration of the server.
+ */
+typedef struct _server_config_t
+{
+    uint16_t port;          /**< The port to listen on. */
+    uint16_t chunkSize;     /**< The payload size of the data frames. */
+    uint16_t slotLength;    /**< The length of the assigned sync slots in seconds, 0 to disable. */
+    uint8_t doors;          /**< The number of doors of a shared image, 0 for a single door. */
+    const char *multicastGroup;     /**< The group to broadcast the image on, nullptr to disable. */
+    uint16_t multicastPort;         /**< The port of the multicast group. */
+    const char *multicastInterface; /**< The address of the interface to broadcast on. */
+    uint32_t multicastGapMs;        /**< The delay between the broadcast chunks. */
+    uint32_t revokeEveryS;  /**< Revoke another card every this many seconds, 0 to disable. */
+    const char *revocationKey; /**< The key of the revocation MAC. */
+    const char *siteKey;    /**< The key the device keys are derived from. */
+    uint32_t ticketLifetime; /**< The time a session ticket is accepted for, in seconds. */
+    bool secureOnly;        /**< Refuse the modules that do not start with a handshake. */
+    bool verbose;           /**< Print every session. */
+} server_config_t;
+
+/**
+ * @brief The counters of the server.
+ */
+typedef struct _server_stats_t
+{
+    std::atomic<uint64_t> connections;  /**< The number of accepted connections. */
+    std::atomic<uint64_t> logRecords;   /**< The number of new log records stored. */
+    std::atomic<uint64_t> notModified;  /**< The number of not modified answers. */
+    std::atomic<uint64_t> downloads;    /**< The number of completed image downloads. */
+    std::atomic<uint64_t> resumed;      /**< The number of downloads resumed from an offset. */
+    std::atomic<uint64_t> bytesServed;  /**< The number of image bytes sent. */
+    std::atomic<uint64_t> ranges;       /**< The number of ranges served after the broadcast. */
+    std::atomic<uint64_t> broadcastBytes; /**< The number of image bytes broadcast. */
+    std::atomic<uint64_t> probes;         /**< The number of revocation probes answered. */
+    std::atomic<uint64_t> revocationsSent; /**< The number of revoked cards sent. */
+    std::atomic<uint64_t> handshakes;     /**< The number of full handshakes. */
+    std::atomic<uint64_t> resumptions;    /**< The number of sessions resumed with a ticket. */
+    std::atomic<uint64_t> ticketsRefused; /**< The number of tickets refused. */
+    std::atomic<uint64_t> protocolErrors; /**< The number of connections closed on bad frames. */
+} server_stats_t;
+
+static server_config_t config = {5000, FRAME_MAX_PAYLOAD, 0, 0, nullptr, 5001, "127.0.0.1", 5,
+                                 0, SERVER_REVOCATION_KEY, SERVER_SITE_KEY,
+                                 SERVER_TICKET_LIFETIME_S, false, false};
+static server_stats_t stats;
+/** @brief The keys of the secure channel. */
+static secure_server_t secureServer;
+
+static uint8_t image[SERVER_IMAGE_SIZE];
+static uint8_t imageHash[SHA256_SIZE];
+
+/** @brief Protects the per-module state below. */
+static std::mutex modulesMutex;
+/** @brief The log sequence number expected next from every module, by chip ID. */
+static std::map<uint32_t, uint32_t> expectedSequence;
+/** @brief The sync slot assigned to every module, by chip ID. */
+static std::map<uint32_t, uint16_t> assignedSlot;
+/** @brief The door assigned to every module, by chip ID. */
+static std::map<uint32_t, uint8_t> assignedDoor;
+/** @brief The UIDs of the revoked cards, in the order of revocation. */
+static std::vector<std::vector<uint8_t>> revocations;
+
+static volatile sig_atomic_t stopRequested = 0;
+
+/**
+ * @brief Write a 16 bit big-endian number to a buffer.
+ * @param buffer The buffer to write to.
+ * @param value The number to write.
+ */
+static void SERVER_WriteUint16(uint8_t *buffer, uint16_t value)
+{
+    buffer[0] = (uint8_t)(value >> 8);
+    buffer[1] = (uint8_t)(value & 0xFF);
+}
+
+/**
+ * @brief Build a synthetic table image with the given number of random cards.
+ * @param records The number of authentication records.
+ *
+ * @details With doors configured one image is built for the whole site, every record is valid on
+ * a random set of doors.
+ */
+static void SERVER_BuildImage(uint16_t records)
+{
+    uint16_t record_size = (config.doors > 0) ? SERVER_AUTHENTICATE_DOORS_SIZE
+                                              : SERVER_AUTHENTICATE_SIZE;
+    uint16_t max_records = (SERVER_IMAGE_SIZE - SERVER_HEADER_SIZE) / record_size;
+    if (records > max_records)
+    {
+        records = max_records;
+    }
+
+    memset(image, 0xFF, sizeof(image));
+    memset(image, 0, SERVER_HEADER_SIZE);
+    SERVER_WriteUint16(&(image[0]), SERVER_HEADER_SIZE);
+    SERVER_WriteUint16(&(image[2]), records * record_size);
+    SERVER_WriteUint16(&(image[4]), SERVER_HEADER_SIZE);
+    SERVER_WriteUint16(&(image[8]), SERVER_IMAGE_SIZE);
+    SERVER_WriteUint16(&(image[52]), record_size);
+    image[54] = 0xFF;
+    BYTEORDER_WriteUint32Be(&(image[56]), 0);
+
+    for (uint16_t i = 0; i < records; i++)
+    {
+        uint8_t *record = &(image[SERVER_HEADER_SIZE + i * record_size]);
+        memset(record, 0, record_size);
+        for (int j = 0; j < 4; j++)
+        {
+            record[j] = (uint8_t)(rand() & 0xFF);
+        }
+        snprintf((char *)&(record[10]), 16, "user%u", (unsigned)i);
+        record[26] = 0;
+        record[27] = 0;
+        record[28] = 23;
+        record[29] = 59;
+        if (config.doors > 0)
+        {
+            uint32_t doors = (uint32_t)rand() & ((config.doors >= 32) ? 0xFFFFFFFF
+                                                                       : ((1u << config.doors) - 1));
+            BYTEORDER_WriteUint32Be(&(record[30]), doors);
+        }
+    }
+}
+
+/**
+ * @brief Load the table image from a raw file, padded to the image size.
+ * @param path The path of the file.
+ * @return True if the file was loaded, false otherwise.
+ */
+static bool SERVER_LoadImage(const char *path)
+{
+    FILE *file = fopen(path, "rb");
+    if (file == nullptr)
+    {
+        perror(path);
+        return false;
+    }
+    memset(image, 0xFF, sizeof(image));
+    size_t length = fread(image, 1, sizeof(image), file);
+    fclose(file);
+
+    return length > 0;
+}
+
+/**
+ * @brief Store a batch of logs and answer with the sequence number expected next.
+ * @param connection The connection of the module.
+ * @param chipId The chip ID of the module.
+ * @param frame The received log frame.
+ * @return True if the answer was sent, false otherwise.
+ */
+static bool SERVER_HandleLog(host_connection_t *connection, uint32_t chipId, const frame_t *frame)
+{
+    if ((frame->length < 4) || (((frame->length - 4) % SERVER_LOG_SIZE) != 0))
+    {
+        return false;
+    }
+    uint32_t sequence = BYTEORDER_ReadUint32Be(frame->payload);
+    uint32_t count = (frame->length - 4) / SERVER_LOG_SIZE;
+
+    uint32_t expected;
+    {
+        std::lock_guard<std::mutex> lock(modulesMutex);
+        auto it = expectedSequence.find(chipId);
+        expected = (it == expectedSequence.end()) ? sequence : it->second;
+
+        if ((int32_t)(sequence - expected) > 0 || (int32_t)(sequence + count - expected) < 0)
+        {
+            // The batch does not continue the stored logs: either this server or the module lost
+            // its state, so the batch is taken as it is
+            stats.logRecords += count;
+            expected = sequence + count;
+        }
+        else
+        {
+            // Store the records not stored yet, the rest is a retransmission
+            stats.logRecords += sequence + count - expected;
+            expected = sequence + count;
+        }
+        expectedSequence[chipId] = expected;
+    }
+
+    uint8_t payload[4];
+    BYTEORDER_WriteUint32Be(payload, expected);
+    return HOST_IO_SendFrame(connection, FRAME_TYPE_ACK, 0, 0, payload, sizeof(payload));
+}
+
+/**
+ * @brief Send a range of the table image, waiting for the acknowledgement of every chunk.
+ * @param connection The connection of the module.
+ * @param position The start of the range.
+ * @param end The end of the range.
+ * @return True if the whole range was acknowledged, false otherwise.
+ */
+static bool SERVER_SendRange(host_connection_t *connection, uint16_t position, uint16_t end)
+{
+    while (position < end)
+    {
+        uint16_t length = end - position;
+        if (length > config.chunkSize)
+        {
+            length = config.chunkSize;
+        }
+        if (!HOST_IO_SendFrame(connection, FRAME_TYPE_DATA, position, SERVER_IMAGE_SIZE,
+                               &(image[position]), length))
+        {
+            return false;
+        }
+        stats.bytesServed += length;
+
+        frame_t ack;
+        if ((HOST_IO_ReceiveFrame(connection, &ack, SERVER_IDLE_TIMEOUT_MS) != HOST_RECEIVE_OK) ||
+            (ack.type != FRAME_TYPE_ACK) || (ack.offset != position + length))
+        {
+            return false;
+        }
+        position += length;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Serve the table image, resuming from the offset of the request if possible.
+ * @param connection The connection of the module.
+ * @param frame The received memory request.
+ * @return True if the transfer finished, false otherwise.
+ */
+static bool SERVER_HandleNewMemory(host_connection_t *connection, const frame_t *frame)
+{
+    if (frame->length != 2 * SHA256_SIZE)
+    {
+        return false;
+    }
+
+    if (memcmp(frame->payload, imageHash, SHA256_SIZE) == 0)
+    {
+        stats.notModified++;
+        return HOST_IO_SendFrame(connection, FRAME_TYPE_NOT_MODIFIED, 0, 0, nullptr, 0);
+    }
+
+    uint16_t position = 0;
+    if ((frame->offset > 0) && (frame->offset < SERVER_IMAGE_SIZE) &&
+        (memcmp(&(frame->payload[SHA256_SIZE]), imageHash, SHA256_SIZE) == 0))
+    {
+        position = frame->offset;
+        stats.resumed++;
+    }
+
+    if (!HOST_IO_SendFrame(connection, FRAME_TYPE_IMAGE_INFO, position, SERVER_IMAGE_SIZE,
+                           imageHash, SHA256_SIZE) ||
+        !SERVER_SendRange(connection, position, SERVER_IMAGE_SIZE))
+    {
+        return false;
+    }
+    stats.downloads++;
+
+    return true;
+}
+
+/**
+ * @brief Serve a range of the table image missing from the broadcast.
+ * @param connection The connection of the module.
+ * @param frame The received range request.
+ * @return True if the transfer finished, false otherwise.
+ */
+static bool SERVER_HandleRange(host_connection_t *connection, const frame_t *frame)
+{
+    if ((frame->length != SHA256_SIZE) || (frame->total == 0) ||
+        (frame->offset + frame->total > SERVER_IMAGE_SIZE) ||
+        (memcmp(frame->payload, imageHash, SHA256_SIZE) != 0))
+    {
+        // The module has chunks of another image, it has to start over
+        return HOST_IO_SendFrame(connection, FRAME_TYPE_IMAGE_INFO, 0, SERVER_IMAGE_SIZE,
+                                 imageHash, SHA256_SIZE);
+    }
+
+    stats.ranges++;
+    return SERVER_SendRange(connection, frame->offset, frame->offset + frame->total);
+}
+
+/**
+ * @brief Answer with the current time and the sync slot of the module.
+ * @param connection The connection of the module.
+ * @param chipId The chip ID of the module.
+ * @return True if the answer was sent, false otherwise.
+ */
+static bool SERVER_HandleTime(host_connection_t *connection, uint32_t chipId)
+{
+    uint8_t payload[6];
+    BYTEORDER_WriteUint32Be(payload, (uint32_t)time(nullptr));
+    if (config.slotLength == 0)
+    {
+        return HOST_IO_SendFrame(connection, FRAME_TYPE_TIME, 0, 0, payload, 4);
+    }
+
+    uint16_t slot;
+    {
+        // Assign the slots in the order the modules first asked for the time
+        std::lock_guard<std::mutex> lock(modulesMutex);
+        auto it = assignedSlot.find(chipId);
+        if (it == assignedSlot.end())
+        {
+            uint32_t index = (uint32_t)assignedSlot.size();
+            slot = (uint16_t)((index * config.slotLength) % 3600);
+            assignedSlot[chipId] = slot;
+        }
+        else
+        {
+            slot = it->second;
+        }
+    }
+    SERVER_WriteUint16(&(payload[4]), slot);
+
+    return HOST_IO_SendFrame(connection, FRAME_TYPE_TIME, 0, 0, payload, sizeof(payload));
+}
+
+/**
+ * @brief Revoke the next card of the table image.
+ * @return True if a card was revoked, false if every card is revoked already.
+ */
+static bool SERVER_RevokeNext(void)
+{
+    uint16_t header_size = (uint16_t)((image[0] << 8) | image[1]);
+    uint16_t length = (uint16_t)((image[2] << 8) | image[3]);
+    uint16_t base = (uint16_t)((image[4] << 8) | image[5]);
+    uint16_t record_size = SERVER_AUTHENTICATE_SIZE;
+    if (header_size >= 54)
+    {
+        record_size = (uint16_t)((image[52] << 8) | image[53]);
+    }
+
+    std::lock_guard<std::mutex> lock(modulesMutex);
+    uint32_t index = (uint32_t)revocations.size();
+    uint32_t address = base + index * record_size;
+    if ((record_size == 0) || ((index + 1) * record_size > length) ||
+        (address + SERVER_UID_SIZE > SERVER_IMAGE_SIZE))
+    {
+        return false;
+    }
+    revocations.emplace_back(&(image[address]), &(image[address + SERVER_UID_SIZE]));
+
+    return true;
+}
+
+/**
+ * @brief Answer a revocation probe with the cards revoked after the version of the module.
+ * @param connection The connection of the module.
+ * @param chipId The chip ID of the module.
+ * @param frame The received probe.
+ * @return True if the answer was sent, false otherwise.
+ *
+ * @details The answer is signed with the chip ID and the nonce of the probe. A module ahead of
+ * the server gets the revocations from version 0, as after a restart of the numbering.
+ */
+static bool SERVER_HandleRevocation(host_connection_t *connection, uint32_t chipId,
+                                    const frame_t *frame)
+{
+    if (frame->length != 8)
+    {
+        return false;
+    }
+    uint32_t base = BYTEORDER_ReadUint32Be(frame->payload);
+
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    uint32_t count;
+    uint32_t left;
+    {
+        std::lock_guard<std::mutex> lock(modulesMutex);
+        uint32_t version = (uint32_t)revocations.size();
+        if (base > version)
+        {
+            base = 0;
+        }
+        count = std::min<uint32_t>(version - base, SERVER_REVOCATIONS_PER_FRAME);
+        left = version - base - count;
+        for (uint32_t i = 0; i < count; i++)
+        {
+            memcpy(&(payload[8 + i * SERVER_UID_SIZE]), revocations[base + i].data(),
+                   SERVER_UID_SIZE);
+        }
+    }
+    BYTEORDER_WriteUint32Be(payload, base);
+    BYTEORDER_WriteUint32Be(&(payload[4]), base + count);
+    uint16_t length = (uint16_t)(8 + count * SERVER_UID_SIZE);
+
+    uint8_t challenge[8];
+    BYTEORDER_WriteUint32Be(challenge, chipId);
+    memcpy(&(challenge[4]), &(frame->payload[4]), 4);
+    sha256_hmac_context_t context;
+    SHA256_HmacInit(&context, (const uint8_t *)config.revocationKey,
+                    (uint16_t)strlen(config.revocationKey));
+    SHA256_HmacUpdate(&context, challenge, sizeof(challenge));
+    SHA256_HmacUpdate(&context, payload, length);
+    SHA256_HmacFinal(&context, &(payload[length]));
+    length += SHA256_SIZE;
+
+    stats.probes++;
+    stats.revocationsSent += count;
+    return HOST_IO_SendFrame(connection, FRAME_TYPE_REVOCATION, 0, (uint16_t)left, payload,
+                             length);
+}
+
+/**
+ * @brief Fill a buffer with random bytes of the operating system.
+ * @param buffer The buffer to fill.
+ * @param length The length of the buffer.
+ */
+static void SERVER_Random(uint8_t *buffer, uint16_t length)
+{
+    std::random_device device;
+    for (uint16_t i = 0; i < length; i += 4)
+    {
+        uint8_t bytes[4];
+        BYTEORDER_WriteUint32Be(bytes, (uint32_t)device());
+        memcpy(&(buffer[i]), bytes, std::min<uint16_t>(4, length - i));
+    }
+}
+
+/**
+ * @brief Answer the handshake of a module and secure the connection.
+ * @param connection The connection of the module.
+ * @param frame The received handshake, its offset is the mode.
+ * @param chipId Pointer to store the authenticated chip ID of the module in.
+ * @return True if the answer was sent, false otherwise.
+ *
+ * @details A refused ticket is answered with an empty handshake frame, the module continues with a
+ * full handshake on the same connection.
+ */
+static bool SERVER_HandleKey(host_connection_t *connection, const frame_t *frame,
+                             uint32_t *chipId)
+{
+    uint8_t random[SECURE_SERVER_RANDOM_SIZE];
+    SERVER_Random(random, sizeof(random));
+
+    uint8_t reply[SECURE_REPLY_FULL_SIZE];
+    uint16_t reply_length = 0;
+    secure_handshake_result_t result =
+        SECURE_ServerAccept(&secureServer, (uint8_t)frame->offset, frame->payload, frame->length,
+                            random, (uint32_t)time(nullptr), reply, &reply_length,
+                            &(connection->session), chipId);
+    if (result == SECURE_HANDSHAKE_FAILED)
+    {
+        return false;
+    }
+    if (result == SECURE_HANDSHAKE_RETRY)
+    {
+        stats.ticketsRefused++;
+        return HOST_IO_SendFrame(connection, FRAME_TYPE_KEY, frame->offset, 0, nullptr, 0);
+    }
+
+    if (frame->offset == SECURE_MODE_RESUME)
+    {
+        stats.resumptions++;
+    }
+    else
+    {
+        stats.handshakes++;
+    }
+    if (!HOST_IO_SendFrame(connection, FRAME_TYPE_KEY, frame->offset, 0, reply, reply_length))
+    {
+        return false;
+    }
+    connection->secure = true;
+
+    return true;
+}
+
+/**
+ * @brief Answer the introduction of a module, with its door if the image is shared.
+ * @param connection The connection of the module.
+ * @param chipId The chip ID of the module.
+ * @return True if the answer was sent, false otherwise.
+ */
+static bool SERVER_HandleHello(host_connection_t *connection, uint32_t chipId)
+{
+    if (config.doors == 0)
+    {
+        return HOST_IO_SendFrame(connection, FRAME_TYPE_HELLO, 0, 0, nullptr, 0);
+    }
+
+    uint8_t door;
+    {
+        // Assign the doors in the order the modules first connected
+        std::lock_guard<std::mutex> lock(modulesMutex);
+        auto it = assignedDoor.find(chipId);
+        if (it == assignedDoor.end())
+        {
+            door = (uint8_t)(assignedDoor.size() % config.doors);
+            assignedDoor[chipId] = door;
+        }
+        else
+        {
+            door = it->second;
+        }
+    }
+
+    return HOST_IO_SendFrame(connection, FRAME_TYPE_HELLO, 0, 0, &door, 1);
+}
+
+/**
+ * @brief Serve a connection of a remote module until it is closed.
+ * @param fd The socket of the connection.
+ */
+static void SERVER_Session(int fd)
+{
+    host_connection_t connection;
+    HOST_IO_Init(&connection, fd);
+    stats.connections++;
+
+    frame_t frame;
+    uint32_t chip_id = 0;
+    uint32_t authenticated_chip_id = 0;
+    bool introduced = false;
+    bool ok = true;
+
+    while (ok)
+    {
+        host_receive_result_t result = HOST_IO_ReceiveFrame(&connection, &frame,
+                                                            SERVER_IDLE_TIMEOUT_MS);
+        if (result != HOST_RECEIVE_OK)
+        {
+            ok = (result == HOST_RECEIVE_CLOSED);
+            break;
+        }
+
+        if (!introduced && (frame.type != FRAME_TYPE_HELLO) && (frame.type != FRAME_TYPE_KEY))
+        {
+            ok = false;
+            break;
+        }
+
+        switch (frame.type)
+        {
+        case FRAME_TYPE_KEY:
+            // The handshake can only be the first exchange of the connection
+            ok = !introduced && !connection.secure &&
+                 SERVER_HandleKey(&connection, &frame, &authenticated_chip_id);
+            break;
+        case FRAME_TYPE_HELLO:
+            if ((frame.length != 4) || (config.secureOnly && !connection.secure))
+            {
+                ok = false;
+                break;
+            }
+            chip_id = BYTEORDER_ReadUint32Be(frame.payload);
+            if (connection.secure && (chip_id != authenticated_chip_id))
+            {
+                // A module can only introduce itself with the chip ID of its key
+                ok = false;
+                break;
+            }
+            introduced = true;
+            ok = SERVER_HandleHello(&connection, chip_id);
+            break;
+        case FRAME_TYPE_LOG:
+            ok = SERVER_HandleLog(&connection, chip_id, &frame);
+            break;
+        case FRAME_TYPE_NEW_MEMORY:
+            ok = SERVER_HandleNewMemory(&connection, &frame);
+            break;
+        case FRAME_TYPE_RANGE:
+            ok = SERVER_HandleRange(&connection, &frame);
+            break;
+        case FRAME_TYPE_TIME:
+            ok = SERVER_HandleTime(&connection, chip_id);
+            break;
+        case FRAME_TYPE_REVOCATION:
+            ok = SERVER_HandleRevocation(&connection, chip_id, &frame);
+            break;
+        default:
+            ok = false;
+            break;
+        }
+    }
+
+    if (!ok)
+    {
+        stats.protocolErrors++;
+    }
+    if (config.verbose)
+    {
+        printf("session %08x: %s%s, %llu bytes out, %llu bytes in\n", chip_id, ok ? "ok" : "error",
+               connection.secure ? " (secure)" : "", (unsigned long long)connection.bytesSent,
+               (unsigned long long)connection.bytesReceived);
+    }
+    HOST_IO_Close(&connection);
+}
+
+/**
+ * @brief Broadcast the table image repeatedly until the server stops.
+ *
+ * @details Every round starts with the image info, followed by the chunks of #FRAME_MAX_PAYLOAD
+ * bytes. A module that joins in the middle of a round collects the rest in the next one, or
+ * downloads the missing ranges over its connection.
+ */
+static void SERVER_Broadcast(void)
+{
+    int fd = HOST_IO_MulticastSender(config.multicastInterface);
+    if (fd < 0)
+    {
+        perror("multicast socket");
+        return;
+    }
+
+    while (!stopRequested)
+    {
+        HOST_IO_SendDatagramFrame(fd, config.multicastGroup, config.multicastPort,
+                                  FRAME_TYPE_IMAGE_INFO, 0, SERVER_IMAGE_SIZE, imageHash,
+                                  SHA256_SIZE);
+        for (uint16_t position = 0; (position < SERVER_IMAGE_SIZE) && !stopRequested;
+             position += FRAME_MAX_PAYLOAD)
+        {
+            usleep(config.multicastGapMs * 1000);
+            uint16_t length = SERVER_IMAGE_SIZE - position;
+            if (length > FRAME_MAX_PAYLOAD)
+            {
+                length = FRAME_MAX_PAYLOAD;
+            }
+            if (HOST_IO_SendDatagramFrame(fd, config.multicastGroup, config.multicastPort,
+                                          FRAME_TYPE_DATA, position, SERVER_IMAGE_SIZE,
+                                          &(image[position]), length))
+            {
+                stats.broadcastBytes += length;
+            }
+        }
+    }
+
+    close(fd);
+}
+
+/**
+ * @brief Revoke another card every #server_config_t::revokeEveryS seconds until the server stops.
+ */
+static void SERVER_Revoke(void)
+{
+    while (!stopRequested)
+    {
+        for (uint32_t i = 0; (i < config.revokeEveryS * 10) && !stopRequested; i++)
+        {
+            usleep(100000);
+        }
+        if (!stopRequested && !SERVER_RevokeNext())
+        {
+            return;
+        }
+    }
+}
+
+/**
+ * @brief Print the counters of the server.
+ */
+static void SERVER_PrintStats(void)
+{
+    printf("connections %llu, log records %llu, not modified %llu, downloads %llu (resumed %llu), "
+           "image bytes %llu, ranges %llu, broadcast bytes %llu, probes %llu (revocations %llu), "
+           "handshakes %llu, resumptions %llu (tickets refused %llu), protocol errors %llu\n",
+           (unsigned long long)stats.connections.load(),
+           (unsigned long long)stats.logRecords.load(),
+           (unsigned long long)stats.notModified.load(),
+           (unsigned long long)stats.downloads.load(),
+           (unsigned long long)stats.resumed.load(),
+           (unsigned long long)stats.bytesServed.load(),
+           (unsigned long long)stats.ranges.load(),
+           (unsigned long long)stats.broadcastBytes.load(),
+           (unsigned long long)stats.probes.load(),
+           (unsigned long long)stats.revocationsSent.load(),
+           (unsigned long long)stats.handshakes.load(),
+           (unsigned long long)stats.resumptions.load(),
+           (unsigned long long)stats.ticketsRefused.load(),
+           (unsigned long long)stats.protocolErrors.load());
+    fflush(stdout);
+}
+
+/**
+ * @brief Request the server to stop.
+ * @param signal The received signal.
+ */
+static void SERVER_Stop(int signal)
+{
+    (void)signal;
+    stopRequested = 1;
+}
+
+/**
+ * @brief Print the usage of the server.
+ * @param name The name of the program.
+ */
+static void SERVER_Usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [--port N] [--records N | --image FILE] [--doors N] [--chunk N]\n"
+            "          [--slot-length S] [--multicast GROUP] [--multicast-port N]\n"
+            "          [--multicast-if ADDR] [--multicast-gap MS] [--revoked N]\n"
+            "          [--revoke-every S] [--revocation-key KEY] [--site-key KEY]\n"
+            "          [--ticket-lifetime S] [--secure-only] [--verbose]\n",
+            name);
+}
+
+int main(int argc, char **argv)
+{
+    uint16_t records = 100;
+    const char *image_path = nullptr;
+    uint32_t revoked = 0;
+
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+        if ((strcmp(argv[i], "--port") == 0) && has_value)
+        {
+            config.port = (uint16_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--records") == 0) && has_value)
+        {
+            records = (uint16_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--image") == 0) && has_value)
+        {
+            image_path = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--doors") == 0) && has_value)
+        {
+            int doors = atoi(argv[++i]);
+            config.doors = (uint8_t)((doors > 32) ? 32 : doors);
+        }
+        else if ((strcmp(argv[i], "--chunk") == 0) && has_value)
+        {
+            config.chunkSize = (uint16_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--slot-length") == 0) && has_value)
+        {
+            config.slotLength = (uint16_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--multicast") == 0) && has_value)
+        {
+            config.multicastGroup = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--multicast-port") == 0) && has_value)
+        {
+            config.multicastPort = (uint16_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--multicast-if") == 0) && has_value)
+        {
+            config.multicastInterface = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--multicast-gap") == 0) && has_value)
+        {
+            config.multicastGapMs = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--revoked") == 0) && has_value)
+        {
+            revoked = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--revoke-every") == 0) && has_value)
+        {
+            config.revokeEveryS = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--revocation-key") == 0) && has_value)
+        {
+            config.revocationKey = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--site-key") == 0) && has_value)
+        {
+            config.siteKey = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--ticket-lifetime") == 0) && has_value)
+        {
+            config.ticketLifetime = (uint32_t)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--secure-only") == 0)
+        {
+            config.secureOnly = true;
+        }
+        else if (strcmp(argv[i], "--verbose") == 0)
+        {
+            config.verbose = true;
+        }
+        else
+        {
+            SERVER_Usage(argv[0]);
+            return 1;
+        }
+    }
+    if ((config.chunkSize == 0) || (config.chunkSize > FRAME_MAX_PAYLOAD))
+    {
+        config.chunkSize = FRAME_MAX_PAYLOAD;
+    }
+    if (strlen(config.siteKey) != SECURE_KEY_SIZE)
+    {
+        fprintf(stderr, "the site key must be %u characters\n", SECURE_KEY_SIZE);
+        return 1;
+    }
+    memcpy(secureServer.siteKey, config.siteKey, SECURE_KEY_SIZE);
+    SERVER_Random(secureServer.ticketKey, SECURE_KEY_SIZE);
+    secureServer.ticketLifetime = config.ticketLifetime;
+
+    if (image_path != nullptr)
+    {
+        if (!SERVER_LoadImage(image_path))
+        {
+            return 1;
+        }
+    }
+    else
+    {
+        SERVER_BuildImage(records);
+    }
+    sha256_context_t context;
+    SHA256_Init(&context);
+    SHA256_Update(&context, image, SERVER_IMAGE_SIZE);
+    SHA256_Final(&context, imageHash);
+    while ((revoked > 0) && SERVER_RevokeNext())
+    {
+        revoked--;
+    }
+
+    int listen_fd = HOST_IO_Listen(config.port);
+    if (listen_fd < 0)
+    {
+        return 1;
+    }
+
+    struct sigaction action;
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = SERVER_Stop;
+    sigaction(SIGINT, &action, nullptr);
+    sigaction(SIGTERM, &action, nullptr);
+
+    printf("listening on port %u, image hash %02x%02x%02x%02x...\n", config.port, imageHash[0],
+           imageHash[1], imageHash[2], imageHash[3]);
+    fflush(stdout);
+
+    std::thread broadcast;
+    if (config.multicastGroup != nullptr)
+    {
+        broadcast = std::thread(SERVER_Broadcast);
+    }
+    std::thread revoke;
+    if (config.revokeEveryS > 0)
+    {
+        revoke = std::thread(SERVER_Revoke);
+    }
+
+    while (!stopRequested)
+    {
+        int fd = accept(listen_fd, nullptr, nullptr);
+        if (fd < 0)
+        {
+            continue;
+        }
+        std::thread(SERVER_Session, fd).detach();
+    }
+
+    close(listen_fd);
+    if (broadcast.joinable())
+    {
+        broadcast.join();
+    }
+    if (revoke.joinable())
+    {
+        revoke.join();
+    }
+    SERVER_PrintStats();
+
+    return 0;
+}
@@ -0,0 +1,388 @@
+/**
+ ***************************************************************************************************
+ * @file host_io.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Implementation of host_io.h.
+ ***************************************************************************************************
+ */
+
+#include "host_io.h"
+
+#include <arpa/inet.h>
+#include <netdb.h>
+#include <netinet/in.h>
+#include <netinet/tcp.h>
+#include <poll.h>
+#include <string.h>
+#include <sys/socket.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <cstdio>
+
+/**
+ * @brief Initialize a connection on an open socket.
+ * @param connection The connection to initialize.
+ * @param fd The socket of the connection.
+ */
+void HOST_IO_Init(host_connection_t *connection, int fd)
+{
+    connection->fd = fd;
+    FRAME_ParserReset(&(connection->parser));
+    connection->bufferLength = 0;
+    connection->bufferPosition = 0;
+    connection->bytesSent = 0;
+    connection->bytesReceived = 0;
+    connection->secure = false;
+
+    // The remote module sends its frames without delay too
+    int flag = 1;
+    setsockopt(fd, IPPROTO_TCP, TCP_NODELAY, &flag, sizeof(flag));
+}
+
+/**
+ * @brief Close a connection.
+ * @param connection The connection to close.
+ */
+void HOST_IO_Close(host_connection_t *connection)
+{
+    if (connection->fd >= 0)
+    {
+        close(connection->fd);
+        connection->fd = -1;
+    }
+}
+
+/**
+ * @brief Open a listening socket on every interface.
+ * @param port The port to listen on.
+ * @return The listening socket, -1 on error.
+ */
+int HOST_IO_Listen(uint16_t port)
+{
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        perror("socket");
+        return -1;
+    }
+
+    int flag = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+
+    if ((bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0) || (listen(fd, 1024) < 0))
+    {
+        perror("bind/listen");
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ * @brief Connect to a server.
+ * @param host The address of the server.
+ * @param port The port of the server.
+ * @return The connected socket, -1 on error.
+ */
+int HOST_IO_Connect(const char *host, uint16_t port)
+{
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    if (inet_pton(AF_INET, host, &(address.sin_addr)) != 1)
+    {
+        return -1;
+    }
+
+    int fd = socket(AF_INET, SOCK_STREAM, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+    if (connect(fd, (struct sockaddr *)&address, sizeof(address)) < 0)
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ * @brief Send a frame, sealed if the connection is secure.
+ * @param connection The connection to send on.
+ * @param type The type of the frame.
+ * @param offset The offset of the payload in the transferred data.
+ * @param total The total size of the transferred data.
+ * @param payload The payload of the frame.
+ * @param length The length of the payload.
+ * @return True if the whole frame was sent, false otherwise.
+ */
+bool HOST_IO_SendFrame(host_connection_t *connection, uint8_t type, uint16_t offset,
+                       uint16_t total, const uint8_t *payload, uint16_t length)
+{
+    uint8_t sealed[FRAME_MAX_WIRE_PAYLOAD];
+    if (connection->secure)
+    {
+        if (length > FRAME_MAX_PAYLOAD)
+        {
+            return false;
+        }
+        if (length > 0)
+        {
+            memcpy(sealed, payload, length);
+        }
+        type |= FRAME_TYPE_SEALED;
+        length = SECURE_Seal(&(connection->session), type, offset, total, sealed, length);
+        payload = sealed;
+    }
+
+    uint8_t buffer[FRAME_MAX_SIZE];
+    uint16_t size = FRAME_Encode(buffer, type, offset, total, payload, length);
+    if (size == 0)
+    {
+        return false;
+    }
+
+    uint16_t sent = 0;
+    while (sent < size)
+    {
+        ssize_t result = send(connection->fd, &(buffer[sent]), size - sent, MSG_NOSIGNAL);
+        if (result <= 0)
+        {
+            return false;
+        }
+        sent += (uint16_t)result;
+    }
+    connection->bytesSent += size;
+
+    return true;
+}
+
+/**
+ * @brief Receive a frame, opened if the connection is secure.
+ * @param connection The connection to receive on.
+ * @param frame The frame to decode into.
+ * @param timeoutMs The maximum time to wait for the whole frame, in milliseconds.
+ * @return The result of the reception, see #host_receive_result_t.
+ */
+host_receive_result_t HOST_IO_ReceiveFrame(host_connection_t *connection, frame_t *frame,
+                                           int timeoutMs)
+{
+    uint64_t deadline = HOST_IO_MonotonicMicros() + (uint64_t)timeoutMs * 1000;
+
+    for (;;)
+    {
+        while (connection->bufferPosition < connection->bufferLength)
+        {
+            uint8_t byte = connection->buffer[connection->bufferPosition++];
+            frame_parse_result_t result = FRAME_ParserFeed(&(connection->parser), frame, byte);
+            if (result == FRAME_PARSE_COMPLETE)
+            {
+                // A plain frame on a secure connection is refused like a corrupted one
+                if (connection->secure && !SECURE_Open(&(connection->session), frame))
+                {
+                    return HOST_RECEIVE_ERROR;
+                }
+                return HOST_RECEIVE_OK;
+            }
+            if (result == FRAME_PARSE_ERROR)
+            {
+                return HOST_RECEIVE_ERROR;
+            }
+        }
+
+        uint64_t now = HOST_IO_MonotonicMicros();
+        if (now >= deadline)
+        {
+            return HOST_RECEIVE_TIMEOUT;
+        }
+
+        struct pollfd descriptor = {connection->fd, POLLIN, 0};
+        int ready = poll(&descriptor, 1, (int)((deadline - now + 999) / 1000));
+        if (ready < 0)
+        {
+            return HOST_RECEIVE_ERROR;
+        }
+        if (ready == 0)
+        {
+            return HOST_RECEIVE_TIMEOUT;
+        }
+
+        ssize_t length = recv(connection->fd, connection->buffer, sizeof(connection->buffer), 0);
+        if (length == 0)
+        {
+            return HOST_RECEIVE_CLOSED;
+        }
+        if (length < 0)
+        {
+            return HOST_RECEIVE_ERROR;
+        }
+        connection->bufferLength = (uint16_t)length;
+        connection->bufferPosition = 0;
+        connection->bytesReceived += (uint64_t)length;
+    }
+}
+
+/**
+ * @brief Open a socket for sending multicast datagrams.
+ * @param interfaceAddress The address of the interface to send on.
+ * @return The socket, -1 on error.
+ */
+int HOST_IO_MulticastSender(const char *interfaceAddress)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    struct in_addr interface_address;
+    inet_pton(AF_INET, interfaceAddress, &interface_address);
+    unsigned char loop = 1;
+    unsigned char ttl = 1;
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_IF, &interface_address, sizeof(interface_address));
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_LOOP, &loop, sizeof(loop));
+    setsockopt(fd, IPPROTO_IP, IP_MULTICAST_TTL, &ttl, sizeof(ttl));
+
+    return fd;
+}
+
+/**
+ * @brief Open a socket receiving the datagrams of a multicast group.
+ * @param group The address of the multicast group.
+ * @param port The port of the multicast group.
+ * @param interfaceAddress The address of the interface to join the group on.
+ * @return The socket, -1 on error.
+ * @note Several sockets can receive the same group, every socket gets every datagram.
+ */
+int HOST_IO_MulticastReceiver(const char *group, uint16_t port, const char *interfaceAddress)
+{
+    int fd = socket(AF_INET, SOCK_DGRAM, 0);
+    if (fd < 0)
+    {
+        return -1;
+    }
+
+    int flag = 1;
+    setsockopt(fd, SOL_SOCKET, SO_REUSEADDR, &flag, sizeof(flag));
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_addr.s_addr = htonl(INADDR_ANY);
+    address.sin_port = htons(port);
+
+    struct ip_mreq membership;
+    inet_pton(AF_INET, group, &(membership.imr_multiaddr));
+    inet_pton(AF_INET, interfaceAddress, &(membership.imr_interface));
+
+    if ((bind(fd, (struct sockaddr *)&address, sizeof(address)) < 0) ||
+        (setsockopt(fd, IPPROTO_IP, IP_ADD_MEMBERSHIP, &membership, sizeof(membership)) < 0))
+    {
+        close(fd);
+        return -1;
+    }
+
+    return fd;
+}
+
+/**
+ * @brief Send a frame as one datagram to a multicast group.
+ * @param fd The socket to send on.
+ * @param group The address of the multicast group.
+ * @param port The port of the multicast group.
+ * @param type The type of the frame.
+ * @param offset The offset of the payload in the transferred data.
+ * @param total The total size of the transferred data.
+ * @param payload The payload of the frame.
+ * @param length The length of the payload.
+ * @return True if the datagram was sent, false otherwise.
+ */
+bool HOST_IO_SendDatagramFrame(int fd, const char *group, uint16_t port, uint8_t type,
+                               uint16_t offset, uint16_t total, const uint8_t *payload,
+                               uint16_t length)
+{
+    uint8_t buffer[FRAME_MAX_SIZE];
+    uint16_t size = FRAME_Encode(buffer, type, offset, total, payload, length);
+    if (size == 0)
+    {
+        return false;
+    }
+
+    struct sockaddr_in address;
+    memset(&address, 0, sizeof(address));
+    address.sin_family = AF_INET;
+    address.sin_port = htons(port);
+    inet_pton(AF_INET, group, &(address.sin_addr));
+
+    return sendto(fd, buffer, size, 0, (struct sockaddr *)&address, sizeof(address)) == size;
+}
+
+/**
+ * @brief Receive a frame sent as one datagram.
+ * @param fd The socket to receive on.
+ * @param frame The frame to decode into.
+ * @param timeoutMs The maximum time to wait for a datagram, in milliseconds.
+ * @return #HOST_RECEIVE_OK if a valid frame was received, #HOST_RECEIVE_TIMEOUT if no datagram was
+ * received, #HOST_RECEIVE_ERROR if the datagram is not a valid frame.
+ */
+host_receive_result_t HOST_IO_ReceiveDatagramFrame(int fd, frame_t *frame, int timeoutMs)
+{
+    struct pollfd descriptor = {fd, POLLIN, 0};
+    int ready = poll(&descriptor, 1, timeoutMs);
+    if (ready < 0)
+    {
+        return HOST_RECEIVE_ERROR;
+    }
+    if (ready == 0)
+    {
+        return HOST_RECEIVE_TIMEOUT;
+    }
+
+    uint8_t buffer[FRAME_MAX_SIZE];
+    ssize_t length = recv(fd, buffer, sizeof(buffer), 0);
+    if (length <= 0)
+    {
+        return HOST_RECEIVE_ERROR;
+    }
+
+    frame_parser_t parser;
+    FRAME_ParserReset(&parser);
+    for (ssize_t i = 0; i < length; i++)
+    {
+        frame_parse_result_t result = FRAME_ParserFeed(&parser, frame, buffer[i]);
+        if (result == FRAME_PARSE_COMPLETE)
+        {
+            return HOST_RECEIVE_OK;
+        }
+        if (result == FRAME_PARSE_ERROR)
+        {
+            break;
+        }
+    }
+
+    return HOST_RECEIVE_ERROR;
+}
+
+/**
+ * @brief Get the time of a monotonic clock.
+ * @return The time in microseconds.
+ */
+uint64_t HOST_IO_MonotonicMicros(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (uint64_t)now.tv_sec * 1000000 + (uint64_t)now.tv_nsec / 1000;
+}
@@ -0,0 +1,73 @@
+/**
+ ***************************************************************************************************
+ * @file host_io.h
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Header file for the frame transfer over POSIX sockets, shared by the host tools.
+ ***************************************************************************************************
+ */
+
+#ifndef HOST_IO_H
+#define HOST_IO_H
+
+#include <stdint.h>
+
+#include "byteorder.h"
+#include "frame.h"
+#include "secure.h"
+
+/**
+ * @brief A connection that sends and receives frames.
+ */
+typedef struct _host_connection_t
+{
+    int fd;                    /**< The socket of the connection. */
+    frame_parser_t parser;     /**< The frame decoder of the received bytes. */
+    uint8_t buffer[512];       /**< The received bytes not decoded yet. */
+    uint16_t bufferLength;     /**< The number of bytes in the buffer. */
+    uint16_t bufferPosition;   /**< The position of the next byte to decode in the buffer. */
+    uint64_t bytesSent;        /**< The number of bytes sent over the connection. */
+    uint64_t bytesReceived;    /**< The number of bytes received over the connection. */
+    bool secure;               /**< True if the frames are sealed with the session. */
+    secure_session_t session;  /**< The keys of the secure channel. */
+} host_connection_t;
+
+/**
+ * @brief The result of receiving a frame.
+ */
+typedef enum _host_receive_result_t
+{
+    HOST_RECEIVE_OK,      /**< A valid frame was received. */
+    HOST_RECEIVE_TIMEOUT, /**< No frame was received in time. */
+    HOST_RECEIVE_CLOSED,  /**< The connection was closed by the peer. */
+    HOST_RECEIVE_ERROR    /**< A corrupted frame was received, or the socket failed. */
+} host_receive_result_t;
+
+void HOST_IO_Init(host_connection_t *connection, int fd);
+
+void HOST_IO_Close(host_connection_t *connection);
+
+int HOST_IO_Listen(uint16_t port);
+
+int HOST_IO_Connect(const char *host, uint16_t port);
+
+bool HOST_IO_SendFrame(host_connection_t *connection, uint8_t type, uint16_t offset,
+                       uint16_t total, const uint8_t *payload, uint16_t length);
+
+host_receive_result_t HOST_IO_ReceiveFrame(host_connection_t *connection, frame_t *frame,
+                                           int timeoutMs);
+
+int HOST_IO_MulticastSender(const char *interfaceAddress);
+
+int HOST_IO_MulticastReceiver(const char *group, uint16_t port, const char *interfaceAddress);
+
+bool HOST_IO_SendDatagramFrame(int fd, const char *group, uint16_t port, uint8_t type,
+                               uint16_t offset, uint16_t total, const uint8_t *payload,
+                               uint16_t length);
+
+host_receive_result_t HOST_IO_ReceiveDatagramFrame(int fd, frame_t *frame, int timeoutMs);
+
+uint64_t HOST_IO_MonotonicMicros(void);
+
+#endif /* HOST_IO_H */
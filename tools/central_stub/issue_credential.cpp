@@ -0,0 +1,182 @@
+/**
+ ***************************************************************************************************
+ * @file issue_credential.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Signs a credential (credential.h) for a card, as the central module would.
+ *
+ * Prints the credential as hexadecimal bytes, to be written to the credential blocks of the card
+ * (RFID_CREDENTIAL_BLOCK of rfid.h), and verifies it the way the remote module does.
+ ***************************************************************************************************
+ */
+
+#include <string.h>
+#include <time.h>
+
+#include <cstdio>
+#include <cstdlib>
+
+#include "credential.h"
+
+/**
+ * @defgroup issue_constants Issuer constants
+ * @{
+ */
+/** @brief The default keys, the CREDENTIAL_KEY_0 and CREDENTIAL_KEY_1 of the remote module. */
+#define ISSUE_KEY_0 "belepteto_rendszer_credential_00"
+#define ISSUE_KEY_1 "belepteto_rendszer_credential_01"
+/** @} */
+
+/**
+ * @brief Parse the UID of a card, right aligned to #CREDENTIAL_UID_SIZE bytes like RFID_ReadTag().
+ * @param text The UID as hexadecimal bytes.
+ * @param uid Buffer of #CREDENTIAL_UID_SIZE bytes.
+ * @return True if the UID is valid, false otherwise.
+ */
+static bool ISSUE_ParseUid(const char *text, uint8_t *uid)
+{
+    size_t length = strlen(text);
+    if ((length == 0) || (length % 2 != 0) || (length / 2 > CREDENTIAL_UID_SIZE))
+    {
+        return false;
+    }
+
+    memset(uid, 0, CREDENTIAL_UID_SIZE);
+    uint8_t *position = &(uid[CREDENTIAL_UID_SIZE - length / 2]);
+    for (size_t i = 0; i < length; i += 2)
+    {
+        char byte[3] = {text[i], text[i + 1], 0};
+        char *end;
+        *(position++) = (uint8_t)strtoul(byte, &end, 16);
+        if (*end != 0)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+/**
+ * @brief Parse a time of the day.
+ * @param text The time as HH:MM.
+ * @param hour Pointer to store the hour in.
+ * @param minute Pointer to store the minute in.
+ * @return True if the time is valid, false otherwise.
+ */
+static bool ISSUE_ParseTime(const char *text, uint8_t *hour, uint8_t *minute)
+{
+    unsigned int h;
+    unsigned int m;
+    if ((sscanf(text, "%u:%u", &h, &m) != 2) || (h > 23) || (m > 59))
+    {
+        return false;
+    }
+    *hour = (uint8_t)h;
+    *minute = (uint8_t)m;
+
+    return true;
+}
+
+/**
+ * @brief Print the usage of the issuer.
+ * @param name The name of the program.
+ */
+static void ISSUE_Usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s --uid HEX [--user N] [--doors MASK] [--from HH:MM] [--to HH:MM]\n"
+            "          [--days N | --expiry UNIX] [--key-index 0|1] [--key KEY] [--door N]\n",
+            name);
+}
+
+int main(int argc, char **argv)
+{
+    credential_t credential = {0, 0, 0xFFFFFFFF, 0, 0, 23, 59, 0};
+    uint8_t uid[CREDENTIAL_UID_SIZE];
+    bool has_uid = false;
+    uint32_t days = 365;
+    const char *key = nullptr;
+    uint8_t door = 0;
+    bool ok = true;
+
+    for (int i = 1; (i < argc) && ok; i++)
+    {
+        bool has_value = (i + 1 < argc);
+        if ((strcmp(argv[i], "--uid") == 0) && has_value)
+        {
+            ok = has_uid = ISSUE_ParseUid(argv[++i], uid);
+        }
+        else if ((strcmp(argv[i], "--user") == 0) && has_value)
+        {
+            credential.userId = (uint32_t)strtoul(argv[++i], nullptr, 0) & 0x00FFFFFF;
+        }
+        else if ((strcmp(argv[i], "--doors") == 0) && has_value)
+        {
+            credential.doors = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        }
+        else if ((strcmp(argv[i], "--from") == 0) && has_value)
+        {
+            ok = ISSUE_ParseTime(argv[++i], &(credential.beginHour), &(credential.beginMinute));
+        }
+        else if ((strcmp(argv[i], "--to") == 0) && has_value)
+        {
+            ok = ISSUE_ParseTime(argv[++i], &(credential.endHour), &(credential.endMinute));
+        }
+        else if ((strcmp(argv[i], "--days") == 0) && has_value)
+        {
+            days = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--expiry") == 0) && has_value)
+        {
+            credential.expiry = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        }
+        else if ((strcmp(argv[i], "--key-index") == 0) && has_value)
+        {
+            credential.keyIndex = (uint8_t)(atoi(argv[++i]) & 0x0F);
+        }
+        else if ((strcmp(argv[i], "--key") == 0) && has_value)
+        {
+            key = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--door") == 0) && has_value)
+        {
+            door = (uint8_t)atoi(argv[++i]);
+        }
+        else
+        {
+            ok = false;
+        }
+    }
+    if (!ok || !has_uid)
+    {
+        ISSUE_Usage(argv[0]);
+        return 1;
+    }
+    if (key == nullptr)
+    {
+        key = (credential.keyIndex == 0) ? ISSUE_KEY_0 : ISSUE_KEY_1;
+    }
+    uint32_t now = (uint32_t)time(nullptr);
+    if (credential.expiry == 0)
+    {
+        credential.expiry = now + days * 24 * 3600;
+    }
+
+    uint8_t data[CREDENTIAL_SIZE];
+    CREDENTIAL_Issue(&credential, (const uint8_t *)key, (uint16_t)strlen(key), uid, data);
+    for (uint8_t i = 0; i < CREDENTIAL_SIZE; i++)
+    {
+        printf("%02x%s", data[i], ((i + 1) % 16 == 0) ? "\n" : " ");
+    }
+
+    // Check it like the remote module on the given door, at the begin of the daily interval
+    uint32_t check_time = now - now % (24 * 3600) + credential.beginHour * 3600 +
+                          credential.beginMinute * 60;
+    credential_result_t result = CREDENTIAL_Verify(uid, data, door, check_time, nullptr);
+    static const char *const names[] = {"valid", "invalid", "expired", "not allowed"};
+    printf("verification on door %u: %s\n", door, names[result]);
+
+    return (result == CREDENTIAL_VALID) ? 0 : 2;
+}
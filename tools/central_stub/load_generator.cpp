@@ -0,0 +1,890 @@
+/**
+ ***************************************************************************************************
+ * @file load_generator.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Load generator simulating a fleet of remote modules syncing with the central module.
+ *
+ * Every simulated module runs on its own thread and performs the same frame sequence as the
+ * synchronization state machine of the remote module (sync.cpp): introduction, log upload with
+ * acknowledgement, resumable table download, revocation probe and time request, with reconnection
+ * and resume after a failed step, at most #LOAD_MAX_ATTEMPTS connections per synchronization.
+ *
+ * A lost frame is emulated by dropping the connection before sending it, as the remote module
+ * would run into its response timeout and reconnect.
+ *
+ * With a multicast group given, every full synchronization first listens to the broadcast of the
+ * table image and only downloads the missing ranges, like the remote module.
+ *
+ * With --secure every connection starts with the handshake of the secure channel (see secure.h),
+ * resumed with the ticket of the previous synchronization of the module unless --no-resume is
+ * given. The broadcast is not used then, like by the remote module.
+ ***************************************************************************************************
+ */
+
+#include <string.h>
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <mutex>
+#include <random>
+#include <thread>
+#include <vector>
+
+#include "host_io.h"
+#include "frame.h"
+#include "secure.h"
+#include "sha256.h"
+
+/**
+ * @defgroup load_constants Load generator constants
+ * @brief Constants matching the remote module.
+ * @{
+ */
+#define LOAD_MAX_ATTEMPTS 5
+#define LOAD_IMAGE_SIZE 4096
+#define LOAD_LOG_SIZE 15
+#define LOAD_LOGS_PER_FRAME ((FRAME_MAX_PAYLOAD - 4) / LOAD_LOG_SIZE)
+#define LOAD_CHUNK_SIZE FRAME_MAX_PAYLOAD
+#define LOAD_CHUNK_COUNT ((LOAD_IMAGE_SIZE + LOAD_CHUNK_SIZE - 1) / LOAD_CHUNK_SIZE)
+#define LOAD_CHUNKS_ALL ((uint32_t)((1ULL << LOAD_CHUNK_COUNT) - 1))
+#define LOAD_MULTICAST_LISTEN_MS 4000
+#define LOAD_MULTICAST_IDLE_MS 1000
+/** @brief The size of the versions and the MAC in a revocation answer. */
+#define LOAD_REVOCATION_OVERHEAD (8 + SHA256_SIZE)
+/** @brief The key the device keys are derived from, the SYNC_SITE_KEY of the remote module. */
+#define LOAD_SITE_KEY "belepteto_rendszer_site_key_0001"
+/** @} */
+
+/**
+ * @brief The configuration of the load generator.
+ */
+typedef struct _load_config_t
+{
+    const char *host;       /**< The address of the central module. */
+    uint16_t port;          /**< The port of the central module. */
+    uint32_t devices;       /**< The number of simulated modules. */
+    uint32_t syncs;         /**< The number of synchronizations per module. */
+    uint32_t logs;          /**< The number of new logs per synchronization. */
+    double loss;            /**< The probability of losing a frame sent by a module. */
+    uint32_t latencyMs;     /**< The delay before every frame sent by a module. */
+    uint32_t timeoutMs;     /**< The response timeout of the modules. */
+    uint32_t spreadMs;      /**< The start of the modules is spread randomly over this time. */
+    bool stallOnLoss;       /**< Wait for the response timeout after a lost frame. */
+    bool cached;            /**< Keep the table between the synchronizations of a module. */
+    uint32_t seed;          /**< The seed of the random generators. */
+    uint32_t chipBase;      /**< The chip ID of the first module. */
+    const char *multicastGroup;     /**< The group of the image broadcast, nullptr to disable. */
+    uint16_t multicastPort;         /**< The port of the multicast group. */
+    const char *multicastInterface; /**< The address of the interface to join the group on. */
+    double multicastLoss;           /**< The probability of losing a broadcast frame. */
+    bool secure;            /**< Secure every connection with a handshake. */
+    bool resume;            /**< Resume the sessions with the tickets. */
+    const char *siteKey;    /**< The key the device keys are derived from. */
+} load_config_t;
+
+/**
+ * @brief The state of a simulated module, kept between connections like in sync.cpp.
+ */
+typedef struct _load_module_t
+{
+    uint32_t chipId;
+    uint8_t tableHash[SHA256_SIZE];
+    uint32_t logSequence;
+    uint32_t logsPending;
+    uint32_t revocationVersion;
+    bool newMemoryStaged;
+    uint8_t newMemoryHash[SHA256_SIZE];
+    uint16_t newMemoryReceived;
+    uint32_t newMemoryChunks;
+    uint8_t newMemory[LOAD_IMAGE_SIZE];
+    host_connection_t connection;
+    secure_client_t secureClient;
+    std::mt19937 random;
+} load_module_t;
+
+/**
+ * @brief The measurements of the whole run.
+ */
+typedef struct _load_results_t
+{
+    std::mutex mutex;
+    std::vector<double> syncMs;      /**< The duration of the successful synchronizations. */
+    std::vector<double> roundTripMs; /**< The time between a request and the first answer. */
+    std::vector<double> handshakeMs; /**< The duration of the handshakes. */
+    uint64_t syncsSucceeded = 0;
+    uint64_t syncsFailed = 0;
+    uint64_t connections = 0;
+    uint64_t connectionsFailed = 0;
+    uint64_t framesLost = 0;
+    uint64_t bytesSent = 0;
+    uint64_t bytesReceived = 0;
+    uint64_t multicastChunks = 0;
+    uint64_t ranges = 0;
+    uint64_t revocations = 0;
+    uint64_t handshakes = 0;
+    uint64_t resumptions = 0;
+} load_results_t;
+
+static load_config_t config = {"127.0.0.1", 5000, 50, 1, 20, 0.0, 0, 5000, 0, false, false, 1,
+                                0x00A00000, nullptr, 5001, "127.0.0.1", 0.0, false, true,
+                                LOAD_SITE_KEY};
+static load_results_t results;
+
+/**
+ * @brief The measurements of one thread, merged into the results at the end.
+ */
+typedef struct _load_local_t
+{
+    std::vector<double> syncMs;
+    std::vector<double> roundTripMs;
+    std::vector<double> handshakeMs;
+    uint64_t syncsSucceeded = 0;
+    uint64_t syncsFailed = 0;
+    uint64_t connections = 0;
+    uint64_t connectionsFailed = 0;
+    uint64_t framesLost = 0;
+    uint64_t bytesSent = 0;
+    uint64_t bytesReceived = 0;
+    uint64_t multicastChunks = 0;
+    uint64_t ranges = 0;
+    uint64_t revocations = 0;
+    uint64_t handshakes = 0;
+    uint64_t resumptions = 0;
+} load_local_t;
+
+/**
+ * @brief Send a frame from a simulated module, applying the latency and the loss.
+ * @return True if the frame was sent, false if it was lost or the connection broke.
+ */
+static bool LOAD_Send(load_module_t *module, load_local_t *local, uint8_t type, uint16_t offset,
+                      uint16_t total, const uint8_t *payload, uint16_t length)
+{
+    if (config.latencyMs > 0)
+    {
+        usleep(config.latencyMs * 1000);
+    }
+
+    std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    if ((config.loss > 0.0) && (distribution(module->random) < config.loss))
+    {
+        local->framesLost++;
+        if (config.stallOnLoss)
+        {
+            usleep(config.timeoutMs * 1000);
+        }
+        return false;
+    }
+
+    return HOST_IO_SendFrame(&(module->connection), type, offset, total, payload, length);
+}
+
+/**
+ * @brief Send a request and wait for the answer, measuring the round trip.
+ * @return True if an answer was received, false otherwise.
+ */
+static bool LOAD_Request(load_module_t *module, load_local_t *local, frame_t *answer,
+                         uint8_t type, uint16_t offset, uint16_t total, const uint8_t *payload,
+                         uint16_t length)
+{
+    uint64_t start = HOST_IO_MonotonicMicros();
+    if (!LOAD_Send(module, local, type, offset, total, payload, length) ||
+        (HOST_IO_ReceiveFrame(&(module->connection), answer, (int)config.timeoutMs) !=
+         HOST_RECEIVE_OK))
+    {
+        return false;
+    }
+    local->roundTripMs.push_back((double)(HOST_IO_MonotonicMicros() - start) / 1000.0);
+
+    return true;
+}
+
+/**
+ * @brief Secure the connection of a simulated module, resuming the previous session if possible.
+ * @return True if the connection is secure, false otherwise.
+ */
+static bool LOAD_Handshake(load_module_t *module, load_local_t *local)
+{
+    if (!config.resume)
+    {
+        module->secureClient.hasTicket = false;
+    }
+
+    uint64_t start = HOST_IO_MonotonicMicros();
+    secure_handshake_result_t result = SECURE_HANDSHAKE_RETRY;
+    while (result == SECURE_HANDSHAKE_RETRY)
+    {
+        uint8_t random[SECURE_CLIENT_RANDOM_SIZE];
+        for (uint8_t i = 0; i < sizeof(random); i += 4)
+        {
+            BYTEORDER_WriteUint32Be(&(random[i]), module->random());
+        }
+        uint8_t hello[SECURE_HELLO_RESUME_SIZE];
+        uint8_t mode;
+        uint16_t length = SECURE_ClientHello(&(module->secureClient), random, &mode, hello);
+
+        frame_t answer;
+        if (!LOAD_Request(module, local, &answer, FRAME_TYPE_KEY, mode, 0, hello, length) ||
+            (answer.type != FRAME_TYPE_KEY))
+        {
+            return false;
+        }
+        result = SECURE_ClientFinish(&(module->secureClient), answer.payload, answer.length,
+                                     &(module->connection.session));
+        if (result == SECURE_HANDSHAKE_DONE)
+        {
+            local->handshakes++;
+            local->resumptions += (mode == SECURE_MODE_RESUME) ? 1 : 0;
+        }
+    }
+    if (result != SECURE_HANDSHAKE_DONE)
+    {
+        return false;
+    }
+    local->handshakeMs.push_back((double)(HOST_IO_MonotonicMicros() - start) / 1000.0);
+    module->connection.secure = true;
+
+    return true;
+}
+
+/**
+ * @brief Upload every pending log of a simulated module.
+ * @return True if every log was stored by the central module, false otherwise.
+ */
+static bool LOAD_Upload(load_module_t *module, load_local_t *local)
+{
+    uint8_t payload[FRAME_MAX_PAYLOAD];
+    frame_t answer;
+
+    while (module->logsPending > 0)
+    {
+        uint32_t count = std::min<uint32_t>(module->logsPending, LOAD_LOGS_PER_FRAME);
+        BYTEORDER_WriteUint32Be(payload, module->logSequence);
+        memset(&(payload[4]), 0x5A, count * LOAD_LOG_SIZE);
+
+        if (!LOAD_Request(module, local, &answer, FRAME_TYPE_LOG, 0, 0, payload,
+                          (uint16_t)(4 + count * LOAD_LOG_SIZE)) ||
+            (answer.type != FRAME_TYPE_ACK) || (answer.length != 4))
+        {
+            return false;
+        }
+
+        uint32_t acked = BYTEORDER_ReadUint32Be(answer.payload);
+        uint32_t released = acked - module->logSequence;
+        if ((released == 0) || (released > module->logsPending))
+        {
+            return false;
+        }
+        module->logSequence = acked;
+        module->logsPending -= released;
+    }
+
+    return true;
+}
+
+/**
+ * @brief Drop the partially received new memory.
+ */
+static void LOAD_DropNewMemory(load_module_t *module)
+{
+    module->newMemoryStaged = false;
+    module->newMemoryReceived = 0;
+    module->newMemoryChunks = 0;
+    memset(module->newMemoryHash, 0, SHA256_SIZE);
+}
+
+/**
+ * @brief Start assembling a new memory.
+ */
+static void LOAD_StartNewMemory(load_module_t *module, const uint8_t *hash)
+{
+    LOAD_DropNewMemory(module);
+    memcpy(module->newMemoryHash, hash, SHA256_SIZE);
+    module->newMemoryStaged = true;
+}
+
+/**
+ * @brief Mark the chunks of the new memory that are completely received.
+ */
+static void LOAD_MarkChunks(load_module_t *module, uint16_t start, uint16_t end)
+{
+    for (uint16_t chunk = (start + LOAD_CHUNK_SIZE - 1) / LOAD_CHUNK_SIZE;
+         chunk < LOAD_CHUNK_COUNT; chunk++)
+    {
+        uint16_t chunk_end = std::min<uint16_t>((chunk + 1) * LOAD_CHUNK_SIZE, LOAD_IMAGE_SIZE);
+        if (chunk_end > end)
+        {
+            break;
+        }
+        module->newMemoryChunks |= (uint32_t)1 << chunk;
+    }
+
+    module->newMemoryReceived = 0;
+    for (uint16_t chunk = 0;
+         (chunk < LOAD_CHUNK_COUNT) && (module->newMemoryChunks & ((uint32_t)1 << chunk));
+         chunk++)
+    {
+        module->newMemoryReceived =
+            std::min<uint16_t>((chunk + 1) * LOAD_CHUNK_SIZE, LOAD_IMAGE_SIZE);
+    }
+}
+
+/**
+ * @brief Collect the chunks of the broadcast table image.
+ * @return True if the table is up to date, false otherwise.
+ */
+static bool LOAD_Multicast(load_module_t *module, load_local_t *local)
+{
+    int fd = HOST_IO_MulticastReceiver(config.multicastGroup, config.multicastPort,
+                                       config.multicastInterface);
+    if (fd < 0)
+    {
+        return false;
+    }
+
+    std::uniform_real_distribution<double> distribution(0.0, 1.0);
+    bool up_to_date = false;
+    uint64_t start = HOST_IO_MonotonicMicros();
+    uint64_t last = start;
+    frame_t frame;
+
+    while (!up_to_date && (module->newMemoryChunks != LOAD_CHUNKS_ALL))
+    {
+        uint64_t now = HOST_IO_MonotonicMicros();
+        if ((now - start > LOAD_MULTICAST_LISTEN_MS * 1000ULL) ||
+            (now - last > LOAD_MULTICAST_IDLE_MS * 1000ULL))
+        {
+            break;
+        }
+        if ((HOST_IO_ReceiveDatagramFrame(fd, &frame, 50) != HOST_RECEIVE_OK) ||
+            ((config.multicastLoss > 0.0) &&
+             (distribution(module->random) < config.multicastLoss)))
+        {
+            continue;
+        }
+        last = HOST_IO_MonotonicMicros();
+
+        if ((frame.type == FRAME_TYPE_IMAGE_INFO) && (frame.length == SHA256_SIZE))
+        {
+            if (memcmp(frame.payload, module->tableHash, SHA256_SIZE) == 0)
+            {
+                LOAD_DropNewMemory(module);
+                up_to_date = true;
+            }
+            else if (!module->newMemoryStaged ||
+                     (memcmp(frame.payload, module->newMemoryHash, SHA256_SIZE) != 0))
+            {
+                LOAD_StartNewMemory(module, frame.payload);
+            }
+            continue;
+        }
+
+        if ((frame.type != FRAME_TYPE_DATA) || !module->newMemoryStaged ||
+            (frame.offset % LOAD_CHUNK_SIZE != 0) || (frame.offset >= LOAD_IMAGE_SIZE))
+        {
+            continue;
+        }
+        uint16_t chunk = frame.offset / LOAD_CHUNK_SIZE;
+        uint16_t length = std::min<uint16_t>(LOAD_CHUNK_SIZE, LOAD_IMAGE_SIZE - frame.offset);
+        if ((frame.length != length) || (module->newMemoryChunks & ((uint32_t)1 << chunk)))
+        {
+            continue;
+        }
+        memcpy(&(module->newMemory[frame.offset]), frame.payload, length);
+        LOAD_MarkChunks(module, frame.offset, frame.offset + length);
+        local->multicastChunks++;
+    }
+
+    close(fd);
+    return up_to_date;
+}
+
+/**
+ * @brief Receive a range of the new memory, acknowledging every chunk.
+ * @return 1 if the range was received, -1 if the central module refused the range, 0 on failure.
+ */
+static int LOAD_ReceiveRange(load_module_t *module, load_local_t *local, uint16_t start,
+                             uint16_t end)
+{
+    frame_t frame;
+    uint16_t next = start;
+
+    while (next < end)
+    {
+        if (HOST_IO_ReceiveFrame(&(module->connection), &frame, (int)config.timeoutMs) !=
+            HOST_RECEIVE_OK)
+        {
+            return 0;
+        }
+        if (frame.type == FRAME_TYPE_IMAGE_INFO)
+        {
+            return -1;
+        }
+        if ((frame.type != FRAME_TYPE_DATA) || (frame.offset != next) || (frame.length == 0) ||
+            (frame.offset + frame.length > end))
+        {
+            return 0;
+        }
+        memcpy(&(module->newMemory[frame.offset]), frame.payload, frame.length);
+        next += frame.length;
+        LOAD_MarkChunks(module, start, next);
+
+        if (!LOAD_Send(module, local, FRAME_TYPE_ACK, next, LOAD_IMAGE_SIZE, nullptr, 0))
+        {
+            return 0;
+        }
+    }
+
+    return 1;
+}
+
+/**
+ * @brief Download the table image of the central module: the gaps of the broadcast chunks, or
+ * the whole image resuming the partial one.
+ * @return True if the table is up to date, false otherwise.
+ */
+static bool LOAD_Download(load_module_t *module, load_local_t *local)
+{
+    for (;;)
+    {
+        if (module->newMemoryStaged && (module->newMemoryChunks == LOAD_CHUNKS_ALL))
+        {
+            uint8_t hash[SHA256_SIZE];
+            sha256_context_t context;
+            SHA256_Init(&context);
+            SHA256_Update(&context, module->newMemory, LOAD_IMAGE_SIZE);
+            SHA256_Final(&context, hash);
+
+            bool valid = (memcmp(hash, module->newMemoryHash, SHA256_SIZE) == 0);
+            if (valid)
+            {
+                // The new table contains the revocations up to its version
+                memcpy(module->tableHash, hash, SHA256_SIZE);
+                bool has_version = (((module->newMemory[0] << 8) | module->newMemory[1]) >= 60);
+                module->revocationVersion = 0;
+                if (has_version)
+                {
+                    module->revocationVersion = BYTEORDER_ReadUint32Be(&(module->newMemory[56]));
+                }
+            }
+            LOAD_DropNewMemory(module);
+            return valid;
+        }
+
+        uint32_t contiguous_chunks =
+            ((uint32_t)1 << (module->newMemoryReceived / LOAD_CHUNK_SIZE)) - 1;
+        if (module->newMemoryStaged && (module->newMemoryChunks != contiguous_chunks))
+        {
+            // Request the first gap of the broadcast chunks
+            uint16_t chunk_end = module->newMemoryReceived / LOAD_CHUNK_SIZE + 1;
+            while ((chunk_end < LOAD_CHUNK_COUNT) &&
+                   !(module->newMemoryChunks & ((uint32_t)1 << chunk_end)))
+            {
+                chunk_end++;
+            }
+            uint16_t start = module->newMemoryReceived;
+            uint16_t end = std::min<uint16_t>(chunk_end * LOAD_CHUNK_SIZE, LOAD_IMAGE_SIZE);
+
+            local->ranges++;
+            if (!LOAD_Send(module, local, FRAME_TYPE_RANGE, start, end - start,
+                           module->newMemoryHash, SHA256_SIZE))
+            {
+                return false;
+            }
+            int result = LOAD_ReceiveRange(module, local, start, end);
+            if (result == 0)
+            {
+                return false;
+            }
+            if (result < 0)
+            {
+                LOAD_DropNewMemory(module);
+            }
+            continue;
+        }
+
+        uint8_t request[2 * SHA256_SIZE];
+        memcpy(request, module->tableHash, SHA256_SIZE);
+        memcpy(&(request[SHA256_SIZE]), module->newMemoryHash, SHA256_SIZE);
+
+        frame_t frame;
+        if (!LOAD_Request(module, local, &frame, FRAME_TYPE_NEW_MEMORY,
+                          module->newMemoryReceived, LOAD_IMAGE_SIZE, request, sizeof(request)))
+        {
+            return false;
+        }
+
+        if (frame.type == FRAME_TYPE_NOT_MODIFIED)
+        {
+            LOAD_DropNewMemory(module);
+            return true;
+        }
+        if ((frame.type != FRAME_TYPE_IMAGE_INFO) || (frame.total != LOAD_IMAGE_SIZE) ||
+            (frame.length != SHA256_SIZE))
+        {
+            return false;
+        }
+
+        if (frame.offset == 0)
+        {
+            LOAD_StartNewMemory(module, frame.payload);
+        }
+        else if ((frame.offset != module->newMemoryReceived) ||
+                 (memcmp(frame.payload, module->newMemoryHash, SHA256_SIZE) != 0))
+        {
+            return false;
+        }
+
+        if (LOAD_ReceiveRange(module, local, frame.offset, LOAD_IMAGE_SIZE) != 1)
+        {
+            return false;
+        }
+    }
+}
+
+/**
+ * @brief Ask for the cards revoked after the revocation version of a simulated module.
+ * @return True if the revocations are up to date, false otherwise.
+ * @note The MAC is not checked, the module only follows the versions.
+ */
+static bool LOAD_Revocations(load_module_t *module, load_local_t *local)
+{
+    frame_t answer;
+    do
+    {
+        uint8_t payload[8];
+        BYTEORDER_WriteUint32Be(payload, module->revocationVersion);
+        BYTEORDER_WriteUint32Be(&(payload[4]), module->random());
+        if (!LOAD_Request(module, local, &answer, FRAME_TYPE_REVOCATION, 0, 0, payload,
+                          sizeof(payload)) ||
+            (answer.type != FRAME_TYPE_REVOCATION) || (answer.length < LOAD_REVOCATION_OVERHEAD))
+        {
+            return false;
+        }
+        uint32_t version = BYTEORDER_ReadUint32Be(&(answer.payload[4]));
+        local->revocations += version - BYTEORDER_ReadUint32Be(answer.payload);
+        module->revocationVersion = version;
+    } while (answer.total > 0);
+
+    return true;
+}
+
+/**
+ * @brief Run one synchronization of a simulated module.
+ * @return True if the synchronization succeeded, false otherwise.
+ */
+static bool LOAD_Sync(load_module_t *module, load_local_t *local)
+{
+    bool logs_sent = false;
+    bool memory_received = false;
+    bool revocations_received = false;
+    LOAD_DropNewMemory(module);
+
+    if ((config.multicastGroup != nullptr) && !config.secure)
+    {
+        memory_received = LOAD_Multicast(module, local);
+    }
+
+    for (uint32_t attempt = 0; attempt < LOAD_MAX_ATTEMPTS; attempt++)
+    {
+        local->connections++;
+        int fd = HOST_IO_Connect(config.host, config.port);
+        if (fd < 0)
+        {
+            local->connectionsFailed++;
+            continue;
+        }
+        HOST_IO_Init(&(module->connection), fd);
+
+        uint8_t payload[4];
+        BYTEORDER_WriteUint32Be(payload, module->chipId);
+        frame_t answer;
+        bool ok = (!config.secure || LOAD_Handshake(module, local)) &&
+                  LOAD_Request(module, local, &answer, FRAME_TYPE_HELLO, 0, 0, payload,
+                               sizeof(payload)) &&
+                  (answer.type == FRAME_TYPE_HELLO);
+
+        if (ok && !logs_sent)
+        {
+            ok = logs_sent = LOAD_Upload(module, local);
+        }
+        if (ok && !memory_received)
+        {
+            ok = memory_received = LOAD_Download(module, local);
+        }
+        if (ok && !revocations_received)
+        {
+            ok = revocations_received = LOAD_Revocations(module, local);
+        }
+        if (ok)
+        {
+            ok = LOAD_Request(module, local, &answer, FRAME_TYPE_TIME, 0, 0, nullptr, 0) &&
+                 (answer.type == FRAME_TYPE_TIME) && (answer.length >= 4);
+        }
+
+        local->bytesSent += module->connection.bytesSent;
+        local->bytesReceived += module->connection.bytesReceived;
+        HOST_IO_Close(&(module->connection));
+        if (ok)
+        {
+            return true;
+        }
+        local->connectionsFailed++;
+    }
+
+    return false;
+}
+
+/**
+ * @brief Run the synchronizations of a simulated module.
+ * @param index The index of the module in the fleet.
+ */
+static void LOAD_Module(uint32_t index)
+{
+    load_module_t module;
+    module.chipId = config.chipBase + index;
+    memset(module.tableHash, 0, SHA256_SIZE);
+    module.logSequence = 0;
+    module.logsPending = 0;
+    module.revocationVersion = 0;
+    module.random.seed(config.seed * 7919 + index);
+    uint8_t device_key[SECURE_KEY_SIZE];
+    SECURE_DeriveDeviceKey((const uint8_t *)config.siteKey, SECURE_KEY_SIZE, module.chipId,
+                           device_key);
+    SECURE_ClientInit(&(module.secureClient), device_key, module.chipId);
+    load_local_t local;
+
+    if (config.spreadMs > 0)
+    {
+        std::uniform_int_distribution<uint32_t> distribution(0, config.spreadMs);
+        usleep(distribution(module.random) * 1000);
+    }
+
+    for (uint32_t i = 0; i < config.syncs; i++)
+    {
+        module.logsPending += config.logs;
+        if (!config.cached)
+        {
+            memset(module.tableHash, 0, SHA256_SIZE);
+        }
+
+        uint64_t start = HOST_IO_MonotonicMicros();
+        if (LOAD_Sync(&module, &local))
+        {
+            local.syncsSucceeded++;
+            local.syncMs.push_back((double)(HOST_IO_MonotonicMicros() - start) / 1000.0);
+        }
+        else
+        {
+            local.syncsFailed++;
+        }
+    }
+
+    std::lock_guard<std::mutex> lock(results.mutex);
+    results.syncMs.insert(results.syncMs.end(), local.syncMs.begin(), local.syncMs.end());
+    results.roundTripMs.insert(results.roundTripMs.end(), local.roundTripMs.begin(),
+                               local.roundTripMs.end());
+    results.handshakeMs.insert(results.handshakeMs.end(), local.handshakeMs.begin(),
+                               local.handshakeMs.end());
+    results.syncsSucceeded += local.syncsSucceeded;
+    results.syncsFailed += local.syncsFailed;
+    results.connections += local.connections;
+    results.connectionsFailed += local.connectionsFailed;
+    results.framesLost += local.framesLost;
+    results.bytesSent += local.bytesSent;
+    results.bytesReceived += local.bytesReceived;
+    results.multicastChunks += local.multicastChunks;
+    results.ranges += local.ranges;
+    results.revocations += local.revocations;
+    results.handshakes += local.handshakes;
+    results.resumptions += local.resumptions;
+}
+
+/**
+ * @brief Get a percentile of sorted samples.
+ * @param samples The sorted samples.
+ * @param percent The percentile, 0 to 100.
+ * @return The percentile, 0 if there are no samples.
+ */
+static double LOAD_Percentile(const std::vector<double> &samples, double percent)
+{
+    if (samples.empty())
+    {
+        return 0.0;
+    }
+    size_t index = (size_t)((percent / 100.0) * (double)(samples.size() - 1) + 0.5);
+    return samples[index];
+}
+
+/**
+ * @brief Print the percentiles of samples.
+ * @param name The name of the samples.
+ * @param samples The samples, sorted in place.
+ */
+static void LOAD_PrintPercentiles(const char *name, std::vector<double> &samples)
+{
+    std::sort(samples.begin(), samples.end());
+    printf("%-16s n=%zu p50=%.2f p90=%.2f p99=%.2f max=%.2f ms\n", name, samples.size(),
+           LOAD_Percentile(samples, 50), LOAD_Percentile(samples, 90),
+           LOAD_Percentile(samples, 99), LOAD_Percentile(samples, 100));
+}
+
+/**
+ * @brief Print the usage of the load generator.
+ * @param name The name of the program.
+ */
+static void LOAD_Usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [--host A.B.C.D] [--port N] [--devices N] [--syncs N] [--logs N]\n"
+            "          [--loss P] [--stall-on-loss] [--latency MS] [--timeout MS] [--spread MS]\n"
+            "          [--cached] [--seed N] [--chip-base N] [--multicast GROUP]\n"
+            "          [--multicast-port N] [--multicast-if ADDR] [--multicast-loss P]\n"
+            "          [--secure] [--no-resume] [--site-key KEY]\n",
+            name);
+}
+
+int main(int argc, char **argv)
+{
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1 < argc);
+        if ((strcmp(argv[i], "--host") == 0) && has_value)
+        {
+            config.host = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--port") == 0) && has_value)
+        {
+            config.port = (uint16_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--devices") == 0) && has_value)
+        {
+            config.devices = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--syncs") == 0) && has_value)
+        {
+            config.syncs = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--logs") == 0) && has_value)
+        {
+            config.logs = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--loss") == 0) && has_value)
+        {
+            config.loss = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--stall-on-loss") == 0)
+        {
+            config.stallOnLoss = true;
+        }
+        else if ((strcmp(argv[i], "--latency") == 0) && has_value)
+        {
+            config.latencyMs = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--timeout") == 0) && has_value)
+        {
+            config.timeoutMs = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--spread") == 0) && has_value)
+        {
+            config.spreadMs = (uint32_t)atoi(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--cached") == 0)
+        {
+            config.cached = true;
+        }
+        else if ((strcmp(argv[i], "--seed") == 0) && has_value)
+        {
+            config.seed = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--multicast") == 0) && has_value)
+        {
+            config.multicastGroup = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--multicast-port") == 0) && has_value)
+        {
+            config.multicastPort = (uint16_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--multicast-if") == 0) && has_value)
+        {
+            config.multicastInterface = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--multicast-loss") == 0) && has_value)
+        {
+            config.multicastLoss = atof(argv[++i]);
+        }
+        else if (strcmp(argv[i], "--secure") == 0)
+        {
+            config.secure = true;
+        }
+        else if (strcmp(argv[i], "--no-resume") == 0)
+        {
+            config.resume = false;
+        }
+        else if ((strcmp(argv[i], "--site-key") == 0) && has_value)
+        {
+            config.siteKey = argv[++i];
+        }
+        else if ((strcmp(argv[i], "--chip-base") == 0) && has_value)
+        {
+            config.chipBase = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        }
+        else
+        {
+            LOAD_Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    if (strlen(config.siteKey) != SECURE_KEY_SIZE)
+    {
+        fprintf(stderr, "the site key must be %u characters\n", SECURE_KEY_SIZE);
+        return 1;
+    }
+
+    uint64_t start = HOST_IO_MonotonicMicros();
+    std::vector<std::thread> threads;
+    threads.reserve(config.devices);
+    for (uint32_t i = 0; i < config.devices; i++)
+    {
+        threads.emplace_back(LOAD_Module, i);
+    }
+    for (std::thread &thread : threads)
+    {
+        thread.join();
+    }
+    double seconds = (double)(HOST_IO_MonotonicMicros() - start) / 1e6;
+
+    uint64_t syncs = results.syncsSucceeded + results.syncsFailed;
+    printf("devices %u, syncs %llu in %.2f s\n", config.devices, (unsigned long long)syncs,
+           seconds);
+    printf("connections      %llu (%.1f/s), failed %llu (%.2f%%), frames lost %llu\n",
+           (unsigned long long)results.connections, (double)results.connections / seconds,
+           (unsigned long long)results.connectionsFailed,
+           results.connections ? 100.0 * (double)results.connectionsFailed /
+                                     (double)results.connections
+                               : 0.0,
+           (unsigned long long)results.framesLost);
+    printf("syncs            succeeded %llu, failed %llu (%.2f%%), %.1f/s\n",
+           (unsigned long long)results.syncsSucceeded, (unsigned long long)results.syncsFailed,
+           syncs ? 100.0 * (double)results.syncsFailed / (double)syncs : 0.0,
+           (double)results.syncsSucceeded / seconds);
+    printf("bytes            sent %llu, received %llu\n", (unsigned long long)results.bytesSent,
+           (unsigned long long)results.bytesReceived);
+    printf("table            broadcast chunks %llu, ranges requested %llu, revocations %llu\n",
+           (unsigned long long)results.multicastChunks, (unsigned long long)results.ranges,
+           (unsigned long long)results.revocations);
+    LOAD_PrintPercentiles("sync", results.syncMs);
+    LOAD_PrintPercentiles("round trip", results.roundTripMs);
+    if (config.secure)
+    {
+        printf("handshakes       %llu, resumed %llu\n", (unsigned long long)results.handshakes,
+               (unsigned long long)results.resumptions);
+        LOAD_PrintPercentiles("handshake", results.handshakeMs);
+    }
+
+    return (results.syncsFailed == 0) ? 0 : 2;
+}
@@ -0,0 +1,249 @@
+/**
+ ***************************************************************************************************
+ * @file ring_bench.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Stress test and benchmark of the circular buffers (CircularBuffer.hpp) on a Linux host.
+ *
+ * The stress test runs the producer and the consumer of SpscRingBuffer on two threads, with random
+ * single and span operations, and checks that every element arrives once and in order. The
+ * benchmark measures the cost of an element through CircularBuffer and SpscRingBuffer on one
+ * thread, and the throughput of SpscRingBuffer between two threads. A side that finds the buffer
+ * full or empty yields, so the test also runs on a single core.
+ ***************************************************************************************************
+ */
+
+#include <stdint.h>
+#include <time.h>
+
+#include <cstdio>
+#include <cstdlib>
+#include <random>
+#include <thread>
+
+#include "CircularBuffer.hpp"
+
+/**
+ * @defgroup bench_constants Benchmark constants
+ * @{
+ */
+#define BENCH_RING_SIZE 64
+#define BENCH_MAX_SPAN 24
+#define BENCH_DEFAULT_ELEMENTS 20000000UL
+/** @} */
+
+/**
+ * @brief Get the time of a monotonic clock.
+ * @return The time in nanoseconds.
+ */
+static double BENCH_Nanos(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e9 + (double)now.tv_nsec;
+}
+
+/**
+ * @brief Pass elements from a producer thread to a consumer thread and check their order.
+ * @param elements The number of elements to pass.
+ * @return The number of errors found.
+ */
+static unsigned long BENCH_Stress(unsigned long elements)
+{
+    static SpscRingBuffer<uint32_t, BENCH_RING_SIZE> ring;
+    unsigned long errors = 0;
+
+    std::thread producer([elements]() {
+        std::mt19937 random(1);
+        uint32_t span[BENCH_MAX_SPAN];
+        uint32_t next = 0;
+        while (next < elements)
+        {
+            uint32_t count = 1 + random() % BENCH_MAX_SPAN;
+            if ((random() & 1) == 0)
+            {
+                count = ring.push(next) ? 1 : 0;
+            }
+            else
+            {
+                if (count > elements - next)
+                {
+                    count = elements - next;
+                }
+                for (uint32_t i = 0; i < count; i++)
+                {
+                    span[i] = next + i;
+                }
+                count = ring.pushSpan(span, count);
+            }
+            if (count == 0)
+            {
+                std::this_thread::yield();
+            }
+            next += count;
+        }
+    });
+
+    std::mt19937 random(2);
+    uint32_t span[BENCH_MAX_SPAN];
+    uint32_t expected = 0;
+    while (expected < elements)
+    {
+        uint32_t count;
+        const uint32_t *head = ring.peek();
+        if ((head != nullptr) && (*head != expected))
+        {
+            errors++;
+        }
+        if ((random() & 1) == 0)
+        {
+            count = ring.pop(span) ? 1 : 0;
+        }
+        else
+        {
+            count = ring.popSpan(span, 1 + random() % BENCH_MAX_SPAN);
+        }
+        if (count == 0)
+        {
+            std::this_thread::yield();
+        }
+        if (ring.size() > ring.capacity())
+        {
+            errors++;
+        }
+        for (uint32_t i = 0; i < count; i++)
+        {
+            if (span[i] != expected)
+            {
+                errors++;
+                expected = span[i];
+            }
+            expected++;
+        }
+    }
+
+    producer.join();
+    if (ring.size() != 0)
+    {
+        errors++;
+    }
+    return errors;
+}
+
+/**
+ * @brief Measure an element through CircularBuffer on one thread.
+ * @param elements The number of elements to pass.
+ * @return The time per element in nanoseconds.
+ */
+static double BENCH_CircularBuffer(unsigned long elements)
+{
+    static CircularBuffer<uint32_t, BENCH_RING_SIZE> buffer;
+    volatile uint32_t sink = 0;
+    uint32_t value = 0;
+
+    double start = BENCH_Nanos();
+    for (unsigned long i = 0; i < elements; i++)
+    {
+        value = (uint32_t)i;
+        buffer.enqueue(&value);
+        buffer.dequeue(&value);
+        sink = sink + value;
+    }
+    return (BENCH_Nanos() - start) / (double)elements;
+}
+
+/**
+ * @brief Measure an element through SpscRingBuffer on one thread.
+ * @param elements The number of elements to pass.
+ * @param span The number of elements per push and pop, 1 uses push() and pop().
+ * @return The time per element in nanoseconds.
+ */
+static double BENCH_SpscRing(unsigned long elements, uint32_t span)
+{
+    static SpscRingBuffer<uint32_t, BENCH_RING_SIZE> ring;
+    volatile uint32_t sink = 0;
+    uint32_t values[BENCH_MAX_SPAN] = {0};
+
+    double start = BENCH_Nanos();
+    for (unsigned long i = 0; i < elements; i += span)
+    {
+        if (span == 1)
+        {
+            ring.push((uint32_t)i);
+            ring.pop(values);
+        }
+        else
+        {
+            values[0] = (uint32_t)i;
+            ring.pushSpan(values, span);
+            ring.popSpan(values, span);
+        }
+        sink = sink + values[0];
+    }
+    return (BENCH_Nanos() - start) / (double)elements;
+}
+
+/**
+ * @brief Measure the throughput of SpscRingBuffer between two threads.
+ * @param elements The number of elements to pass.
+ * @param span The number of elements per push and pop.
+ * @return The time per element in nanoseconds.
+ */
+static double BENCH_SpscThreads(unsigned long elements, uint32_t span)
+{
+    static SpscRingBuffer<uint32_t, BENCH_RING_SIZE> ring;
+
+    double start = BENCH_Nanos();
+    std::thread producer([elements, span]() {
+        uint32_t values[BENCH_MAX_SPAN] = {0};
+        unsigned long sent = 0;
+        while (sent < elements)
+        {
+            uint32_t count = (elements - sent < span) ? (uint32_t)(elements - sent) : span;
+            count = ring.pushSpan(values, count);
+            if (count == 0)
+            {
+                std::this_thread::yield();
+            }
+            sent += count;
+        }
+    });
+
+    uint32_t values[BENCH_MAX_SPAN];
+    unsigned long received = 0;
+    while (received < elements)
+    {
+        uint32_t count = ring.popSpan(values, span);
+        if (count == 0)
+        {
+            std::this_thread::yield();
+        }
+        received += count;
+    }
+    producer.join();
+    return (BENCH_Nanos() - start) / (double)elements;
+}
+
+/**
+ * @brief Run the stress test and the benchmark.
+ * @param argc The number of arguments.
+ * @param argv The arguments: the number of elements per measurement.
+ * @return 0 if the stress test passed, 2 otherwise.
+ */
+int main(int argc, char **argv)
+{
+    unsigned long elements = (argc > 1) ? strtoul(argv[1], nullptr, 0) : BENCH_DEFAULT_ELEMENTS;
+
+    unsigned long errors = BENCH_Stress(elements);
+    printf("%-36s %lu elements, %lu errors\n", "Stress test, two threads", elements, errors);
+
+    printf("%-36s %8.2f ns\n", "CircularBuffer, one thread", BENCH_CircularBuffer(elements));
+    printf("%-36s %8.2f ns\n", "SpscRingBuffer, one thread", BENCH_SpscRing(elements, 1));
+    printf("%-36s %8.2f ns\n", "SpscRingBuffer span 16, one thread", BENCH_SpscRing(elements, 16));
+    printf("%-36s %8.2f ns\n", "SpscRingBuffer, two threads", BENCH_SpscThreads(elements, 1));
+    printf("%-36s %8.2f ns\n", "SpscRingBuffer span 16, two threads",
+           BENCH_SpscThreads(elements, 16));
+
+    return (errors == 0) ? 0 : 2;
+}
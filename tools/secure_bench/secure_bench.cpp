@@ -0,0 +1,208 @@
+/**
+ ***************************************************************************************************
+ * @file secure_bench.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Benchmark of the secure channel of the sync (secure.h) on a Linux host.
+ *
+ * Measures the module's and the central module's side of the full and the resumed handshake, and
+ * the cost of sealing and opening the frames per kilobyte, with the sketch sources unchanged.
+ ***************************************************************************************************
+ */
+
+#include <stdint.h>
+#include <string.h>
+#include <time.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "secure.h"
+
+/**
+ * @defgroup bench_constants Benchmark constants
+ * @{
+ */
+#define BENCH_SITE_KEY "belepteto_rendszer_site_key_0001"
+#define BENCH_CHIP_ID 0x00A00001
+/** @} */
+
+/**
+ * @brief Get the time of a monotonic clock.
+ * @return The time in microseconds.
+ */
+static double BENCH_Micros(void)
+{
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    return (double)now.tv_sec * 1e6 + (double)now.tv_nsec / 1e3;
+}
+
+/**
+ * @brief Fill a buffer with pseudo random bytes.
+ * @param buffer The buffer to fill.
+ * @param length The length of the buffer.
+ */
+static void BENCH_Random(uint8_t *buffer, uint16_t length)
+{
+    for (uint16_t i = 0; i < length; i++)
+    {
+        buffer[i] = (uint8_t)(rand() & 0xFF);
+    }
+}
+
+/**
+ * @brief Print the median of samples.
+ * @param name The name of the measurement.
+ * @param samples The samples in microseconds, sorted in place.
+ */
+static void BENCH_Print(const char *name, std::vector<double> &samples)
+{
+    std::sort(samples.begin(), samples.end());
+    printf("%-28s %10.1f us\n", name, samples[samples.size() / 2]);
+}
+
+/**
+ * @brief Run one handshake between a client and the server.
+ * @param server The keys of the central module.
+ * @param client The handshake state of the module, with or without a ticket.
+ * @param clientMicros Pointer to add the time spent on the module's side to.
+ * @param serverMicros Pointer to add the time spent on the central module's side to.
+ * @return True if the channel was established, false otherwise.
+ */
+static bool BENCH_Handshake(const secure_server_t *server, secure_client_t *client,
+                            double *clientMicros, double *serverMicros)
+{
+    uint8_t client_random[SECURE_CLIENT_RANDOM_SIZE];
+    uint8_t server_random[SECURE_SERVER_RANDOM_SIZE];
+    BENCH_Random(client_random, sizeof(client_random));
+    BENCH_Random(server_random, sizeof(server_random));
+
+    uint8_t hello[SECURE_HELLO_RESUME_SIZE];
+    uint8_t reply[SECURE_REPLY_FULL_SIZE];
+    uint16_t reply_length;
+    uint8_t mode;
+    uint32_t chip_id;
+    secure_session_t client_session;
+    secure_session_t server_session;
+
+    double start = BENCH_Micros();
+    uint16_t length = SECURE_ClientHello(client, client_random, &mode, hello);
+    double middle = BENCH_Micros();
+    secure_handshake_result_t accepted =
+        SECURE_ServerAccept(server, mode, hello, length, server_random, (uint32_t)time(nullptr),
+                            reply, &reply_length, &server_session, &chip_id);
+    double end = BENCH_Micros();
+    secure_handshake_result_t finished =
+        SECURE_ClientFinish(client, reply, reply_length, &client_session);
+    *clientMicros += (middle - start) + (BENCH_Micros() - end);
+    *serverMicros += end - middle;
+
+    return (accepted == SECURE_HANDSHAKE_DONE) && (finished == SECURE_HANDSHAKE_DONE);
+}
+
+int main(int argc, char **argv)
+{
+    int rounds = (argc > 1) ? atoi(argv[1]) : 200;
+    if (rounds <= 0)
+    {
+        fprintf(stderr, "usage: %s [ROUNDS]\n", argv[0]);
+        return 1;
+    }
+
+    secure_server_t server;
+    memcpy(server.siteKey, BENCH_SITE_KEY, SECURE_KEY_SIZE);
+    BENCH_Random(server.ticketKey, SECURE_KEY_SIZE);
+    server.ticketLifetime = 3600;
+    uint8_t device_key[SECURE_KEY_SIZE];
+    SECURE_DeriveDeviceKey(server.siteKey, SECURE_KEY_SIZE, BENCH_CHIP_ID, device_key);
+
+    std::vector<double> x25519;
+    std::vector<double> full_client;
+    std::vector<double> full_server;
+    std::vector<double> resume_client;
+    std::vector<double> resume_server;
+    for (int i = 0; i < rounds; i++)
+    {
+        uint8_t private_key[X25519_SIZE];
+        uint8_t public_key[X25519_SIZE];
+        BENCH_Random(private_key, sizeof(private_key));
+        double start = BENCH_Micros();
+        X25519_PublicKey(public_key, private_key);
+        x25519.push_back(BENCH_Micros() - start);
+
+        secure_client_t client;
+        SECURE_ClientInit(&client, device_key, BENCH_CHIP_ID);
+        double client_micros = 0.0;
+        double server_micros = 0.0;
+        if (!BENCH_Handshake(&server, &client, &client_micros, &server_micros))
+        {
+            fprintf(stderr, "full handshake failed\n");
+            return 2;
+        }
+        full_client.push_back(client_micros);
+        full_server.push_back(server_micros);
+
+        client_micros = 0.0;
+        server_micros = 0.0;
+        if (!BENCH_Handshake(&server, &client, &client_micros, &server_micros))
+        {
+            fprintf(stderr, "resumed handshake failed\n");
+            return 2;
+        }
+        resume_client.push_back(client_micros);
+        resume_server.push_back(server_micros);
+    }
+
+    printf("handshakes, median of %d rounds\n", rounds);
+    BENCH_Print("X25519 scalar multiplication", x25519);
+    BENCH_Print("full, module side", full_client);
+    BENCH_Print("full, central side", full_server);
+    BENCH_Print("resumed, module side", resume_client);
+    BENCH_Print("resumed, central side", resume_server);
+
+    // Seal and open a kilobyte in frames of the full payload size, as the table download does
+    secure_session_t session;
+    BENCH_Random(session.sendKey, SECURE_KEY_SIZE);
+    memcpy(session.receiveKey, session.sendKey, SECURE_KEY_SIZE);
+    session.sendCounter = 0;
+    session.receiveCounter = 0;
+    std::vector<double> seal;
+    std::vector<double> open;
+    frame_t frame;
+    for (int i = 0; i < rounds; i++)
+    {
+        double seal_micros = 0.0;
+        double open_micros = 0.0;
+        for (uint16_t sent = 0; sent < 1024; sent += FRAME_MAX_PAYLOAD)
+        {
+            BENCH_Random(frame.payload, FRAME_MAX_PAYLOAD);
+            frame.type = FRAME_TYPE_DATA | FRAME_TYPE_SEALED;
+            frame.offset = sent;
+            frame.total = 1024;
+            double start = BENCH_Micros();
+            frame.length = SECURE_Seal(&session, frame.type, frame.offset, frame.total,
+                                       frame.payload, FRAME_MAX_PAYLOAD);
+            double middle = BENCH_Micros();
+            bool opened = SECURE_Open(&session, &frame);
+            open_micros += BENCH_Micros() - middle;
+            seal_micros += middle - start;
+            if (!opened)
+            {
+                fprintf(stderr, "open failed\n");
+                return 2;
+            }
+        }
+        seal.push_back(seal_micros);
+        open.push_back(open_micros);
+    }
+
+    printf("frames of %u bytes, per KB\n", FRAME_MAX_PAYLOAD);
+    BENCH_Print("seal", seal);
+    BENCH_Print("open", open);
+
+    return 0;
+}
@@ -0,0 +1,44 @@
+/**
+ ***************************************************************************************************
+ * @file Arduino.h
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief The part of the Arduino core used by the synchronization, for the Linux host build.
+ ***************************************************************************************************
+ */
+
+#ifndef ARDUINO_SHIM_H
+#define ARDUINO_SHIM_H
+
+#include <stdint.h>
+#include <stddef.h>
+#include <string.h>
+
+#define F(string) (string)
+
+unsigned long millis(void);
+
+unsigned long micros(void);
+
+void delay(unsigned long ms);
+
+void yield(void);
+
+/**
+ * @brief The ESP8266 specific functions.
+ */
+class EspClass
+{
+public:
+    uint32_t chipId = 0x00C0FFEE; /**< The chip ID reported by getChipId(), set by the host. */
+
+    uint32_t getChipId(void);
+    uint32_t random(void);
+    bool rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size);
+    bool rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size);
+};
+
+extern EspClass ESP;
+
+#endif /* ARDUINO_SHIM_H */
@@ -0,0 +1,63 @@
+/**
+ ***************************************************************************************************
+ * @file RTClib.h
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief The part of RTClib used by rtc.cpp, for the Linux host build. The RTC runs from the
+ * clock of the host.
+ ***************************************************************************************************
+ */
+
+#ifndef RTCLIB_SHIM_H
+#define RTCLIB_SHIM_H
+
+#include <Arduino.h>
+
+#include <Wire.h>
+
+/**
+ * @brief A point in time.
+ */
+class DateTime
+{
+private:
+    uint32_t _unixtime;
+
+public:
+    DateTime(uint32_t unixtime = 0);
+    DateTime(const char *date, const char *time);
+
+    uint32_t unixtime(void) const;
+};
+
+/**
+ * @brief The clock sources of the countdown timer.
+ */
+enum PCF8523TimerClockFreq
+{
+    PCF8523_FrequencySecond = 2,
+    PCF8523_FrequencyMinute = 3
+};
+
+/**
+ * @brief The RTC, running from the clock of the host with an adjustable offset.
+ */
+class RTC_PCF8523
+{
+private:
+    int64_t _offset = 0;
+
+public:
+    bool begin(TwoWire *wire);
+    bool initialized(void);
+    bool lostPower(void);
+    void adjust(const DateTime &time);
+    void start(void);
+    DateTime now(void);
+    void enableCountdownTimer(PCF8523TimerClockFreq clkFreq, uint8_t numPeriods,
+                              uint8_t lowPulseWidth = 0);
+    void disableCountdownTimer(void);
+};
+
+#endif /* RTCLIB_SHIM_H */
@@ -0,0 +1,51 @@
+/**
+ ***************************************************************************************************
+ * @file Wire.h
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief I2C bus for the Linux host build, with a 24LC64 EEPROM emulated in RAM on it.
+ ***************************************************************************************************
+ */
+
+#ifndef WIRE_SHIM_H
+#define WIRE_SHIM_H
+
+#include <Arduino.h>
+
+/**
+ * @brief Size of the emulated EEPROM.
+ */
+#define WIRE_SHIM_EEPROM_SIZE 8192
+
+/**
+ * @brief I2C bus with an emulated 24LC64 EEPROM.
+ */
+class TwoWire
+{
+private:
+    uint8_t _transmit[64];
+    uint8_t _transmitLength = 0;
+    uint8_t _receive[WIRE_SHIM_EEPROM_SIZE];
+    uint16_t _receiveLength = 0;
+    uint16_t _receivePosition = 0;
+    uint16_t _pointer = 0;
+
+public:
+    uint8_t memory[WIRE_SHIM_EEPROM_SIZE]; /**< The content of the emulated EEPROM. */
+    uint32_t pageWrites = 0;               /**< The number of page writes to the EEPROM. */
+
+    TwoWire(void);
+
+    void begin(void);
+    void beginTransmission(uint8_t address);
+    uint8_t endTransmission(bool stop = true);
+    size_t write(uint8_t data);
+    uint16_t requestFrom(uint8_t address, uint16_t quantity);
+    int available(void);
+    int read(void);
+};
+
+extern TwoWire Wire;
+
+#endif /* WIRE_SHIM_H */
@@ -0,0 +1,236 @@
+/**
+ ***************************************************************************************************
+ * @file shim.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Implementation of the Arduino, Wire and RTClib shims for the Linux host build.
+ ***************************************************************************************************
+ */
+
+#include <Arduino.h>
+#include <RTClib.h>
+#include <Wire.h>
+
+#include <time.h>
+#include <unistd.h>
+
+#include <random>
+
+EspClass ESP;
+TwoWire Wire;
+
+/**
+ * @brief Get the microseconds since the first call of millis() or micros().
+ * @return The microseconds since the first call.
+ */
+static unsigned long long SHIM_Elapsed(void)
+{
+    static struct timespec start = {0, 0};
+    struct timespec now;
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if ((start.tv_sec == 0) && (start.tv_nsec == 0))
+    {
+        start = now;
+    }
+    return (unsigned long long)((now.tv_sec - start.tv_sec) * 1000000LL +
+                                (now.tv_nsec - start.tv_nsec) / 1000);
+}
+
+/**
+ * @brief Get the milliseconds since the first call.
+ * @return The milliseconds since the first call.
+ */
+unsigned long millis(void)
+{
+    return (unsigned long)(SHIM_Elapsed() / 1000);
+}
+
+/**
+ * @brief Get the microseconds since the first call.
+ * @return The microseconds since the first call.
+ */
+unsigned long micros(void)
+{
+    return (unsigned long)SHIM_Elapsed();
+}
+
+void delay(unsigned long ms)
+{
+    usleep(ms * 1000);
+}
+
+void yield(void)
+{
+}
+
+uint32_t EspClass::getChipId(void)
+{
+    return chipId;
+}
+
+uint32_t EspClass::random(void)
+{
+    static std::mt19937 generator(chipId);
+    return generator();
+}
+
+/**
+ * @brief The host has no RTC user memory, nothing survives a restart.
+ */
+bool EspClass::rtcUserMemoryRead(uint32_t offset, uint32_t *data, size_t size)
+{
+    (void)offset;
+    (void)data;
+    (void)size;
+    return false;
+}
+
+bool EspClass::rtcUserMemoryWrite(uint32_t offset, uint32_t *data, size_t size)
+{
+    (void)offset;
+    (void)data;
+    (void)size;
+    return false;
+}
+
+TwoWire::TwoWire(void)
+{
+    memset(memory, 0xFF, sizeof(memory));
+}
+
+void TwoWire::begin(void)
+{
+}
+
+void TwoWire::beginTransmission(uint8_t address)
+{
+    (void)address;
+    _transmitLength = 0;
+}
+
+/**
+ * @brief Finish the transmission: the first two bytes set the address pointer of the EEPROM, the
+ * rest is written to its page, wrapping around at the page boundary like the 24LC64.
+ */
+uint8_t TwoWire::endTransmission(bool stop)
+{
+    (void)stop;
+    if (_transmitLength < 2)
+    {
+        return 2;
+    }
+
+    _pointer = (uint16_t)(((_transmit[0] << 8) | _transmit[1]) % WIRE_SHIM_EEPROM_SIZE);
+    if (_transmitLength > 2)
+    {
+        uint16_t page = _pointer & ~(uint16_t)31;
+        for (uint8_t i = 2; i < _transmitLength; i++)
+        {
+            memory[page | ((_pointer + i - 2) & 31)] = _transmit[i];
+        }
+        pageWrites++;
+    }
+
+    return 0;
+}
+
+size_t TwoWire::write(uint8_t data)
+{
+    if (_transmitLength >= sizeof(_transmit))
+    {
+        return 0;
+    }
+    _transmit[_transmitLength++] = data;
+    return 1;
+}
+
+uint16_t TwoWire::requestFrom(uint8_t address, uint16_t quantity)
+{
+    (void)address;
+    if (quantity > sizeof(_receive))
+    {
+        quantity = sizeof(_receive);
+    }
+    for (uint16_t i = 0; i < quantity; i++)
+    {
+        _receive[i] = memory[(_pointer + i) % WIRE_SHIM_EEPROM_SIZE];
+    }
+    _pointer = (uint16_t)((_pointer + quantity) % WIRE_SHIM_EEPROM_SIZE);
+    _receiveLength = quantity;
+    _receivePosition = 0;
+
+    return quantity;
+}
+
+int TwoWire::available(void)
+{
+    return _receiveLength - _receivePosition;
+}
+
+int TwoWire::read(void)
+{
+    if (_receivePosition >= _receiveLength)
+    {
+        return -1;
+    }
+    return _receive[_receivePosition++];
+}
+
+DateTime::DateTime(uint32_t unixtime) : _unixtime(unixtime)
+{
+}
+
+DateTime::DateTime(const char *date, const char *time)
+{
+    (void)date;
+    (void)time;
+    _unixtime = (uint32_t)::time(nullptr);
+}
+
+uint32_t DateTime::unixtime(void) const
+{
+    return _unixtime;
+}
+
+bool RTC_PCF8523::begin(TwoWire *wire)
+{
+    (void)wire;
+    return true;
+}
+
+bool RTC_PCF8523::initialized(void)
+{
+    return true;
+}
+
+bool RTC_PCF8523::lostPower(void)
+{
+    return false;
+}
+
+void RTC_PCF8523::adjust(const DateTime &time)
+{
+    _offset = (int64_t)time.unixtime() - (int64_t)::time(nullptr);
+}
+
+void RTC_PCF8523::start(void)
+{
+}
+
+DateTime RTC_PCF8523::now(void)
+{
+    return DateTime((uint32_t)((int64_t)::time(nullptr) + _offset));
+}
+
+void RTC_PCF8523::enableCountdownTimer(PCF8523TimerClockFreq clkFreq, uint8_t numPeriods,
+                                       uint8_t lowPulseWidth)
+{
+    (void)clkFreq;
+    (void)numPeriods;
+    (void)lowPulseWidth;
+}
+
+void RTC_PCF8523::disableCountdownTimer(void)
+{
+}
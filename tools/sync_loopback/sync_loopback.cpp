@@ -0,0 +1,186 @@
+/**
+ ***************************************************************************************************
+ * @file sync_loopback.cpp
+ * @author Péter Varga
+ * @date 2026. 10. 18.
+ ***************************************************************************************************
+ * @brief Runs the synchronization state machine of the remote module (sync.cpp) on the host.
+ *
+ * The sketch sources of the synchronization, the log, the EEPROM image and the RTC are compiled
+ * unchanged against the shims of this directory, with the loopback transport back end
+ * (transport_loopback.cpp), so every sync talks to the central module stand-in
+ * (tools/central_stub) over real sockets, with the timeouts and resume logic of the firmware.
+ ***************************************************************************************************
+ */
+
+#include <Arduino.h>
+#include <Wire.h>
+
+#include <unistd.h>
+
+#include <algorithm>
+#include <cstdio>
+#include <cstdlib>
+#include <vector>
+
+#include "authenticate_log.h"
+#include "eeprom.h"
+#include "revocation.h"
+#include "rtc.h"
+#include "sync.h"
+
+/**
+ * @brief Pause between two steps of the state machine, like the loop() of the firmware.
+ */
+#define LOOPBACK_STEP_PAUSE_US 100
+
+/**
+ * @brief Options of the run.
+ */
+typedef struct _loopback_config_t
+{
+    uint32_t syncs = 3;           /**< Number of synchronizations. */
+    uint32_t logs = 40;           /**< Logs written before every synchronization. */
+    uint32_t chipId = 0x00C0FFEE; /**< Chip ID reported to the central module. */
+    sync_mode_t mode = SYNC_MODE_FULL; /**< The kind of the synchronizations. */
+} loopback_config_t;
+
+/**
+ * @brief Print the usage of the harness.
+ * @param name The name of the program.
+ */
+static void LOOPBACK_Usage(const char *name)
+{
+    fprintf(stderr,
+            "usage: %s [--syncs N] [--logs N] [--chip-id N] [--mode full|logs|revocation]\n",
+            name);
+}
+
+/**
+ * @brief Write synthetic logs, as if cards were read.
+ * @param count The number of logs.
+ * @param serial The serial of the first log, part of its UID.
+ */
+static void LOOPBACK_WriteLogs(uint32_t count, uint32_t serial)
+{
+    for (uint32_t i = 0; i < count; i++)
+    {
+        uint8_t uid[10] = {0};
+        uint32_t value = serial + i;
+        uid[0] = 0x04;
+        uid[1] = (uint8_t)(value >> 24);
+        uid[2] = (uint8_t)(value >> 16);
+        uid[3] = (uint8_t)(value >> 8);
+        uid[4] = (uint8_t)value;
+        AUTHENTICATE_LOG_WriteLog(uid, RTC_GetTime(), (uint8_t)(i & 1));
+    }
+}
+
+int main(int argc, char **argv)
+{
+    loopback_config_t config;
+    for (int i = 1; i < argc; i++)
+    {
+        bool has_value = (i + 1) < argc;
+        if ((strcmp(argv[i], "--syncs") == 0) && has_value)
+        {
+            config.syncs = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--logs") == 0) && has_value)
+        {
+            config.logs = (uint32_t)atoi(argv[++i]);
+        }
+        else if ((strcmp(argv[i], "--chip-id") == 0) && has_value)
+        {
+            config.chipId = (uint32_t)strtoul(argv[++i], nullptr, 0);
+        }
+        else if ((strcmp(argv[i], "--mode") == 0) && has_value)
+        {
+            i++;
+            if (strcmp(argv[i], "full") == 0)
+            {
+                config.mode = SYNC_MODE_FULL;
+            }
+            else if (strcmp(argv[i], "logs") == 0)
+            {
+                config.mode = SYNC_MODE_LOGS;
+            }
+            else if (strcmp(argv[i], "revocation") == 0)
+            {
+                config.mode = SYNC_MODE_REVOCATION;
+            }
+            else
+            {
+                LOOPBACK_Usage(argv[0]);
+                return 1;
+            }
+        }
+        else
+        {
+            LOOPBACK_Usage(argv[0]);
+            return 1;
+        }
+    }
+
+    ESP.chipId = config.chipId;
+    EEPROM_Init();
+    RTC_Init();
+    AUTHENTICATE_LOG_Init();
+    REVOCATION_Init();
+    SYNC_Init();
+
+    uint32_t failed = 0;
+    uint32_t serial = 0;
+    std::vector<double> syncMs;
+    for (uint32_t sync = 0; sync < config.syncs; sync++)
+    {
+        LOOPBACK_WriteLogs(config.logs, serial);
+        serial += config.logs;
+        EEPROM_MemoryImage_Flush();
+
+        uint32_t pageWrites = Wire.pageWrites;
+        uint32_t steps = 0;
+        unsigned long start = millis();
+        SYNC_Start(config.mode);
+        while (SYNC_Step())
+        {
+            steps++;
+            // The loop writes the committed pages of the EEPROM between the steps
+            if (EEPROM_MemoryImage_IsCommitReady())
+            {
+                EEPROM_MemoryImage_CommitStep();
+            }
+            usleep(LOOPBACK_STEP_PAUSE_US);
+        }
+        unsigned long elapsed = millis() - start;
+        EEPROM_MemoryImage_Flush();
+
+        uint8_t hash[32];
+        AUTHENTICATE_LOG_GetTableHash(hash);
+        printf("sync %u: %s in %lu ms, %u steps, %u page writes, %u logs left, "
+               "table %02x%02x%02x%02x, revocation version %u\n",
+               sync + 1, SYNC_Succeeded() ? "succeeded" : "failed", elapsed, steps,
+               Wire.pageWrites - pageWrites, AUTHENTICATE_LOG_GetLogCount(), hash[0], hash[1],
+               hash[2], hash[3], REVOCATION_GetVersion());
+        sync_stats_t stats;
+        SYNC_GetStats(&stats);
+        if (stats.handshakeMicros > 0)
+        {
+            printf("        %s handshake %u us, crypto %u us for %u bytes\n",
+                   stats.resumed ? "resumed" : "full", stats.handshakeMicros, stats.cryptoMicros,
+                   stats.cryptoBytes);
+        }
+        if (!SYNC_Succeeded())
+        {
+            failed++;
+        }
+        syncMs.push_back((double)elapsed);
+    }
+
+    std::sort(syncMs.begin(), syncMs.end());
+    printf("syncs %u, failed %u, median %.0f ms, max %.0f ms\n", config.syncs, failed,
+           syncMs.empty() ? 0.0 : syncMs[syncMs.size() / 2],
+           syncMs.empty() ? 0.0 : syncMs.back());
+
+    return (failed == 0) ? 0 : 2;
+}